@@ -9,6 +9,7 @@ if [ $# -eq 1 ]
           for i in "q"; do
             echo "./waf --run \"thomasAODV --unit_test_situation --doTest=test_$j.txt --a=$i\""
             ./waf --run "thomasAODV --unit_test_situation --doTest=test_$j.txt --a=$i"
+            python convertQLrnStats.py out_stats_"$i"_node18.bin
             mv out_stats_"$i"_node18.csv out_stats_"$i"_node18_"$j".csv
           done
         done
@@ -5,6 +5,7 @@ if [ $# -eq 1 ]
     for i in "A"; do
       echo "./waf --run \"thomasAODV --unit_test_situation --doTest=test_$1.txt --a=qosq --traffic_miguel_test=voip/traffic$i\""
       ./waf --run "thomasAODV --unit_test_situation --doTest=test_$1.txt --a=qosq --traffic_miguel_test=voip/traffic$i"
+      python convertQLrnStats.py out_stats_qosq_node18.bin
       mv out_stats_qosq_node18.csv out_stats_qosq_node18_$i.csv
       mv qosqroute_t1950_test_$1.txt qosqroute_t1950_test_$1_$i.txt
       mv qosqroute_t950_test_$1.txt qosqroute_t950_test_$1_$i.txt
@@ -0,0 +1,69 @@
+import os,sys
+import struct
+import glob
+
+# Reads the out_stats_<algorithm>_node<id>.bin files written by QLrnStatsSink, and turns them back into the
+# out_stats_<algorithm>_node<id>.csv files plot_jitter_graph.py reads (one line per packet received at the destination).
+
+RECORD = struct.Struct("=QqqqIBB")
+
+LEARNING  = 0x01
+DELAY_OK  = 0x02
+JITTER_OK = 0x04
+LOSS_OK   = 0x08
+
+# as traffic_type_to_traffic_string in q-learner.cc
+TRAFFIC_TYPES = {
+    0 : "Unknown traffic type. (or aodv or icmp)",
+    1 : "ICMP traffic",
+    2 : "WEB traffic",
+    3 : "VOIP / TRAFFIC_A traffic",
+    4 : "VIDEO / TRAFFIC_B traffic",
+    5 : "UDP ECHO traffic",
+    6 : "VOIP / TRAFFIC_A traffic",
+    7 : "VIDEO / TRAFFIC_B traffic",
+    8 : "OTHER / TRAFFIC_C traffic",
+}
+
+CSV_HEADER = "pktID,currTime,delay,initial_estim,learning,metric_delay,metric_jitter,metric_loss,second_to_last_hop,trafficType\n"
+
+def ip_to_str(ip):
+    return "%d.%d.%d.%d" % ((ip >> 24) & 0xff, (ip >> 16) & 0xff, (ip >> 8) & 0xff, ip & 0xff)
+
+def read_stats(filename):
+    """Yields (uid, time_ns, delay_ns, initial_estim_ns, verdict, prev_hop, traffic_type) per received packet."""
+    data = open(filename, "rb").read()
+    if data[:4] != b"QST1":
+        raise(Exception(filename + " is not a statistics file"))
+    pos = 4
+    # a run that died mid-record leaves a partial record at the end, skip it
+    while pos + RECORD.size <= len(data):
+        uid, t, delay, estim, prev_hop, verdict, traffic = RECORD.unpack_from(data, pos)
+        pos += RECORD.size
+        yield (uid, t, delay, estim, verdict, ip_to_str(prev_hop), traffic)
+
+def fixed(value_ns, unit_ns):
+    # times are whole ns, so print them exactly instead of through a float
+    return "%+d.%0*d" % (value_ns // unit_ns, len(str(unit_ns)) - 1, value_ns % unit_ns)
+
+def convert(filename, outname):
+    out = open(outname, "w")
+    out.write(CSV_HEADER)
+    for uid, t, delay, estim, verdict, prev_hop, traffic in read_stats(filename):
+        line = "%d,%ss,%sms,%+d.0ns" % (uid, fixed(t, 1000000000), fixed(delay, 1000000), estim)
+        if verdict & LEARNING:
+            line += ",learning,OK,OK,OK"
+        else:
+            line += ",not_learning"
+            for bit in (DELAY_OK, JITTER_OK, LOSS_OK):
+                line += ",OK" if verdict & bit else ",NOK"
+        out.write(line + "," + prev_hop + "," + TRAFFIC_TYPES[traffic] + "\n")
+    out.close()
+
+if __name__ == "__main__":
+    files = sys.argv[1:] if len(sys.argv) > 1 else glob.glob("out_stats_*.bin")
+    if len(files) == 0:
+        print("No out_stats_*.bin files found.")
+        sys.exit(1)
+    for f in files:
+        convert(f, f[:-4] + ".csv")
@@ -0,0 +1,81 @@
+import os,sys
+import struct
+import glob
+
+# Turns the <ip>_qtable<traffic>.bin recordings written by QTableRecorder back into the
+# <ip>_qtable<traffic>.txt files drawQTables.py reads (one line per sample, the full qtable on every line).
+
+def ip_to_str(ip):
+    return "%d.%d.%d.%d" % ((ip >> 24) & 0xff, (ip >> 16) & 0xff, (ip >> 8) & 0xff, ip & 0xff)
+
+def layout(destinations, neighbours, ips, arrow):
+    out = ""
+    for d in destinations:
+        for n in neighbours:
+            out += ips[('D', d)] + arrow + ips[('N', n)] + ","
+    return out + "\n"
+
+def convert(filename, outname):
+    data = open(filename, "rb").read()
+    if data[:4] != b"QTR1":
+        raise(Exception(filename + " is not a qtable recording"))
+
+    pos = 4
+    destinations = []
+    neighbours = []
+    ips = {}
+    values = {}
+    header_written = False
+    out = open(outname, "w")
+
+    while pos < len(data):
+        tag = data[pos:pos+1]
+        pos += 1
+        if tag == b"D":
+            row, ip = struct.unpack_from("=II", data, pos)
+            pos += 8
+            ips[('D', row)] = ip_to_str(ip)
+            destinations.append(row)
+        elif tag == b"N":
+            col, ip = struct.unpack_from("=II", data, pos)
+            pos += 8
+            ips[('N', col)] = ip_to_str(ip)
+            if col in neighbours:
+                neighbours.remove(col)
+            neighbours.append(col)
+        elif tag == b"R":
+            col, = struct.unpack_from("=I", data, pos)
+            pos += 4
+            if col in neighbours:
+                neighbours.remove(col)
+        elif tag == b"S":
+            t, count = struct.unpack_from("=qI", data, pos)
+            pos += 12
+            for i in range(count):
+                row, col, v = struct.unpack_from("=HHq", data, pos)
+                pos += 12
+                values[(row, col)] = v
+            if not header_written:
+                out.write(layout(destinations, neighbours, ips, " -> "))
+                header_written = True
+            line = "%+d.0ns|" % t
+            for d in destinations:
+                for n in neighbours:
+                    line += "%+d.0ns," % values.get((d, n), 0)
+            out.write(line + "\n")
+        elif tag == b"E":
+            pos += 8
+            out.write(layout(destinations, neighbours, ips, " >> "))
+            break
+        else:
+            raise(Exception("Unknown record '" + repr(tag) + "' in " + filename + " at byte " + str(pos - 1)))
+
+    out.close()
+
+if __name__ == "__main__":
+    files = sys.argv[1:] if len(sys.argv) > 1 else glob.glob("*_qtable*.bin")
+    if len(files) == 0:
+        print("No *_qtable*.bin files found.")
+        sys.exit(1)
+    for f in files:
+        convert(f, f[:-4] + ".txt")
@@ -2,6 +2,7 @@ import os,sys
 import matplotlib.pyplot as plt
 import argparse
 import glob
+import convertQTableRecords
 
 def file_iter(file_ptr):
     while True:
@@ -75,6 +76,11 @@ if __name__ == "__main__":
 
     args = parser.parse_args()
 
+    # the simulation records qtables in binary, convert them first
+    for b in glob.glob("*_qtable_"+args.traffic+".bin"):
+        convertQTableRecords.convert(b, b[:-4] + ".txt")
+        os.remove(b)
+
     if (len(glob.glob("*_qtable_"+args.traffic+".txt") ) == 0 ) :
         if (len(glob.glob("*_qtable_"+args.traffic+"_graph.txt") ) == 0) :
             print "Oops, no QTable files found. Perhaps re-run the ns3 script?\n"
@@ -0,0 +1,112 @@
+import os,sys
+import math
+import random
+
+# Writes the QLearningTests/bench_<layout>_<nodes>.txt scenarios the scaling benchmark runs
+# (./waf --run "QLrnSweep --tests=bench_* --a=q,qosq,aodv --jobs=1"), in the format of the hand written tests.
+#
+#   python generate_bench_scenarios.py [--nodes=50,200,500,1000] [--layouts=grid,random,clustered] [--seed=1338]
+#
+# Only the 50 node scenarios are checked in, run this before benchmarking the larger ones.
+# Every scenario has the usual flow from node0 to the last node plus TRAFFIC events for the other flows, with sources
+# and destinations all different (a QLearner controls one flow of its own and the sinks of a node share the port).
+# Nodes are SPACING m apart on average, which keeps most of them within wifi range of a few others.
+
+SPACING = 80
+LAYOUTS = ["grid", "random", "clustered"]
+NODES = [50, 200, 500, 1000]
+TOTAL_TIME = 100
+FLOWS_START = 10
+FLOW_RATE = 4800
+FLOW_TYPES = ["trafficA", "trafficB", "trafficC"]
+
+HEADER = """{
+  "NameDesc":%s,
+  "Number of nodes":%d,
+  "trafficType":voip/trafficA,
+  "totalTime":%d,
+  "eps":0.2,
+  "learning_rate":0.5,
+  "ideal":false,
+  "learning_phases":true,
+  "smaller_learning_traffic":true,
+"""
+
+def nr_of_flows(n):
+    # the flow from node0 included, one more for every 50 nodes
+    return max(4, n // 50 + 1)
+
+def side(n):
+    return int(math.ceil(math.sqrt(n)))
+
+def grid(n, rng):
+    s = side(n)
+    return [((i % s) * SPACING, (i // s) * SPACING) for i in range(n)]
+
+def uniform(n, rng):
+    size = side(n) * SPACING
+    return [(rng.randint(0, size), rng.randint(0, size)) for i in range(n)]
+
+def clustered(n, rng):
+    # clusters on a coarse grid, close enough for the edges of neighbouring clusters to be in range of each other
+    per_cluster = 25
+    nr_of_clusters = int(math.ceil(n / float(per_cluster)))
+    s = side(nr_of_clusters)
+    radius = 1.5 * SPACING
+    centres = [(radius + (c % s) * 3 * SPACING, radius + (c // s) * 3 * SPACING) for c in range(nr_of_clusters)]
+    ret = []
+    for i in range(n):
+        cx, cy = centres[i % nr_of_clusters]
+        r = radius * math.sqrt(rng.random())
+        a = 2 * math.pi * rng.random()
+        ret.append((int(cx + r * math.cos(a)), int(cy + r * math.sin(a))))
+    return ret
+
+def place(layout, n, rng):
+    locations = {"grid" : grid, "random" : uniform, "clustered" : clustered}[layout](n, rng)
+    # node0 and the last node are the ends of the usual flow, put them in opposite corners
+    locations.sort(key=lambda l: (l[0] + l[1], l[0]))
+    return locations
+
+def flows(n, rng):
+    # InstallEventTraffic does not take the last node, node0 has the usual flow already
+    ends = rng.sample(range(1, n - 1), 2 * (nr_of_flows(n) - 1))
+    for f in range(nr_of_flows(n) - 1):
+        src, dst = ends[2 * f], ends[2 * f + 1]
+        if dst == TOTAL_TIME - FLOWS_START:
+            # the parser takes a destination equal to the duration for a forgotten value
+            src, dst = dst, src
+        yield (src, dst, FLOW_TYPES[f % len(FLOW_TYPES)])
+
+def write(layout, n, seed):
+    rng = random.Random(seed * 10007 + n * 31 + LAYOUTS.index(layout))
+    filename = os.path.join("QLearningTests", "bench_%s_%d.txt" % (layout, n))
+    out = open(filename, "w")
+    out.write(HEADER % ("scaling benchmark - %s layout - %d nodes - %d flows" % (layout, n, nr_of_flows(n)), n, TOTAL_TIME))
+    for i, (x, y) in enumerate(place(layout, n, rng)):
+        out.write('  "node%d":{\n    "x":%d,\n    "y":%d,\n  },\n' % (i, x, y))
+    for src, dst, traffic in flows(n, rng):
+        out.write('  "event":{%d-%d-TRAFFIC-%d-%d-%d-%s},\n' % (FLOWS_START, src, FLOW_RATE, dst, TOTAL_TIME - FLOWS_START, traffic))
+    out.write("}\n")
+    out.close()
+    return filename
+
+def option(name, default):
+    for a in sys.argv[1:]:
+        if a.startswith("--" + name + "="):
+            return a.split("=", 1)[1]
+    return default
+
+if __name__ == "__main__":
+    nodes = [int(n) for n in option("nodes", ",".join(str(n) for n in NODES)).split(",")]
+    layouts = option("layouts", ",".join(LAYOUTS)).split(",")
+    seed = int(option("seed", "1338"))
+    for layout in layouts:
+        if layout not in LAYOUTS:
+            print("Unknown layout " + layout + ", choose from " + ",".join(LAYOUTS))
+            sys.exit(1)
+        for n in nodes:
+            if n < 2 * nr_of_flows(n):
+                print("Need at least " + str(2 * nr_of_flows(n)) + " nodes for " + str(nr_of_flows(n)) + " flows.")
+                sys.exit(1)
+            print(write(layout, n, seed))
@@ -1,9 +1,10 @@
-import sys
+import os,sys
 import argparse
 import numpy as np
 import matplotlib.patches as mpatches
 import matplotlib.pyplot as plt
 from pylab import savefig
+import convertQLrnStats
 
 def file_iter(file_ptr):
     while True:
@@ -15,6 +16,9 @@ def file_iter(file_ptr):
 def create_graph(filename, ignore_learning):
     if (not filename) :
         return [],[],[]
+    # the simulation writes the statistics in binary, convert them first
+    if (not os.path.exists(filename) and os.path.exists(filename[:-4] + ".bin")):
+        convertQLrnStats.convert(filename[:-4] + ".bin", filename)
     data = open(filename, "r")
 
     timestamps = []
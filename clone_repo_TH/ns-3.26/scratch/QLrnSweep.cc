@@ -0,0 +1,459 @@
+#include "ns3/qlrn-test-base.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <set>
+#include <deque>
+#include <map>
+#include <cstring>
+#include <cctype>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <glob.h>
+
+using namespace ns3;
+
+/*
+ * Runs the tests in QLearningTests/ (like QLrnTests) or randomly placed scenarios (like thomasAODV without
+ * --doTest) over a grid of parameters, one forked worker process per run and --jobs workers at a time.
+ *
+ *   ./waf --run "QLrnSweep --tests=0-40,57 --eps=0.0,0.05 --learn=0.3,0.5 --jobs=32"
+ *   ./waf --run "QLrnSweep --numberOfNodes=10,20,40 --traffic=voip,video --totalTime=200 --runs=5"
+ *   ./waf --run "QLrnSweep --tests=bench_* --a=q,qosq,aodv --jobs=1"
+ *
+ * Tests are given by index (test<i>.txt, checked against test<i>_expected_results.txt) or by a name pattern in
+ * QLearningTests/ such as bench_grid_* (the scaling scenarios generate_bench_scenarios.py writes, only the 50 node
+ * ones are checked in, run "python generate_bench_scenarios.py" first for the larger ones). Those have no
+ * expected results, so they are run as a comparison of --a algorithms (as thomasAODV --a= does). Time those in an
+ * optimized build (./waf configure --build-profile=optimized), the asserts of the debug build stop most runs of a
+ * few tens of nodes or more.
+ *
+ * Every finished run is appended to the --report csv right away, with the wall clock and cpu time and peak rss of its
+ * worker and how fast the simulation itself went (simulated seconds and events per wall clock second of
+ * Simulator::Run). Keep --jobs at 1 when those numbers matter, workers compete for the memory bandwidth. Starting
+ * the same sweep again skips the runs that are already in the report, so a sweep that was interrupted (or crashed)
+ * picks up where it left off.
+ * A worker that crashes or exceeds --timeout only costs its own run, which is reported as CRASH / TIMEOUT.
+ *
+ * The rng seed is --seed for every run, the rng run number is the test index + 1 (as in QLrnTests) or 1 for
+ * named tests and scenarios, plus the repetition for --runs > 1. Runs that only differ in the swept parameters
+ * therefore see the same random numbers.
+ */
+
+struct SweepRun {
+  std::string key;
+  int test;                      // -1 for a named test or a scenario run
+  std::string test_name;         // QLearningTests/<test_name>.txt, empty for a scenario run
+  std::map<std::string, std::string> params;
+  uint32_t rng_run;
+};
+
+struct SweepResult {
+  std::string verdict;
+  int exit_status;
+  double wall_s;
+  double cpu_s;
+  long max_rss_kb;
+  double sim_s;                  // of Simulator::Run
+  uint64_t events;
+  double run_wall_s;
+  std::string message;
+};
+
+static std::vector<std::string>
+SplitList (std::string list) {
+  std::vector<std::string> ret;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (!item.empty()) {
+      ret.push_back(item);
+    }
+  }
+  return ret;
+}
+
+// QLearningTests/<pattern>.txt, without the directory and .txt
+static std::vector<std::string>
+FindNamedTests (std::string pattern) {
+  std::vector<std::string> ret;
+  glob_t found;
+  if (glob(("QLearningTests/" + pattern + ".txt").c_str(), 0, 0, &found) == 0) {
+    for (size_t i = 0; i < found.gl_pathc; i++) {
+      std::string path = found.gl_pathv[i];
+      ret.push_back(path.substr(std::strlen("QLearningTests/"), path.size() - std::strlen("QLearningTests/") - 4));
+    }
+  }
+  globfree(&found);
+  if (ret.empty()) {
+    NS_FATAL_ERROR("No test matches QLearningTests/" << pattern << ".txt");
+  }
+  return ret;
+}
+
+// "all", or comma separated test indices and ranges such as "0-20,35", or name patterns such as "bench_grid_*"
+static std::vector<std::pair<int, std::string> >
+ParseTests (std::string list, int nr_of_tests) {
+  std::vector<std::pair<int, std::string> > ret;
+  auto add = [&ret] (int i) { ret.push_back(std::make_pair(i, "test" + std::to_string(i))); };
+  if (list == "all") {
+    for (int i = 0; i < nr_of_tests; i++) {
+      add(i);
+    }
+    return ret;
+  }
+  for (const auto& item : SplitList(list)) {
+    if (!std::isdigit(item[0])) {
+      for (const auto& name : FindNamedTests(item)) {
+        ret.push_back(std::make_pair(-1, name));
+      }
+      continue;
+    }
+    size_t dash = item.find('-');
+    int first = std::stoi(item.substr(0, dash));
+    int last = (dash == std::string::npos ? first : std::stoi(item.substr(dash + 1)));
+    for (int i = first; i <= last; i++) {
+      if (i >= nr_of_tests) {
+        NS_FATAL_ERROR("There is no test" << i << " (found " << nr_of_tests << " tests).");
+      }
+      add(i);
+    }
+  }
+  return ret;
+}
+
+// same search as QLrnTests : test<i>.txt and test<i>_expected_results.txt for increasing i
+static int
+CountTests () {
+  int i = 0;
+  for (; ; i++) {
+    std::stringstream s, ss;
+    s << "QLearningTests/test" << i << ".txt";
+    ss << "QLearningTests/test" << i << "_expected_results.txt";
+    std::ifstream f(s.str());
+    std::ifstream ff(ss.str());
+    if (!f.good() || !ff.good()) {
+      return i;
+    }
+  }
+}
+
+static std::string
+CsvField (std::string s) {
+  std::replace(s.begin(), s.end(), '\n', ' ');
+  std::string ret = "\"";
+  for (auto c : s) {
+    ret += c;
+    if (c == '"') {
+      ret += '"';
+    }
+  }
+  return ret + "\"";
+}
+
+static std::set<std::string>
+ReadFinishedRuns (std::string report) {
+  std::set<std::string> ret;
+  std::ifstream in(report);
+  std::string line;
+  while (std::getline(in, line)) {
+    std::string key = line.substr(0, line.find(','));
+    if (!key.empty() && key != "run") {
+      ret.insert(key);
+    }
+  }
+  return ret;
+}
+
+static const char* SWEEP_PARAMS[] = {"a", "eps", "learn", "gamma", "rho", "traffic", "numberOfNodes"};
+
+static void
+WriteReportLine (std::ofstream& out, const SweepRun& run, const SweepResult& res, uint32_t seed) {
+  out << run.key << "," << run.test_name;
+  for (auto p : SWEEP_PARAMS) {
+    auto it = run.params.find(p);
+    out << "," << (it == run.params.end() ? "" : it->second);
+  }
+  out << "," << seed << "," << run.rng_run << "," << res.verdict << "," << res.exit_status << ","
+      << res.wall_s << "," << res.cpu_s << "," << res.max_rss_kb << "," << res.sim_s << "," << res.events << ","
+      << res.run_wall_s << "," << (res.run_wall_s > 0 ? res.sim_s / res.run_wall_s : 0) << ","
+      << (res.run_wall_s > 0 ? res.events / res.run_wall_s : 0) << "," << CsvField(res.message) << std::endl;
+}
+
+/* Body of a worker process, never returns. Writes its verdict, what RunSimulator measured ("<sim s> <events> <wall s>")
+ * and its message to fd, one line each, and exits with 0 (passed / done), 1 (test failed) or 2 (configuration
+ * failed); anything else the parent sees is a crash. */
+static void
+RunWorker (const SweepRun& run, uint32_t seed, double total_time, int fd) {
+  QLearningBase obj;
+  std::vector<std::string> args = {"QLrnSweep"};
+  if (run.test_name != "") {
+    args.push_back("--unit_test_situation");
+    args.push_back("--doTest=" + run.test_name + ".txt");
+    if (run.params.count("a")) {
+      args.push_back("--a=" + run.params.at("a"));
+    }
+  } else {
+    args.push_back("--numberOfNodes=" + run.params.at("numberOfNodes"));
+    args.push_back("--totalTime=" + std::to_string(total_time));
+  }
+  std::vector<char*> argv;
+  for (auto& a : args) {
+    argv.push_back(&a[0]);
+  }
+
+  std::string verdict = "CONFIG_FAILED", message = "";
+  int code = 2;
+  if (obj.Configure(argv.size(), argv.data())) {
+    // Configure sets the seed itself, so pin it afterwards
+    RngSeedManager::SetSeed(seed);
+    RngSeedManager::SetRun(run.rng_run);
+    for (const auto& p : run.params) {
+      if (p.first == "eps") { obj.SetEps(std::stof(p.second)); }
+      else if (p.first == "learn") { obj.SetLearningRate(std::stof(p.second)); }
+      else if (p.first == "gamma") { obj.SetGamma(std::stof(p.second)); }
+      else if (p.first == "rho") { obj.SetRho(std::stof(p.second)); }
+      else if (p.first == "traffic") { obj.SetTraffic(p.second); }
+    }
+    if (run.test_name != "") {
+      if (total_time > 0) {
+        obj.SetTotalTime(total_time);
+      }
+      bool passed = obj.RunTest(message);
+      verdict = (passed ? "PASS" : "FAIL");
+      code = (passed ? 0 : 1);
+    } else {
+      code = obj.Run();
+      verdict = (code == 0 ? "DONE" : "FAIL");
+    }
+  }
+  // the pipe buffer must hold the whole message, the parent only reads it once we exited
+  std::stringstream measured;
+  measured << obj.GetRunSimSeconds() << " " << obj.GetRunEvents() << " " << obj.GetRunWallSeconds();
+  std::string out = verdict + "\n" + measured.str() + "\n" + message.substr(0, 4000);
+  if (write(fd, out.c_str(), out.size()) < 0) {
+    code = 3;
+  }
+  close(fd);
+  _exit(code);
+}
+
+int
+main (int argc, char *argv[])
+{
+  CommandLine cmd;
+  std::string tests = "all";
+  std::string algorithms = "", eps = "", learn = "", gamma = "", rho = "", traffic = "", numberOfNodes = "";
+  std::string report = "qlrn_sweep_report.csv";
+  std::string log_dir = "";
+  uint32_t jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t seed = 1338;
+  uint32_t runs = 1;
+  uint32_t timeout = 0;
+  double totalTime = 0;
+  cmd.AddValue ("tests", "tests of QLearningTests/ to run : all, or indices and ranges such as 0-20,35, or name patterns such as bench_grid_* (ignored when numberOfNodes is set)", tests);
+  cmd.AddValue ("a", "comma separated algorithms (q, qosq, aodv) to compare the tests with instead of checking their expected results", algorithms);
+  cmd.AddValue ("numberOfNodes", "comma separated node counts, runs randomly placed scenarios instead of the tests", numberOfNodes);
+  cmd.AddValue ("eps", "comma separated epsilon values (default : the one of the test / scenario)", eps);
+  cmd.AddValue ("learn", "comma separated learning rates", learn);
+  cmd.AddValue ("gamma", "comma separated gamma values", gamma);
+  cmd.AddValue ("rho", "comma separated rho values", rho);
+  cmd.AddValue ("traffic", "comma separated traffic types (voip, video, web, ping, trafficA/trafficB, ...)", traffic);
+  cmd.AddValue ("totalTime", "simulated seconds per run (default : the time of the test, required for scenarios)", totalTime);
+  cmd.AddValue ("runs", "repetitions of every combination, with consecutive rng run numbers", runs);
+  cmd.AddValue ("seed", "rng seed of every run", seed);
+  cmd.AddValue ("jobs", "number of worker processes running at the same time", jobs);
+  cmd.AddValue ("timeout", "wall clock seconds after which a worker is killed, 0 = never", timeout);
+  cmd.AddValue ("report", "csv file the results are appended to, runs already in it are skipped", report);
+  cmd.AddValue ("logDir", "existing directory for the output of every run (default : discard it)", log_dir);
+  cmd.Parse (argc, argv);
+
+  Time::SetResolution (Time::NS);
+  NS_ASSERT_MSG(jobs > 0 && runs > 0, "Need at least one job and one run.");
+  NS_ASSERT_MSG(numberOfNodes == "" || totalTime > 0, "Scenario runs need a --totalTime.");
+
+  // every combination of the grid, only the swept parameters end up in the run key
+  std::vector<std::map<std::string, std::string> > grid(1);
+  std::map<std::string, std::string> lists = {{"a", algorithms}, {"eps", eps}, {"learn", learn}, {"gamma", gamma}, {"rho", rho},
+                                              {"traffic", traffic}, {"numberOfNodes", numberOfNodes}};
+  for (auto p : SWEEP_PARAMS) {
+    std::vector<std::string> values = SplitList(lists[p]);
+    if (values.empty()) {
+      continue;
+    }
+    std::vector<std::map<std::string, std::string> > next;
+    for (const auto& point : grid) {
+      for (const auto& v : values) {
+        next.push_back(point);
+        next.back()[p] = v;
+      }
+    }
+    grid.swap(next);
+  }
+
+  std::vector<std::pair<int, std::string> > test_list = {std::make_pair(-1, std::string(""))};
+  if (numberOfNodes == "") {
+    test_list = ParseTests(tests, CountTests());
+  }
+  for (const auto& test : test_list) {
+    if (test.first < 0 && test.second != "" && algorithms == "") {
+      NS_FATAL_ERROR(test.second << " has no expected results, run it with --a=q,qosq,aodv (or a part of those).");
+    }
+  }
+
+  std::set<std::string> finished = ReadFinishedRuns(report);
+  std::deque<SweepRun> todo;
+  uint32_t nr_of_runs = 0;
+  for (auto test : test_list) {
+    for (const auto& point : grid) {
+      for (uint32_t r = 0; r < runs; r++) {
+        SweepRun run;
+        run.test = test.first;
+        run.test_name = test.second;
+        run.params = point;
+        run.rng_run = (test.first >= 0 ? test.first + 1 : 1) + r;
+        std::stringstream key;
+        key << (test.second != "" ? test.second : "scenario");
+        for (auto p : SWEEP_PARAMS) {
+          if (point.count(p)) {
+            key << "|" << p << "=" << point.at(p);
+          }
+        }
+        if (runs > 1) {
+          key << "|run=" << r;
+        }
+        run.key = key.str();
+        nr_of_runs++;
+        if (!finished.count(run.key)) {
+          todo.push_back(run);
+        }
+      }
+    }
+  }
+
+  bool new_report = finished.empty() && !std::ifstream(report).good();
+  std::ofstream out(report, std::ios::app);
+  NS_ASSERT_MSG(out.is_open(), "Could not open " << report << ".");
+  if (new_report) {
+    out << "run,test";
+    for (auto p : SWEEP_PARAMS) {
+      out << "," << p;
+    }
+    out << ",seed,rngRun,verdict,exitStatus,wall_s,cpu_s,maxRss_kB,simTime_s,events,runWall_s,simSecondsPerWallSecond,eventsPerSecond,message" << std::endl;
+  }
+
+  std::cout << nr_of_runs << " run(s), " << nr_of_runs - todo.size() << " already in " << report << ", running "
+            << todo.size() << " on " << jobs << " worker(s)." << std::endl;
+
+  struct Worker { SweepRun run; int fd; timeval start; };
+  std::map<pid_t, Worker> workers;
+  std::map<std::string, uint32_t> totals;
+  uint32_t done = 0, nr_to_do = todo.size();
+
+  while (!todo.empty() || !workers.empty()) {
+    while (!todo.empty() && workers.size() < jobs) {
+      SweepRun run = todo.front();
+      todo.pop_front();
+      int fds[2];
+      if (pipe(fds) != 0) {
+        NS_FATAL_ERROR("pipe failed : " << strerror(errno));
+      }
+      std::cout.flush();
+      Worker w = {run, fds[0], timeval()};
+      gettimeofday(&w.start, 0);
+      pid_t pid = fork();
+      if (pid < 0) {
+        NS_FATAL_ERROR("fork failed : " << strerror(errno));
+      }
+      if (pid == 0) {
+        close(fds[0]);
+        std::string name = run.key;
+        std::replace(name.begin(), name.end(), '|', '_');
+        std::string log = (log_dir == "" ? "/dev/null" : log_dir + "/" + name + ".log");
+        int log_fd = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (log_fd >= 0) {
+          dup2(log_fd, STDOUT_FILENO);
+          dup2(log_fd, STDERR_FILENO);
+          close(log_fd);
+        }
+        if (timeout > 0) {
+          alarm(timeout);
+        }
+        RunWorker(run, seed, totalTime, fds[1]);
+      }
+      close(fds[1]);
+      workers[pid] = w;
+    }
+
+    int status = 0;
+    rusage usage;
+    pid_t pid = wait4(-1, &status, 0, &usage);
+    if (pid < 0) {
+      if (errno != EINTR) {
+        NS_FATAL_ERROR("wait4 failed : " << strerror(errno));
+      }
+      continue;
+    }
+    auto it = workers.find(pid);
+    if (it == workers.end()) {
+      continue;
+    }
+    Worker w = it->second;
+    workers.erase(it);
+
+    timeval now;
+    gettimeofday(&now, 0);
+    SweepResult res;
+    res.wall_s = (now.tv_sec - w.start.tv_sec) + (now.tv_usec - w.start.tv_usec) / 1e6;
+    res.cpu_s = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    res.max_rss_kb = usage.ru_maxrss;
+    res.sim_s = 0;
+    res.events = 0;
+    res.run_wall_s = 0;
+
+    std::string from_worker;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(w.fd, buf, sizeof(buf))) > 0) {
+      from_worker.append(buf, n);
+    }
+    close(w.fd);
+
+    if (WIFEXITED(status)) {
+      res.exit_status = WEXITSTATUS(status);
+      size_t nl = from_worker.find('\n');
+      size_t nl2 = (nl == std::string::npos ? nl : from_worker.find('\n', nl + 1));
+      res.verdict = (nl2 == std::string::npos ? "CRASH" : from_worker.substr(0, nl));
+      if (nl2 != std::string::npos) {
+        std::stringstream measured(from_worker.substr(nl + 1, nl2 - nl - 1));
+        measured >> res.sim_s >> res.events >> res.run_wall_s;
+        res.message = from_worker.substr(nl2 + 1);
+      }
+    } else {
+      res.exit_status = -WTERMSIG(status);
+      res.verdict = (WTERMSIG(status) == SIGALRM ? "TIMEOUT" : "CRASH");
+      res.message = strsignal(WTERMSIG(status));
+    }
+    WriteReportLine(out, w.run, res, seed);
+    totals[res.verdict]++;
+    done++;
+    std::cout << "[" << done << "/" << nr_to_do << "] " << w.run.key << " : " << res.verdict << " (" << res.wall_s << " s";
+    if (res.run_wall_s > 0) {
+      std::cout << ", " << res.sim_s / res.run_wall_s << " sim s/s, " << res.events / res.run_wall_s << " events/s, "
+                << res.max_rss_kb / 1024 << " MB";
+    }
+    std::cout << ")" << std::endl;
+  }
+
+  std::cout << "Ran " << done << " run(s).";
+  for (const auto& t : totals) {
+    std::cout << " [" << t.first << "]: " << t.second;
+  }
+  std::cout << "\nResults are in " << report << "." << std::endl;
+  return 0;
+}
@@ -22,7 +22,6 @@ main (int argc, char *argv[])
   if (TEST_GOING_WRONG != -2) { std::cout << "Focusing on test case" << TEST_GOING_WRONG << "...:\n"; }
 
   Time::SetResolution (Time::NS);
-  Packet::EnablePrinting();
 
   // Since std::filesystem isn't usable (it seems), and in the interest of saving time
   // we will simply use this method that just checks files in the directory with increasing
@@ -88,7 +88,6 @@ main (int argc, char *argv[])
     {
       NS_FATAL_ERROR ("Configuration failed. Aborted.");
     }
-    Packet::EnablePrinting();
 
     // Config::SetDefault ("ns3::WifiRemoteStationManager::FragmentationThreshold",
     //                     StringValue ("2200"));
@@ -302,7 +302,6 @@ class ThomasAODV:
         os.close()
 
 if __name__ == "__main__":
-    ns.network.Packet.EnablePrinting();
     obj = ThomasAODV()
     if ( not obj.Configure (sys.argv) ):
         NS_FATAL_ERROR ("Configuration failed. Aborted.");
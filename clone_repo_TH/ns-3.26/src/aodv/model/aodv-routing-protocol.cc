@@ -171,7 +171,7 @@ RoutingProtocol::RoutingProtocol () :
   m_lastBcastTime (Seconds (0))
 {
   m_nb.SetCallback (MakeCallback (&RoutingProtocol::SendRerrWhenBreaksLinkToNextHop, this));
-  m_output_filestream = 0;
+  m_stats_sink = 0;
   m_traffic_destinations = std::vector<Ipv4Address>();
   m_running_avg_latency = std::make_pair<int,float>(0,0);
   m_prev_delay = 0;
@@ -358,7 +358,7 @@ void RoutingProtocol::UpdateAvgDelay(PacketTimeSentTag ptst_tag, PortNrTag pnt)
 void RoutingProtocol::OutputDataToFile(PacketTimeSentTag ptst_tag, Ptr<const Packet> p, bool learning_packet, TrafficType t, Ipv4Address sourceIP) {
   // p->Print(std::cout);std::cout<<std::endl;
   PortNrTag pnt;
-  NS_ASSERT(p->PeekPacketTag(pnt) || CheckAODVHeader(p));
+  NS_ASSERT(QRoutingTag::Get(p).Peek(pnt) || CheckAODVHeader(p));
 
   uint64_t currDelay = (Simulator::Now() - ptst_tag.GetSentTime()).GetInteger();
 
@@ -370,26 +370,16 @@ void RoutingProtocol::OutputDataToFile(PacketTimeSentTag ptst_tag, Ptr<const Pac
   float total_traffic_sent_to_me = float(pnt.GetPktNumber() + (!pnt.GetLearningPkt() ? 1 : 0)) /*because 1/0 is undefined, we add one (pkt number is 0-index)*/ ;
   float packet_loss = 1 - total_traffic_recv_by_me / (pnt.GetLearningPkt() ? total_traffic_recv_by_me : total_traffic_sent_to_me);
 
-  bool delay_ok = currDelay < TrafficTypeReqsMap[t].GetDelayMax();
-  bool jitter_ok = jitter_val < TrafficTypeReqsMap[t].GetJitterMax();
-  bool packet_loss_ok = packet_loss< TrafficTypeReqsMap[t].GetRandomLossMax();
+  bool delay_ok = currDelay < GetTrafficRequirements(t).GetDelayMax();
+  bool jitter_ok = jitter_val < GetTrafficRequirements(t).GetJitterMax();
+  bool packet_loss_ok = packet_loss< GetTrafficRequirements(t).GetRandomLossMax();
 
   NS_ASSERT_MSG(IamAmongTheDestinations(), "Not an intended destination, so why is it outputting as if it is ? " << m_ipv4->GetAddress(1,0).GetLocal());
 
-  *(m_output_filestream->GetStream()) << p->GetUid() << "," << Simulator::Now().As(Time::S) << ","
-          << (Simulator::Now() - ptst_tag.GetSentTime()).As(Time::MS) << "," << ptst_tag.GetInitialEstim();
-  if (learning_packet)  { *(m_output_filestream->GetStream()) << ",learning,OK,OK,OK"; }
-  else                  {
-    *(m_output_filestream->GetStream()) << ",not_learning"
-        << (delay_ok?",OK":",NOK")
-        << (jitter_ok?",OK":",NOK")
-        << (packet_loss_ok?",OK":",NOK");
-  }
-  // else                  { *(m_output_filestream->GetStream()) << ",not_learning"<< (delay_ok&&jitter_ok&&packet_loss_ok?",OK":",NOK"); }
-  *(m_output_filestream->GetStream()) << "," << ptst_tag.GetPrevHop();
-  *(m_output_filestream->GetStream()) << "," << traffic_type_to_traffic_string(t) << "\n";
-
-  (m_output_filestream->GetStream())->flush();
+  uint8_t verdict = (learning_packet ? QLrnStatsSink::LEARNING : 0) | (delay_ok ? QLrnStatsSink::DELAY_OK : 0)
+                    | (jitter_ok ? QLrnStatsSink::JITTER_OK : 0) | (packet_loss_ok ? QLrnStatsSink::LOSS_OK : 0);
+  m_stats_sink->Record(p->GetUid(), Simulator::Now(), Simulator::Now() - ptst_tag.GetSentTime(), ptst_tag.GetInitialEstim(),
+                       verdict, ptst_tag.GetPrevHop(), t);
 }
 
 
@@ -409,6 +399,11 @@ RoutingProtocol::DoDispose ()
       iter->first->Close ();
     }
   m_socketSubnetBroadcastAddresses.clear ();
+  if (m_stats_sink)
+    {
+      m_stats_sink->Close ();
+      m_stats_sink = 0;
+    }
   Ipv4RoutingProtocol::DoDispose ();
 }
 
@@ -490,6 +485,13 @@ bool RoutingProtocol::CheckIcmpTTLExceeded(Ptr<const Packet> p, Icmpv4TimeExceed
 }
 
 void RoutingProtocol::CheckTraffic(Ptr<const Packet> p, TrafficType& t) {
+  QRoutingTag qrt = QRoutingTag::Get(p);
+  TrafficTypeTag ttt;
+  if (qrt.Peek(ttt)) {
+    t = ttt.GetTrafficType();
+    return;
+  }
+
   Icmpv4Header i;
   Icmpv4TimeExceeded ii;
   UdpHeader u;
@@ -497,7 +499,7 @@ void RoutingProtocol::CheckTraffic(Ptr<const Packet> p, TrafficType& t) {
 
   p->PeekHeader(i);
   p->PeekHeader(u);
-  p->PeekPacketTag(pnt);
+  qrt.Peek(pnt);
 
   if ((i.GetType() == 0 || i.GetType() == 3 || i.GetType() == 5 || i.GetType() == 8 || i.GetType() == 11) && pnt.GetDstPort() == 0)   {
     p->PeekHeader(ii);
@@ -535,7 +537,7 @@ void RoutingProtocol::CheckTraffic(Ptr<const Packet> p, TrafficType& t) {
               || i.GetType() == 12 || i.GetType() == 13 || i.GetType() == 14 || i.GetType() == 15
               || i.GetType() == 16 || i.GetType() == 18 || i.GetType() == 17 || i.GetType() == 130) {
     NS_LOG_ERROR("confused packet::");
-    std::stringstream ss; p->Print(ss); NS_LOG_ERROR(ss.str());
+    NS_LOG_ERROR(*p);
     NS_ASSERT_MSG(false, "weird icmp");
   } else {
     //Will be printed in the else { } below
@@ -544,6 +546,13 @@ void RoutingProtocol::CheckTraffic(Ptr<const Packet> p, TrafficType& t) {
     NS_ASSERT(t == OTHER);
   }
   // p->Print(std::cout<<std::endl);std::cout<< "   ttype:" << traffic_type_to_traffic_string(t) <<std::endl;
+
+  // Packets carrying a PortNrTag were classified on their port and keep that class on every hop, so remember it.
+  // Untagged ones (AODV, ICMP, ...) are told apart by their size, which depends on where we look at them, so no caching there.
+  if (pnt.GetDstPort() != 0) {
+    qrt.Set(TrafficTypeTag(t));
+    qrt.Store(p);
+  }
   return;
 }
 
@@ -555,14 +564,14 @@ void RoutingProtocol::CorrectPacketTrackingOutput(Ptr<const Packet> p, Ipv4Heade
   TrafficType t = OTHER;
 
   CheckTraffic(p, t);
-  p->PeekPacketTag(pnt);
+  QRoutingTag::Get(p).Peek(pnt);
   if ( t == ICMP || t == VIDEO || t == WEB || t == VOIP || t == UDP_ECHO || t == TRAFFIC_A || t == TRAFFIC_B || t == TRAFFIC_C ) {
     if (pnt.GetLearningPkt()) {
       m_learning_packets_sent -= 1;
     } else {
       m_traffic_packets_sent -= 1;
     }
-  } else if (m_qlearner && (m_qlearner->CheckQLrnHeader(p,q) || m_qlearner->CheckQLrnHeader(p,qosq))){ NS_ASSERT_MSG(false, "Ideally this would only happen for traffic packets.(1)");
+  } else if (m_qlearner && (m_qlearner->CheckQLrnFeedback(p, true) || m_qlearner->CheckQLrnHeader(p,q) || m_qlearner->CheckQLrnHeader(p,qosq))){ NS_ASSERT_MSG(false, "Ideally this would only happen for traffic packets.(1)");
   } else if (CheckAODVHeader(p)) { NS_ASSERT_MSG(false, "Ideally this would only happen for traffic packets (2)).");
   } else if (m_qlearner == 0) {
     return;
@@ -594,10 +603,10 @@ void RoutingProtocol::PacketTrackingOutput(Ptr<const Packet> p, Ipv4Header heade
   CheckTraffic(p, t);
 
   bool HasQLrnHeader = false;
-  if (m_qlearner) { HasQLrnHeader = (m_qlearner->CheckQLrnHeader(p,q) || m_qlearner->CheckQLrnHeader(p,qosq)); }
+  if (m_qlearner) { HasQLrnHeader = (m_qlearner->CheckQLrnFeedback(p, true) || m_qlearner->CheckQLrnHeader(p,q) || m_qlearner->CheckQLrnHeader(p,qosq)); }
 
   if ( t == ICMP || t == VIDEO || t == WEB || t == VOIP || t == UDP_ECHO || t == TRAFFIC_A || t == TRAFFIC_B || t == TRAFFIC_C ) {
-    p->PeekPacketTag(pnt);
+    QRoutingTag::Get(p).Peek(pnt);
     if (pnt.GetLearningPkt()){ m_learning_packets_sent += 1; }
     else { m_traffic_packets_sent += 1; /* p->Print(std::cout<<std::endl);*/  }
   } else if (HasQLrnHeader) {
@@ -625,13 +634,43 @@ void RoutingProtocol::PacketTrackingOutput(Ptr<const Packet> p, Ipv4Header heade
     }
   }
 }
+void RoutingProtocol::TxAccounting(Ptr<const Packet> p) {
+  // Traffic with a PortNrTag was already counted on the routing output, so that is left alone.
+  PortNrTag pnt;
+  QRoutingTag::Get(p).Peek(pnt);
+  if (pnt.GetDstPort() != 0) {
+    return;
+  }
+  Ipv4Header ipHeader;
+  p->PeekHeader(ipHeader);
+  if (ipHeader.GetSource() != m_ipv4->GetAddress(1,0).GetLocal()) {
+    return;
+  }
+
+  // The udp ports sit right behind the ip header, read them in place instead of peeking them on a copy
+  uint8_t start[64] = {0};
+  uint32_t ports_at = ipHeader.GetSerializedSize();
+  p->CopyData(start, std::min<uint32_t>(p->GetSize(), ports_at + 4));
+  uint16_t src_port = (start[ports_at] << 8) | start[ports_at + 1];
+  uint16_t dst_port = (start[ports_at + 2] << 8) | start[ports_at + 3];
+  // Not 654 (AODV) or 404 (QLRN) or 0 (ICMP ? ), those are counted elsewhere.
+  // 9998 is left out s.t. udp-echo tests work, otherwise that traffic would be counted twice.
+  if (dst_port == 654 || dst_port == 404 || dst_port == 0 || dst_port == 9998 || src_port == 9998) {
+    return;
+  }
+
+  Ptr<Packet> p_copy = p->Copy();
+  p_copy->RemoveHeader(ipHeader);
+  PacketTrackingOutput(p_copy);
+}
+
 void RoutingProtocol::PacketTrackingInput(Ptr<const Packet> p, Ipv4Header header) {
   // packet reaches us
   TrafficType t = OTHER;
   PortNrTag pnt;
   QLrnInfoTag tagg; //part of method2
 
-  p->PeekPacketTag(pnt);
+  QRoutingTag::Get(p).Peek(pnt);
 
   CheckTraffic(p,t);
 
@@ -644,7 +683,6 @@ void RoutingProtocol::PacketTrackingInput(Ptr<const Packet> p, Ipv4Header header
 
     //Deferred output now also passes here, so we dont count that as we have already counted it in the regular transmission fct
     DeferredRouteOutputTag tag; //or we will be off-by-one for every deferred output
-    std::stringstream ss; p->Print(ss);
 
    /*
     * 2 methods shown below, first uses PNT markings to decide if a packet is learning traffic or not whiel second method looks only at QLrnInfoTag.
@@ -703,9 +741,8 @@ RoutingProtocol::Start ()
   // TraceConnectWithoutContext ("Rx", MakeCallback(&RoutingProtocol::Packet TrackingInput , this  ));
 
   if (m_output_data_to_file && IamAmongTheDestinations() ) {
-    std::stringstream ss; ss << "out_stats_aodv_node"<<m_ipv4->GetObject<Node> ()->GetId ()<<".csv";
-    m_output_filestream = Create<OutputStreamWrapper> (ss.str(), std::ios::out);
-    *(m_output_filestream->GetStream ()) << "pktID,currTime,delay,initial_estim,learning,metric_delay,metric_jitter,metric_loss,second_to_last_hop,trafficType\n";
+    std::stringstream ss; ss << "out_stats_aodv_node"<<m_ipv4->GetObject<Node> ()->GetId ()<<".bin";
+    m_stats_sink = Create<QLrnStatsSink> (ss.str());
   }
 
   NS_LOG_FUNCTION (this);
@@ -735,10 +772,14 @@ RoutingProtocol::RouteOutput (Ptr<Packet> p, const Ipv4Header &header,
   PacketTimeSentTag ptst_tag;
   if (m_qlearner) {
     m_qlearner->HandleRouteOutput(p, header, t);
-  } else if (!m_qlearner && !(p->PeekPacketTag(ptst_tag) ) ) {
-    ptst_tag.SetPrevHop(m_ipv4->GetAddress(1,0).GetLocal());
-    ptst_tag.SetSentTime(Simulator::Now().GetInteger());
-    p->AddPacketTag(ptst_tag);
+  } else {
+    QRoutingTag qrt = QRoutingTag::Get(p);
+    if (!qrt.Peek(ptst_tag)) {
+      ptst_tag.SetPrevHop(m_ipv4->GetAddress(1,0).GetLocal());
+      ptst_tag.SetSentTime(Simulator::Now().GetInteger());
+      qrt.Set(ptst_tag);
+      qrt.Store(p);
+    }
   }
 
   if (!p)
@@ -802,7 +843,7 @@ RoutingProtocol::RouteOutput (Ptr<Packet> p, const Ipv4Header &header,
   PortNrTag pnt;
 
   NS_LOG_DEBUG ("Valid Route not found, sending it to LoopBackRoute with a DeferredOutputTag  pktid:" << p->GetUid()) ;
-  p->PeekPacketTag(pnt);
+  QRoutingTag::Get(p).Peek(pnt);
   if (!p->PeekPacketTag (tag)) {
       if (pnt.GetLearningPkt() ){
         // drop it  / code taken from no aodv interfaces / dont waste time enqueueing it.
@@ -830,8 +871,7 @@ RoutingProtocol::DeferredRouteOutput (Ptr<const Packet> p, const Ipv4Header & he
 
   if (header.GetDestination() == m_ipv4->GetAddress(1,0).GetLocal()) {
       // std::cout << "dropping packet because its deferred and the destination is ourselves..?" << std::endl;
-      std::stringstream ss; p->Print(ss);
-      NS_LOG_DEBUG("Dropping a packet because it was deferred output and the destination is ourselves.\n" << ss.str());
+      NS_LOG_DEBUG("Dropping a packet because it was deferred output and the destination is ourselves.\n" << *p);
       return;
   }
 
@@ -906,12 +946,14 @@ RoutingProtocol::RouteInput (Ptr<const Packet> _p, const Ipv4Header &header,
     m_qlearner->HandleRouteInput(p, header, p->PeekPacketTag(tag), randomDecidedDuplicate, t);
     if (p->PeekPacketTag(dpt)){
       if ( dpt.GetDrop() ) {
-        std::stringstream ss; p->Print(ss << std::endl);
-        NS_LOG_DEBUG("Dropping a pkt " << ss.str());
+        NS_LOG_DEBUG("Dropping a pkt " << std::endl << *p);
         return true; //drop the learning packet that isnt needed anymore bc upstream is converged
       }
     }
-  } else if (p->PeekPacketTag(ptst_tag) && p->PeekPacketTag(pnt) && IamAmongTheDestinations() ){
+  }
+  // (after HandleRouteInput, which may have changed it)
+  QRoutingTag qrt = QRoutingTag::Get(p);
+  if (!m_qlearner && qrt.Peek(ptst_tag) && qrt.Peek(pnt) && IamAmongTheDestinations() ){
     // the IamAmongTheDestinations in the if can be removed, then all nodes keep a notion of avg delay...
     // std::stringstream ss; p->Print(ss<<std::endl); NS_LOG_UNCOND("node" << m_ipv4->GetObject<Node>()->GetId() << "\n" << ss.str());
     // std::cout <<(p->PeekPacketTag(ptst_tag) ? " has a ptst_tag": "does not have a ptst tag") << "\n";
@@ -950,10 +992,10 @@ RoutingProtocol::RouteInput (Ptr<const Packet> _p, const Ipv4Header &header,
     // If we're QLearning, we must allow some room for error, thus dont automatically drop duplicates please
     if (randomDecidedDuplicate) {
       NS_LOG_DEBUG ("QLRN-not dropping a packet b/c we sent it, then received it back with random. pktId:" << p->GetUid());
-    } else if (p->PeekPacketTag(tagg)) {
+    } else if (qrt.Peek(tagg)) {
       NS_LOG_DEBUG ("QLRN-not dropping a packet b/c we sent it, then received it but QTag is there, bad decision?? UPDATE OF Q ??. pktId:" << p->GetUid());
       NS_LOG_DEBUG ("IE MAYBE SET A BOOL OR SO TO MAKE A HIGHER ESTIMATE GO BACK TO NEXT HOP");
-    } else if (p->PeekPacketTag(q_rt_pkt_tag)) {
+    } else if (qrt.Peek(q_rt_pkt_tag)) {
       if (q_rt_pkt_tag.PacketIsQRouted()) { } // fine, dont drop
       else {
         NS_LOG_UNCOND ("Dropping a packet.");
@@ -1069,7 +1111,7 @@ RoutingProtocol::RouteInput (Ptr<const Packet> _p, const Ipv4Header &header,
           lcb (p, header, iif);
 
           if (!m_qlearner && m_output_data_to_file) {
-            PacketTimeSentTag ptst_tag; bool has_ptst_tag = p->PeekPacketTag(ptst_tag);
+            PacketTimeSentTag ptst_tag; bool has_ptst_tag = QRoutingTag::Get(p).Peek(ptst_tag);
             bool is_aodv_traffic = CheckAODVHeader(p);
             if (!has_ptst_tag && !is_aodv_traffic) {
               NS_FATAL_ERROR("should at least be either AODV or have a tag");
@@ -1100,10 +1142,12 @@ RoutingProtocol::RouteInput (Ptr<const Packet> _p, const Ipv4Header &header,
 
   if (!m_qlearner) {
     PacketTimeSentTag ptst_tag;
-    NS_ASSERT(p->PeekPacketTag(ptst_tag));
-    p->RemovePacketTag(ptst_tag);
+    QRoutingTag qrt = QRoutingTag::Get(p);
+    NS_ASSERT(qrt.Peek(ptst_tag));
+    qrt.Remove(ptst_tag);
     ptst_tag.SetPrevHop(m_ipv4->GetAddress(1,0).GetLocal());
-    p->AddPacketTag(ptst_tag);
+    qrt.Set(ptst_tag);
+    qrt.Store(p);
   }
 
   // Forwarding
@@ -1128,7 +1172,7 @@ RoutingProtocol::Forwarding (Ptr<const Packet> _p, const Ipv4Header & header,
     NS_ASSERT_MSG(m_qlearner->CheckDestinationKnown(dst), "Destination " << dst << " was not known for QLearner in forwarding function at node "<< m_qlearner->GetNode()->GetId() <<".");
     QLrnHeader q;
     QoSQLrnHeader qosq;
-    if (m_qlearner->CheckQLrnHeader(p,q) || m_qlearner->CheckQLrnHeader(p, qosq)) {
+    if (m_qlearner->CheckQLrnFeedback(p, true) || m_qlearner->CheckQLrnHeader(p,q) || m_qlearner->CheckQLrnHeader(p, qosq)) {
       NS_LOG_DEBUG("We received a QLRN packet not destined for us and tried to forward it, most likely we received it by accident. Drop." );
       return true;
     }
@@ -1150,13 +1194,13 @@ RoutingProtocol::Forwarding (Ptr<const Packet> _p, const Ipv4Header & header,
               // In that case, the agent only explores 100*eps % of the time and that can be any random node
               // NS_FATAL_ERROR("I dont think this actually ever happens because if we have to forward a packet we should indeed also have a neighbour to use.");
               //Drop it, no neighbours = no routes...
-              std::stringstream ss; p->Print(ss<<std::endl<<p->GetUid()<< " ");
               Icmpv4TimeExceeded ii;
-              PortNrTag pnt; p->PeekPacketTag(pnt);
+              PortNrTag pnt; QRoutingTag::Get(p).Peek(pnt);
               NS_ASSERT_MSG(
                 ((p->GetSize( ) == 180 || p->GetSize() == 308) && pnt.GetLearningPkt()) ||
                  CheckIcmpTTLExceeded(p, ii)
-                 , "[AODV node " << m_ipv4->GetObject<Node> ()->GetId () << "] " << "this should only be learning traffic right? otherwise (if no neighbours) we shouldnt get this far!" << ss.str());
+                 , "[AODV node " << m_ipv4->GetObject<Node> ()->GetId () << "] " << "this should only be learning traffic right? otherwise (if no neighbours) we shouldnt get this far!"
+                 << std::endl << p->GetUid() << " " << *p);
               // this is wrong actually I think ! only has a point if we're not the source of the packet & the intermediate nodes can decide to drop packets
               m_nr_of_lrn_dropped += 1; // to verify wireshark pkt count with lrn_rec + lrn_sent at node0
               return true;
@@ -1284,7 +1328,7 @@ RoutingProtocol::Forwarding (Ptr<const Packet> _p, const Ipv4Header & header,
 
   NS_LOG_DEBUG ("Route not found to "<< dst << ". Send RERR message. Drop packet " << p->GetUid () << " because no route to forward it_2.");
   NS_LOG_DEBUG("Route:" << *(toDst.GetRoute()) << "   " << toDst.GetFlag() << " (0 is valid___)    " << toDst.GetLifeTime().As(Time::S) << "  " << toDst.GetInterface() );
-  std::stringstream ss;p->Print(ss);NS_LOG_DEBUG(ss.str() << "\nat time " << Simulator::Now().As(Time::S));
+  NS_LOG_DEBUG(*p << "\nat time " << Simulator::Now().As(Time::S));
   NS_LOG_DEBUG("RERR: " << origin << " --> " << dst << " went wrong at node " << m_qlearner->GetNode()->GetId() << " for packet " << p->GetUid());
 
   SendRerrWhenNoRouteToForward (dst, 0, origin);
@@ -1367,6 +1411,7 @@ RoutingProtocol::NotifyInterfaceUp (uint32_t i)
   Ptr<WifiNetDevice> wifi = dev->GetObject<WifiNetDevice> ();
   if (wifi == 0)
     return;
+  wifi->SetTxAccountingCallback (MakeCallback (&RoutingProtocol::TxAccounting, this));
   Ptr<WifiMac> mac = wifi->GetMac ();
   if (mac == 0)
     return;
@@ -1385,6 +1430,7 @@ RoutingProtocol::NotifyInterfaceDown (uint32_t i)
   Ptr<WifiNetDevice> wifi = dev->GetObject<WifiNetDevice> ();
   if (wifi != 0)
     {
+      wifi->SetTxAccountingCallback (MakeNullCallback<void, Ptr<const Packet> > ());
       Ptr<WifiMac> mac = wifi->GetMac ()->GetObject<AdhocWifiMac> ();
       if (mac != 0)
         {
@@ -2380,7 +2426,7 @@ RoutingProtocol::RecvReply (Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sen
           NS_ASSERT(m_qlearner->CheckDestinationKnown(sender));
 
         /* use PTST data to get a good first guess */
-        if (!p->PeekPacketTag(ptst_tag)) {
+        if (!QRoutingTag::Get(p).Peek(ptst_tag)) {
           NS_LOG_DEBUG("RREP without PTST TAG found. currNode=" << m_ipv4->GetAddress(1,0).GetLocal() << "  dst?  " << rrepHeader.GetOrigin () << " sender:" << sender << " pkt id:" << p->GetUid());
         } else {
           NS_LOG_DEBUG("RREP with PTST TAG found. currNode=" << m_ipv4->GetAddress(1,0).GetLocal() << "  dst?  " << rrepHeader.GetOrigin () << " sender:" << sender << " pkt id:" << p->GetUid() );
@@ -2737,7 +2783,7 @@ RoutingProtocol::SendPacketFromQueue (Ipv4Address dst, Ptr<Ipv4Route> route)
           << "  queue length right now: " << m_queue.GetSize() << ", max: " << m_queue.GetMaxQueueLen());
       }
 
-      std::stringstream ss;  p->Print(ss);  NS_LOG_DEBUG(ss.str());
+      NS_LOG_DEBUG(*p);
 
       if (m_qlearner) {
 
@@ -2759,11 +2805,13 @@ RoutingProtocol::SendPacketFromQueue (Ipv4Address dst, Ptr<Ipv4Route> route)
         // this part added because packets leaving the queue are having queue time
         // in the travel time already, this is not what we want.
         QLrnInfoTag qtag, old_qtag;
-        if (p->PeekPacketTag(old_qtag)) {
+        QRoutingTag qrt = QRoutingTag::Get(p);
+        if (qrt.Peek(old_qtag)) {
           qtag = old_qtag;
           qtag.SetTime(Simulator::Now().GetInteger());
         }
-        p->ReplacePacketTag(qtag);
+        qrt.Set(qtag);
+        qrt.Store(p);
 
       }
 
@@ -44,6 +44,7 @@
 #include "ns3/qos-qlrn-header.h"
 #include "ns3/thomas-packet-tags.h"
 #include "ns3/traffic-types.h"
+#include "ns3/qlrn-stats-sink.h"
 #include <map>
 
 namespace ns3
@@ -103,7 +104,7 @@ public:
   std::map<Ipv4Address,uint64_t> m_prev_delay_per_prev_hop;
   uint64_t m_prev_delay;
   bool m_output_data_to_file;
-  Ptr<OutputStreamWrapper> m_output_filestream;
+  Ptr<QLrnStatsSink> m_stats_sink;
 
  /**
   * Assign a fixed random variable stream number to the random variables
@@ -160,6 +161,8 @@ public:
   void SendRequest (Ipv4Address dst);
   void PacketTrackingOutput(Ptr<const Packet> p, Ipv4Header = Ipv4Header());
   void CorrectPacketTrackingOutput(Ptr<const Packet> p, Ipv4Header = Ipv4Header()); //for when pkts are dropped due to non-existing routes
+  // Registered as TxAccountingCallback on our wifi devices, counts what we originate but wasnt seen by the routing output
+  void TxAccounting(Ptr<const Packet> p);
   void CheckTraffic(Ptr<const Packet> p, TrafficType& );
   /// detecting ICMP TTL Exc
   bool CheckIcmpTTLExceeded(Ptr<const Packet> p, Icmpv4TimeExceeded& ii);
@@ -0,0 +1,150 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/boolean.h"
+#include "ns3/yans-wifi-helper.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/aodv-helper.h"
+#include "ns3/aodv-routing-protocol.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/udp-header.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/thomas-packet-tags.h"
+
+namespace ns3
+{
+namespace aodv
+{
+
+/**
+ * \ingroup aodv
+ *
+ * \brief Packets the node originates are counted by the tx accounting callback of its WifiNetDevice,
+ * except the ones the routing output already counted (tagged with a PortNrTag) and AODV and QLRN packets.
+ */
+class TxAccountingTestCase : public TestCase
+{
+  Ipv4Address m_address; //!< address of the node
+
+  /// A UDP packet from the node to dstPort, tagged as TRAFFIC_A so that PacketTrackingOutput counts it as traffic
+  Ptr<Packet> CreateUdpPacket (uint16_t dstPort, bool portTag);
+
+public:
+  TxAccountingTestCase ();
+  void DoRun ();
+};
+
+TxAccountingTestCase::TxAccountingTestCase () :
+    TestCase ("Only untagged data packets are counted by TxAccounting")
+{
+}
+
+Ptr<Packet>
+TxAccountingTestCase::CreateUdpPacket (uint16_t dstPort, bool portTag)
+{
+  Ptr<Packet> p = Create<Packet> (100);
+  UdpHeader udp;
+  udp.SetSourcePort (49153);
+  udp.SetDestinationPort (dstPort);
+  p->AddHeader (udp);
+  Ipv4Header ip;
+  ip.SetSource (m_address);
+  ip.SetDestination (Ipv4Address ("10.1.1.2"));
+  ip.SetProtocol (17);
+  ip.SetTtl (64);
+  ip.SetPayloadSize (p->GetSize ());
+  p->AddHeader (ip);
+
+  QRoutingTag qrt = QRoutingTag::Get (p);
+  qrt.Set (TrafficTypeTag (TRAFFIC_A));
+  if (portTag)
+    {
+      qrt.Set (PortNrTag (dstPort));
+    }
+  qrt.Store (p);
+  return p;
+}
+
+void
+TxAccountingTestCase::DoRun ()
+{
+  NodeContainer nodes;
+  nodes.Create (1);
+  Ptr<MobilityModel> m = CreateObject<ConstantPositionMobilityModel> ();
+  m->SetPosition (Vector (0, 0, 0));
+  nodes.Get (0)->AggregateObject (m);
+  WifiMacHelper wifiMac;
+  wifiMac.SetType ("ns3::AdhocWifiMac");
+  YansWifiPhyHelper wifiPhy = YansWifiPhyHelper::Default ();
+  YansWifiChannelHelper wifiChannel = YansWifiChannelHelper::Default ();
+  wifiPhy.SetChannel (wifiChannel.Create ());
+  WifiHelper wifi;
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager", "DataMode", StringValue ("OfdmRate6Mbps"));
+  NetDeviceContainer devices = wifi.Install (wifiPhy, wifiMac, nodes);
+
+  AodvHelper aodv;
+  aodv.Set ("EnableHello", BooleanValue (false));
+  InternetStackHelper internetStack;
+  internetStack.SetRoutingHelper (aodv);
+  internetStack.Install (nodes);
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces = address.Assign (devices);
+  m_address = interfaces.GetAddress (0);
+
+  Ptr<RoutingProtocol> routing = DynamicCast<RoutingProtocol> (nodes.Get (0)->GetObject<Ipv4> ()->GetRoutingProtocol ());
+  NS_TEST_ASSERT_MSG_NE (routing, 0, "AODV is not the routing protocol of the node");
+  Ptr<WifiNetDevice> dev = DynamicCast<WifiNetDevice> (devices.Get (0));
+  int traffic = routing->TrafficStatistics ();
+  int learning = routing->LrnTrafficStatistics ();
+  int control = routing->AODVStatistics ();
+  int qlrn = routing->QStatistics ();
+
+  dev->Send (CreateUdpPacket (5000, false), dev->GetBroadcast (), 0x0800);
+  NS_TEST_EXPECT_MSG_EQ (routing->TrafficStatistics (), traffic + 1, "An untagged data packet must be counted");
+  dev->Send (CreateUdpPacket (5000, true), dev->GetBroadcast (), 0x0800);
+  NS_TEST_EXPECT_MSG_EQ (routing->TrafficStatistics (), traffic + 1, "A packet with a PortNrTag was already counted on the routing output");
+  dev->Send (CreateUdpPacket (654, false), dev->GetBroadcast (), 0x0800);
+  NS_TEST_EXPECT_MSG_EQ (routing->TrafficStatistics (), traffic + 1, "AODV packets are counted elsewhere");
+  dev->Send (CreateUdpPacket (404, false), dev->GetBroadcast (), 0x0800);
+  NS_TEST_EXPECT_MSG_EQ (routing->TrafficStatistics (), traffic + 1, "QLRN packets are counted elsewhere");
+
+  NS_TEST_EXPECT_MSG_EQ (routing->LrnTrafficStatistics (), learning, "No learning packet was sent");
+  NS_TEST_EXPECT_MSG_EQ (routing->AODVStatistics (), control, "The AODV packet must not be counted by TxAccounting");
+  NS_TEST_EXPECT_MSG_EQ (routing->QStatistics (), qlrn, "The QLRN packet must not be counted by TxAccounting");
+
+  Simulator::Destroy ();
+}
+
+//-----------------------------------------------------------------------------
+// Test suite
+//-----------------------------------------------------------------------------
+class AodvTxAccountingTestSuite : public TestSuite
+{
+public:
+  AodvTxAccountingTestSuite () : TestSuite ("routing-aodv-tx-accounting", UNIT)
+  {
+    AddTestCase (new TxAccountingTestCase (), TestCase::QUICK);
+  }
+} g_aodvTxAccountingTestSuite;
+
+
+}
+}
@@ -202,6 +202,43 @@ OnOffApplication::IncreaseAmountOfTraffic(uint64_t new_data_rate, float increase
   ScheduleNextTx();
 }
 
+void
+OnOffApplication::Freeze (void)
+{
+  SetMaxBytes (FREEZE_ONOFFAPPLICATION_SENDING);
+}
+
+void
+OnOffApplication::Resume (void)
+{
+  SetMaxBytes (0);
+}
+
+void
+OnOffApplication::IncreaseRate (void)
+{
+  IncreaseAmountOfTraffic ();
+}
+
+void
+OnOffApplication::ReduceRate (void)
+{
+  ReduceAmountOfTraffic ();
+}
+
+void
+OnOffApplication::ScaleRate (double factor)
+{
+  if (factor > 1)
+    {
+      IncreaseAmountOfTraffic (0, factor);
+    }
+  else
+    {
+      ReduceAmountOfTraffic (0, factor);
+    }
+}
+
 void
 OnOffApplication::SetLearning (bool b)
 {
@@ -372,7 +409,9 @@ void OnOffApplication::SendPacket ()
   m_txTrace (packet);
   PortNrTag pnt(InetSocketAddress::ConvertFrom (m_peer).GetPort (), m_learning, (!m_learning?m_packet_number:0));
   m_packet_number += 1;
-  packet->AddPacketTag(pnt);
+  QRoutingTag qrt;
+  qrt.Set(pnt);
+  qrt.Store(packet);
   m_socket->Send (packet);
   m_totBytes += m_pktSize;
   if (InetSocketAddress::IsMatchingType (m_peer))
@@ -32,6 +32,7 @@
 #include "ns3/data-rate.h"
 #include "ns3/traced-callback.h"
 #include "ns3/boolean.h"
+#include "ns3/traffic-rate-control.h"
 namespace ns3 {
 
 class Address;
@@ -83,7 +84,7 @@ class Socket;
 * If the underlying socket type supports broadcast, this application
 * will automatically enable the SetAllowBroadcast(true) socket option.
 */
-class OnOffApplication : public Application
+class OnOffApplication : public Application, public TrafficRateControl
 {
 public:
   /**
@@ -105,6 +106,13 @@ public:
    * \param maxBytes the total number of bytes to send
    */
   void SetMaxBytes (uint64_t maxBytes);
+
+  // TrafficRateControl
+  void Freeze (void);
+  void Resume (void);
+  void IncreaseRate (void);
+  void ReduceRate (void);
+  void ScaleRate (double factor);
   void SetLearning (bool b);
 
   /**
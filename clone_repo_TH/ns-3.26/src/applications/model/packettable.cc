@@ -1,9 +1,13 @@
 #include "packettable.h"
+#include <limits>
 
 namespace ns3 {
 
+NS_LOG_COMPONENT_DEFINE ("PacketTable");
+
 PacketTableEntry::PacketTableEntry() {
   m_enqueued_at = Simulator::Now();
+  m_dequeued_at = NanoSeconds(0);
   m_last_queue_time = NanoSeconds(0);
   m_packet_state = NONE;
   m_number_of_times_enqueued = 0;
@@ -19,6 +23,7 @@ void PacketTableEntry::Enqueue() {
 void PacketTableEntry::Dequeue() {
   NS_ASSERT(m_packet_state == ENQUEUED);
   m_last_queue_time = Simulator::Now() - m_enqueued_at;
+  m_dequeued_at = Simulator::Now();
   m_packet_state = DEQUEUED;
   m_enqueued_at = NanoSeconds(0);
 }
@@ -29,39 +34,123 @@ int PacketTableEntry::GetNumberOfTimesSeen() {
 
 // ====================================================================================================
 
-PacketTable::PacketTable() : m_packet_info() {
+/* uid of the slots that hold no packet */
+static const uint64_t PACKETTABLE_EMPTY_SLOT = std::numeric_limits<uint64_t>::max();
 
+PacketTable::PacketTable(Time retention, uint32_t capacity) :
+  m_slots(), m_mask(capacity - 1), m_used(0), m_retention(retention), m_evictions(0), m_misses(0) {
+  NS_ASSERT_MSG(capacity > 0 && (capacity & (capacity - 1)) == 0, "PacketTable capacity should be a power of 2, not " << capacity);
+  Slot empty;
+  empty.uid = PACKETTABLE_EMPTY_SLOT;
+  m_slots.assign(capacity, empty);
 }
 
 PacketTable::~PacketTable(){
+  NS_LOG_LOGIC("PacketTable of " << m_slots.size() << " slots : " << m_used << " in use, " << m_evictions << " evicted, " << m_misses << " misses.");
+}
 
+bool
+PacketTable::IsUsed(uint32_t slot) const {
+  return m_slots[slot].uid != PACKETTABLE_EMPTY_SLOT;
+}
+
+uint32_t
+PacketTable::Probe(uint64_t uid) const {
+  uint32_t slot = (uid * 0x9E3779B97F4A7C15ULL) >> 32 & m_mask;
+  while (IsUsed(slot) && m_slots[slot].uid != uid) {
+    slot = (slot + 1) & m_mask;
+  }
+  return slot;
+}
+
+void
+PacketTable::Compact() {
+  std::vector<Slot> old_slots;
+  old_slots.swap(m_slots);
+  Time now = Simulator::Now();
+
+  uint32_t live = 0;
+  for (const auto& s : old_slots) {
+    if (s.uid != PACKETTABLE_EMPTY_SLOT && now - s.last_seen <= m_retention) {
+      live++;
+    }
+  }
+  uint32_t capacity = old_slots.size();
+  while (live * 2 > capacity) {
+    capacity *= 2;
+  }
+
+  Slot empty;
+  empty.uid = PACKETTABLE_EMPTY_SLOT;
+  m_slots.assign(capacity, empty);
+  m_mask = capacity - 1;
+  m_evictions += m_used - live;
+  NS_LOG_DEBUG("Evicting " << m_used - live << " packets older than " << m_retention.As(Time::MS) << ", " << live << " left in " << capacity << " slots.");
+  m_used = live;
+
+  for (const auto& s : old_slots) {
+    if (s.uid != PACKETTABLE_EMPTY_SLOT && now - s.last_seen <= m_retention) {
+      m_slots[Probe(s.uid)] = s;
+    }
+  }
 }
 
 void
 PacketTable::EnqueuePacket(uint64_t packetUid) {
-  if ( m_packet_info.find(packetUid) == m_packet_info.end() ) {
-    m_packet_info.insert(std::make_pair(packetUid, PacketTableEntry() ) );
+  NS_ASSERT(packetUid != PACKETTABLE_EMPTY_SLOT);
+  uint32_t slot = Probe(packetUid);
+  if (!IsUsed(slot)) {
+    if ((m_used + 1) * 4 > m_slots.size() * 3) {
+      Compact();
+      slot = Probe(packetUid);
+    }
+    m_slots[slot].uid = packetUid;
+    m_slots[slot].entry = PacketTableEntry();
+    m_used++;
   }
-  m_packet_info[packetUid].Enqueue();
+  m_slots[slot].entry.Enqueue();
+  m_slots[slot].last_seen = Simulator::Now();
 }
 
 void
 PacketTable::DequeuePacket(uint64_t packetUid) {
   //TODO : this if / else was needed b/c otherwise we would dequeue a packet after getting it as a Duplicate
   //this would lead to very large queue times, which is not desired, of course
-  if ( m_packet_info.find(packetUid) == m_packet_info.end() ) {
-    NS_FATAL_ERROR("Trying to dequeue a packet that was never queued to begin with.");
+  uint32_t slot = Probe(packetUid);
+  if (!IsUsed(slot)) {
+    m_misses++;
+    NS_FATAL_ERROR("Trying to dequeue a packet that was never queued to begin with (or was evicted, retention is " << m_retention.As(Time::MS) << ").");
   }
-  m_packet_info[packetUid].Dequeue( ) ;
+  m_slots[slot].entry.Dequeue( ) ;
+  m_slots[slot].last_seen = Simulator::Now();
 }
 
 Time PacketTable::GetPacketQueueTime(uint64_t packetUid) {
   // return NanoSeconds(0); //disables the queue delay thing
-  return m_packet_info[packetUid].GetLastQueueTime();
+  uint32_t slot = Probe(packetUid);
+  if (!IsUsed(slot)) {
+    m_misses++;
+    return NanoSeconds(0);
+  }
+  return m_slots[slot].entry.GetLastQueueTime();
 }
 
 int PacketTable::GetNumberOfTimesSeen(uint64_t packetUid) {
-  return m_packet_info[packetUid].GetNumberOfTimesSeen();
+  uint32_t slot = Probe(packetUid);
+  if (!IsUsed(slot)) {
+    m_misses++;
+    return 0;
+  }
+  return m_slots[slot].entry.GetNumberOfTimesSeen();
+}
+
+bool PacketTable::GetPacketDequeueTime(uint64_t packetUid, Time& t) {
+  uint32_t slot = Probe(packetUid);
+  if (!IsUsed(slot) || !m_slots[slot].entry.IsDequeued()) {
+    return false;
+  }
+  t = m_slots[slot].entry.GetDequeueTime();
+  return true;
 }
 
 } //namespace ns3
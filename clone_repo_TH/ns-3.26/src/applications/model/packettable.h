@@ -4,7 +4,8 @@
 #include "ns3/nstime.h"
 #include "ns3/simulator.h"
 #include "ns3/log.h"
-#include <map>
+#include "ns3/thomas-configuration.h"
+#include <vector>
 
 namespace ns3 {
 
@@ -20,6 +21,7 @@ public:
   int GetNumberOfTimesSeen();
   Time GetEnqueueTime() { return m_enqueued_at; }
   Time GetDequeueTime() { return m_dequeued_at; }
+  bool IsDequeued() const { return m_packet_state == DEQUEUED; }
   // packets can be sent back, and would then possibly end up in the queue again, with a different queue time
   // we should be able to deal with this
   Time GetLastQueueTime() { return m_last_queue_time; }
@@ -37,18 +39,50 @@ private:
   int m_number_of_times_enqueued;
 };
 
+/*
+ * Keeps the MAC queue times of the packets (by uid) this node has seen. Open addressing with linear probing, entries
+ * that have not been (de)queued for longer than the retention time are evicted when the table fills up, so the
+ * memory use follows the number of packets in flight instead of all packets ever sent.
+ */
 class PacketTable {
 public:
-  PacketTable();
+  PacketTable(Time retention = MilliSeconds(500 * PACKETTABLE_RETENTION_MAX_DELAYS), uint32_t capacity = PACKETTABLE_INITIAL_CAPACITY);
   ~PacketTable();
   void EnqueuePacket(uint64_t);
   void DequeuePacket(uint64_t);
 
+  // unknown (or evicted) packets have a queue time of 0 and have been seen 0 times
   Time GetPacketQueueTime(uint64_t);
   int GetNumberOfTimesSeen(uint64_t);
+  // false if the packet is unknown or still in the queue, otherwise t is when it last left the queue.
+  // Unlike the getters above, does not count as a miss.
+  bool GetPacketDequeueTime(uint64_t, Time& t);
+
+  // normally set to a multiple of the MAC queue's MaxDelay, see PACKETTABLE_RETENTION_MAX_DELAYS
+  void SetRetention(Time retention) { m_retention = retention; }
+  Time GetRetention() const { return m_retention; }
+  uint64_t GetEvictions() const { return m_evictions; }
+  uint64_t GetMisses() const { return m_misses; }
+  uint32_t GetSize() const { return m_used; }
 
 private:
-  std::map<uint64_t,PacketTableEntry > m_packet_info;
+  struct Slot {
+    uint64_t uid;
+    Time last_seen;
+    PacketTableEntry entry;
+  };
+  // slot of the packet, or the empty slot where it would go
+  uint32_t Probe(uint64_t uid) const;
+  bool IsUsed(uint32_t slot) const;
+  // drops the stale entries and grows the table if it is still too full afterwards
+  void Compact();
+
+  std::vector<Slot> m_slots;
+  uint32_t m_mask;
+  uint32_t m_used;
+  Time m_retention;
+  uint64_t m_evictions;
+  uint64_t m_misses;
 };
 
 } //namespace ns3
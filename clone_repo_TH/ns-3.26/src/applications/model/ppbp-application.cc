@@ -31,6 +31,9 @@
 #include "ns3/udp-socket-factory.h"
 #include "ns3/double.h"
 #include "ns3/pointer.h"
+#include "ns3/boolean.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/thomas-packet-tags.h"
 
 NS_LOG_COMPONENT_DEFINE ("PPBPApplication");
 
@@ -74,6 +77,10 @@ namespace ns3 {
 					   TypeIdValue (UdpSocketFactory::GetTypeId ()),
 					   MakeTypeIdAccessor (&PPBPApplication::m_protocolTid),
 					   MakeTypeIdChecker ())
+		.AddAttribute ("Learning", "is it a learning traffic gen or not",
+					   BooleanValue (false),
+					   MakeBooleanAccessor (&PPBPApplication::m_learning),
+					   MakeBooleanChecker ())
 		.AddTraceSource ("Tx", "A new packet is created and is sent",
 						 MakeTraceSourceAccessor (&PPBPApplication::m_txTrace),
 						 "ns3::Packet::TracedCallback" )
@@ -90,6 +97,8 @@ namespace ns3 {
 		m_totalBytes = 0;
 		m_activebursts = 0;
 		m_offPeriod = true;
+		m_frozen = false;
+		m_packet_number = 0;
 	}
 
 	PPBPApplication::~PPBPApplication()
@@ -223,6 +232,12 @@ namespace ns3 {
 	PPBPApplication::ScheduleNextTx()
 	{
 		NS_LOG_FUNCTION_NOARGS ();
+		if (m_frozen)
+		{
+			// Resume (or the next burst arrival) starts sending again
+			m_offPeriod = true;
+			return;
+		}
 		uint32_t bits = (m_pktSize + 30) * 8;
 		Time nextTime(Seconds (bits /
 							   static_cast<double>(m_cbrRate.GetBitRate())));
@@ -260,6 +275,14 @@ namespace ns3 {
 		NS_LOG_FUNCTION_NOARGS ();
 		Ptr<Packet> packet = Create<Packet> (m_pktSize);
 		m_txTrace (packet);
+		// like OnOffApplication, so the QLearner can route and account for this traffic
+		if (InetSocketAddress::IsMatchingType (m_peer))
+		{
+			QRoutingTag qrt;
+			qrt.Set(PortNrTag(InetSocketAddress::ConvertFrom (m_peer).GetPort (), m_learning, (!m_learning ? m_packet_number : 0)));
+			m_packet_number += 1;
+			qrt.Store(packet);
+		}
 		m_socket->Send (packet);
 		m_totalBytes += packet->GetSize();
 		m_lastStartTime = Simulator::Now();
@@ -274,6 +297,50 @@ namespace ns3 {
 		ScheduleStartEvent();
 	}
 
+	void
+	PPBPApplication::Freeze ()
+	{
+		NS_LOG_FUNCTION_NOARGS ();
+		m_frozen = true;
+		Simulator::Cancel(m_sendEvent);
+		m_offPeriod = true;
+	}
+
+	void
+	PPBPApplication::Resume ()
+	{
+		NS_LOG_FUNCTION_NOARGS ();
+		if (!m_frozen) return;
+		m_frozen = false;
+		if (m_socket != 0 && m_offPeriod) ScheduleNextTx();
+	}
+
+	void
+	PPBPApplication::IncreaseRate ()
+	{
+		ScaleRate(10);
+	}
+
+	void
+	PPBPApplication::ReduceRate ()
+	{
+		ScaleRate(0.1);
+	}
+
+	void
+	PPBPApplication::ScaleRate (double factor)
+	{
+		NS_LOG_FUNCTION (this << factor);
+		NS_ASSERT_MSG (factor > 0, "Can not scale the rate by " << factor);
+		m_cbrRate = DataRate(static_cast<uint64_t>(m_cbrRate.GetBitRate() * factor));
+	}
+
+	void
+	PPBPApplication::SetLearning (bool b)
+	{
+		m_learning = b;
+	}
+
 	void
 	PPBPApplication::ConnectionFailed(Ptr<Socket>)
 	{
@@ -29,6 +29,7 @@
 #include "ns3/random-variable-stream.h"
 #include "ns3/traced-callback.h"
 #include "ns3/data-rate.h"
+#include "ns3/traffic-rate-control.h"
 
 namespace ns3 {
 
@@ -89,7 +90,7 @@ namespace ns3 {
 	 *		Proceedings of INFOCOM 2003, San Francisco, USA, April 2003.
 	 */
 
-	class PPBPApplication : public Application
+	class PPBPApplication : public Application, public TrafficRateControl
 	{
 	public:
 		static TypeId GetTypeId (void);
@@ -103,6 +104,14 @@ namespace ns3 {
 		 */
 		uint32_t      GetTotalBytes() const;
 
+		// TrafficRateControl, scales the burst intensity; the bursts themselves keep coming while frozen
+		void Freeze ();
+		void Resume ();
+		void IncreaseRate ();
+		void ReduceRate ();
+		void ScaleRate (double factor);
+		void SetLearning (bool b);
+
 	protected:
 		virtual void DoDispose ();
 
@@ -154,6 +163,9 @@ namespace ns3 {
 		Time			m_timeSlot;						// The time slot
 		int				m_activebursts;					// Number of active bursts at time t
 		bool			m_offPeriod;
+		bool			m_frozen;						// True between Freeze and Resume
+		bool			m_learning;						// Learning traffic or not, for the PortNrTag
+		uint64_t		m_packet_number;				// Number of the next data packet, for the PortNrTag
 
 
 	private:
@@ -147,6 +147,56 @@ QLearner::GetTypeId (void)
                    BooleanValue(false),
                    MakeBooleanAccessor(&QLearner::m_print_qtables),
                    MakeBooleanChecker())
+    .AddAttribute ("QTableSamplingInterval",
+                   "Simulated time between two samples when printing QTables, zero samples every change.",
+                   TimeValue(Seconds(0)),
+                   MakeTimeAccessor(&QLearner::m_qtable_sampling_interval),
+                   MakeTimeChecker())
+    .AddAttribute ("FeedbackBatchSize",
+                   "Number of feedback records for the same previous hop sent together in one QLRN packet, 0 sends a QLrnHeader per record.",
+                   UintegerValue(0),
+                   MakeUintegerAccessor(&QLearner::m_feedback_batch_size),
+                   MakeUintegerChecker<uint32_t>())
+    .AddAttribute ("FeedbackBatchDelay",
+                   "Longest time a feedback record waits for others to fill up its batch.",
+                   TimeValue(MilliSeconds(5)),
+                   MakeTimeAccessor(&QLearner::m_feedback_batch_delay),
+                   MakeTimeChecker())
+    .AddAttribute ("RateStepInterval",
+                   "Shortest time between two changes of the rate of the learning traffic, zero lets every step through.",
+                   TimeValue(Seconds(0)),
+                   MakeTimeAccessor(&QLearner::m_rate_step_interval),
+                   MakeTimeChecker())
+    .AddAttribute ("RateStepHysteresis",
+                   "Net number of learn more / learn less votes needed to change the rate of the learning traffic.",
+                   UintegerValue(1),
+                   MakeUintegerAccessor(&QLearner::m_rate_step_hysteresis),
+                   MakeUintegerChecker<uint32_t>(1))
+    .AddAttribute ("SnapshotTime",
+                   "Time at which the qtables are saved to <SnapshotPrefix><node ip>.qsnap, zero never saves them.",
+                   TimeValue(Seconds(0)),
+                   MakeTimeAccessor(&QLearner::m_snapshot_time),
+                   MakeTimeChecker())
+    .AddAttribute ("SnapshotPrefix",
+                   "Prefix of the files the qtables are saved to at SnapshotTime.",
+                   StringValue("qsnap_"),
+                   MakeStringAccessor(&QLearner::m_snapshot_prefix),
+                   MakeStringChecker())
+    .AddAttribute ("WarmStartPrefix",
+                   "If not empty, the qtables are loaded from <WarmStartPrefix><node ip>.qsnap when the application starts.",
+                   StringValue(""),
+                   MakeStringAccessor(&QLearner::m_warm_start_prefix),
+                   MakeStringChecker())
+    .AddAttribute ("CountersPrefix",
+                   "If not empty, the Q-routing counters and histograms are written to <CountersPrefix><node ip>_counters.csv.",
+                   StringValue(""),
+                   MakeStringAccessor(&QLearner::m_counters_prefix),
+                   MakeStringChecker())
+    .AddAttribute ("CountersInterval",
+                   "Simulated time between two writes of the counters, zero only writes them when the application stops.",
+                   TimeValue(Seconds(0)),
+                   MakeTimeAccessor(&QLearner::m_counters_interval),
+                   MakeTimeChecker())
     .AddAttribute ("Ideal",
                     "Specify ideal or not",
                    BooleanValue(false),
@@ -216,12 +266,25 @@ QLearner::QLearner (float eps_param = DEFAULT_EPSILON_VALUE, float learning_rate
   m_slow_qlearner = false;
   m_output_data_to_file = false;
   m_print_qtables = false;
+  m_feedback_batch_size = 0;
+  m_feedback_batch_delay = MilliSeconds(5);
+  m_rate_step_interval = Seconds(0);
+  m_rate_step_hysteresis = 1;
+  m_rate_votes = 0;
+  m_next_rate_step = Seconds(0);
+  m_snapshot_time = Seconds(0);
+  m_snapshot_prefix = "qsnap_";
+  m_warm_start_prefix = "";
+  m_counters_prefix = "";
+  m_counters_interval = Seconds(0);
+  m_counters_started = false;
+  m_counters_done = true;
 
   m_report_dst_to_src = false;
 
   m_num_applications = 0;
 
-  m_output_filestream = 0;
+  m_stats_sink = 0;
   m_use_learning_phases = false;
   m_traffic_sources = std::vector<Ipv4Address>();
   m_traffic_destinations = std::vector<Ipv4Address>();
@@ -229,14 +292,14 @@ QLearner::QLearner (float eps_param = DEFAULT_EPSILON_VALUE, float learning_rate
 
   tmp = std::set<unsigned int>();
 
-  m_qtable = QTable();
-  m_qtable_voip = QTable();
-  m_qtable_video = QTable();
+  m_qtables = MultiClassQTable();
 
   neighbours = std::vector<Ipv4Address>();
   aodvProto = 0;
   learning_traffic_applications = 0;
   real_traffic = 0;
+  m_learning_rate_control = 0;
+  m_traffic_rate_control = 0;
 
   m_small_learning_stream = false;
 
@@ -248,7 +311,7 @@ QLearner::QLearner (float eps_param = DEFAULT_EPSILON_VALUE, float learning_rate
   m_max_retry = 4;
   m_prev_delay = 0;
 
-  m_packet_sent_stats_per_neighb_per_time = std::map<std::pair<Ipv4Address,Ipv4Address> ,std::vector<std::tuple<uint64_t,uint64_t,float> > >();
+  m_packet_sent_stats_per_neighb_per_time = std::map<std::pair<Ipv4Address,Ipv4Address>,SentPacketWindow>();
   m_packet_recv_stats_per_neighb          = std::map<std::pair<Ipv4Address,Ipv4Address> ,std::pair<uint64_t,float> >();
 
   m_backup_per_prev_hop_for_unusable_delay = std::map<Ipv4Address,Time>();
@@ -262,10 +325,12 @@ QLearner::~QLearner()
   aodvProto = 0;
   learning_traffic_applications = 0;
   real_traffic = 0;
+  m_learning_rate_control = 0;
+  m_traffic_rate_control = 0;
   m_qlrn_socket = 0;
   m_epsilon = 0;
   m_other_qlearners = std::map<Ipv4Address, Ptr<QLearner> >();
-  m_output_filestream = 0;
+  m_stats_sink = 0;
 }
 
 std::vector<Ipv4Address>
@@ -363,6 +428,8 @@ void QLearner::RouteHelper(Ptr<Ipv4Route> route, Ipv4Address dst, TrafficType t,
 
 bool
 QLearner::Route(Ptr<Ipv4Route> route, Ptr<Packet> p, const Ipv4Address& dst, const Ipv4Address& src) {
+  // the clock is only read when the counters are written somewhere
+  WallClockTimer timer(m_counters_prefix.empty() ? 0 : &m_route_cost);
   QLrnInfoTag tag;
 
   PortNrTag pnt;
@@ -373,27 +440,25 @@ QLearner::Route(Ptr<Ipv4Route> route, Ptr<Packet> p, const Ipv4Address& dst, con
 
   uint64_t initial_estim;
 
-  std::stringstream ss;
-  p->Print(ss);
-
   //Get traffic type of packet;
   TrafficType t = OTHER;
   aodvProto->CheckTraffic(p, t);
   QLrnHeader qlrnHeader;
   QoSQLrnHeader qosQlrnHeader;
 
-  if (p->PeekPacketTag(tag)) {
-    NS_LOG_DEBUG(m_name << ss.str() << "  size:" << p->GetSize() << " packet uid: " << p->GetUid() << " time sent: " << tag.GetTime().As(Time::MS));
+  QRoutingTag qrt = QRoutingTag::Get(p);
+  if (qrt.Peek(tag)) {
+    NS_LOG_DEBUG(m_name << *p << "  size:" << p->GetSize() << " packet uid: " << p->GetUid() << " time sent: " << tag.GetTime().As(Time::MS));
   } else {
-    NS_LOG_DEBUG(m_name << ss.str() << "  size:" << p->GetSize() << " packet uid: " << p->GetUid());
+    NS_LOG_DEBUG(m_name << *p << "  size:" << p->GetSize() << " packet uid: " << p->GetUid());
   }
 
-  p->PeekPacketTag(pnt);
+  qrt.Peek(pnt);
 
   if (t == OTHER && CheckAODVHeader(p)){
     NS_LOG_LOGIC (m_name << p->GetUid() << " is AODV traffic, dont reroute it.");
     return true;
-  } else if (t == OTHER && (CheckQLrnHeader(p, qlrnHeader) || CheckQLrnHeader(p, qosQlrnHeader) ) ) {
+  } else if (t == OTHER && (CheckQLrnFeedback(p, true) || CheckQLrnHeader(p, qlrnHeader) || CheckQLrnHeader(p, qosQlrnHeader) ) ) {
     NS_LOG_LOGIC (m_name << p->GetUid() << " is QLRN traffic, dont reroute it.");
     return true;
   } else {
@@ -403,11 +468,13 @@ QLearner::Route(Ptr<Ipv4Route> route, Ptr<Packet> p, const Ipv4Address& dst, con
     then send to a random next hop 1
     */
 
-    if ( ( random_value < m_eps_thresh) && m_learning_phase[dst] && p->PeekPacketTag(tag) /* &&  pnt.GetLearningPkt() TODO stil lnot sure about htis */ ) {
+    if ( ( random_value < m_eps_thresh) && m_learning_phase[dst] && qrt.Peek(tag) /* &&  pnt.GetLearningPkt() TODO stil lnot sure about htis */ ) {
       NS_LOG_DEBUG(m_name << "Taking an e-greedy decision path for packet " << p->GetUid() << "!. e = " << m_eps_thresh);
+      Count(t, QRC_DECISION_EPSILON_GREEDY);
 
       Ipv4Address next_hop = route->GetGateway(); //for log purposes
-      p->AddPacketTag(RandomDecisionTag(true));
+      qrt.Set(RandomDecisionTag(true));
+      qrt.Store(p);
       auto random_estimate = GetQTable(t).GetRandomEstim(dst);
       initial_estim = random_estimate.GetQValue().GetInteger();
       route->SetGateway(random_estimate.GetNextHop()  );
@@ -422,7 +489,7 @@ QLearner::Route(Ptr<Ipv4Route> route, Ptr<Packet> p, const Ipv4Address& dst, con
       if its not at node 0, [case B] with a chance of rho send the packet to the optimum possible next hop (to help next hop learn) and otherwise
       send it to a random unconverged next hop
     */
-    else if ( !m_learning_phase[dst] && pnt.GetLearningPkt() && p->PeekPacketTag(tag) ) { /* so not in learning phase, but it is LEARNING/maintenance traffic*/
+    else if ( !m_learning_phase[dst] && pnt.GetLearningPkt() && qrt.Peek(tag) ) { /* so not in learning phase, but it is LEARNING/maintenance traffic*/
       // case A
       if (src == m_this_node_ip || src == Ipv4Address(UNINITIALIZED_IP_ADDRESS_VALUE) ) {
         // from the source, do the exploration. Intermediate nodes should just try and find their best estimates
@@ -431,31 +498,38 @@ QLearner::Route(Ptr<Ipv4Route> route, Ptr<Packet> p, const Ipv4Address& dst, con
             " we need src to be one of the traffic sources..." << m_this_node_ip) ;
         }
         if (random_value < m_eps_thresh /*(m_eps_thresh == 0 ? 0.5: m_eps_thresh ) */) {// Pick any neighbour : do EXPLORATION ---
+          Count(t, QRC_DECISION_EPSILON_GREEDY);
           RouteHelper(route,dst,t,initial_estim,0,p); // mode 0 means the next hop will be random
         } else {          // Pick only a non-converged value : do TARGETTED EXPLORATION
           if (GetQTable(t).HasConverged(dst) || AllNeighboursBlacklisted(dst,t)) {
             // seems like this not having the all neighb blacklisted check was the part that was missing for the testmiguel8 issue with vv many learning pkts
+            Count(t, QRC_LEARNING_DROPPED);
             return false; /* drop the packet if there is nothing to learn and pkt wasnt lucky OR all are blacklisted  */
           }
-          else { RouteHelper(route,dst,t,initial_estim,1,p); } //mode 1 means the next hop will be an unconverged hop
+          else {
+            Count(t, QRC_DECISION_TARGETED_EXPLORATION);
+            RouteHelper(route,dst,t,initial_estim,1,p); //mode 1 means the next hop will be an unconverged hop
+          }
         }
       }
       // case B
       else { // intermediate nodes (usually) just find their best choice still.
         if (random_value < m_rho) {
+          Count(t, QRC_DECISION_RHO_OPTIMAL);
           RouteHelper(route,dst,t,initial_estim,2,p); // mode 2 means the next hop will be optimal
         } else {
           // was thinking about having a similar choice here as for node0 but that won't do probably
           // so just make it random ? then at least in some cases itll be the good direction...
+          Count(t, QRC_DECISION_EPSILON_GREEDY);
           RouteHelper(route,dst,t,initial_estim,0,p); // mode 1 means the next hop will be RANDOM
         }
         // if (random_value > ( m_eps_thresh == 0 ? 0.5: m_eps_thresh ) ) {// Pick any neighbour : do EXPLORATION
         //   Route Helper(route,dst,t,initial_estim,false,p);
         // } else {          // Pick only a non-converged value : do EXPLORATION
       }
-    } else if (!m_learning_phase[dst] && (!pnt.GetLearningPkt() && p->PeekPacketTag(tag) ) ) {
-      std::stringstream ss;p->Print(ss<<std::endl);
-    } else if (!m_learning_phase[dst] && (pnt.GetLearningPkt() && !p->PeekPacketTag(tag) ) ) {
+    } else if (!m_learning_phase[dst] && (!pnt.GetLearningPkt() && qrt.Peek(tag) ) ) {
+      // nothing to do
+    } else if (!m_learning_phase[dst] && (pnt.GetLearningPkt() && !qrt.Peek(tag) ) ) {
       std::stringstream ss;p->Print(ss<<std::endl<<p->GetUid()<<"   ");
       if (t != ICMP ) { NS_LOG_UNCOND("This is odd, what packet was it ?: \n" << ss.str() << "==message over=="); }
       if (t != ICMP) { } else { NS_FATAL_ERROR(ss.str() << "\nTest for unreachable code : learning packet without QLrnTag header");}
@@ -469,6 +543,7 @@ QLearner::Route(Ptr<Ipv4Route> route, Ptr<Packet> p, const Ipv4Address& dst, con
        * Its REAL traffic or we are in learning phase and the traffic got a good RNG roll so it was above eps threshold ,
        * and is intended to explore the currently-optimal solution. In any case, we should make the (perceived) optimal routing decision
        **/
+      Count(t, QRC_DECISION_EXPLOIT);
       auto next_estimate = GetQTable(t).GetNextEstim(dst);
       // so this is for the TO-DO show that A/B/C  are taking different paths so they each have a QoS set
       // it will only return the a_estim for b if there is no non-blacklisted alternative, same with b_estim for c
@@ -483,7 +558,7 @@ QLearner::Route(Ptr<Ipv4Route> route, Ptr<Packet> p, const Ipv4Address& dst, con
                      << next_estimate.GetQValue() << " is the lowest value I found in my qtable (for dst = " << dst << ")." << "\n"
                      << /*GetQTable(t).PrettyPrint()*/"" << " PS BE CAREFUL IF ALL BLACKLISTED THIS WILL BE A RANDOM RESULT TOO.");
 
-      if (!pnt.GetLearningPkt() && !p->PeekPacketTag(tag) && GetPacketTable()->GetNumberOfTimesSeen(p->GetUid()) > m_max_retry ) {
+      if (!pnt.GetLearningPkt() && !qrt.Peek(tag) && GetPacketTable()->GetNumberOfTimesSeen(p->GetUid()) > m_max_retry ) {
         // for this max retry parameter, if we set it to 0, it will work on the 1st time we see the pkt again (i think)
         // Try to let the QLearner decide for itself to learn more and figure a way out of the loop
         tag.SetTime(Simulator::Now().GetInteger());
@@ -492,12 +567,13 @@ QLearner::Route(Ptr<Ipv4Route> route, Ptr<Packet> p, const Ipv4Address& dst, con
         tag.SetUsableDelay(false);
 
 
-        p->AddPacketTag(tag);
+        qrt.Set(tag);
+        qrt.Store(p);
         // p->Print(std::cout<<std::endl);std::cout << p->GetUid() << std::endl;
         // NS_LOG_UNCOND(  m_name << " is adding a lrn header to " << p->GetUid() << " because it has been seen more than max_retry times. \n"
         //              << GetQTable(t).PrettyPrint() << "\n");
 
-      } else if (!p->PeekPacketTag(tag) && !pnt.GetLearningPkt() && GetAODV()->CheckIcmpTTLExceeded(p,ii)) { // because of adding this call to icmp ttl exceeded we observed issue
+      } else if (!qrt.Peek(tag) && !pnt.GetLearningPkt() && GetAODV()->CheckIcmpTTLExceeded(p,ii)) { // because of adding this call to icmp ttl exceeded we observed issue
         return false; // -- this isnt going to benefit anyyone, drop the icmp ttl packet instead of waterproofing the adding of a QLrnInfoTag to it, as it goes wrong SOMEWHERE
       }
 
@@ -505,14 +581,16 @@ QLearner::Route(Ptr<Ipv4Route> route, Ptr<Packet> p, const Ipv4Address& dst, con
       route->SetGateway( next_estimate.GetNextHop() );
     }
 
-    if (!p->PeekPacketTag(ptab) && !p->PeekPacketTag(ptct) && !p->PeekPacketTag(ptst_tag) ) {
-      ptab.SetEstimTypeA(GetQTable(TRAFFIC_A).GetNextEstim(dst).GetQValue().GetInteger());
-      ptab.SetEstimTypeB(GetQTable(TRAFFIC_B).GetNextEstim(dst).GetQValue().GetInteger());
-      ptct.SetEstimTypeC(GetQTable(TRAFFIC_C).GetNextEstim(dst).GetQValue().GetInteger());
+    if (!qrt.Peek(ptab) && !qrt.Peek(ptct) && !qrt.Peek(ptst_tag) ) {
+      auto estims = m_qtables.GetNextEstims(dst);
+      ptab.SetEstimTypeA(estims[MultiClassQTable::ClassOf(TRAFFIC_A)].GetQValue().GetInteger());
+      ptab.SetEstimTypeB(estims[MultiClassQTable::ClassOf(TRAFFIC_B)].GetQValue().GetInteger());
+      ptct.SetEstimTypeC(estims[MultiClassQTable::ClassOf(TRAFFIC_C)].GetQValue().GetInteger());
       ptct.SetSentTime(Simulator::Now().GetInteger());
 
-      p->AddPacketTag(ptab);
-      p->AddPacketTag(ptct);
+      qrt.Set(ptab);
+      qrt.Set(ptct);
+      qrt.Store(p);
     }
   }
 
@@ -548,14 +626,14 @@ void QLearner::RouteDiffBasedOnType(QTableEntry& next_estimate, Ipv4Address dst,
     else if (t == TRAFFIC_B) {
       // find the best estim NOT EQUAL to the optimal estimate
       // std::cout << next_estimate_by_ref.GetRealLoss()<< "  "<< 1-(next_estimate_by_ref.GetRealLoss()/10000.0) << "  "
-      //   << TrafficTypeReqsMap[TRAFFIC_A].GetRandomLossMax() << "  " << next_estimate_by_ref.GetNextHop()<< std::endl;
+      //   << GetTrafficRequirements(TRAFFIC_A).GetRandomLossMax() << "  " << next_estimate_by_ref.GetNextHop()<< std::endl;
 
-      if (1-(next_estimate_by_ref.GetRealLoss()/10000.0) > TrafficTypeReqsMap[TRAFFIC_A].GetRandomLossMax() &&
+      if (1-(next_estimate_by_ref.GetRealLoss()/10000.0) > GetTrafficRequirements(TRAFFIC_A).GetRandomLossMax() &&
              next_estimate.GetNextHop() != Ipv4Address(UNINITIALIZED_IP_ADDRESS_VALUE_QTABLE) &&
              next_estimate_by_ref.GetRealLoss() != 0) {
         // could fill in here to get the 2nd best estimate, but thats not very interesting. We're mainly interested in seeing B take the faster option!
         std::cout << "-" << next_estimate_by_ref.GetRealLoss()<< "  "<< 1-(next_estimate_by_ref.GetRealLoss()/10000.0) << "  "
-          << TrafficTypeReqsMap[TRAFFIC_A].GetRandomLossMax() << "  " <<  next_estimate_by_ref.GetNextHop() << std::endl;
+          << GetTrafficRequirements(TRAFFIC_A).GetRandomLossMax() << "  " <<  next_estimate_by_ref.GetNextHop() << std::endl;
       } else {
         a_estim = next_estimate;
       }
@@ -582,46 +660,13 @@ void QLearner::RouteDiffBasedOnType(QTableEntry& next_estimate, Ipv4Address dst,
 }
 
 void QLearner::RoutingPacketViaNeighbToDst(Ipv4Address via,Ipv4Address dst) {
-  // find newest entry ...
-  std::tuple<uint64_t, uint64_t, float> most_recent = std::tuple<uint64_t, uint64_t, float>(0,0,0);
-  for (const auto& i : m_packet_sent_stats_per_neighb_per_time[std::pair<Ipv4Address,Ipv4Address>(via,dst)]) {
-    if (std::get<0>(i) > std::get<0>(most_recent)) {
-      most_recent = i;
-    }
-  }
-
-  std::tuple<uint64_t, uint64_t, float> new_value =
-    std::tuple<uint64_t, uint64_t, float>(Simulator::Now().GetInteger(), std::get<1>(most_recent)+1, std::get<2>(most_recent));
-
-  m_packet_sent_stats_per_neighb_per_time[std::pair<Ipv4Address,Ipv4Address>(via,dst)].push_back(new_value);
-  CleanTheNumPktsTimestampMap((Simulator::Now()-Seconds(5)).GetInteger(), via, dst);
-}
-
-void QLearner::CleanTheNumPktsTimestampMap(uint64_t time_cutoff,Ipv4Address via,Ipv4Address dst) {
-  bool done = false;
-  while (!done) {
-    done = true;
-    for (unsigned int i = 0; i < m_packet_sent_stats_per_neighb_per_time[std::pair<Ipv4Address,Ipv4Address>(via,dst)].size(); i++ ) {
-      if (std::get<0>(m_packet_sent_stats_per_neighb_per_time[std::pair<Ipv4Address,Ipv4Address>(via,dst)].at(i)) < time_cutoff &&
-          m_packet_sent_stats_per_neighb_per_time[std::pair<Ipv4Address,Ipv4Address>(via,dst)].size() != 1) {
-        m_packet_sent_stats_per_neighb_per_time[std::pair<Ipv4Address,Ipv4Address>(via,dst)].erase(
-          m_packet_sent_stats_per_neighb_per_time[std::pair<Ipv4Address,Ipv4Address>(via,dst)].begin()+i);
-        done = false;
-        break;
-      }
-    }
-  }
+  SentPacketWindow& window = m_packet_sent_stats_per_neighb_per_time[std::pair<Ipv4Address,Ipv4Address>(via,dst)];
+  window.Sent(Simulator::Now().GetInteger());
+  window.Expire((Simulator::Now()-Seconds(5)).GetInteger());
 }
 
 uint64_t QLearner::GetNumPktsSentViaNeighbToDst(uint64_t ts, Ipv4Address via, Ipv4Address dst) {
-  std::tuple<uint64_t, uint64_t, float> ret = std::tuple<uint64_t, uint64_t, float>(0,0,0);
-
-  for (const auto& i : m_packet_sent_stats_per_neighb_per_time[std::pair<Ipv4Address,Ipv4Address>(via,dst)]) {
-    if (std::get<0>(i) < ts && std::get<0>(i) > std::get<0>(ret)) {
-      ret = i;
-    }
-  }
-  return std::get<1>(ret);
+  return m_packet_sent_stats_per_neighb_per_time[std::pair<Ipv4Address,Ipv4Address>(via,dst)].GetCountBefore(ts);
 }
 
 void QLearner::ReceivedPktFromPrevHopToDst(Ipv4Address prev_hop, Ipv4Address dst) {
@@ -648,8 +693,9 @@ void QLearner::HandleRouteOutput(Ptr<Packet> p, const Ipv4Header &header, Traffi
 
   QLrnInfoTag tag;
   PortNrTag pnt;
-  p->PeekPacketTag(pnt);
-  if (!p->PeekPacketTag(tag)  && header.GetDestination()!=bcast) {
+  QRoutingTag qrt = QRoutingTag::Get(p);
+  qrt.Peek(pnt);
+  if (!qrt.Peek(tag)  && header.GetDestination()!=bcast) {
     /**
      *  No QLrnInfoTag was found, we are QLearning and this is the RouteOutput function, so we are also the source.
      *  To check this, following assert:
@@ -662,7 +708,7 @@ void QLearner::HandleRouteOutput(Ptr<Packet> p, const Ipv4Header &header, Traffi
      */
     QLrnHeader qlrnHeader;
     QoSQLrnHeader qosQlrnHeader;
-    if ( CheckQLrnHeader(p, qlrnHeader) || CheckQLrnHeader(p, qosQlrnHeader) ) {
+    if ( CheckQLrnFeedback(p, true) || CheckQLrnHeader(p, qlrnHeader) || CheckQLrnHeader(p, qosQlrnHeader) ) {
       /* So if the packet is a QInfo packet, dont add a tag because then we will be getting more QInfo packets in response, and these packets are always from next-hop neighbours anyway */
       NS_LOG_DEBUG("(RouteOutput)" << m_name << "Not adding a tag to packet " << p->GetUid() << " because it is a QInfo packet. PrevHop of QInfo: "  << tag.GetPrevHop());
     } else if (CheckAODVHeader(p)) { //disable learning off AODV packets here if you want
@@ -670,7 +716,8 @@ void QLearner::HandleRouteOutput(Ptr<Packet> p, const Ipv4Header &header, Traffi
         tag.SetPrevHop(m_this_node_ip);
         NS_LOG_DEBUG("[RouteOutput node " << GetNode()->GetId() << "] : Adding a tag to packet " << p->GetUid() << " (which has size = " << p->GetSize() << ")   PrevHop:"  << tag.GetPrevHop()<< ". This packet is meant for " << header.GetDestination());
         tag.SetMaint(!m_learning_phase[header.GetDestination()]);
-        p->AddPacketTag(tag);
+        qrt.Set(tag);
+        qrt.Store(p);
     } else {
       // careful here, icmp must be in lrn phase both directions
       if ((m_learning_phase[header.GetDestination()] && pnt.GetLearningPkt() ) || pnt.GetLearningPkt() || (m_learning_phase[header.GetDestination()] && m_num_applications <= 1 ) /* added for legacy reasons, if only 1 application (icmp test21/22)*/ ){
@@ -679,14 +726,16 @@ void QLearner::HandleRouteOutput(Ptr<Packet> p, const Ipv4Header &header, Traffi
         tag.SetTime(Simulator::Now().GetInteger());
         tag.SetPrevHop(m_this_node_ip);
         tag.SetMaint(!m_learning_phase[header.GetDestination()]);
-        p->AddPacketTag(tag);
+        qrt.Set(tag);
+        qrt.Store(p);
       } else {
         // Add a tag signifying that it is a packet being handled by QRouting!
         QRoutedTrafficPacketTag q(true);
-        p->AddPacketTag(q);
+        qrt.Set(q);
+        qrt.Store(p);
       }
     }
-  } else if (p->PeekPacketTag(tag)) {
+  } else if (qrt.Peek(tag)) {
     /**
      * If we see a packet that already has a tag in this RouteOutput function we are not sure what has happened to allow that.
      * It should always be the source that has RouteOutput called, and from then on it should be the RouteInput determining the plays
@@ -703,18 +752,19 @@ void QLearner::HandleRouteInput(Ptr<Packet> p, const Ipv4Header &header, bool de
   NS_ASSERT_MSG (Time::GetResolution () == 7, "As defined in nstime.h, Unit value should be 7 == NS. Undefined behaviour if this condition is not satisfied.");
 
   QLrnInfoTag tag;
+  QRoutingTag qrt = QRoutingTag::Get(p);
 
   // tried to do it in Route fct, but cant remove there
   RandomDecisionTag rd_tag;
-  random_sentback = p->RemovePacketTag(rd_tag);
+  random_sentback = qrt.Remove(rd_tag);
 
   PacketTimeSentTagPrecursorAB ptab;
   PacketTimeSentTagPrecursorCT ptct;
 
-  PacketTimeSentTag ptst_tag_2; p->PeekPacketTag(ptst_tag_2);
-  PortNrTag pnt; p->PeekPacketTag(pnt);
+  PacketTimeSentTag ptst_tag_2; qrt.Peek(ptst_tag_2);
+  PortNrTag pnt; qrt.Peek(pnt);
 
-  if (p->PeekPacketTag(ptct) && p->PeekPacketTag(ptab) ) {
+  if (qrt.Peek(ptct) && qrt.Peek(ptab) ) {
     PacketTimeSentTag ptst;
 
     if      (t == VOIP  || t == TRAFFIC_A) { ptst.SetInitialEstim(ptab.GetEstimTypeAAsInt()); }
@@ -723,28 +773,29 @@ void QLearner::HandleRouteInput(Ptr<Packet> p, const Ipv4Header &header, bool de
 
     ptst.SetSentTime(ptct.GetSentTimeAsInt());
     ptst.SetPrevHop(m_this_node_ip);
-    p->RemovePacketTag(ptab);
-    p->RemovePacketTag(ptct);
+    qrt.Remove(ptab);
+    qrt.Remove(ptct);
 
-    p->AddPacketTag(ptst);
-    if (header.GetDestination() != bcast && p->PeekPacketTag(pnt) && !pnt.GetLearningPkt() ) {
+    qrt.Set(ptst);
+    if (header.GetDestination() != bcast && qrt.Peek(pnt) && !pnt.GetLearningPkt() ) {
       ReceivedPktFromPrevHopToDst(header.GetSource(),header.GetDestination()); //must be 1st hop or the ptab,ptct tags would be gone
     }
   } else if (header.GetDestination() != m_this_node_ip) {
     PacketTimeSentTag ptst_tag;
-    p->RemovePacketTag(ptst_tag);
-    if (header.GetDestination() != bcast && p->PeekPacketTag(pnt) && !pnt.GetLearningPkt() ) {
+    qrt.Remove(ptst_tag);
+    if (header.GetDestination() != bcast && qrt.Peek(pnt) && !pnt.GetLearningPkt() ) {
       ReceivedPktFromPrevHopToDst(ptst_tag.GetPrevHop(),header.GetDestination()); //must be 1st hop or the ptab,ptct tags would be gone
       ptst_tag.SetPrevHop(m_this_node_ip);
-      p->AddPacketTag(ptst_tag);
+      qrt.Set(ptst_tag);
     }
-  } else if ( p->PeekPacketTag(ptst_tag_2) ){
-    if (header.GetDestination() != bcast && p->PeekPacketTag(pnt) && !pnt.GetLearningPkt() ) {
+  } else if ( qrt.Peek(ptst_tag_2) ){
+    if (header.GetDestination() != bcast && qrt.Peek(pnt) && !pnt.GetLearningPkt() ) {
       ReceivedPktFromPrevHopToDst(ptst_tag_2.GetPrevHop(),header.GetDestination()); //must be 1st hop or the ptab,ptct tags would be gone
     }
   }
+  qrt.Store(p);
 
-  if (!p->PeekPacketTag(tag) && header.GetDestination() != m_this_node_ip && header.GetDestination()!=bcast) {
+  if (!qrt.Peek(tag) && header.GetDestination() != m_this_node_ip && header.GetDestination()!=bcast) {
 
     /**
       * If we reach this part of the code, then we arrive in a situation where a packet arrives for which we are not the source
@@ -756,7 +807,7 @@ void QLearner::HandleRouteInput(Ptr<Packet> p, const Ipv4Header &header, bool de
       TcpHeader tcpHdr;
       QLrnHeader qlrnHeader;
       QoSQLrnHeader qosQlrnHeader;
-      if ( CheckQLrnHeader(p, qlrnHeader) || CheckQLrnHeader(p, qosQlrnHeader) ) {
+      if ( CheckQLrnFeedback(p, true) || CheckQLrnHeader(p, qlrnHeader) || CheckQLrnHeader(p, qosQlrnHeader) ) {
         // std::cout << "QLrnHeader found!\n"; // so this one is fine
       } else if (true) {
         if (!CheckDestinationKnown(header.GetDestination()) ){
@@ -773,7 +824,7 @@ void QLearner::HandleRouteInput(Ptr<Packet> p, const Ipv4Header &header, bool de
         p->Print(std::cout);std::cout<<std::endl;
         NS_ASSERT_MSG(false, "Found no PTST tag even though it is not a QInfo packet and it is not a bcast packet and not a TCP packet, also we are not the destination. ");
       }
-  } else if (p->PeekPacketTag(tag) && header.GetSource() == m_this_node_ip ) {
+  } else if (qrt.Peek(tag) && header.GetSource() == m_this_node_ip ) {
 
     /**
      * After all, who would have added the tag?
@@ -809,7 +860,8 @@ void QLearner::HandleRouteInput(Ptr<Packet> p, const Ipv4Header &header, bool de
         // std::cout << p->GetUid() << " at (B)" << m_name << std::endl;
         Send(tag.GetPrevHop(), p->GetUid(), TravelTimeHelper(tag), header.GetDestination(), header.GetSource(), t, sender_convergence ) ;
         if (GetPacketTable()->GetNumberOfTimesSeen(p->GetUid()) > 1) {       new_tag.SetUsableDelay(false);     }
-        p->ReplacePacketTag(new_tag);
+        qrt.Set(new_tag);
+        qrt.Store(p);
       } else if ( !random_sentback) {
         QLrnInfoTag new_tag(Simulator::Now().GetInteger(), m_this_node_ip, tag.GetMaint(), tag.GetUsableDelay());
         NS_LOG_DEBUG("(RouteInput)" << m_name << "Found a tag on packet i alrdy sent once, pid = " << p->GetUid() << ". Prev hop = " << tag.GetPrevHop() << ". Replacing it & sending back some info.") ;
@@ -821,14 +873,15 @@ void QLearner::HandleRouteInput(Ptr<Packet> p, const Ipv4Header &header, bool de
         // std::cout << p->GetUid() << " at (C)" << m_name << std::endl;
         Send(tag.GetPrevHop(), p->GetUid(), TravelTimeHelper(tag), header.GetDestination(), header.GetSource(), t, sender_convergence ) ;
         if (GetPacketTable()->GetNumberOfTimesSeen(p->GetUid()) > 1) {       new_tag.SetUsableDelay(false);     }
-        p->ReplacePacketTag(new_tag);
+        qrt.Set(new_tag);
+        qrt.Store(p);
       } else {
-        std::stringstream ss; p->Print(ss); NS_LOG_DEBUG( "(RouteInput)" << m_name << ss.str());
+        NS_LOG_DEBUG( "(RouteInput)" << m_name << *p);
         NS_ASSERT(false);
       }
     }
 
-  } else if (p->PeekPacketTag(tag) && header.GetSource() != m_this_node_ip && header.GetDestination() != m_this_node_ip) {
+  } else if (qrt.Peek(tag) && header.GetSource() != m_this_node_ip && header.GetDestination() != m_this_node_ip) {
 
     /**
      * QLrnInfoTag was found and there is a m_qlearner
@@ -873,14 +926,16 @@ void QLearner::HandleRouteInput(Ptr<Packet> p, const Ipv4Header &header, bool de
       // the m_use_learning_phases is added for tests with ICMP
       // the m_num_applications was added for test 49 (and others, probably) : after 42 packets node1 would C and stop forwarding thus not getting the 49 expected pkts -- but not correct bc node1 never has appl
       // just changed it to 42 instead of 49, can change it but meh who cares eh
-      p->RemovePacketTag(tag);
+      qrt.Remove(tag);
+      qrt.Store(p);
       DropPacketTag dpt(true);
       p->AddPacketTag(dpt);
     } else {
       if (GetPacketTable()->GetNumberOfTimesSeen(p->GetUid()) > 1) {       new_tag.SetUsableDelay(false);     }
-      p->ReplacePacketTag(new_tag);
+      qrt.Set(new_tag);
+      qrt.Store(p);
     }
-  } else if (p->PeekPacketTag(tag) && header.GetDestination() == m_this_node_ip && (t != OTHER || CheckAODVHeader(p)) ){
+  } else if (qrt.Peek(tag) && header.GetDestination() == m_this_node_ip && (t != OTHER || CheckAODVHeader(p)) ){
     /*TODO ICMP TTL EXCeeded handling should happen here I suppose, not sure */
     /**
      * QLrnInfoTag was found and there is a m_qlearner
@@ -909,7 +964,7 @@ void QLearner::HandleRouteInput(Ptr<Packet> p, const Ipv4Header &header, bool de
       // p->RemovePacketTag(tag);
 
     PacketTimeSentTag ptst_tag;
-    if (p->PeekPacketTag(ptst_tag) && m_use_learning_phases) {
+    if (qrt.Peek(ptst_tag) && m_use_learning_phases) {
       // p->Print(std::cout<<std::endl); std::cout << p->GetUid() << std::endl;
       if (m_report_dst_to_src) {
         NS_FATAL_ERROR("Not using this anymore, need unless you specify who the dst is in the function this wont work anymore (which is possbile, header.GetDst, but worth?)");
@@ -923,7 +978,7 @@ void QLearner::HandleRouteInput(Ptr<Packet> p, const Ipv4Header &header, bool de
     PortNrTag pnt;
     // Had to add this to make sure its actually traffic of ours.. If there is a PNT, it came from one of the onoff appl we configured
     // and we can then reasonably decide if its learning or real traffic
-    if (m_this_node_ip == /*m_traffic_destination*/ header.GetDestination() && p->PeekPacketTag(pnt))  {
+    if (m_this_node_ip == /*m_traffic_destination*/ header.GetDestination() && qrt.Peek(pnt))  {
       // but its due to the first packet (its not seperate learning, traffic, so thats why)
       // p->Print(std::cout << m_name << " to check why its suddenly really big delay" << "  " );std::cout<< "  " << m_running_avg_latency.first << " " << m_running_avg_latency.second <<std::endl;
       // std::stringstream ss;p->Print(ss);ss<<std::endl;NS_LOG_UNCOND(ss.str());
@@ -933,10 +988,10 @@ void QLearner::HandleRouteInput(Ptr<Packet> p, const Ipv4Header &header, bool de
         OutputDataToFile(ptst_tag, p, pnt.GetLearningPkt() /* due to the anti-loop system, this is needed */, t, header.GetSource() );
       }
     }
-  } else if (!p->PeekPacketTag(tag) && header.GetDestination() == m_this_node_ip) {
+  } else if (!qrt.Peek(tag) && header.GetDestination() == m_this_node_ip) {
     // this clause added for the case where its not learning traffic and we still want to check our metrics
     PacketTimeSentTag ptst_tag;
-    if (p->PeekPacketTag(ptst_tag) && m_use_learning_phases) {
+    if (qrt.Peek(ptst_tag) && m_use_learning_phases) {
       aodvProto->CheckTraffic(p,t);
       if (t == OTHER) { } //See other TODO for icmp ttl exc above
       else {
@@ -954,7 +1009,7 @@ void QLearner::HandleRouteInput(Ptr<Packet> p, const Ipv4Header &header, bool de
     PortNrTag pnt;
     // Had to add this to make sure its actually traffic of ours.. If there is a PNT, it came from one of the onoff appl we configured
     // and we can then reasonably decide if its learning or real traffic.. ?
-    if (m_this_node_ip == /*m_traffic_destination*/ header.GetDestination() && p->PeekPacketTag(pnt) )  {
+    if (m_this_node_ip == /*m_traffic_destination*/ header.GetDestination() && qrt.Peek(pnt) )  {
       // std::cout << m_this_node_ip << std::endl;
       // but its due to the first packet (its not seperate learning, traffic, so thats why)
       // p->Print(std::cout << m_name << " to check why its suddenly really big delay" << "  " );std::cout<< "  " << m_running_avg_latency.first << " " << m_running_avg_latency.second <<std::endl;
@@ -1122,6 +1177,16 @@ void
 QLearner::DoDispose (void)
 {
   NS_LOG_FUNCTION (this);
+  if (m_stats_sink) {
+    m_stats_sink->Close();
+    m_stats_sink = 0;
+  }
+  // the application may not have been stopped before the simulation ended
+  if (!m_counters_done) {
+    WriteCountersToFile();
+    m_counters_done = true;
+  }
+  m_counters_event.Cancel();
   Application::DoDispose ();
 }
 //
@@ -1142,7 +1207,7 @@ void QLearner::QLrnPacketTracking (Ptr<const Packet> p) {
   //Must be QLRN packets!
   QLrnHeader q;
   QoSQLrnHeader qosq;
-  NS_ASSERT_MSG(CheckQLrnHeader_withoutUDP(p,q) || CheckQLrnHeader_withoutUDP(p,qosq), "this should have been a valid QLRN traffic since im the one who made / sent it ??");
+  NS_ASSERT_MSG(CheckQLrnFeedback(p, false) || CheckQLrnHeader_withoutUDP(p,q) || CheckQLrnHeader_withoutUDP(p,qosq), "this should have been a valid QLRN traffic since im the one who made / sent it ??");
 }
 
 void
@@ -1202,6 +1267,8 @@ QLearner::StartApplication (void)
 
   mac_queue->TraceConnectWithoutContext("EnqueuePacket",MakeCallback(&QLearner::MACEnqueuePacket, this));
   mac_queue->TraceConnectWithoutContext("DequeuePacket",MakeCallback(&QLearner::MACDequeuePacket, this));
+  // a packet cannot sit in the queue for longer than MaxDelay, forget about it some time after that
+  GetPacketTable()->SetRetention(mac_queue->GetMaxDelay() * static_cast<int64_t>(PACKETTABLE_RETENTION_MAX_DELAYS));
   // MACEnqueuePacket
   // MACDequeuePacket
 
@@ -1214,32 +1281,89 @@ QLearner::StartApplication (void)
     neighbours = FindNeighboursManual ();
   }
 
-  m_qtable = QTable(neighbours, GetNode()->GetObject<Ipv4>()->GetAddress(1,0).GetLocal(), m_learningrate,
-                  m_qconvergence_threshold, m_learning_threshold, std::vector<Ipv4Address>(), "_web", m_in_test, m_print_qtables, m_gamma);
-  m_qtable_video = QTable(neighbours, GetNode()->GetObject<Ipv4>()->GetAddress(1,0).GetLocal(), m_learningrate,
-                  m_qconvergence_threshold, m_learning_threshold, std::vector<Ipv4Address>(), "_video", m_in_test, m_print_qtables, m_gamma);
-  m_qtable_voip = QTable(neighbours, GetNode()->GetObject<Ipv4>()->GetAddress(1,0).GetLocal(), m_learningrate,
-                  m_qconvergence_threshold, m_learning_threshold, std::vector<Ipv4Address>(), "_voip", m_in_test, m_print_qtables, m_gamma);
+  m_qtables = MultiClassQTable(neighbours, GetNode()->GetObject<Ipv4>()->GetAddress(1,0).GetLocal(), m_learningrate,
+                  m_qconvergence_threshold, m_learning_threshold, m_in_test, m_print_qtables, m_gamma, m_qtable_sampling_interval);
+  // random next hops come from the same stream as the e-greedy choice
+  m_qtables.SetRandomVariable(m_epsilon);
+
+  if (!m_warm_start_prefix.empty()) {
+    LoadSnapshot();
+  }
+  if (m_snapshot_time > Simulator::Now()) {
+    Simulator::Schedule(m_snapshot_time - Simulator::Now(), &QLearner::SaveSnapshot, this);
+  }
+  m_counters_done = m_counters_prefix.empty();
+  if (!m_counters_prefix.empty() && m_counters_interval > Seconds(0)) {
+    m_counters_event = Simulator::Schedule(m_counters_interval, &QLearner::WritePeriodicCounters, this);
+  }
 
   if (GetNode()->GetId() == 27) {
-    std::cout << m_qtable.PrettyPrint() << std::endl;
+    std::cout << GetQTable(WEB).PrettyPrint() << std::endl;
     std::cout << "\n======================BEGIN========================\n\n";
   }
 
-  if (m_output_data_to_file && IamAmongTheDestinations() && m_output_filestream == 0) {
-    std::stringstream ss; ss << "out_stats_q_node"<<GetNode()->GetId()<<".csv";
-    m_output_filestream = Create<OutputStreamWrapper> (ss.str(), std::ios::out);
-    *(m_output_filestream->GetStream ()) << "pktID,currTime,delay,initial_estim,learning,metric_delay,metric_jitter,metric_loss,second_to_last_hop,trafficType\n";
+  if (m_output_data_to_file && IamAmongTheDestinations() && m_stats_sink == 0) {
+    std::stringstream ss; ss << "out_stats_q_node"<<GetNode()->GetId()<<".bin";
+    m_stats_sink = Create<QLrnStatsSink> (ss.str());
   }
 
   if (m_num_applications == 1 && real_traffic != 0 && m_use_learning_phases) {
-    if (real_traffic/*->GetN() == 1*/ != 0) {
-      try {
-        dynamic_cast<OnOffApplication&> ( *(PeekPointer(real_traffic/*->Get(0)*/)) ).SetLearning(true);
-      } catch (std::exception bc) {
-        NS_FATAL_ERROR("We expect all traffic generators to be OnOffGenerators right now, due to the changes that were made to OnOffApplication to make it stop/start." << bc.what());
-      }
-    }
+    DataRateControl()->SetLearning(true);
+  }
+}
+
+void
+QLearner::SaveSnapshot() {
+  std::stringstream filename;
+  filename << m_snapshot_prefix << m_this_node_ip << ".qsnap";
+  std::ofstream os(filename.str().c_str(), std::ios::out | std::ios::binary);
+  if (!os) {
+    NS_FATAL_ERROR(m_name << "Could not open " << filename.str() << " to save the qtables to.");
+  }
+  m_qtables.Save(os);
+  uint32_t nr_phases = m_learning_phase.size();
+  os.write(reinterpret_cast<const char*>(&nr_phases), sizeof(nr_phases));
+  for (const auto& phase : m_learning_phase) {
+    uint32_t dst = phase.first.Get();
+    uint8_t learning = phase.second;
+    os.write(reinterpret_cast<const char*>(&dst), sizeof(dst));
+    os.write(reinterpret_cast<const char*>(&learning), sizeof(learning));
+  }
+  // a truncated snapshot would only fail when another run loads it
+  os.flush();
+  if (!os) {
+    NS_FATAL_ERROR(m_name << "Could not write the qtables to " << filename.str() << ".");
+  }
+  NS_LOG_INFO(m_name << "Saved the qtables to " << filename.str() << " at " << Simulator::Now().GetSeconds() << "s.");
+}
+
+void
+QLearner::LoadSnapshot() {
+  std::stringstream filename;
+  filename << m_warm_start_prefix << m_this_node_ip << ".qsnap";
+  std::ifstream is(filename.str().c_str(), std::ios::in | std::ios::binary);
+  if (!is) {
+    NS_FATAL_ERROR(m_name << "Could not open " << filename.str() << " to load the qtables from.");
+  }
+  if (!m_qtables.Load(is)) {
+    NS_FATAL_ERROR(m_name << filename.str() << " is not a qtable snapshot of " << m_this_node_ip << ".");
+  }
+  uint32_t nr_phases = 0;
+  is.read(reinterpret_cast<char*>(&nr_phases), sizeof(nr_phases));
+  for (uint32_t p = 0; p < nr_phases && is.good(); p++) {
+    uint32_t dst = 0;
+    uint8_t learning = 1;
+    is.read(reinterpret_cast<char*>(&dst), sizeof(dst));
+    is.read(reinterpret_cast<char*>(&learning), sizeof(learning));
+    m_learning_phase[Ipv4Address(dst)] = learning;
+  }
+  if (!is.good()) {
+    NS_FATAL_ERROR(m_name << filename.str() << " ends in the middle of the learning phases.");
+  }
+  // The traffic generators only start after the qlearners, so they cannot be switched over yet. The destination of our own
+  // traffic stays in the learning phase instead, and the first feedback on its (converged) entries ends it as usual.
+  if (m_learning_phase.count(m_my_sent_traffic_destination)) {
+    m_learning_phase[m_my_sent_traffic_destination] = true;
   }
 }
 
@@ -1278,14 +1402,29 @@ QLearner::Receive(Ptr<Socket> socket) {
   Ptr<Packet> packet = socket->RecvFrom (sourceAddress);
   Ipv4Address sourceIPAddress = InetSocketAddress::ConvertFrom (sourceAddress).GetIpv4 ();
 
-  TrafficType t = OTHER;
+  if (CheckQLrnFeedback(packet, false)) {
+    QLrnFeedbackHeader feedback;
+    packet->RemoveHeader (feedback);
+    NS_ASSERT_MSG(!feedback.IsQoS(), "QoS feedback received by a QLearner without QoS.");
+    for (const auto& record : feedback.GetRecords()) {
+      QLrnHeader qlrnHeader = record.ToQLrnHeader();
+      LearnFromQLrnHeader(sourceIPAddress, qlrnHeader, packet);
+    }
+    return;
+  }
 
   QLrnHeader qlrnHeader;
   packet->RemoveHeader (qlrnHeader);
   if (!qlrnHeader.IsValid ()) {
       NS_FATAL_ERROR("Incorrect QLrnHeader found."); //stop simulation
   }
-  t = qlrnHeader.GetTrafficType();
+  LearnFromQLrnHeader(sourceIPAddress, qlrnHeader, packet);
+}
+
+void
+QLearner::LearnFromQLrnHeader(Ipv4Address sourceIPAddress, QLrnHeader& qlrnHeader, Ptr<Packet> packet) {
+  TrafficType t = qlrnHeader.GetTrafficType();
+  NoteFeedbackReceived(t, qlrnHeader.GetPktId());
 
   NS_LOG_DEBUG( m_name << "learning info about " << qlrnHeader.GetPDst() <<" from packet ID " << qlrnHeader.GetPktId()
             << " : travel time was " << Time::FromInteger(qlrnHeader.GetTime(), Time::NS).As(Time::MS) << " and next estim : " << Time::FromInteger(qlrnHeader.GetNextEstim(), Time::NS)
@@ -1310,9 +1449,7 @@ QLearner::Receive(Ptr<Socket> socket) {
 
   }
 
-  GetQTable(TRAFFIC_A).GetEntryByRef(qlrnHeader.GetPDst(), sourceIPAddress).SetSenderConverged(qlrnHeader.GetSenderConverged());
-  GetQTable(TRAFFIC_B).GetEntryByRef(qlrnHeader.GetPDst(), sourceIPAddress).SetSenderConverged(qlrnHeader.GetSenderConverged());
-  GetQTable(TRAFFIC_C).GetEntryByRef(qlrnHeader.GetPDst(), sourceIPAddress).SetSenderConverged(qlrnHeader.GetSenderConverged());
+  m_qtables.SetSenderConverged(qlrnHeader.GetPDst(), sourceIPAddress, qlrnHeader.GetSenderConverged());
 
   Ipv4Address destination = qlrnHeader.GetPDst() ;
   if (qlrnHeader.GetSenderConverged()) {
@@ -1360,19 +1497,11 @@ QLearner::Receive(Ptr<Socket> socket) {
         m_use_learning_phases && !m_learning_phase[destination] && m_num_applications == 2 && learning_traffic_applications/*->GetN() == 1*/!=0 && real_traffic/*->GetN() == 1*/!=0) {
     // std::cout << (to_dst_learn_more ? "to dst learn more":"not to dst learn more" ) << std::endl;
     // std::cout << (to_neigh_learn_more ? "to neigh learn more":"not to neigh learn more" ) << std::endl;
-    try {
-      dynamic_cast<OnOffApplication&> ( *(PeekPointer(learning_traffic_applications/*->Get(0)*/)) ).IncreaseAmountOfTraffic(0,1.5); //--VANHIER
-    } catch (std::bad_cast e) {
-      NS_FATAL_ERROR("bad cast was thrown & caught. learning_traffic_applications should be of the OnOffApplication variety though." << e.what() );
-    }
+    VoteLearningRate(+1); //--VANHIER
 
   } else if ( ( to_dst_learn_less || to_neigh_learn_less ) && m_small_learning_stream && m_my_sent_traffic_destination == destination /* dont mess with traffic if its not our dst*/ &&
                 m_use_learning_phases && !m_learning_phase[destination] && m_num_applications == 2 && learning_traffic_applications/*->GetN() == 1*/!=0 && real_traffic/*->GetN() == 1*/!=0) {
-    try {
-      dynamic_cast<OnOffApplication&> ( *(PeekPointer(learning_traffic_applications/*->Get(0)*/)) ).ReduceAmountOfTraffic(0,0.5); //--VANHIER
-    } catch (std::bad_cast e) {
-      NS_FATAL_ERROR("bad cast was thrown & caught. learning_traffic_applications should be of the OnOffApplication variety though." << e.what() );
-    }
+    VoteLearningRate(-1); //--VANHIER
 
   }
   return;
@@ -1384,17 +1513,13 @@ QLearner::StopTrafficStartLearning(Ipv4Address i) {
   NS_ASSERT_MSG(m_my_sent_traffic_destination == i, "Trying to stop traffic to a destination Im totally not sending traffic to!");
   // Stop the learning traffic thing
   NS_FATAL_ERROR("currently unused.");
-  for (unsigned int i = 0; i < (learning_traffic_applications != 0 ? 1 : 0) ; i++) {
-    try {
-      if (!m_small_learning_stream) {
-        dynamic_cast<OnOffApplication&> ( *(PeekPointer(learning_traffic_applications/*->Get(0)*/)) ).SetMaxBytes(0);
-      } else {
-        dynamic_cast<OnOffApplication&> ( *(PeekPointer(learning_traffic_applications/*->Get(0)*/)) ).IncreaseAmountOfTraffic();
-      }
-      dynamic_cast<OnOffApplication&> ( *(PeekPointer(real_traffic/*->Get(0)*/)) ).SetMaxBytes(FREEZE_ONOFFAPPLICATION_SENDING);
-    } catch (std::exception bc) {
-      NS_FATAL_ERROR("We expect all traffic generators to be OnOffGenerators right now, due to the changes that were made to OnOffApplication to make it stop/start." << bc.what());
+  if (learning_traffic_applications != 0) {
+    if (!m_small_learning_stream) {
+      LearningRateControl()->Resume();
+    } else {
+      LearningRateControl()->IncreaseRate();
     }
+    DataRateControl()->Freeze();
   }
   SetLearningPhase(true, i);
 
@@ -1408,28 +1533,18 @@ QLearner::StopLearningStartTraffic(Ipv4Address i) {
   NS_ASSERT_MSG(m_my_sent_traffic_destination == i, "Trying to stop learning traffic to a destination Im totally not sending traffic to!  "
                   << m_my_sent_traffic_destination << " " << i);
   // std::cout << m_name << "  " << learning_traffic_applications/*->GetN()*/ << std::endl;
-  for (unsigned int i = 0; i < (learning_traffic_applications != 0 ? 1 : 0) ; i++) {
-    try {
-      if (!m_small_learning_stream) {
-        dynamic_cast<OnOffApplication&> ( *(PeekPointer(learning_traffic_applications/*->Get(0)*/)) ).SetMaxBytes(FREEZE_ONOFFAPPLICATION_SENDING);
-      } else {
-        dynamic_cast<OnOffApplication&> ( *(PeekPointer(learning_traffic_applications/*->Get(0)*/)) ).ReduceAmountOfTraffic();
-      }
-      dynamic_cast<OnOffApplication&> ( *(PeekPointer(real_traffic/*->Get(0)*/)) ).SetMaxBytes(0);
-    } catch (std::exception bc) {
-      NS_FATAL_ERROR("We expect all traffic generators to be OnOffGenerators right now, due to the changes that were made to OnOffApplication to make it stop/start." << bc.what());
+  if (learning_traffic_applications != 0) {
+    if (!m_small_learning_stream) {
+      LearningRateControl()->Freeze();
+    } else {
+      LearningRateControl()->ReduceRate();
     }
+    DataRateControl()->Resume();
   }
   SetLearningPhase(false,i);
   //workaround to let old tests work still
   if (m_num_applications == 1 && real_traffic != 0) {
-    if (real_traffic/*->GetN() == 1*/!=0) {
-      try {
-        dynamic_cast<OnOffApplication&> ( *(PeekPointer(real_traffic/*->Get(0)*/)) ).SetLearning(false);
-      } catch (std::exception bc) {
-        NS_FATAL_ERROR("We expect all traffic generators to be OnOffGenerators right now, due to the changes that were made to OnOffApplication to make it stop/start." << bc.what());
-      }
-    }
+    DataRateControl()->SetLearning(false);
   }
 }
 
@@ -1452,7 +1567,19 @@ QLearner::Send (Ipv4Address node_to_notify, uint64_t packet_Uid, Time travel_tim
     delay = m_delay * 1000000;
   }
 
+  Count(t, QRC_FEEDBACK_SENT);
   QLrnHeader qLrnHeader ( packet_Uid, travel_time.GetInteger(), GetQTable(t).GetNextEstim(packet_dst).GetQValue().GetInteger()+delay, sender_converged, packet_dst, t);
+  if (m_feedback_batch_size > 0 && !m_ideal) {
+    QLrnFeedbackRecord record;
+    record.packet_id = packet_Uid;
+    record.time_as_int = qLrnHeader.GetTime();
+    record.next_estim = qLrnHeader.GetNextEstim();
+    record.packet_dst = packet_dst;
+    record.traffic_type = t;
+    record.sender_converged = sender_converged;
+    QueueFeedback(node_to_notify, record, false);
+    return;
+  }
   Ptr<Packet> packet = Create<Packet> ();
   // if (GetNode()->GetObject<Ipv4>()->GetAddress(1,0).GetLocal() == Ipv4Address("10.1.1.8") ||
   //     GetNode()->GetObject<Ipv4>()->GetAddress(1,0).GetLocal() == Ipv4Address("10.1.1.2")) {
@@ -1497,6 +1624,37 @@ QLearner::Send (Ipv4Address node_to_notify, uint64_t packet_Uid, Time travel_tim
   }
 }
 
+void
+QLearner::QueueFeedback (Ipv4Address node_to_notify, const QLrnFeedbackRecord& record, bool qos) {
+  auto pending = m_pending_feedback.find(node_to_notify);
+  if (pending == m_pending_feedback.end()) {
+    pending = m_pending_feedback.insert(std::make_pair(node_to_notify, QLrnFeedbackHeader(qos))).first;
+  }
+  pending->second.AddRecord(record);
+  if (pending->second.GetNRecords() >= m_feedback_batch_size) {
+    FlushFeedback(node_to_notify);
+  } else if (!m_feedback_flush_event[node_to_notify].IsRunning()) {
+    m_feedback_flush_event[node_to_notify] = Simulator::Schedule(m_feedback_batch_delay, &QLearner::FlushFeedback, this, node_to_notify);
+  }
+}
+
+void
+QLearner::FlushFeedback (Ipv4Address node_to_notify) {
+  auto pending = m_pending_feedback.find(node_to_notify);
+  m_feedback_flush_event[node_to_notify].Cancel();
+  if (pending == m_pending_feedback.end() || m_qlrn_socket == 0) {
+    return;
+  }
+  QLrnFeedbackHeader feedback = pending->second;
+  m_pending_feedback.erase(pending);
+
+  feedback.SetSentTime(Simulator::Now().GetInteger());
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (feedback);
+  m_txTrace(packet);
+  m_qlrn_socket->SendTo (packet, 0, InetSocketAddress (node_to_notify, QLRN_PORT));
+}
+
 void
 QLearner::FixRoute (Ptr<Ipv4Route> route, Ptr<NetDevice> net, Ipv4Address src) {
   // route.SetDestination (Ipv4Address dest) already fine
@@ -1507,25 +1665,19 @@ QLearner::FixRoute (Ptr<Ipv4Route> route, Ptr<NetDevice> net, Ipv4Address src) {
 
 void
 QLearner::NotifyLinkDown(Ipv4Address neighb) {
-  m_qtable.MarkNeighbDown(neighb);
-  m_qtable_voip.MarkNeighbDown(neighb);
-  m_qtable_video.MarkNeighbDown(neighb);
-
-  m_qtable.Unconverge();
-  m_qtable_voip.Unconverge();
-  m_qtable_video.Unconverge();
+  m_qtables.MarkNeighbDown(neighb);
+  // no m_qtables.Unconverge() : entries via a neighbour that is down already don't count as converged
+  // (QTableEntry::HasConverged), so it never changed anything and only walked every row of every class
 
   for (const auto& dst : m_traffic_destinations ) {
-    if (!m_learning_phase[dst] && !m_qtable.HasConverged(dst,true) ) {
+    if (!m_learning_phase[dst] && !GetQTable(WEB).HasConverged(dst,true) ) {
       SetLearningPhase(true,dst);
     }
   }
 }
 
 void QLearner::AddNeighbour(Ipv4Address neighb) {
-  m_qtable.AddNeighbour(neighb);
-  m_qtable_voip.AddNeighbour(neighb);
-  m_qtable_video.AddNeighbour(neighb);
+  m_qtables.AddNeighbour(neighb);
 }
 
 void
@@ -1544,6 +1696,18 @@ QLearner::StopApplication ()
     m_qlrn_socket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
     m_qlrn_socket = 0;
   }
+  // feedback still waiting for its batch has nowhere to go anymore
+  for (auto& event : m_feedback_flush_event) {
+    Simulator::Cancel(event.second);
+  }
+  m_feedback_flush_event.clear();
+  m_pending_feedback.clear();
+
+  if (!m_counters_done) {
+    m_counters_event.Cancel();
+    WriteCountersToFile();
+    m_counters_done = true;
+  }
 }
 
 std::string
@@ -1553,32 +1717,61 @@ QLearner::GetStatistics() {
   return ss.str();
 }
 
-QTable& QLearner::GetQTable(TrafficType t) {
-  if (t == ICMP || t == WEB || t == OTHER || t == UDP_ECHO || t == TRAFFIC_C) {
-    return m_qtable;
-  } else if (t == VIDEO|| t == TRAFFIC_B) {
-    return m_qtable_video;
-  } else if (t == VOIP || t == TRAFFIC_A) {
-    return m_qtable_voip;
-  } else {
-    NS_FATAL_ERROR("unknown traffic.");
+QRoutingCounters
+QLearner::GetCounters(MultiClassQTable::QTableClass c) {
+  QRoutingCounters counters = m_counters[c];
+  counters += m_qtables.GetTable(c).GetCounters();
+  return counters;
+}
+
+void
+QLearner::NoteFeedbackReceived(TrafficType t, uint64_t packet_id) {
+  Count(t, QRC_FEEDBACK_RECEIVED);
+  Time sent;
+  if (m_packet_info.GetPacketDequeueTime(packet_id, sent)) {
+    m_feedback_rtt[MultiClassQTable::ClassOf(t)].Add((Simulator::Now() - sent).GetNanoSeconds());
   }
 }
 
-bool QLearner::AddDestination (Ipv4Address via, Ipv4Address dst, Time t) {
-  bool regular_table = m_qtable.AddDestination(via,dst,t);
-  bool voip_table = m_qtable_voip.AddDestination(via,dst,t);
-  bool video_table = m_qtable_video.AddDestination(via,dst,t);
+void
+QLearner::WriteCountersToFile() {
+  std::stringstream filename, node;
+  filename << m_counters_prefix << m_this_node_ip << "_counters.csv";
+  node << m_this_node_ip;
+  std::ofstream os(filename.str().c_str(), m_counters_started ? std::ios::app : std::ios::trunc);
+  if (!os) {
+    NS_FATAL_ERROR(m_name << "Could not open " << filename.str() << " to write the counters to.");
+  }
+  if (!m_counters_started) {
+    WriteCountersHeader(os);
+    m_counters_started = true;
+  }
+  double now = Simulator::Now().GetSeconds();
+  for (uint32_t c = 0; c < MultiClassQTable::NR_QTABLE_CLASSES; c++) {
+    MultiClassQTable::QTableClass qtable_class = MultiClassQTable::QTableClass(c);
+    std::string name = MultiClassQTable::NameOf(qtable_class);
+    WriteCounters(os, now, node.str(), name, GetCounters(qtable_class));
+    WriteHistogram(os, now, node.str(), name, "feedback_rtt_ns", m_feedback_rtt[c]);
+  }
+  WriteHistogram(os, now, node.str(), "all", "route_wall_clock_ns", m_route_cost);
+}
+
+void
+QLearner::WritePeriodicCounters() {
+  WriteCountersToFile();
+  m_counters_event = Simulator::Schedule(m_counters_interval, &QLearner::WritePeriodicCounters, this);
+}
+
+QTable& QLearner::GetQTable(TrafficType t) {
+  return m_qtables.GetTable(t);
+}
 
-  NS_ASSERT( regular_table == voip_table);
-  NS_ASSERT( regular_table == video_table);
-  return regular_table && voip_table && video_table;
+bool QLearner::AddDestination (Ipv4Address via, Ipv4Address dst, Time t) {
+  return m_qtables.AddDestination(via,dst,t);
 }
 
 bool QLearner::CheckDestinationKnown(const Ipv4Address& i) {
-  NS_ASSERT(m_qtable.CheckDestinationKnown(i) == m_qtable_voip.CheckDestinationKnown(i));
-  NS_ASSERT(m_qtable_voip.CheckDestinationKnown(i) == m_qtable_video.CheckDestinationKnown(i));
-  return m_qtable.CheckDestinationKnown(i) && m_qtable_voip.CheckDestinationKnown(i) && m_qtable_video.CheckDestinationKnown(i);
+  return m_qtables.CheckDestinationKnown(i);
 }
 
 Ipv4Address QLearner::GetNextHop(Ipv4Address dst, TrafficType t) {
@@ -1586,9 +1779,7 @@ Ipv4Address QLearner::GetNextHop(Ipv4Address dst, TrafficType t) {
 }
 
 void QLearner::ChangeQValuesFromZero(Ipv4Address dst, Ipv4Address aodv_next_hop) {
-  m_qtable.ChangeQValuesFromZero(dst, aodv_next_hop);
-  m_qtable_voip.ChangeQValuesFromZero(dst, aodv_next_hop);
-  m_qtable_video.ChangeQValuesFromZero(dst, aodv_next_hop);
+  m_qtables.ChangeQValuesFromZero(dst, aodv_next_hop);
 }
 
 std::string QLearner::PrintQTable(TrafficType t) {
@@ -1674,7 +1865,7 @@ Time QLearner::TravelTimeHelper(QLrnInfoTag tag) {
 
 void QLearner::OutputDataToFile(PacketTimeSentTag ptst_tag, Ptr<const Packet> p, bool learning_packet, TrafficType t,Ipv4Address sourceIP) {
   PortNrTag pnt;
-  NS_ASSERT(p->PeekPacketTag(pnt));
+  NS_ASSERT(QRoutingTag::Get(p).Peek(pnt));
   uint64_t currDelay = (Simulator::Now() - ptst_tag.GetSentTime()).GetInteger();
 
   m_prev_delay = (m_prev_delay_per_prev_hop[ptst_tag.GetPrevHop()] == 0? currDelay:m_prev_delay_per_prev_hop[ptst_tag.GetPrevHop()]);
@@ -1702,37 +1893,55 @@ void QLearner::OutputDataToFile(PacketTimeSentTag ptst_tag, Ptr<const Packet> p,
     }
   }
 
-  bool delay_ok = currDelay < TrafficTypeReqsMap[t].GetDelayMax();
-  bool jitter_ok = jitter_val < TrafficTypeReqsMap[t].GetJitterMax();
+  bool delay_ok = currDelay < GetTrafficRequirements(t).GetDelayMax();
+  bool jitter_ok = jitter_val < GetTrafficRequirements(t).GetJitterMax();
   // std::cout << packet_loss << std::endl;
-  bool packet_loss_ok = packet_loss < TrafficTypeReqsMap[t].GetRandomLossMax();
+  bool packet_loss_ok = packet_loss < GetTrafficRequirements(t).GetRandomLossMax();
 
   NS_ASSERT(packet_loss >= 0);
   // if (packet_loss < 0) { packet_loss = 0; }
 
-  *(m_output_filestream->GetStream()) << p->GetUid() << "," << Simulator::Now().As(Time::S) << ","
-          << (Simulator::Now() - ptst_tag.GetSentTime()).As(Time::MS) << "," << ptst_tag.GetInitialEstim();
-  if (learning_packet)  { *(m_output_filestream->GetStream()) << ",learning,OK,OK,OK"; }
-  else                  {
-    *(m_output_filestream->GetStream()) << ",not_learning"
-        << (delay_ok?",OK":",NOK")
-        << (jitter_ok?",OK":",NOK")
-        << (packet_loss_ok?",OK":",NOK");
-  }
-  *(m_output_filestream->GetStream()) << "," << ptst_tag.GetPrevHop();
-  *(m_output_filestream->GetStream()) << "," << traffic_type_to_traffic_string(t) << "\n";
-
-  (m_output_filestream->GetStream())->flush();
+  uint8_t verdict = (learning_packet ? QLrnStatsSink::LEARNING : 0) | (delay_ok ? QLrnStatsSink::DELAY_OK : 0)
+                    | (jitter_ok ? QLrnStatsSink::JITTER_OK : 0) | (packet_loss_ok ? QLrnStatsSink::LOSS_OK : 0);
+  m_stats_sink->Record(p->GetUid(), Simulator::Now(), Simulator::Now() - ptst_tag.GetSentTime(), ptst_tag.GetInitialEstim(),
+                       verdict, ptst_tag.GetPrevHop(), t);
 }
 
 void QLearner::SetLearningTrafficGen( Ptr<Application> a ) {
   m_num_applications += 1;
   learning_traffic_applications = a;
+  m_learning_rate_control = 0;
 }
 
 void QLearner::SetTrafficGen(  Ptr<Application> a ) {
   m_num_applications += 1;
   real_traffic = a;
+  m_traffic_rate_control = 0;
+}
+
+TrafficRateControl* QLearner::LearningRateControl () {
+  if (m_learning_rate_control == 0) {
+    m_learning_rate_control = GetTrafficRateControl(learning_traffic_applications);
+  }
+  return m_learning_rate_control;
+}
+
+TrafficRateControl* QLearner::DataRateControl () {
+  if (m_traffic_rate_control == 0) {
+    m_traffic_rate_control = GetTrafficRateControl(real_traffic);
+  }
+  return m_traffic_rate_control;
+}
+
+void
+QLearner::VoteLearningRate (int vote) {
+  m_rate_votes += vote;
+  if (Simulator::Now() < m_next_rate_step || (uint32_t) std::abs(m_rate_votes) < m_rate_step_hysteresis) {
+    return;
+  }
+  LearningRateControl()->ScaleRate(m_rate_votes > 0 ? 1.5 : 0.5);
+  m_rate_votes = 0;
+  m_next_rate_step = Simulator::Now() + m_rate_step_interval;
 }
 
 } // Namespace ns3
@@ -36,6 +36,7 @@
 #include "ns3/socket-factory.h"
 #include "ns3/packet.h"
 #include "ns3/uinteger.h"
+#include "ns3/string.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/ipv4-routing-protocol.h"
 #include "ns3/ipv4-routing-helper.h"
@@ -52,10 +53,15 @@
 #include "ns3/tcp-header.h"
 #include "ns3/qlrn-header.h"
 #include "ns3/qos-qlrn-header.h"
+#include "ns3/qlrn-feedback-header.h"
 #include "ns3/thomas-packet-tags.h"
 #include "ns3/traffic-types.h"
 #include "ns3/qtable.h"
 #include "ns3/packettable.h"
+#include "ns3/qrouting-counters.h"
+#include "ns3/sent-packet-window.h"
+#include "ns3/qlrn-stats-sink.h"
+#include "ns3/traffic-rate-control.h"
 #include "ns3/mobility-module.h" /* makes STA mobile but we dont want any of that <-- needed for placement in grid */
 #include "ns3/thomas-configuration.h"
 #include <iomanip>
@@ -65,6 +71,8 @@
 // #include "ns3/ipv6-address.h"
 // #include "ns3/inet6-socket-address.h"
 
+class RateStepTestCase;
+
 namespace ns3 {
 
 int traffic_string_to_port_number (std::string traffic);
@@ -102,6 +110,8 @@ public:
   virtual bool CheckQLrnHeader_withoutUDP(Ptr<const Packet> p, QLrnHeader& qlrnHeader);
   virtual bool CheckQLrnHeader(Ptr<const Packet> p, QoSQLrnHeader& qlrnHeader);
   virtual bool CheckQLrnHeader_withoutUDP(Ptr<const Packet> p, QoSQLrnHeader& qlrnHeader);
+  // with FeedbackBatchSize > 0, all QLRN packets carry a QLrnFeedbackHeader instead
+  bool CheckQLrnFeedback(Ptr<const Packet> p, bool with_udp) { return m_feedback_batch_size > 0 && QLrnFeedbackHeader::IsFeedback(p, with_udp); }
 
   /**
   * TODO
@@ -136,6 +146,19 @@ public:
 
   /// if true, print qtables to files, if false, dont
   bool m_print_qtables;
+  /// simulated time between two samples of the recorded qtables, zero records every change
+  Time m_qtable_sampling_interval;
+
+  /**
+   * At m_snapshot_time (if not zero), the qtables and learning phases are saved to <m_snapshot_prefix><node ip>.qsnap.
+   * If m_warm_start_prefix is set, StartApplication loads them back from <m_warm_start_prefix><node ip>.qsnap,
+   * so that a run starts out converged instead of going through the learning phase again.
+   */
+  void SaveSnapshot();
+  void LoadSnapshot();
+  Time m_snapshot_time;
+  std::string m_snapshot_prefix;
+  std::string m_warm_start_prefix;
   std::string PrintQTable(TrafficType t) ;
   void FinaliseQTables(TrafficType t);
 
@@ -150,6 +173,18 @@ public:
   int QStatistics() { return m_control_packets_sent; }
   std::string GetStatistics();
 
+  /// Routing decisions and feedback of class c at this node, together with the transitions counted by its QTable
+  QRoutingCounters GetCounters(MultiClassQTable::QTableClass c);
+  /// Time (ns) from the MAC sending a packet of class c to the feedback about it arriving back here
+  const LogHistogram& GetFeedbackRtt(MultiClassQTable::QTableClass c) const { return m_feedback_rtt[c]; }
+  /// Wall clock time (ns) spent per call of Route, only measured when CountersPrefix is set
+  const LogHistogram& GetRouteCost() const { return m_route_cost; }
+  /**
+   * Appends the counters and histograms to <m_counters_prefix><node ip>_counters.csv (see WriteCounters in
+   * qrouting-counters.h), every m_counters_interval if that is not zero and when the application stops.
+   */
+  void WriteCountersToFile();
+
   Ptr<aodv::RoutingProtocol> GetAODV() { return aodvProto; }
   bool SetOtherQLearners(NodeContainer);
 
@@ -159,6 +194,8 @@ public:
    * TODO
    */
   QTable& GetQTable(TrafficType t);
+  // Replaces the qtables CreateQRoutingTable made, for code that drives the learner without running it (utils/bench-qlearner)
+  void SetQTables(const MultiClassQTable& qtables) { m_qtables = qtables; }
 
   void InitializeLearningPhases(std::vector<Ipv4Address>);
   void SetLearningPhase(bool b, Ipv4Address i) { m_learning_phase[i] = b; }
@@ -174,6 +211,10 @@ public:
   Ptr<Application> real_traffic;
   void SetLearningTrafficGen( Ptr<Application> a );
   void SetTrafficGen( Ptr<Application> a );
+  // The TrafficRateControl of learning_traffic_applications / real_traffic, looked up on first use and kept.
+  // Not when they are set, generators that are never throttled (e.g. V4Ping) don't have to implement it.
+  TrafficRateControl* LearningRateControl ();
+  TrafficRateControl* DataRateControl ();
 
   virtual void UpdateAvgDelay(PacketTimeSentTag,PortNrTag);
   float AvgDelayAsFloat() { return m_running_avg_latency.second; }
@@ -191,8 +232,14 @@ protected:
   virtual void DoDispose (void);
   virtual void StartApplication (void);
 private:
+  friend class ::RateStepTestCase;
+
   virtual void StopApplication (void);
 
+  // filled by LearningRateControl / DataRateControl
+  TrafficRateControl* m_learning_rate_control;
+  TrafficRateControl* m_traffic_rate_control;
+
   void RouteHelper(Ptr<Ipv4Route>, Ipv4Address, TrafficType, uint64_t&, int, Ptr<Packet>);
 
   /**
@@ -225,6 +272,11 @@ private:
   */
   void ReceiveAodv (Ptr<Socket> socket);
 
+  /**
+   * Learn from the feedback in one QLrnHeader, sent by from. packet is the packet that carried it.
+   */
+  void LearnFromQLrnHeader (Ipv4Address from, QLrnHeader& qlrnHeader, Ptr<Packet> packet);
+
 protected:
   uint32_t m_sent; //!< Counter for sent packets
   Ptr<Socket> m_socket; //!< Socket for potentially intercepting AODV traffic
@@ -233,16 +285,37 @@ protected:
   /// Callbacks for tracing the packet Tx events
   TracedCallback<Ptr<const Packet> > m_txTrace;
 
+  /**
+   * Feedback for a previous hop is sent as QLrnFeedbackHeader records once m_feedback_batch_size of them are waiting,
+   * or m_feedback_batch_delay after the first one was queued. With a batch size of 0, every record goes out right
+   * away as a QLrnHeader / QoSQLrnHeader of its own.
+   */
+  void QueueFeedback (Ipv4Address node_to_notify, const QLrnFeedbackRecord& record, bool qos);
+  void FlushFeedback (Ipv4Address node_to_notify);
+  uint32_t m_feedback_batch_size;
+  Time m_feedback_batch_delay;
+  std::map<Ipv4Address, QLrnFeedbackHeader> m_pending_feedback;
+  std::map<Ipv4Address, EventId> m_feedback_flush_event;
+
+  /**
+   * Every feedback that says to learn more (+1) or less (-1) about the destination we send to is a vote.
+   * The learning traffic is only scaled (x1.5 or x0.5) once the votes add up to m_rate_step_hysteresis either way,
+   * and at most once every m_rate_step_interval; the votes start over after every step.
+   */
+  void VoteLearningRate (int vote);
+  Time m_rate_step_interval;
+  uint32_t m_rate_step_hysteresis;
+  int m_rate_votes;
+  Time m_next_rate_step;
+
   /// Underlying routing protocol
   Ptr<aodv::RoutingProtocol> aodvProto;
 
   /// std::list of ipv4 addresses of neighbours
   std::vector<Ipv4Address> neighbours;
 
-  /// QTable
-  QTable m_qtable;
-  QTable m_qtable_video;
-  QTable m_qtable_voip;
+  /// QTables of the web, video and voip traffic classes
+  MultiClassQTable m_qtables;
 
   ///
   PacketTable m_packet_info;
@@ -299,7 +372,22 @@ protected:
 
   bool m_output_data_to_file;
   void OutputDataToFile(PacketTimeSentTag, Ptr<const Packet> p, bool learning_pkt,TrafficType t, Ipv4Address i);
-  Ptr<OutputStreamWrapper> m_output_filestream;
+  Ptr<QLrnStatsSink> m_stats_sink;
+
+  void Count(TrafficType t, QRoutingCounter c) { m_counters[MultiClassQTable::ClassOf(t)].Increment(c); }
+  // Counts a feedback record about packet_id and the round trip time of that packet, if the MAC sent it
+  void NoteFeedbackReceived(TrafficType t, uint64_t packet_id);
+  void WritePeriodicCounters();
+  std::array<QRoutingCounters, MultiClassQTable::NR_QTABLE_CLASSES> m_counters;
+  std::array<LogHistogram, MultiClassQTable::NR_QTABLE_CLASSES> m_feedback_rtt;
+  LogHistogram m_route_cost;
+  std::string m_counters_prefix;
+  Time m_counters_interval;
+  EventId m_counters_event;
+  // whether the file was started (with the header), and whether the final counters went into it (or there is
+  // nothing to write : no CountersPrefix, or the application has not started)
+  bool m_counters_started;
+  bool m_counters_done;
 
   bool m_report_dst_to_src;
 
@@ -317,8 +405,7 @@ protected:
 
   void RoutingPacketViaNeighbToDst(Ipv4Address via,Ipv4Address dst);
   uint64_t GetNumPktsSentViaNeighbToDst(uint64_t time,Ipv4Address via,Ipv4Address dst);
-  std::map<std::pair<Ipv4Address,Ipv4Address>,std::vector<std::tuple<uint64_t,uint64_t,float> > > m_packet_sent_stats_per_neighb_per_time;
-  void CleanTheNumPktsTimestampMap(uint64_t time,Ipv4Address via,Ipv4Address dst); // remove all timestamps that are higher than currtime - 30s or so ?
+  std::map<std::pair<Ipv4Address,Ipv4Address>,SentPacketWindow> m_packet_sent_stats_per_neighb_per_time; // over the last 5s
   void ReceivedPktFromPrevHopToDst(Ipv4Address prev_hop, Ipv4Address dst);
   uint64_t GetNumRecvPktFromPrevHopToDst(Ipv4Address prev_hop, Ipv4Address dst);
   std::map<std::pair<Ipv4Address,Ipv4Address> ,std::pair<uint64_t,float> > m_packet_recv_stats_per_neighb;
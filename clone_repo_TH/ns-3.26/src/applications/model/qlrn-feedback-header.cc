@@ -0,0 +1,262 @@
+#include "qlrn-feedback-header.h"
+#include "ns3/assert.h"
+
+namespace ns3 {
+
+static const uint8_t QLRN_FEEDBACK_MAGIC = 0xB7;
+static const uint8_t QLRN_FEEDBACK_FLAG_QOS = 0x01;
+static const uint8_t QLRN_FEEDBACK_TYPE_MASK = 0x0F;
+static const uint8_t QLRN_FEEDBACK_CONVERGED = 0x10;
+static const uint8_t QLRN_FEEDBACK_SAME_DST = 0x20;
+
+static uint32_t
+VarintSize (uint64_t v) {
+  uint32_t size = 1;
+  while (v >= 0x80) {
+    v >>= 7;
+    size++;
+  }
+  return size;
+}
+
+static void
+WriteVarint (Buffer::Iterator& i, uint64_t v) {
+  while (v >= 0x80) {
+    i.WriteU8(uint8_t(v | 0x80));
+    v >>= 7;
+  }
+  i.WriteU8(uint8_t(v));
+}
+
+// false if the buffer ends before the varint does (or it is longer than a uint64 can hold)
+static bool
+ReadVarint (Buffer::Iterator& i, uint64_t& v) {
+  v = 0;
+  for (uint32_t shift = 0; shift < 64; shift += 7) {
+    if (i.GetRemainingSize() == 0) {
+      return false;
+    }
+    uint8_t byte = i.ReadU8();
+    v |= uint64_t(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static uint64_t
+ZigZag (uint64_t current, uint64_t previous) {
+  int64_t diff = int64_t(current - previous);
+  return (uint64_t(diff) << 1) ^ uint64_t(diff >> 63);
+}
+
+static uint64_t
+UnZigZag (uint64_t encoded, uint64_t previous) {
+  int64_t diff = int64_t(encoded >> 1) ^ -int64_t(encoded & 1);
+  return previous + uint64_t(diff);
+}
+
+static bool
+IsKnownTrafficType (uint8_t type) {
+  return type == WEB  || type == ICMP || type == VIDEO ||
+         type == VOIP || type == UDP_ECHO || type == TRAFFIC_A ||
+         type == TRAFFIC_B || type == TRAFFIC_C || type == OTHER;
+}
+
+QLrnFeedbackRecord::QLrnFeedbackRecord () :
+  packet_id(0), time_as_int(0), next_estim(0), packet_dst(Ipv4Address(UNINITIALIZED_IP_ADDRESS_QLRN_HEADER)),
+  traffic_type(OTHER), sender_converged(false), real_delay(0), real_loss(0), num_pkts(0), made_at(0) { }
+
+QLrnHeader
+QLrnFeedbackRecord::ToQLrnHeader () const {
+  return QLrnHeader(packet_id, time_as_int, next_estim, sender_converged, packet_dst, traffic_type);
+}
+
+QoSQLrnHeader
+QLrnFeedbackRecord::ToQoSQLrnHeader () const {
+  return QoSQLrnHeader(packet_id, time_as_int, next_estim, real_delay, sender_converged, packet_dst, real_loss, num_pkts, traffic_type);
+}
+
+QLrnFeedbackHeader::QLrnFeedbackHeader (bool qos) : m_qos(qos), m_sent_at(0), m_valid(true) { }
+
+TypeId
+QLrnFeedbackHeader::GetTypeId () {
+  static TypeId tid = TypeId ("ns3::QLrnFeedbackHeader")
+    .SetParent<Header> ()
+    .SetGroupName("Applications")
+    .AddConstructor<QLrnFeedbackHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+QLrnFeedbackHeader::GetInstanceTypeId () const {
+  return GetTypeId();
+}
+
+uint32_t
+QLrnFeedbackHeader::GetSerializedSize () const {
+  uint32_t size = 2 + VarintSize(m_records.size());
+  if (m_qos) {
+    size += VarintSize(m_sent_at);
+  }
+  uint64_t prev_id = 0;
+  Ipv4Address prev_dst;
+  for (uint32_t r = 0; r < m_records.size(); r++) {
+    const QLrnFeedbackRecord& rec = m_records[r];
+    size += 1;
+    if (r == 0 || rec.packet_dst != prev_dst) {
+      size += 4;
+    }
+    size += VarintSize(ZigZag(rec.packet_id, prev_id)) + VarintSize(rec.time_as_int) + VarintSize(rec.next_estim);
+    if (m_qos) {
+      size += VarintSize(rec.real_delay) + VarintSize(rec.real_loss) + VarintSize(rec.num_pkts) + VarintSize(m_sent_at - rec.made_at);
+    }
+    prev_id = rec.packet_id;
+    prev_dst = rec.packet_dst;
+  }
+  return size;
+}
+
+void
+QLrnFeedbackHeader::Serialize (Buffer::Iterator start) const {
+  start.WriteU8(QLRN_FEEDBACK_MAGIC);
+  start.WriteU8(m_qos ? QLRN_FEEDBACK_FLAG_QOS : 0);
+  WriteVarint(start, m_records.size());
+  if (m_qos) {
+    WriteVarint(start, m_sent_at);
+  }
+
+  uint64_t prev_id = 0;
+  Ipv4Address prev_dst;
+  for (uint32_t r = 0; r < m_records.size(); r++) {
+    const QLrnFeedbackRecord& rec = m_records[r];
+    bool same_dst = r != 0 && rec.packet_dst == prev_dst;
+    start.WriteU8(uint8_t(rec.traffic_type) | (rec.sender_converged ? QLRN_FEEDBACK_CONVERGED : 0) | (same_dst ? QLRN_FEEDBACK_SAME_DST : 0));
+    if (!same_dst) {
+      uint8_t buf[4];
+      rec.packet_dst.Serialize (buf);
+      start.Write (buf, 4);
+    }
+    WriteVarint(start, ZigZag(rec.packet_id, prev_id));
+    WriteVarint(start, rec.time_as_int);
+    WriteVarint(start, rec.next_estim);
+    if (m_qos) {
+      NS_ASSERT_MSG(rec.made_at <= m_sent_at, "Feedback record made after the packet carrying it was sent.");
+      WriteVarint(start, rec.real_delay);
+      WriteVarint(start, rec.real_loss);
+      WriteVarint(start, rec.num_pkts);
+      WriteVarint(start, m_sent_at - rec.made_at);
+    }
+    prev_id = rec.packet_id;
+    prev_dst = rec.packet_dst;
+  }
+}
+
+uint32_t
+QLrnFeedbackHeader::Deserialize (Buffer::Iterator start) {
+  m_records.clear();
+  m_valid = false;
+  Buffer::Iterator i = start;
+  if (i.GetRemainingSize() < 3 || i.ReadU8() != QLRN_FEEDBACK_MAGIC) {
+    return 0;
+  }
+  m_qos = i.ReadU8() & QLRN_FEEDBACK_FLAG_QOS;
+  uint64_t nr_records;
+  if (!ReadVarint(i, nr_records) || (m_qos && !ReadVarint(i, m_sent_at))) {
+    return 0;
+  }
+
+  uint64_t prev_id = 0;
+  Ipv4Address prev_dst;
+  for (uint64_t r = 0; r < nr_records; r++) {
+    if (i.GetRemainingSize() == 0) {
+      return 0;
+    }
+    uint8_t flags = i.ReadU8();
+    QLrnFeedbackRecord rec;
+    if (!IsKnownTrafficType(flags & QLRN_FEEDBACK_TYPE_MASK)) {
+      return 0;
+    }
+    rec.traffic_type = TrafficType(flags & QLRN_FEEDBACK_TYPE_MASK);
+    rec.sender_converged = flags & QLRN_FEEDBACK_CONVERGED;
+    if (flags & QLRN_FEEDBACK_SAME_DST) {
+      if (r == 0) {
+        return 0;
+      }
+      rec.packet_dst = prev_dst;
+    } else {
+      if (i.GetRemainingSize() < 4) {
+        return 0;
+      }
+      uint8_t buf[4];
+      i.Read (buf, 4);
+      rec.packet_dst = Ipv4Address::Deserialize (buf);
+    }
+    uint64_t id, loss, num_pkts, age;
+    if (!ReadVarint(i, id) || !ReadVarint(i, rec.time_as_int) || !ReadVarint(i, rec.next_estim)) {
+      return 0;
+    }
+    rec.packet_id = UnZigZag(id, prev_id);
+    if (m_qos) {
+      if (!ReadVarint(i, rec.real_delay) || !ReadVarint(i, loss) || !ReadVarint(i, num_pkts) || !ReadVarint(i, age) || age > m_sent_at) {
+        return 0;
+      }
+      rec.real_loss = loss;
+      rec.num_pkts = num_pkts;
+      rec.made_at = m_sent_at - age;
+    }
+    m_records.push_back(rec);
+    prev_id = rec.packet_id;
+    prev_dst = rec.packet_dst;
+  }
+
+  uint32_t dist = i.GetDistanceFrom (start);
+  if (dist != GetSerializedSize ()) {
+    // not written by Serialize (overlong varints, stray flag bits), so not ours
+    return 0;
+  }
+  m_valid = true;
+  return dist;
+}
+
+void
+QLrnFeedbackHeader::Print (std::ostream &os) const {
+  os << "========QLRNFEEDBACKHEADER=========\n";
+  os << (m_qos ? "qos" : "no qos") << ", " << m_records.size() << " records";
+  if (m_qos) {
+    os << ", sent at " << m_sent_at;
+  }
+  os << std::endl;
+  for (const auto& rec : m_records) {
+    os << "PacketID " << rec.packet_id << " time recv " << rec.time_as_int << " my estim " << rec.next_estim
+       << " pkt dst " << rec.packet_dst << " type " << rec.traffic_type << (rec.sender_converged ? " sndr conv" : " sndr no conv");
+    if (m_qos) {
+      os << " delay " << rec.real_delay << " loss " << rec.real_loss << " nr pkts " << rec.num_pkts << " made at " << rec.made_at;
+    }
+    os << std::endl;
+  }
+}
+
+bool
+QLrnFeedbackHeader::IsFeedback (Ptr<const Packet> p, bool with_udp) {
+  uint32_t offset = with_udp ? 8 : 0;
+  if (p->GetSize() < offset + 3) {
+    return false;
+  }
+  // cheap look at the first byte behind the udp header before really parsing anything
+  uint8_t start[9];
+  p->CopyData(start, offset + 1);
+  if (start[offset] != QLRN_FEEDBACK_MAGIC) {
+    return false;
+  }
+  QLrnFeedbackHeader feedback;
+  if (with_udp) {
+    Ptr<Packet> payload = p->CreateFragment(offset, p->GetSize() - offset);
+    return payload->PeekHeader(feedback) == payload->GetSize() && feedback.IsValid();
+  }
+  return p->PeekHeader(feedback) == p->GetSize() && feedback.IsValid();
+}
+
+} //namespace ns3
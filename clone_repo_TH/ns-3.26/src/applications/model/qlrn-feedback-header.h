@@ -0,0 +1,89 @@
+#ifndef QLRN_FEEDBACK_HEADER_H
+#define QLRN_FEEDBACK_HEADER_H
+
+#include "ns3/header.h"
+#include "ns3/packet.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/qlrn-header.h"
+#include "ns3/qos-qlrn-header.h"
+#include "ns3/traffic-types.h"
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * What one QLrnHeader / QoSQLrnHeader used to carry, as one entry of a QLrnFeedbackHeader.
+ * The QoS fields are left at 0 by the plain QLearner.
+ */
+struct QLrnFeedbackRecord {
+  QLrnFeedbackRecord ();
+
+  QLrnHeader ToQLrnHeader () const;
+  QoSQLrnHeader ToQoSQLrnHeader () const;
+
+  uint64_t    packet_id;        /// uid of packet that triggered this feedback
+  uint64_t    time_as_int;      /// travel time of that packet
+  uint64_t    next_estim;       /// next estimate
+  Ipv4Address packet_dst;
+  TrafficType traffic_type;
+  bool        sender_converged;
+  // QoS only
+  uint64_t    real_delay;
+  uint16_t    real_loss;
+  uint32_t    num_pkts;         /// number of packets the sender of the feedback received from the prev hop
+  uint64_t    made_at;          /// time (ns) the feedback was made at, counts of sent packets are compared as of this time
+};
+
+/**
+* \brief   QLrn feedback header, several feedback records for the same previous hop in one packet
+  \verbatim
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  |  Magic (0xB7) |     Flags     | Nr of records ~
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  | (QoS) time the packet was sent ~
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  |  Type | C | S |  (!S) DestinationAddress      ~
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  | Packet UID - UID of previous record ~ Time packet arrived ~ next estim ~
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  | (QoS) real delay ~ real loss ~ nr of pkts received ~ age of the record ~
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  \endverbatim
+  Fields ending in ~ are LEB128 varints, the UID difference is zigzag encoded. Flags bit 0 marks QoS records.
+  Per record, C is the sender converged bit and S says the destination is the same as in the previous record.
+*/
+class QLrnFeedbackHeader : public Header
+{
+public:
+  QLrnFeedbackHeader (bool qos = false);
+
+  static TypeId GetTypeId ();
+  TypeId GetInstanceTypeId () const;
+  uint32_t GetSerializedSize () const;
+  void Serialize (Buffer::Iterator start) const;
+  uint32_t Deserialize (Buffer::Iterator start);
+  void Print (std::ostream &os) const;
+
+  // true if p starts with a valid QLrnFeedbackHeader (behind a udp header if with_udp) that spans the whole packet.
+  // The first byte of a QLrnHeader / QoSQLrnHeader can be anything, so only ask this when feedback is being batched.
+  static bool IsFeedback (Ptr<const Packet> p, bool with_udp);
+
+  void AddRecord (const QLrnFeedbackRecord& r) { m_records.push_back(r); }
+  const std::vector<QLrnFeedbackRecord>& GetRecords () const { return m_records; }
+  uint32_t GetNRecords () const { return m_records.size(); }
+  bool IsQoS () const { return m_qos; }
+  void SetSentTime (uint64_t t) { m_sent_at = t; }
+  uint64_t GetSentTime () const { return m_sent_at; }
+
+  bool IsValid () const { return m_valid; }
+
+private:
+  bool m_qos;
+  uint64_t m_sent_at;
+  std::vector<QLrnFeedbackRecord> m_records;
+  bool m_valid;
+};
+
+}
+
+#endif /* QLRN_FEEDBACK_HEADER_H */
@@ -0,0 +1,51 @@
+#include "qlrn-stats-sink.h"
+#include "ns3/fatal-impl.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("QLrnStatsSink");
+
+/* size of the stream buffer, the file is written in chunks of this many bytes */
+static const size_t QLRN_STATS_SINK_CHUNK_SIZE = 1 << 20;
+
+QLrnStatsSink::QLrnStatsSink(std::string filename) :
+  m_filename(filename), m_buffer(QLRN_STATS_SINK_CHUNK_SIZE), m_closed(false) {
+  // the buffer has to be set before the file is opened for libstdc++ to use it
+  m_out.rdbuf()->pubsetbuf(&m_buffer[0], m_buffer.size());
+  m_out.open(m_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  NS_ASSERT_MSG(m_out.is_open(), "Could not open " << m_filename << " to write the statistics in.");
+  FatalImpl::RegisterStream(&m_out);
+  m_out.write("QST1", 4);
+}
+
+QLrnStatsSink::~QLrnStatsSink() {
+  Close();
+}
+
+void
+QLrnStatsSink::Record(uint64_t uid, Time now, Time delay, Time initial_estim, uint8_t verdict, Ipv4Address prev_hop, TrafficType t) {
+  if (m_closed) {
+    return;
+  }
+  Put<uint64_t>(uid);
+  Put<int64_t>(now.GetInteger());
+  Put<int64_t>(delay.GetInteger());
+  Put<int64_t>(initial_estim.GetInteger());
+  Put<uint32_t>(prev_hop.Get());
+  Put<uint8_t>(verdict);
+  Put<uint8_t>(t);
+}
+
+void
+QLrnStatsSink::Close() {
+  if (m_closed) {
+    return;
+  }
+  m_closed = true;
+  FatalImpl::UnregisterStream(&m_out);
+  m_out.close();
+}
+
+} //namespace ns3
@@ -0,0 +1,54 @@
+#ifndef QLRN_STATS_SINK_H
+#define QLRN_STATS_SINK_H
+
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/traffic-types.h"
+#include <fstream>
+#include <vector>
+#include <string>
+
+namespace ns3 {
+
+/**
+ * Per-packet statistics of the traffic arriving at a destination (the out_stats_<algorithm>_node<id> files),
+ * written as fixed-width binary records instead of one flushed csv line per packet.
+ *
+ * The records go through a large stream buffer, so the file is written in chunks. The stream is registered
+ * with FatalImpl, so what is buffered still ends up in the file when the simulation dies on an assert.
+ * convertQLrnStats.py turns the file back into the csv plot_jitter_graph.py reads.
+ *
+ * File layout (native byte order) : the magic "QST1", followed by records of 38 bytes
+ *   uint64 packet uid, int64 time (ns), int64 delay (ns), int64 initial estimate (ns),
+ *   uint32 second to last hop ip, uint8 verdict bits (see Verdict), uint8 traffic type
+ */
+class QLrnStatsSink : public SimpleRefCount<QLrnStatsSink> {
+public:
+  enum Verdict {
+    LEARNING  = 0x01,
+    DELAY_OK  = 0x02,
+    JITTER_OK = 0x04,
+    LOSS_OK   = 0x08
+  };
+
+  QLrnStatsSink(std::string filename);
+  ~QLrnStatsSink();
+
+  void Record(uint64_t uid, Time now, Time delay, Time initial_estim, uint8_t verdict, Ipv4Address prev_hop, TrafficType t);
+  // Writes what is buffered and closes the file. Further records are ignored.
+  void Close();
+
+private:
+  template <typename T>
+  void Put(T value) { m_out.write(reinterpret_cast<const char*>(&value), sizeof(value)); }
+
+  std::string m_filename;
+  std::vector<char> m_buffer;
+  std::ofstream m_out;
+  bool m_closed;
+};
+
+} //namespace ns3
+
+#endif /* QLRN_STATS_SINK_H */
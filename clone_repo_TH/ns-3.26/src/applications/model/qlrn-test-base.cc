@@ -10,12 +10,22 @@ QLearningBase::QLearningBase () :
   pcap (false),
   printRoutes (false),
   printQTables(false),
+  qtableSamplingInterval(0),
+  feedbackBatchSize(0),
+  feedbackBatchDelay(5),
+  snapshotAt(0),
+  snapshotPrefix("qsnap_"),
+  warmStartPrefix(""),
+  countersPrefix(""),
+  countersInterval(0),
+  trafficRequirements(""),
   linkBreak (false),
   linkUnBreak (false),
   qlearn(true),
   numHops(4),
   node_to_break(999999),
   eps(0.05),
+  gamma(DEFAULT_GAMMA_VALUE),
   learning_rate(0.5),
   fixLocs(false),
   traffic("ping"),
@@ -31,7 +41,10 @@ QLearningBase::QLearningBase () :
   m_type_of_run("n/a"),
   metrics_back_to_src(false),
   smaller_learning_traffic(false),
-  interferer(0)
+  interferer(0),
+  m_run_sim_s(0),
+  m_run_events(0),
+  m_run_wall_s(0)
 {
   DataGeneratingApplications = ApplicationContainer();
   LearningGeneratingApplications = ApplicationContainer();
@@ -89,6 +102,10 @@ bool QLearningBase::ConfigureTest(
     rho = test_case.GetRho();
     q_conv_thresh = test_case.GetQConvThresh();
     learn_more_threshold = test_case.GetLrnMoreThreshold();
+    // the requirements are shared by every test in the run, the command line has the last word
+    ResetTrafficRequirements();
+    ConfigureTrafficRequirements(test_case.GetTrafficRequirements());
+    ConfigureTrafficRequirements(trafficRequirements);
 
     for (const auto& i : test_case.GetBreakIds()) {
       NS_ASSERT(i > 0 && i < int(numberOfNodes)); //just to see if its possible to do this iteration in the try block
@@ -185,6 +202,15 @@ QLearningBase::Configure (int argc, char **argv)
   cmd.AddValue ("pcap", "enable / disable pcap trace output", pcap);
   cmd.AddValue ("printRoutes", "enable / disable routing table output", printRoutes);
   cmd.AddValue ("printQTables", "enable / disable printing of QTables", printQTables);
+  cmd.AddValue ("qtableSamplingInterval", "ms of simulated time between two samples of printed QTables (0 = every change)", qtableSamplingInterval);
+  cmd.AddValue ("feedbackBatchSize", "Number of QLRN feedback records sent together to a previous hop (0 = one QLrnHeader per packet)", feedbackBatchSize);
+  cmd.AddValue ("feedbackBatchDelay", "ms a QLRN feedback record waits at most for its batch to fill up", feedbackBatchDelay);
+  cmd.AddValue ("snapshotAt", "Time (s) at which every node saves its qtables to <snapshotPrefix><ip>.qsnap (0 = never)", snapshotAt);
+  cmd.AddValue ("snapshotPrefix", "Prefix of the qtable snapshot files", snapshotPrefix);
+  cmd.AddValue ("warmStartPrefix", "Start from the qtable snapshots <warmStartPrefix><ip>.qsnap instead of empty qtables", warmStartPrefix);
+  cmd.AddValue ("countersPrefix", "Write the Q-routing counters and histograms of every node to <countersPrefix><ip>_counters.csv (empty = off)", countersPrefix);
+  cmd.AddValue ("countersInterval", "Time (s) between two writes of the counters (0 = only at the end)", countersInterval);
+  cmd.AddValue ("trafficRequirements", "Override the jitter (ms), delay (ms) and loss the traffic types require, e.g. trafficA=40:80:0.001/trafficC=400:400:0.1", trafficRequirements);
   cmd.AddValue ("numberOfNodes", "Number of nodes in the net, larger than 1", numberOfNodes);
   cmd.AddValue ("totalTime", "Simulation time in seconds", totalTime);
   cmd.AddValue ("linkBreak", "Makes some node part of the path between src and dst unresponsive.", linkBreak);
@@ -227,9 +253,11 @@ QLearningBase::Configure (int argc, char **argv)
   if (test_case_filename != "") {
     if (!test_case.FromFile("QLearningTests/" + test_case_filename)) { NS_FATAL_ERROR("loading test_case failed. Check the input file."); }
     numberOfNodes = test_case.GetNoN();
+    ConfigureTrafficRequirements(test_case.GetTrafficRequirements());
   } else {
     // Do nothing
   }
+  ConfigureTrafficRequirements(trafficRequirements);
   NS_ASSERT_MSG (numHops <= numberOfNodes or not linkBreak, "We wont be able to trigger a link breaking this far downstream as the path cannot possibly be that long.");
   NS_ASSERT_MSG (numberOfNodes > 1, "We need at least 2 nodes, otherwise there is no traffic to analyse.");
 
@@ -311,6 +339,16 @@ QLearningBase::DetermineNodeToBreak () {
   }
 }
 
+void
+QLearningBase::RunSimulator () {
+  auto start = std::chrono::steady_clock::now();
+  uint64_t events = Simulator::GetEventCount();
+  Simulator::Run ();
+  m_run_wall_s = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+  m_run_events = Simulator::GetEventCount() - events;
+  m_run_sim_s = Simulator::Now().GetSeconds();
+}
+
 void
 QLearningBase::ReportProgress() {
   std::cout << "Currently at time T = " << Simulator::Now().As(Time::S) << ".\n";
@@ -373,8 +411,8 @@ void QLearningBase::HandleTrafficEvent(TestEvent i) {
     );
     Simulator::Schedule (Seconds (i.t), &QLearner::SetLearningPhase, qq, true, interfaces.GetAddress(i.node_rx));
 
-    dynamic_cast<OnOffApplication&> ( *(PeekPointer(EventLearningGeneratingApplications.Get(EventLearningGeneratingApplications.GetN()-1) ) ) ).SetMaxBytes(FREEZE_ONOFFAPPLICATION_SENDING);
-    dynamic_cast<OnOffApplication&> ( *(PeekPointer(EventDataGeneratingApplications.Get(EventDataGeneratingApplications.GetN()-1) ) ) ).SetMaxBytes(FREEZE_ONOFFAPPLICATION_SENDING);
+    qq->LearningRateControl()->Freeze();
+    qq->DataRateControl()->Freeze();
   } else {
     // dont freeze either onoff appl
   }
@@ -460,7 +498,7 @@ QLearningBase::Run ()
     }
   }
 
-  Simulator::Run ();
+  RunSimulator ();
 
 
   // For checking icmp dropped-ness
@@ -1191,7 +1229,7 @@ bool QLearningBase::RunTest(std::string& err) {
 
   }
 
-  Simulator::Run ();
+  RunSimulator ();
 
   if (qlearn && m_type_of_run == "n/a") {
     for (unsigned int i = 0; i < numberOfNodes; i++) {
@@ -1427,7 +1465,7 @@ QLearningBase::CreateAndPlaceNodes ()
       "MinY", DoubleValue (30.0));
     mobility.Install (nodes.Get (numberOfNodes - 1));
   } else if (test_case.IsLoaded() && !fixLocs) {
-    uint8_t index = 0;
+    uint32_t index = 0;
     for (const auto& location : test_case.GetLocations()) {
       mobility.SetPositionAllocator ("ns3::GridPositionAllocator",
         "MinX", DoubleValue (location.first),
@@ -1499,7 +1537,12 @@ QLearningBase::InstallInternetStack ()
   // }
 
   Ipv4AddressHelper addresses;
-  addresses.SetBase("10.1.1.0", "255.255.225.0");
+  if (numberOfNodes < 255) {
+    addresses.SetBase("10.1.1.0", "255.255.225.0");
+  } else {
+    // 10.1.1.x runs out of addresses, continue in 10.1.2.x and on (the source stays 10.1.1.1)
+    addresses.SetBase("10.1.0.0", "255.255.0.0", "0.0.1.1");
+  }
 
   interfaces = addresses.Assign (devices);
 
@@ -1761,11 +1804,7 @@ QLearningBase::InstallApplications ()
       NS_ASSERT_MSG(DataGeneratingApplications.GetN() > 0, "We do need some application to generate traffic or it won't make any sense.");
 
       // In this case, we should freeze the traffic generating thing until the QLearner has converged to some values!
-      try {
-        dynamic_cast<OnOffApplication&> ( *(PeekPointer(DataGeneratingApplications.Get(0))) ).SetMaxBytes(FREEZE_ONOFFAPPLICATION_SENDING);
-      } catch (std::exception bc) {
-        NS_FATAL_ERROR("We expect all traffic generators to be OnOffGenerators right now, due to the changes that were made to OnOffApplication to make it stop/start." << bc.what());
-      }
+      GetTrafficRateControl(DataGeneratingApplications.Get(0))->Freeze();
 
       NS_ASSERT_MSG(ctr <= 2, "too many traffics specified!");
     }
@@ -1811,6 +1850,14 @@ QLearningBase::InstallApplications ()
   if (qlearn) {
     qlrn = QLearnerHelper(eps, learning_rate, gamma, q_conv_thresh, rho, learn_more_threshold, in_test,
                           max_retry, ideal, learning_phases, m_qos_qlearning, m_output_stats, printQTables, metrics_back_to_src);
+    qlrn.SetAttribute("QTableSamplingInterval", TimeValue(MilliSeconds(qtableSamplingInterval)));
+    qlrn.SetAttribute("FeedbackBatchSize", UintegerValue(feedbackBatchSize));
+    qlrn.SetAttribute("FeedbackBatchDelay", TimeValue(MilliSeconds(feedbackBatchDelay)));
+    qlrn.SetAttribute("SnapshotTime", TimeValue(Seconds(snapshotAt)));
+    qlrn.SetAttribute("SnapshotPrefix", StringValue(snapshotPrefix));
+    qlrn.SetAttribute("WarmStartPrefix", StringValue(warmStartPrefix));
+    qlrn.SetAttribute("CountersPrefix", StringValue(countersPrefix));
+    qlrn.SetAttribute("CountersInterval", TimeValue(Seconds(countersInterval)));
 
     QLearners = qlrn.Install (nodes);
     QLearners.Start (Seconds(4));
@@ -26,6 +26,7 @@
 #include <iostream>
 #include <cmath>
 #include <algorithm>
+#include <chrono>
 #ifndef Q_LEARN_BASE_TEST_H_
 #define Q_LEARN_BASE_TEST_H_
 
@@ -62,6 +63,17 @@ public:
   ApplicationContainer GetQLearners() { return QLearners; }
 
   void SetTotalTime (double t) { totalTime = t; }
+  /// Overrides of what Configure / ConfigureTest set, for parameter sweeps (call before Run / RunTest)
+  void SetEps (float e) { eps = e; }
+  void SetLearningRate (float l) { learning_rate = l; }
+  void SetGamma (float g) { gamma = g; }
+  void SetRho (float r) { rho = r; }
+  void SetTraffic (std::string t) { traffic = t; }
+
+  /// Simulated seconds, events executed and wall clock seconds of the Simulator::Run of the last Run / RunTest
+  double GetRunSimSeconds () { return m_run_sim_s; }
+  uint64_t GetRunEvents () { return m_run_events; }
+  double GetRunWallSeconds () { return m_run_wall_s; }
 
   void NullInterfererSocket() { interferer = 0; }
 
@@ -78,6 +90,20 @@ private:
   bool printRoutes;
   /// Print qtables if true
   bool printQTables;
+  /// Simulated ms between two samples of the printed qtables, 0 samples every change
+  uint32_t qtableSamplingInterval;
+  /// Feedback records per QLRN packet (0 = one QLrnHeader per packet) and the ms they wait at most for a full batch
+  uint32_t feedbackBatchSize;
+  uint32_t feedbackBatchDelay;
+  /// Time (s) the qtables are saved at (0 = never), the prefix of those files, and the prefix of the ones to start from
+  double snapshotAt;
+  std::string snapshotPrefix;
+  std::string warmStartPrefix;
+  /// Prefix of the files the Q-routing counters are written to (empty = off), and the time (s) between two writes (0 = at the end)
+  std::string countersPrefix;
+  double countersInterval;
+  /// Requirements of the traffic types that differ from the defaults, see ConfigureTrafficRequirements (empty = none)
+  std::string trafficRequirements;
   /// Link break somewhere? (and unbreak?)
   bool linkBreak;
   bool linkUnBreak;
@@ -161,8 +187,14 @@ private:
   Ptr<Socket> interferer;
   std::vector<Ipv4Address> traffic_sources;
   std::vector<Ipv4Address> traffic_destinations;
+  /// What RunSimulator measured
+  double m_run_sim_s;
+  uint64_t m_run_events;
+  double m_run_wall_s;
 private:
   void HandleTrafficEvent(TestEvent);
+  /// Simulator::Run, measuring how fast the simulation went
+  void RunSimulator ();
 
   void CreateAndPlaceNodes ();
   void CreateDevices ();
@@ -154,7 +154,7 @@ bool QLrnTest::FromFile(std::string filename) {
     while (std::getline(infile,line)){
       file.push_back(line);
     }
-  } catch (std::exception e &) {
+  } catch (std::exception& e) {
     std::cout << "Got an exception while trying to read the file." << e.what() << std::endl;
   }
 
@@ -183,6 +183,7 @@ bool QLrnTest::FromFile(std::string filename) {
     m_max_retry = std::stoi(GetValue("\"max_retry\":",file[i+nr_of_variables], nr_of_variables, "4"));
     m_learn_more_threshold = std::stof(GetValue("\"learn_more_threshold\":",file[i+nr_of_variables], nr_of_variables, "0.025"));
     m_gamma = std::stof( GetValue("\"gamma\":",file[i+nr_of_variables], nr_of_variables,"0") );
+    m_traffic_requirements = GetValue("\"traffic_requirements\":",file[i+nr_of_variables], nr_of_variables, "");
 
     running_index = i+nr_of_variables+1; //+1 to go to the nodeX{ line
     for (uint j = 0; j < m_number_of_nodes; j++) {
@@ -218,6 +219,7 @@ std::string QLrnTest::PrettyPrint() {
   ss << (m_metrics_back_to_src ? "     - Metrics about real time are being comm'ed back to src":"     - Metrics about real time are not being sent back to src") << std::endl;
   ss << (m_small_learning_stream ? "    - A small stream of learning traffic remains in data phase" : " no small learning traffic remains." ) << std::endl;
   ss << "Rho = " << m_rho << "     - max retry = " << m_max_retry << "     - m_qconv = " << m_q_conv_thresh << "     - m_lrn_more_th = " << m_learn_more_threshold << "    - gamma = " << m_gamma;
+  ss << (m_traffic_requirements.empty() ? "" : "     - requirements: " + m_traffic_requirements);
   ss <<  std::endl << std::endl;
   return ss.str();
 }
@@ -283,7 +285,7 @@ bool QLrnTestResult::FromFile(std::string filename) {
 
   try {
     infile.open(filename);
-  } catch (std::exception e &) {
+  } catch (std::exception& e) {
     std::cout << e.what() << std::endl;
     NS_ASSERT(false);
   }
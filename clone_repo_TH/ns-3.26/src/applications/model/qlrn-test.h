@@ -70,6 +70,7 @@ public:
   float GetRho() { return m_rho; }
   int GetMaxRetry() { return m_max_retry; }
   float GetLrnMoreThreshold() { return m_learn_more_threshold; }
+  std::string GetTrafficRequirements() { return m_traffic_requirements; }
   std::string PrettyPrint();
   std::vector<TestEvent> GetEvents() { return m_test_events; }
 private:
@@ -106,6 +107,7 @@ private:
   int m_max_retry;
   float m_gamma;
   float m_learn_more_threshold;
+  std::string m_traffic_requirements;
   std::vector<TestEvent> m_test_events;
 };
 
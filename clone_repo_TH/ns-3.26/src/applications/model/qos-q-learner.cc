@@ -52,6 +52,11 @@ QoSQLearner::GetTypeId (void)
                    BooleanValue(false),
                    MakeBooleanAccessor(&QoSQLearner::m_print_qtables),
                    MakeBooleanChecker())
+    .AddAttribute ("QTableSamplingInterval",
+                   "Simulated time between two samples when printing QTables, zero samples every change.",
+                   TimeValue(Seconds(0)),
+                   MakeTimeAccessor(&QoSQLearner::m_qtable_sampling_interval),
+                   MakeTimeChecker())
    .AddAttribute ("QConvergenceThreshold",
                    "Specify % difference allowable in QValue when looking at converged / not converged",
                    DoubleValue(QTABLE_CONVERGENCE_THRESHOLD),
@@ -72,6 +77,51 @@ QoSQLearner::GetTypeId (void)
                    BooleanValue(false),
                    MakeBooleanAccessor (&QoSQLearner::m_in_test),
                    MakeBooleanChecker ())
+    .AddAttribute ("FeedbackBatchSize",
+                   "Number of feedback records for the same previous hop sent together in one QLRN packet, 0 sends a QoSQLrnHeader per record.",
+                   UintegerValue(0),
+                   MakeUintegerAccessor(&QoSQLearner::m_feedback_batch_size),
+                   MakeUintegerChecker<uint32_t>())
+    .AddAttribute ("FeedbackBatchDelay",
+                   "Longest time a feedback record waits for others to fill up its batch.",
+                   TimeValue(MilliSeconds(5)),
+                   MakeTimeAccessor(&QoSQLearner::m_feedback_batch_delay),
+                   MakeTimeChecker())
+    .AddAttribute ("RateStepInterval",
+                   "Shortest time between two changes of the rate of the learning traffic, zero lets every step through.",
+                   TimeValue(Seconds(0)),
+                   MakeTimeAccessor(&QoSQLearner::m_rate_step_interval),
+                   MakeTimeChecker())
+    .AddAttribute ("RateStepHysteresis",
+                   "Net number of learn more / learn less votes needed to change the rate of the learning traffic.",
+                   UintegerValue(1),
+                   MakeUintegerAccessor(&QoSQLearner::m_rate_step_hysteresis),
+                   MakeUintegerChecker<uint32_t>(1))
+    .AddAttribute ("SnapshotTime",
+                   "Time at which the qtables are saved to <SnapshotPrefix><node ip>.qsnap, zero never saves them.",
+                   TimeValue(Seconds(0)),
+                   MakeTimeAccessor(&QoSQLearner::m_snapshot_time),
+                   MakeTimeChecker())
+    .AddAttribute ("SnapshotPrefix",
+                   "Prefix of the files the qtables are saved to at SnapshotTime.",
+                   StringValue("qsnap_"),
+                   MakeStringAccessor(&QoSQLearner::m_snapshot_prefix),
+                   MakeStringChecker())
+    .AddAttribute ("WarmStartPrefix",
+                   "If not empty, the qtables are loaded from <WarmStartPrefix><node ip>.qsnap when the application starts.",
+                   StringValue(""),
+                   MakeStringAccessor(&QoSQLearner::m_warm_start_prefix),
+                   MakeStringChecker())
+    .AddAttribute ("CountersPrefix",
+                   "If not empty, the Q-routing counters and histograms are written to <CountersPrefix><node ip>_counters.csv.",
+                   StringValue(""),
+                   MakeStringAccessor(&QoSQLearner::m_counters_prefix),
+                   MakeStringChecker())
+    .AddAttribute ("CountersInterval",
+                   "Simulated time between two writes of the counters, zero only writes them when the application stops.",
+                   TimeValue(Seconds(0)),
+                   MakeTimeAccessor(&QoSQLearner::m_counters_interval),
+                   MakeTimeChecker())
     .AddAttribute ("Ideal",
                     "Specify ideal or not",
                     BooleanValue(false),
@@ -162,6 +212,7 @@ QoSQLearner::Send(Ipv4Address node_to_notify, uint64_t packet_Uid, Time travel_t
   Ptr<Packet> packet = Create<Packet> ();
 
   // std::cout << "going to be doing the find by ref thing here now;.." << std::endl;
+  Count(t, QRC_FEEDBACK_SENT);
   QoSQLrnHeader qLrnHeader (  packet_Uid, travel_time.GetInteger(), next_estim,
                               qte_next_hop.GetRealDelay(), sender_converged, packet_dst,
                               (
@@ -172,6 +223,21 @@ QoSQLearner::Send(Ipv4Address node_to_notify, uint64_t packet_Uid, Time travel_t
                               ),
                               GetNumRecvPktFromPrevHopToDst(node_to_notify, packet_dst), t);
   // std::cout << "and done....." << std::endl;
+  if (m_feedback_batch_size > 0) {
+    QLrnFeedbackRecord record;
+    record.packet_id = packet_Uid;
+    record.time_as_int = qLrnHeader.GetTime();
+    record.next_estim = qLrnHeader.GetNextEstim();
+    record.packet_dst = packet_dst;
+    record.traffic_type = t;
+    record.sender_converged = sender_converged;
+    record.real_delay = qLrnHeader.GetRealDelay();
+    record.real_loss = qLrnHeader.GetRealLoss();
+    record.num_pkts = qLrnHeader.GetNumPktsThatSenderReceivedFromMe();
+    record.made_at = Simulator::Now().GetInteger();
+    QueueFeedback(node_to_notify, record, true);
+    return;
+  }
 
 
   // if (GetNode()->GetId() == 2) {
@@ -203,14 +269,31 @@ void QoSQLearner::Receive(Ptr<Socket> socket) {
   Ptr<Packet> packet = socket->RecvFrom (sourceAddress);
   Ipv4Address sourceIPAddress = InetSocketAddress::ConvertFrom (sourceAddress).GetIpv4 ();
 
-  TrafficType t = OTHER;
+  if (CheckQLrnFeedback(packet, false)) {
+    QLrnFeedbackHeader feedback;
+    packet->RemoveHeader(feedback);
+    NS_ASSERT_MSG(feedback.IsQoS(), "Feedback without QoS metrics received by a QoSQLearner.");
+    for (const auto& record : feedback.GetRecords()) {
+      QoSQLrnHeader qlrnHeader = record.ToQoSQLrnHeader();
+      LearnFromQoSQLrnHeader(sourceIPAddress, qlrnHeader, record.made_at, packet);
+    }
+    return;
+  }
 
   QoSQLrnHeader qlrnHeader;
   packet->RemoveHeader(qlrnHeader);
   if (!qlrnHeader.IsValid ()) {
       NS_FATAL_ERROR("Incorrect QLrnHeader found."); //stop simulation
   }
-  t = qlrnHeader.GetTrafficType();
+  PacketLossTrackingSentTimeQInfo loss_time_sent;
+  bool has_sent_time = packet->PeekPacketTag(loss_time_sent);
+  NS_ASSERT_MSG(has_sent_time, "We expect this now, so must have this tag present.");
+  LearnFromQoSQLrnHeader(sourceIPAddress, qlrnHeader, loss_time_sent.GetSentTimeAsInt(), packet);
+}
+
+void QoSQLearner::LearnFromQoSQLrnHeader(Ipv4Address sourceIPAddress, QoSQLrnHeader& qlrnHeader, uint64_t time_value_at_src_of_QLrnHeader, Ptr<Packet> packet) {
+  TrafficType t = qlrnHeader.GetTrafficType();
+  NoteFeedbackReceived(t, qlrnHeader.GetPktId());
 
   // std::stringstream ss; qlrnHeader.Print(ss<<std::endl);
   // packet->Print(ss);
@@ -230,13 +313,9 @@ void QoSQLearner::Receive(Ptr<Socket> socket) {
   // have also found the currently most recently observed delay value
   //So we effectively set the real delay equal to the previous node's real delay + the time it took for the QInfoTagged packet (not the qlrn header) to travel
 
-  GetQTable(TRAFFIC_A).GetEntryByRef(qlrnHeader.GetPDst(), sourceIPAddress).SetRealDelay( qlrnHeader.GetRealDelay() + qlrnHeader.GetTime() );
-  GetQTable(TRAFFIC_B).GetEntryByRef(qlrnHeader.GetPDst(), sourceIPAddress).SetRealDelay( qlrnHeader.GetRealDelay() + qlrnHeader.GetTime() );
-  GetQTable(TRAFFIC_C).GetEntryByRef(qlrnHeader.GetPDst(), sourceIPAddress).SetRealDelay( qlrnHeader.GetRealDelay() + qlrnHeader.GetTime() );
-
-  PacketLossTrackingSentTimeQInfo loss_time_sent;
-  NS_ASSERT_MSG(packet->PeekPacketTag(loss_time_sent), "We expect this now, so must have this tag present.");
-  uint64_t time_value_at_src_of_QLrnHeader = loss_time_sent.GetSentTimeAsInt();
+  for (auto entry : m_qtables.GetEntriesByRef(qlrnHeader.GetPDst(), sourceIPAddress)) {
+    entry->SetRealDelay( qlrnHeader.GetRealDelay() + qlrnHeader.GetTime() );
+  }
 
   if (GetNumPktsSentViaNeighbToDst(time_value_at_src_of_QLrnHeader,sourceIPAddress, qlrnHeader.GetPDst()) != 0) {
     float new_loss_value = 1.0;
@@ -270,14 +349,14 @@ void QoSQLearner::Receive(Ptr<Socket> socket) {
 
     SetRealLossForOutput(sourceIPAddress,qlrnHeader.GetPDst(),new_loss_value); //stored as a real float
 
-    GetQTable(TRAFFIC_A).GetEntryByRef(qlrnHeader.GetPDst(), sourceIPAddress).SetRealLoss( new_loss_value * 10000); //stored as uint16 so *10000 to get ab,cd as value
-    GetQTable(TRAFFIC_B).GetEntryByRef(qlrnHeader.GetPDst(), sourceIPAddress).SetRealLoss( new_loss_value * 10000);
-    GetQTable(TRAFFIC_C).GetEntryByRef(qlrnHeader.GetPDst(), sourceIPAddress).SetRealLoss( new_loss_value * 10000);
+    for (auto entry : m_qtables.GetEntriesByRef(qlrnHeader.GetPDst(), sourceIPAddress)) {
+      entry->SetRealLoss( new_loss_value * 10000); //stored as uint16 so *10000 to get ab,cd as value
+    }
   }
 
   NS_LOG_DEBUG( m_name << "learning info about " << qlrnHeader.GetPDst() <<" from packet ID " << qlrnHeader.GetPktId()
             << " : travel time was " << Time::FromInteger(qlrnHeader.GetTime(), Time::NS).As(Time::MS) << " and next estim : " << Time::FromInteger(qlrnHeader.GetNextEstim(), Time::NS)
-            << ". This info was contained in pkt " << packet->GetUid() << " sent by " <<  InetSocketAddress::ConvertFrom (sourceAddress).GetIpv4 ());
+            << ". This info was contained in pkt " << packet->GetUid() << " sent by " <<  sourceIPAddress);
   uint64_t unpunished_new_q_value = GetQTable(t).CalculateNewQValue(sourceIPAddress, //get the neighbour that we chose as next hop
                                       qlrnHeader.GetPDst(),   //the actual destination of the packet ( to know which entry in the QTable to update)
                                       m_packet_info.GetPacketQueueTime(qlrnHeader.GetPktId()), //the time the packet spent in the queue
@@ -319,9 +398,7 @@ void QoSQLearner::Receive(Ptr<Socket> socket) {
   QTableEntry new_value = GetQTable(t).GetNextEstim(qlrnHeader.GetPDst(),old_value.GetNextHop());
 
 
-  GetQTable(TRAFFIC_A).GetEntryByRef(qlrnHeader.GetPDst(), InetSocketAddress::ConvertFrom (sourceAddress).GetIpv4 ()).SetSenderConverged(qlrnHeader.GetSenderConverged());
-  GetQTable(TRAFFIC_B).GetEntryByRef(qlrnHeader.GetPDst(), InetSocketAddress::ConvertFrom (sourceAddress).GetIpv4 ()).SetSenderConverged(qlrnHeader.GetSenderConverged());
-  GetQTable(TRAFFIC_C).GetEntryByRef(qlrnHeader.GetPDst(), InetSocketAddress::ConvertFrom (sourceAddress).GetIpv4 ()).SetSenderConverged(qlrnHeader.GetSenderConverged());
+  m_qtables.SetSenderConverged(qlrnHeader.GetPDst(), sourceIPAddress, qlrnHeader.GetSenderConverged());
 
   Ipv4Address destination = qlrnHeader.GetPDst() ;
   if (qlrnHeader.GetSenderConverged()) {
@@ -366,22 +443,14 @@ void QoSQLearner::Receive(Ptr<Socket> socket) {
     // std::cout << (to_dst_learn_more ? "to dst learn more":"not to dst learn more" ) << std::endl;
     // std::cout << (to_neigh_learn_more ? "to neigh learn more":"not to neigh learn more" ) << std::endl;
 
-    try {
-      dynamic_cast<OnOffApplication&> ( *(PeekPointer(learning_traffic_applications)) ).IncreaseAmountOfTraffic(0,1.5); //--VANHIER
-    } catch (std::bad_cast e) {
-      NS_FATAL_ERROR("bad cast was thrown & caught. learning_traffic_applications should be of the OnOffApplication variety though." << e.what() );
-    }
+    VoteLearningRate(+1); //--VANHIER
 
   } else if ( ( to_dst_learn_less || to_neigh_learn_less ) && m_small_learning_stream && m_my_sent_traffic_destination == destination /* dont mess with traffic if its not our dst*/ &&
                 m_use_learning_phases && !m_learning_phase[destination] && m_num_applications == 2 && learning_traffic_applications/*->GetN()==1*/ != 0 && real_traffic/*->GetN()==1*/ != 0) {
     // std::cout << (to_dst_learn_less ? "to dst learn less":"not to dst learn less" ) << std::endl;
     // std::cout << (to_neigh_learn_less ? "to neigh learn less":"not to neigh learn less" ) << std::endl;
 
-    try {
-      dynamic_cast<OnOffApplication&> ( *(PeekPointer(learning_traffic_applications/*->Get(0)*/)) ).ReduceAmountOfTraffic(0,0.5); //--VANHIER
-    } catch (std::bad_cast e) {
-      NS_FATAL_ERROR("bad cast was thrown & caught. learning_traffic_applications should be of the OnOffApplication variety though." << e.what() );
-    }
+    VoteLearningRate(-1); //--VANHIER
 
   }
   return;
@@ -391,13 +460,12 @@ void QoSQLearner::Receive(Ptr<Socket> socket) {
 
 void QoSQLearner::ApplyMetricsToQValue(Ipv4Address dst, Ipv4Address next_hop, uint64_t unpunished_value, TrafficType t,
     uint64_t delay_metric, uint64_t jitter_metric, float packet_loss_metric) {
-  std::vector<TrafficType> TrafficTypes = {TRAFFIC_A, TRAFFIC_B, TRAFFIC_C};
-
   NS_ASSERT_MSG(packet_loss_metric <= 10000, "Having more packets received than we sent? i think not!");
 
-  for (auto i : TrafficTypes ) {
+  auto entries = m_qtables.GetEntriesByRef(dst, next_hop);
+  for (auto i : {TRAFFIC_A, TRAFFIC_B, TRAFFIC_C} ) {
 
-    QTableEntry* entry =  &GetQTable(i).GetEntryByRef(dst, next_hop) ;
+    QTableEntry* entry = entries[MultiClassQTable::ClassOf(i)];
     uint64_t old_value = entry->GetQValue().GetInteger();
     if (t == i) {
       if (unpunished_value > old_value) {
@@ -409,22 +477,15 @@ void QoSQLearner::ApplyMetricsToQValue(Ipv4Address dst, Ipv4Address next_hop, ui
     }
     float delay_coefficient = 1.0, jitter_coefficient = 1.0, packet_loss_coefficient = 1.0;
 
-    delay_coefficient = ( delay_metric < TrafficTypeReqsMap[i].GetDelayMax() ? 1.0 : 1+(delay_metric / TrafficTypeReqsMap[i].GetDelayMax()));
-    jitter_coefficient = ( jitter_metric < TrafficTypeReqsMap[i].GetJitterMax() ? 1.0 : 2+(jitter_metric / TrafficTypeReqsMap[i].GetJitterMax())); //jitter is lower qvals so mult more
+    const TrafficRequirements& reqs = GetTrafficRequirements(i);
+    delay_coefficient = reqs.DelayCoefficient(delay_metric);
+    jitter_coefficient = reqs.JitterCoefficient(jitter_metric);
 
     if (packet_loss_metric == 0.0) { } else {
       float actual_percent_loss = 1- (packet_loss_metric / 10000.0);
-      if (actual_percent_loss > 10 * TrafficTypeReqsMap[i].GetRandomLossMax()) {
-        packet_loss_coefficient = 12.5;
-      } else if (actual_percent_loss > 2 * TrafficTypeReqsMap[i].GetRandomLossMax()) {
-        packet_loss_coefficient = 8;
-      } else if (actual_percent_loss > TrafficTypeReqsMap[i].GetRandomLossMax()) {
-        packet_loss_coefficient = 4;
-      } else {
-        packet_loss_coefficient = 1.0;
-        // if (GetNode()->GetId() == 0) { std::cout << dst << " " << next_hop << " " << actual_percent_loss << " " << TrafficTypeReqsMap[i].GetRandomLossMax() <<
-        // GetQTable(t).PrettyPrint("yeah this is the table") << std::endl;;}
-      }
+      packet_loss_coefficient = reqs.LossCoefficient(actual_percent_loss);
+      // if (GetNode()->GetId() == 0) { std::cout << dst << " " << next_hop << " " << actual_percent_loss << " " << reqs.GetRandomLossMax() <<
+      // GetQTable(t).PrettyPrint("yeah this is the table") << std::endl;;}
     }
 
     if (GetNode()->GetId() == 0 && i == TRAFFIC_A
@@ -440,7 +501,7 @@ void QoSQLearner::ApplyMetricsToQValue(Ipv4Address dst, Ipv4Address next_hop, ui
 
     if (entry->GetCoefficientTally() > 1.0) {
 
-      entry->AddStrike(); // start here instead of after the 1st time its bad metrics, why ? idk!
+      GetQTable(i).AddStrike(dst, *entry); // start here instead of after the 1st time its bad metrics, why ? idk!
       // entry->SetCoefficientTally(delay_coefficient * jitter_coefficient * packet_loss_coefficient);
 
       float curr_tally = entry->GetCoefficientTally();
@@ -461,14 +522,14 @@ void QoSQLearner::ApplyMetricsToQValue(Ipv4Address dst, Ipv4Address next_hop, ui
         // }
 
         uint64_t new_value = (old_value * (curr_tally + new_tally) / 2 < Seconds(100).GetInteger() ? old_value * (curr_tally + new_tally) / 2 :Seconds(100).GetInteger());
-        GetQTable(i).SetQValueWrapper(dst,next_hop,Time::FromInteger(new_value, Time::NS));
+        GetQTable(i).SetQValueWrapper(dst,*entry,Time::FromInteger(new_value, Time::NS));
         entry->SetCoefficientTally((curr_tally + new_tally) / 2.0);
 
         // For some reason, enabling this wrecks it again
         // entry->SetCoefficientTally((1-m_learningrate) * entry->GetCoefficientTally());
         //do nothing
         if (new_tally == 1.0) {
-          entry->DeductStrike();
+          GetQTable(i).DeductStrike(dst, *entry);
         }
       } else {
         coefficient = new_tally / curr_tally;
@@ -476,7 +537,7 @@ void QoSQLearner::ApplyMetricsToQValue(Ipv4Address dst, Ipv4Address next_hop, ui
         if (GetNode()->GetId() == 0 && old_value != 0) {
           NS_LOG_DEBUG ( "(keep punish) old value was = " << old_value << "  and new value is " << new_value );
         }
-        GetQTable(i).SetQValueWrapper(dst,next_hop,Time::FromInteger(new_value, Time::NS));
+        GetQTable(i).SetQValueWrapper(dst,*entry,Time::FromInteger(new_value, Time::NS));
         entry->SetCoefficientTally(delay_coefficient * jitter_coefficient * packet_loss_coefficient);
       }
     }
@@ -495,7 +556,7 @@ void QoSQLearner::ApplyMetricsToQValue(Ipv4Address dst, Ipv4Address next_hop, ui
 
       /* careful here, dont want to inadvertendly cause it to converge if all coeffs are equal to 1! */
       // --- this should be resolved, this is now the onyl call to set QValue in the QoSQ case for dst
-      GetQTable(i).SetQValueWrapper(dst,next_hop,Time::FromInteger(new_value, Time::NS));
+      GetQTable(i).SetQValueWrapper(dst,*entry,Time::FromInteger(new_value, Time::NS));
       entry->SetCoefficientTally(delay_coefficient * jitter_coefficient * packet_loss_coefficient);
     }
     // if (packet_loss_coefficient * delay_coefficient * jitter_coefficient != 1 && GetNode()->GetId() == 0) {
@@ -511,9 +572,8 @@ QoSQLearner::StartApplication (void) {
   m_q_value_when_all_blacklisted = (GetNode()->GetId() == 0 ? Seconds(100).GetInteger():0);
   m_this_node_ip = GetNode()->GetObject<Ipv4>()->GetAddress(1,0).GetLocal();
   if (m_output_data_to_file && IamAmongTheDestinations() ) {
-    std::stringstream ss; ss << "out_stats_qosq_node"<<GetNode()->GetId()<<".csv";
-    m_output_filestream = Create<OutputStreamWrapper> (ss.str(), std::ios::out);
-    *(m_output_filestream->GetStream ()) << "pktID,currTime,delay,initial_estim,learning,metrics,second_to_last_hop,trafficType\n";
+    std::stringstream ss; ss << "out_stats_qosq_node"<<GetNode()->GetId()<<".bin";
+    m_stats_sink = Create<QLrnStatsSink> (ss.str());
   }
 
   QLearner::StartApplication();
@@ -52,6 +52,8 @@ public:
 
 private:
   virtual void Receive (Ptr<Socket> socket);
+  // the packet counts in the feedback are as of time_value_at_src_of_QLrnHeader, when its sender made it
+  void LearnFromQoSQLrnHeader (Ipv4Address sourceIPAddress, QoSQLrnHeader& qlrnHeader, uint64_t time_value_at_src_of_QLrnHeader, Ptr<Packet> packet);
   virtual void Send(Ipv4Address node_to_notify, uint64_t packet_Uid, Time travel_time, Ipv4Address packet_dst, Ipv4Address packet_src, TrafficType t, bool sender_converged) ;
   virtual void StartApplication(void);
   uint64_t m_q_value_when_all_blacklisted;
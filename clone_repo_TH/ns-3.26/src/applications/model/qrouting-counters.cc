@@ -0,0 +1,135 @@
+#include "qrouting-counters.h"
+#include "ns3/assert.h"
+#include <algorithm>
+#include <limits>
+
+namespace ns3 {
+
+QRoutingCounters&
+QRoutingCounters::operator+= (const QRoutingCounters& other) {
+  for (uint32_t c = 0; c < NR_QROUTING_COUNTERS; c++) {
+    m_counts[c] += other.m_counts[c];
+  }
+  return *this;
+}
+
+const char*
+QRoutingCounters::NameOf(QRoutingCounter c) {
+  switch (c) {
+    case QRC_DECISION_EPSILON_GREEDY:       return "decision_epsilon_greedy";
+    case QRC_DECISION_TARGETED_EXPLORATION: return "decision_targeted_exploration";
+    case QRC_DECISION_RHO_OPTIMAL:          return "decision_rho_optimal";
+    case QRC_DECISION_EXPLOIT:              return "decision_exploit";
+    case QRC_LEARNING_DROPPED:              return "learning_dropped";
+    case QRC_FEEDBACK_SENT:                 return "feedback_sent";
+    case QRC_FEEDBACK_RECEIVED:             return "feedback_received";
+    case QRC_BLACKLISTED:                   return "blacklisted";
+    case QRC_UNBLACKLISTED:                 return "unblacklisted";
+    case QRC_CONVERGED:                     return "converged";
+    case QRC_UNCONVERGED:                   return "unconverged";
+    default:
+      NS_ASSERT_MSG(false, "Unknown QRoutingCounter " << c);
+      return "";
+  }
+}
+
+// ====================================================================================================
+
+LogHistogram::LogHistogram() :
+  m_count(0), m_sum(0), m_min(std::numeric_limits<uint64_t>::max()), m_max(0) {
+  m_buckets.fill(0);
+}
+
+uint32_t
+LogHistogram::BucketOf(uint64_t value) {
+  uint32_t bucket = 0;
+  while (value != 0) {
+    value >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+uint64_t
+LogHistogram::BucketUpperBound(uint32_t bucket) {
+  NS_ASSERT_MSG(bucket < NR_BUCKETS, "LogHistogram has no bucket " << bucket);
+  if (bucket == NR_BUCKETS - 1) {
+    return std::numeric_limits<uint64_t>::max();
+  }
+  return (uint64_t(1) << bucket) - 1;
+}
+
+void
+LogHistogram::Add(uint64_t value) {
+  m_buckets[BucketOf(value)]++;
+  m_count++;
+  m_sum += value;
+  if (value < m_min) {
+    m_min = value;
+  }
+  if (value > m_max) {
+    m_max = value;
+  }
+}
+
+LogHistogram&
+LogHistogram::operator+= (const LogHistogram& other) {
+  for (uint32_t b = 0; b < NR_BUCKETS; b++) {
+    m_buckets[b] += other.m_buckets[b];
+  }
+  m_count += other.m_count;
+  m_sum += other.m_sum;
+  if (other.m_min < m_min) {
+    m_min = other.m_min;
+  }
+  if (other.m_max > m_max) {
+    m_max = other.m_max;
+  }
+  return *this;
+}
+
+uint64_t
+LogHistogram::GetPercentile(double fraction) const {
+  NS_ASSERT_MSG(fraction >= 0 && fraction <= 1, "Percentiles are asked for as a fraction in [0, 1], not " << fraction);
+  if (m_count == 0) {
+    return 0;
+  }
+  // the value the rank-th smallest sample falls in
+  uint64_t rank = fraction * m_count;
+  if (rank == 0) {
+    rank = 1;
+  }
+  uint64_t seen = 0;
+  for (uint32_t b = 0; b < NR_BUCKETS; b++) {
+    seen += m_buckets[b];
+    if (seen >= rank) {
+      // no further off than the exact maximum
+      return std::min(BucketUpperBound(b), m_max);
+    }
+  }
+  return m_max;
+}
+
+// ====================================================================================================
+
+void
+WriteCountersHeader(std::ostream& os) {
+  os << "time,node,class,name,count,mean,p50,p90,p99,max\n";
+}
+
+void
+WriteCounters(std::ostream& os, double time, const std::string& node, const std::string& traffic_class, const QRoutingCounters& counters) {
+  for (uint32_t c = 0; c < NR_QROUTING_COUNTERS; c++) {
+    os << time << "," << node << "," << traffic_class << "," << QRoutingCounters::NameOf(QRoutingCounter(c)) << ","
+       << counters.Get(QRoutingCounter(c)) << ",,,,,\n";
+  }
+}
+
+void
+WriteHistogram(std::ostream& os, double time, const std::string& node, const std::string& traffic_class, const std::string& name, const LogHistogram& histogram) {
+  os << time << "," << node << "," << traffic_class << "," << name << "," << histogram.GetCount() << "," << histogram.GetMean() << ","
+     << histogram.GetPercentile(0.5) << "," << histogram.GetPercentile(0.9) << "," << histogram.GetPercentile(0.99) << ","
+     << histogram.GetMax() << "\n";
+}
+
+} //namespace ns3
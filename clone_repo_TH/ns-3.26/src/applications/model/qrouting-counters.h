@@ -0,0 +1,111 @@
+#ifndef QROUTING_COUNTERS_H
+#define QROUTING_COUNTERS_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace ns3 {
+
+/**
+ * What QRoutingCounters counts. The routing decisions are the branches QLearner::Route takes, the transitions
+ * are counted by the QTable of the class as they happen.
+ */
+enum QRoutingCounter {
+  QRC_DECISION_EPSILON_GREEDY = 0,    // a random next hop : e-greedy in the learning phase, exploring learning traffic after it
+  QRC_DECISION_TARGETED_EXPLORATION,  // a random next hop among the entries that have not converged (at the source)
+  QRC_DECISION_RHO_OPTIMAL,           // learning traffic sent along the best estimate (at intermediate nodes)
+  QRC_DECISION_EXPLOIT,               // the best estimate, for data traffic and learning traffic in the learning phase
+  QRC_LEARNING_DROPPED,               // learning traffic dropped at the source as there was nothing left to explore
+  QRC_FEEDBACK_SENT,                  // feedback records (QLrnHeader or one record of a QLrnFeedbackHeader)
+  QRC_FEEDBACK_RECEIVED,
+  QRC_BLACKLISTED,                    // entries that got their last strike
+  QRC_UNBLACKLISTED,                  // entries that lost their last strike
+  QRC_CONVERGED,                      // destinations (rows) all of whose available entries converged
+  QRC_UNCONVERGED,                    // destinations that stopped being converged
+  NR_QROUTING_COUNTERS
+};
+
+/// Counts of the Q-routing events of one traffic class at one node
+class QRoutingCounters {
+public:
+  QRoutingCounters() { m_counts.fill(0); }
+
+  void Increment(QRoutingCounter c) { m_counts[c]++; }
+  uint64_t Get(QRoutingCounter c) const { return m_counts[c]; }
+  QRoutingCounters& operator+= (const QRoutingCounters& other);
+
+  // snake case name of the counter, as it appears in the counters files
+  static const char* NameOf(QRoutingCounter c);
+
+private:
+  std::array<uint64_t, NR_QROUTING_COUNTERS> m_counts;
+};
+
+/**
+ * Histogram with power of 2 buckets, cheap enough to be filled on every routing decision. Bucket 0 holds the zeros,
+ * bucket b the values in [2^(b-1), 2^b). Percentiles are the upper bound of the bucket they fall in, so they are
+ * at most a factor 2 off, the minimum, maximum and mean are exact.
+ */
+class LogHistogram {
+public:
+  static const uint32_t NR_BUCKETS = 65;
+
+  LogHistogram();
+
+  void Add(uint64_t value);
+  LogHistogram& operator+= (const LogHistogram& other);
+
+  uint64_t GetCount() const { return m_count; }
+  uint64_t GetMin() const { return m_count == 0 ? 0 : m_min; }
+  uint64_t GetMax() const { return m_max; }
+  double GetMean() const { return m_count == 0 ? 0 : double(m_sum) / m_count; }
+  uint64_t GetBucketCount(uint32_t bucket) const { return m_buckets[bucket]; }
+  // fraction in [0, 1], e.g. 0.99 for the 99th percentile
+  uint64_t GetPercentile(double fraction) const;
+
+  static uint32_t BucketOf(uint64_t value);
+  // largest value that still goes in bucket
+  static uint64_t BucketUpperBound(uint32_t bucket);
+
+private:
+  std::array<uint64_t, NR_BUCKETS> m_buckets;
+  uint64_t m_count;
+  uint64_t m_sum;
+  uint64_t m_min;
+  uint64_t m_max;
+};
+
+/// Adds the wall clock time (ns) from its construction to its destruction to a LogHistogram, does nothing (and
+/// does not read the clock) if that is null
+class WallClockTimer {
+public:
+  WallClockTimer(LogHistogram* histogram) : m_histogram(histogram) {
+    if (m_histogram) {
+      m_start = std::chrono::steady_clock::now();
+    }
+  }
+  ~WallClockTimer() {
+    if (m_histogram) {
+      m_histogram->Add(std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now() - m_start).count());
+    }
+  }
+private:
+  LogHistogram* m_histogram;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+/**
+ * Lines of the <prefix><node ip>_counters.csv files QLearner writes (see its CountersPrefix attribute),
+ *   time (s),node,class,name,count,mean,p50,p90,p99,max
+ * counters only fill in the count, histograms (in ns) all of it.
+ */
+void WriteCountersHeader(std::ostream& os);
+void WriteCounters(std::ostream& os, double time, const std::string& node, const std::string& traffic_class, const QRoutingCounters& counters);
+void WriteHistogram(std::ostream& os, double time, const std::string& node, const std::string& traffic_class, const std::string& name, const LogHistogram& histogram);
+
+} //namespace ns3
+
+#endif /* QROUTING_COUNTERS_H */
@@ -0,0 +1,251 @@
+#include "qtable-recorder.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/system-thread.h"
+#include <limits>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("QTableRecorder");
+
+/* buffered bytes after which the buffer goes to the writer thread */
+static const size_t QTABLE_RECORDER_CHUNK_SIZE = 1 << 20;
+static const int64_t QTABLE_RECORDER_NOT_RECORDED = std::numeric_limits<int64_t>::min();
+
+/**
+ * The writer thread all QTableRecorders hand their chunks to. It runs while at least one recorder is open and
+ * writes the chunks in the order they were handed off.
+ */
+class QTableRecordWriter {
+public:
+  static QTableRecordWriter& Get() {
+    static QTableRecordWriter writer;
+    return writer;
+  }
+
+  // A recorder starts handing off chunks, the first one starts the thread
+  void Open() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_users++ == 0) {
+      m_stop = false;
+      m_thread = Create<SystemThread> (MakeCallback (&QTableRecordWriter::Loop, this));
+      m_thread->Start();
+    }
+  }
+
+  // Queues the chunk for out (and closing out after it), returns the ticket to wait for it with
+  uint64_t Write(std::ofstream* out, std::vector<char>& chunk, bool close) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobs.push_back(Job());
+    m_jobs.back().out = out;
+    m_jobs.back().data.swap(chunk);
+    m_jobs.back().close = close;
+    m_work_available.notify_one();
+    return ++m_queued;
+  }
+
+  // Blocks until the chunk of the ticket and everything handed off before it are written
+  void WaitFor(uint64_t ticket) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_work_done.wait(lock, [this, ticket] { return m_written >= ticket; });
+  }
+
+  // A recorder is done, the last one stops the thread
+  void Release() {
+    Ptr<SystemThread> thread;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      NS_ASSERT(m_users > 0);
+      if (--m_users > 0) {
+        return;
+      }
+      m_stop = true;
+      m_work_available.notify_one();
+      thread = m_thread;
+      m_thread = 0;
+    }
+    thread->Join();
+  }
+
+private:
+  struct Job {
+    std::ofstream* out;
+    std::vector<char> data;
+    bool close;
+  };
+
+  QTableRecordWriter() : m_queued(0), m_written(0), m_users(0), m_stop(false) { }
+
+  void Loop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+      // the predicate is checked under the lock, so a chunk handed off before the wait is never missed
+      m_work_available.wait(lock, [this] { return !m_jobs.empty() || m_stop; });
+      if (m_jobs.empty()) {
+        return;
+      }
+      Job job;
+      std::swap(job.data, m_jobs.front().data);
+      job.out = m_jobs.front().out;
+      job.close = m_jobs.front().close;
+      m_jobs.pop_front();
+      lock.unlock();
+
+      if (!job.data.empty()) {
+        job.out->write(&job.data[0], job.data.size());
+      }
+      if (job.close) {
+        job.out->close();
+      }
+
+      lock.lock();
+      m_written++;
+      m_work_done.notify_all();
+    }
+  }
+
+  std::mutex m_mutex;
+  std::condition_variable m_work_available;
+  std::condition_variable m_work_done;
+  std::deque<Job> m_jobs;
+  uint64_t m_queued;
+  uint64_t m_written;
+  uint32_t m_users;
+  bool m_stop;
+  Ptr<SystemThread> m_thread;
+};
+
+QTableRecorder::QTableRecorder(std::string filename, Time sampling_interval) :
+  m_filename(filename), m_sampling_interval(sampling_interval), m_sample_scheduled(false), m_closed(false),
+  m_last_seen(Seconds(0)) {
+  m_out.open(m_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  NS_ASSERT_MSG(m_out.is_open(), "Could not open " << m_filename << " to record the qtable in.");
+  m_buffer.reserve(QTABLE_RECORDER_CHUNK_SIZE);
+  Put("QTR1", 4);
+
+  QTableRecordWriter::Get().Open();
+}
+
+QTableRecorder::~QTableRecorder() {
+  Close();
+}
+
+void
+QTableRecorder::Put(const void* data, size_t size) {
+  const char* bytes = static_cast<const char*>(data);
+  m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+}
+
+void
+QTableRecorder::AddDestination(uint32_t row, Ipv4Address dst) {
+  if (m_last.size() <= row) {
+    m_last.resize(row + 1);
+    m_is_dirty.resize(row + 1);
+  }
+  uint32_t ip = dst.Get();
+  Put("D", 1); Put(&row, sizeof(row)); Put(&ip, sizeof(ip));
+}
+
+void
+QTableRecorder::AddNeighbour(uint32_t col, Ipv4Address neighb) {
+  uint32_t ip = neighb.Get();
+  Put("N", 1); Put(&col, sizeof(col)); Put(&ip, sizeof(ip));
+}
+
+void
+QTableRecorder::RemoveNeighbour(uint32_t col) {
+  Put("R", 1); Put(&col, sizeof(col));
+}
+
+void
+QTableRecorder::RecordCell(uint32_t row, uint32_t col, Time value) {
+  NS_ASSERT_MSG(row <= std::numeric_limits<uint16_t>::max() && col <= std::numeric_limits<uint16_t>::max(),
+                "QTable too large to record (" << row << "," << col << ").");
+  if (m_last.size() <= row) {
+    m_last.resize(row + 1);
+    m_is_dirty.resize(row + 1);
+  }
+  if (m_last[row].size() <= col) {
+    m_last[row].resize(col + 1, QTABLE_RECORDER_NOT_RECORDED);
+    m_is_dirty[row].resize(col + 1, false);
+  }
+  if (m_last[row][col] == value.GetInteger()) {
+    return;
+  }
+  m_last[row][col] = value.GetInteger();
+  if (!m_is_dirty[row][col]) {
+    m_is_dirty[row][col] = true;
+    m_dirty.push_back(std::make_pair(row, col));
+  }
+}
+
+void
+QTableRecorder::CellsRecorded() {
+  if (m_dirty.empty() || m_closed) {
+    return;
+  }
+  m_last_seen = Simulator::Now();
+  if (m_sampling_interval.IsZero()) {
+    WriteSample(m_last_seen);
+  } else if (!m_sample_scheduled) {
+    m_sample_scheduled = true;
+    Simulator::Schedule(m_sampling_interval, &QTableRecorder::Sample, Ptr<QTableRecorder> (this));
+  }
+}
+
+void
+QTableRecorder::Sample() {
+  m_sample_scheduled = false;
+  WriteSample(Simulator::Now());
+}
+
+void
+QTableRecorder::WriteSample(Time t) {
+  if (m_dirty.empty() || m_closed) {
+    return;
+  }
+  int64_t now = t.GetInteger();
+  uint32_t count = m_dirty.size();
+  Put("S", 1); Put(&now, sizeof(now)); Put(&count, sizeof(count));
+  for (const auto& cell : m_dirty) {
+    Put(&cell.first, sizeof(cell.first));
+    Put(&cell.second, sizeof(cell.second));
+    Put(&m_last[cell.first][cell.second], sizeof(int64_t));
+    m_is_dirty[cell.first][cell.second] = false;
+  }
+  m_dirty.clear();
+
+  if (m_buffer.size() >= QTABLE_RECORDER_CHUNK_SIZE) {
+    HandOffBuffer(false);
+  }
+}
+
+uint64_t
+QTableRecorder::HandOffBuffer(bool close) {
+  std::vector<char> chunk;
+  chunk.reserve(QTABLE_RECORDER_CHUNK_SIZE);
+  chunk.swap(m_buffer);
+  return QTableRecordWriter::Get().Write(&m_out, chunk, close);
+}
+
+void
+QTableRecorder::Close() {
+  if (m_closed) {
+    return;
+  }
+  // the simulator may already be gone when this runs from the destructor, so use the last time we saw
+  WriteSample(m_last_seen);
+  int64_t now = m_last_seen.GetInteger();
+  Put("E", 1); Put(&now, sizeof(now));
+  m_closed = true;
+
+  QTableRecordWriter& writer = QTableRecordWriter::Get();
+  writer.WaitFor(HandOffBuffer(true));
+  writer.Release();
+}
+
+} //namespace ns3
@@ -0,0 +1,70 @@
+#ifndef QTABLE_RECORDER_H
+#define QTABLE_RECORDER_H
+
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/simple-ref-count.h"
+#include <fstream>
+#include <vector>
+#include <string>
+
+namespace ns3 {
+
+/**
+ * Records the evolution of a QTable for drawQTables.py without going through iostreams on every update.
+ *
+ * Only the cells that changed since the previous sample are kept, as binary delta records. Samples are taken
+ * at most once per sampling interval (or on every call to Sample if the interval is zero), collected in a
+ * buffer and written to disk in chunks by a writer thread, one for all recorders of the process (a node has a
+ * QTable per traffic class, so a thread per recorder would mean hundreds of them). convertQTableRecords.py turns the
+ * resulting file back into the <ip>_qtable<traffic>.txt csv format.
+ *
+ * File layout (native byte order) : the magic "QTR1", followed by records starting with one tag byte
+ *   'D' uint32 row id, uint32 ip          : a destination (row) was added
+ *   'N' uint32 column id, uint32 ip       : a neighbour (column) was added, or re-added at the end
+ *   'R' uint32 column id                  : a neighbour (column) was removed
+ *   'S' int64 time (ns), uint32 count, count x { uint16 row, uint16 column, int64 qvalue (ns) } : a sample
+ *   'E' int64 time (ns)                   : end of the recording
+ */
+class QTableRecorder : public SimpleRefCount<QTableRecorder> {
+public:
+  QTableRecorder(std::string filename, Time sampling_interval);
+  ~QTableRecorder();
+
+  void AddDestination(uint32_t row, Ipv4Address dst);
+  void AddNeighbour(uint32_t col, Ipv4Address neighb);
+  void RemoveNeighbour(uint32_t col);
+  // Note the current value of a cell, only remembered if it differs from what was recorded before
+  void RecordCell(uint32_t row, uint32_t col, Time value);
+  // Called after a batch of RecordCell calls, takes a sample now or makes sure one is scheduled
+  void CellsRecorded();
+  // Writes the pending sample and whatever is buffered and waits until it is in the file. Further calls are ignored.
+  void Close();
+
+private:
+  void Sample();
+  void WriteSample(Time t);
+  void Put(const void* data, size_t size);
+  // Hands the buffer to the writer thread, returns the ticket to wait for it with
+  uint64_t HandOffBuffer(bool close);
+
+  std::string m_filename;
+  Time m_sampling_interval;
+  bool m_sample_scheduled;
+  bool m_closed;
+  Time m_last_seen;
+
+  // last recorded value per [row][column], dirty cells are listed once in m_dirty
+  std::vector<std::vector<int64_t> > m_last;
+  std::vector<std::vector<bool> > m_is_dirty;
+  std::vector<std::pair<uint16_t, uint16_t> > m_dirty;
+
+  std::vector<char> m_buffer;
+
+  // only used by the writer thread once opened, until Close has waited for the last chunk
+  std::ofstream m_out;
+};
+
+} //namespace ns3
+
+#endif /* QTABLE_RECORDER_H */
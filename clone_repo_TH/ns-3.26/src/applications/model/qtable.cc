@@ -2,6 +2,28 @@
 
 namespace ns3 {
 
+/* snapshots, see MultiClassQTable */
+static const char QTABLE_SNAPSHOT_MAGIC[4] = {'Q', 'S', 'N', '1'};
+static const uint8_t QTABLE_SNAPSHOT_CONVERGED = 0x01;
+static const uint8_t QTABLE_SNAPSHOT_SENDER_CONVERGED = 0x02;
+static const uint8_t QTABLE_SNAPSHOT_LEARN_MORE = 0x04;
+static const uint8_t QTABLE_SNAPSHOT_LEARN_LESS = 0x08;
+static const uint8_t QTABLE_SNAPSHOT_BLACKLISTED = 0x10;
+
+template <typename T>
+static void
+PutValue (std::ostream& os, T v) {
+  os.write(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+template <typename T>
+static T
+GetValue (std::istream& is) {
+  T v = T();
+  is.read(reinterpret_cast<char*>(&v), sizeof(v));
+  return v;
+}
+
 /* Util */
 //lengthen string
 
@@ -83,6 +105,33 @@ void QTableEntry::Unconverge() {
   m_converged = false;
 }
 
+void QTableEntry::Save(std::ostream& os) const {
+  PutValue<int64_t>(os, m_my_estim.GetInteger());
+  PutValue<uint64_t>(os, m_real_observed_delay);
+  PutValue<uint16_t>(os, m_real_observed_loss);
+  PutValue<float>(os, m_coeff_tally);
+  PutValue<uint8_t>(os, (m_converged ? QTABLE_SNAPSHOT_CONVERGED : 0) | (m_sender_converged ? QTABLE_SNAPSHOT_SENDER_CONVERGED : 0) |
+                        (m_learn_more ? QTABLE_SNAPSHOT_LEARN_MORE : 0) | (m_learn_less ? QTABLE_SNAPSHOT_LEARN_LESS : 0) |
+                        (m_blacklisted ? QTABLE_SNAPSHOT_BLACKLISTED : 0));
+  PutValue<uint8_t>(os, m_number_of_strikes);
+}
+
+void QTableEntry::Load(std::istream& is) {
+  m_my_estim = Time::FromInteger(GetValue<int64_t>(is), Time::NS);
+  m_real_observed_delay = GetValue<uint64_t>(is);
+  m_real_observed_loss = GetValue<uint16_t>(is);
+  m_coeff_tally = GetValue<float>(is);
+  uint8_t flags = GetValue<uint8_t>(is);
+  m_converged = flags & QTABLE_SNAPSHOT_CONVERGED;
+  m_sender_converged = flags & QTABLE_SNAPSHOT_SENDER_CONVERGED;
+  m_learn_more = flags & QTABLE_SNAPSHOT_LEARN_MORE;
+  m_learn_less = flags & QTABLE_SNAPSHOT_LEARN_LESS;
+  m_blacklisted = flags & QTABLE_SNAPSHOT_BLACKLISTED;
+  m_number_of_strikes = GetValue<uint8_t>(is);
+  // the events that would have allowed it again are not part of the snapshot
+  m_allow_change_to_learning = true;
+}
+
 QTableEntry::~QTableEntry() { }
 
 void QTableEntry::SetQValue(Time t, bool _verbose) {
@@ -126,217 +175,453 @@ QTable::QTable() { }
 void QTable::Unconverge() {
   //rather crude method of going back to a "learning" phase. -- refined, now only unconverges those QTE's where the nexthop is marked unavailable
   for (auto dst : m_destinations) {
-    for (auto& i : m_qtable[dst]) {
+    uint32_t dst_id = InternDestination(dst);
+    for (auto& i : m_qtable[dst_id]) {
       if (i.HasConverged()) {
         if (!i.IsAvailable()) {
           i.Unconverge();
         }
       }
     }
+    RecountRow(dst_id);
   }
 }
 
 NS_LOG_COMPONENT_DEFINE ("QTable");
 
-QTable::QTable(std::vector<Ipv4Address> _neighbours, Ipv4Address nodeip, float learning_rate, float convergence_threshold,
-          float learn_more_threshold, std::vector<Ipv4Address> _unavail, std::string addition, bool _in_test, bool print_qtables, float gamma) :
-  m_nodeip(nodeip),m_learningrate(learning_rate), m_convergence_threshold(convergence_threshold), m_gamma(gamma),
-  m_learn_more_threshold(learn_more_threshold), m_neighbours(_neighbours), m_destinations(_neighbours),
-  m_unavail(_unavail), m_in_test(_in_test), m_print_qtables(print_qtables) {
+/* m_best_col markers, a column id is >= 0 */
+static const int32_t BEST_ESTIM_STALE = -1;
+static const int32_t BEST_ESTIM_NONE = -2;
 
-  m_qtable = std::map<Ipv4Address, std::vector<QTableEntry > >();
-  for (auto neighb : m_neighbours) {
-    m_qtable[neighb] = std::vector<QTableEntry >();
-    for (auto i : m_neighbours) {
-      if (i == neighb) {
-        m_qtable[neighb].push_back(QTableEntry(i, MilliSeconds(INITIAL_QVALUE_QTABLEENTRY_VIA), m_convergence_threshold, m_learn_more_threshold, m_nodeip));
-      } else { // some initial estimates i guess
-        m_qtable[neighb].push_back(QTableEntry(i, MilliSeconds(INITIAL_QVALUE_QTABLEENTRY_NOT_VIA), m_convergence_threshold, m_learn_more_threshold, m_nodeip));
-      }
-    }
+QTableTopology::QTableTopology(std::vector<Ipv4Address> neighbours) :
+  m_generation(0) {
+  for (auto neighb : neighbours) {
+    AddNeighbour(neighb);
   }
-  std::stringstream ss;
-  ss << m_nodeip << "_qtable" << addition << ".txt";
-  m_output_file_name = ss.str();
+}
 
-  if (!m_in_test && m_print_qtables) {
-    std::ofstream ofs;
-    ofs.open(m_output_file_name, std::ofstream::out | std::ofstream::trunc);
-    ofs.close();
-    m_out_stream = Create<OutputStreamWrapper> (m_output_file_name, std::ios::out | std::ios::ate | std::ios::app);
+uint32_t
+QTableTopology::InternDestination(Ipv4Address dst) {
+  auto it = m_dst_ids.find(dst);
+  if (it != m_dst_ids.end()) {
+    return it->second;
   }
+  uint32_t id = m_dst_ids.size();
+  m_dst_ids[dst] = id;
+  m_dst_addrs.push_back(dst);
+  return id;
+}
+
+int32_t
+QTableTopology::FindDestination(Ipv4Address dst) const {
+  auto it = m_dst_ids.find(dst);
+  return (it == m_dst_ids.end() ? -1 : it->second);
+}
+
+int32_t
+QTableTopology::ColumnOf(Ipv4Address neighb) const {
+  auto it = m_neighb_ids.find(neighb);
+  return (it == m_neighb_ids.end() ? -1 : it->second);
+}
+
+uint32_t
+QTableTopology::AddNeighbour(Ipv4Address neighb) {
+  auto it = m_neighb_ids.find(neighb);
+  if (it != m_neighb_ids.end()) {
+    return it->second;
+  }
+  uint32_t col;
+  if (!m_free_slots.empty()) {
+    col = m_free_slots.back();
+    m_free_slots.pop_back();
+    m_slot_addrs[col] = neighb;
+  } else {
+    col = m_slot_addrs.size();
+    m_slot_addrs.push_back(neighb);
+    m_neighbour_pos.push_back(0);
+    m_neighbour_bits.push_back(false);
+    m_unavail_bits.push_back(false);
+    m_added_at.push_back(0);
+    m_changed_at.push_back(0);
+    m_available_pos.push_back(0);
+  }
+  m_neighb_ids[neighb] = col;
+  m_neighbour_pos[col] = m_neighbours.size();
+  m_neighbours.push_back(neighb);
+  m_neighbour_bits[col] = true;
+  m_unavail_bits[col] = false;
+  IndexAvailable(col, true);
+  m_added_at[col] = ++m_generation;
+  return col;
 }
 
 void
-QTable::MarkNeighbDown(Ipv4Address neighb) {
-  if (std::find(m_neighbours.begin(), m_neighbours.end(), neighb ) != m_neighbours.end()) {
-    if (std::find(m_unavail.begin(), m_unavail.end(), neighb) == m_unavail.end()) {
-      // neighbour is not yet marked as unavail
-      m_unavail.push_back(neighb);
-      for (const auto& dst : m_destinations) {
-        for (unsigned int i = 0; i < m_qtable[dst].size(); i++) {
-          if (m_qtable[dst].at(i).GetNextHop() == neighb) {
-            m_qtable[dst].at(i).SetUnavailable(true);
-          }
-        }
-      }
-      NS_LOG_DEBUG(neighb << " is down. Marked at node" << m_nodeip << "." );
-    }
+QTableTopology::RemoveNeighbour(Ipv4Address neighb) {
+  int32_t col = ColumnOf(neighb);
+  if (col < 0) {
+    return;
+  }
+  if (IsColumnAvailable(col)) {
+    IndexAvailable(col, false);
+  }
+  // the last neighbour takes the place of the removed one in m_neighbours
+  uint32_t pos = m_neighbour_pos[col];
+  Ipv4Address last = m_neighbours.back();
+  m_neighbours[pos] = last;
+  m_neighbour_pos[m_neighb_ids[last]] = pos;
+  m_neighbours.pop_back();
+
+  m_neighb_ids.erase(neighb);
+  m_neighbour_bits[col] = false;
+  m_unavail_bits[col] = false;
+  m_changed_at[col] = ++m_generation;
+  m_free_slots.push_back(col);
+}
+
+void
+QTableTopology::SetColumnAvailable(uint32_t col, bool available) {
+  NS_ASSERT_MSG(IsColumnNeighbour(col), "Column " << col << " is a free slot.");
+  if (IsColumnAvailable(col) == available) {
+    return;
+  }
+  m_unavail_bits[col] = !available;
+  IndexAvailable(col, available);
+  m_changed_at[col] = ++m_generation;
+}
+
+void
+QTableTopology::IndexAvailable(uint32_t col, bool available) {
+  if (available) {
+    m_available_pos[col] = m_available_cols.size();
+    m_available_cols.push_back(col);
   } else {
-    NS_LOG_DEBUG("Trying to mark a neighbour unavailable but it's not a neighbour");
+    // the last available column takes its place
+    uint32_t pos = m_available_pos[col];
+    uint32_t last = m_available_cols.back();
+    m_available_cols[pos] = last;
+    m_available_pos[last] = pos;
+    m_available_cols.pop_back();
   }
 }
 
-bool QTable::IsNeighbourAvailable(Ipv4Address neighb) {
-  return std::find(m_unavail.begin(), m_unavail.end(), neighb) == m_unavail.end();
+bool
+QTableTopology::IsNeighbourAvailable(Ipv4Address neighb) const {
+  int32_t col = ColumnOf(neighb);
+  return col < 0 || IsColumnAvailable(col);
 }
 
-bool QTable::HasConverged(Ipv4Address dst, bool best_estim_only) {
-  bool ret = true;
-  QTableEntry q;
-  for (const auto& i : m_qtable[dst]){
-    if (!IsNeighbourAvailable(i.GetNextHop())) {
-      //skip
-    } else if (!best_estim_only)  {
-      ret = ret && i.HasConverged();
-      if (!ret) { return ret; }
-    } else {
-      if (q.GetQValue().GetInteger() > i.GetQValue().GetInteger()) {
-        q = i;
+std::vector<Ipv4Address>
+QTableTopology::GetUnavails() const {
+  std::vector<Ipv4Address> unavail;
+  for (uint32_t col = 0; col < NrColumns(); col++) {
+    if (IsColumnNeighbour(col) && !IsColumnAvailable(col)) {
+      unavail.push_back(m_slot_addrs[col]);
+    }
+  }
+  return unavail;
+}
+
+uint32_t
+QTable::EnsureRow(uint32_t dst_id) {
+  if (dst_id >= m_qtable.size()) {
+    // ids are shared with the other classes, the rows in between belong to destinations this class has not seen yet
+    m_qtable.resize(dst_id + 1);
+    m_has_row.resize(dst_id + 1, false);
+    m_listed.resize(dst_id + 1, false);
+    m_row_generation.resize(dst_id + 1, 0);
+    m_best_col.resize(dst_id + 1, BEST_ESTIM_STALE);
+    m_first_best_col.resize(dst_id + 1, BEST_ESTIM_STALE);
+    m_unconverged_cols.resize(dst_id + 1);
+    m_unconverged_pos.resize(dst_id + 1);
+    m_nr_usable.resize(dst_id + 1, 0);
+    m_row_converged.resize(dst_id + 1, false);
+  }
+  if (!m_has_row[dst_id]) {
+    // a new row is filled in with the neighbours as they are now
+    m_has_row[dst_id] = true;
+    m_row_generation[dst_id] = m_topo->GetGeneration();
+  }
+  SyncRow(dst_id);
+  return dst_id;
+}
+
+void
+QTable::SyncRow(uint32_t dst_id) {
+  uint64_t row_generation = m_row_generation[dst_id];
+  if (row_generation == m_topo->GetGeneration()) {
+    return;
+  }
+  if (m_listed[dst_id]) {
+    std::vector<QTableEntry >& row = m_qtable[dst_id];
+    // columns taken since, in the order they were taken in, as the new entries are based on the ones before them
+    std::vector<uint32_t> added;
+    for (uint32_t col = 0; col < m_topo->NrColumns(); col++) {
+      if (m_topo->IsColumnNeighbour(col) && m_topo->ColumnAddedAt(col) > row_generation) {
+        added.push_back(col);
+      }
+    }
+    std::sort(added.begin(), added.end(), [this] (uint32_t a, uint32_t b) { return m_topo->ColumnAddedAt(a) < m_topo->ColumnAddedAt(b); } );
+    for (auto col : added) {
+      InitColumn(dst_id, col);
+    }
+    for (uint32_t col = 0; col < row.size(); col++) {
+      if (m_topo->AvailabilityChangedAt(col) > row_generation) {
+        row[col].SetUnavailable(!IsColumnAvailable(col));
       }
     }
   }
-  // if (best_estim_only){
-  //   if (q.HasConverged()) {
-  //     NS_LOG_UNCOND("best estim has conv to valu of " << q.GetQValue().GetSeconds() );
-  //   }
-  // }
-  return (ret && !best_estim_only) || (q.HasConverged() && best_estim_only);
-}
-
-void QTable::AddNeighbour( Ipv4Address neighb) {
-  if (std::find(m_unavail.begin(), m_unavail.end(), neighb) != m_unavail.end()) {
-    NS_LOG_ERROR("I (" << m_nodeip << ") received a SendHello message from an AODV neighbour and it was marked unavail. neighb= " << neighb << ". Unmarking it. (3x bc traffic types.)");
-    auto unavail_index = std::find(m_unavail.begin(), m_unavail.end(), neighb);
-    m_unavail.erase(unavail_index);
-    for (const auto& dst : m_destinations) {
-      for (unsigned int i = 0; i < m_qtable[dst].size(); i++) {
-        if (m_qtable[dst].at(i).GetNextHop() == neighb) {
-          m_qtable[dst].at(i).SetUnavailable(false);
-        }
+  m_row_generation[dst_id] = m_topo->GetGeneration();
+  m_best_col[dst_id] = BEST_ESTIM_STALE;
+  RecountRow(dst_id);
+}
+
+void
+QTable::InitColumn(uint32_t dst_id, uint32_t col) {
+  std::vector<QTableEntry >& row = m_qtable[dst_id];
+  Ipv4Address neighb = m_topo->NeighbourOf(col);
+  Time estim = MilliSeconds(NEW_NEIGHBOUR_INITIAL_INCREMENT);
+  if (m_topo->DestinationOf(dst_id) == neighb) {
+    estim = MilliSeconds(0);
+  } else { // some initial estimates i guess
+    // the best estimate via the neighbours that were there before this one
+    bool found = false;
+    Time best;
+    for (uint32_t c = 0; c < row.size(); c++) {
+      if (c != col && m_topo->IsColumnNeighbour(c) && m_topo->ColumnAddedAt(c) < m_topo->ColumnAddedAt(col) && (!found || row[c].GetQValue() < best)) {
+        best = row[c].GetQValue();
+        found = true;
       }
     }
-  } else {
-    NS_LOG_ERROR("I (" << m_nodeip << ") received a SendHello message from an AODV neighbour and it was not marked unavail. neighb= " << neighb << ". (3x bc traffic types.)");
+    if (found) {
+      estim = best + MilliSeconds(NEW_NEIGHBOUR_INITIAL_INCREMENT);
+    }
   }
-  if (std::find(m_neighbours.begin(), m_neighbours.end(), neighb) == m_neighbours.end()) {
-    NS_LOG_ERROR("I (" << m_nodeip << ") received a SendHello message from an AODV neighbour and it was not already a neighbour. neighb= " << neighb << ". Adding the neighbour. (3x bc traffic types.)");
-    for (auto i : m_destinations) {
-      if (i == neighb) {
-        m_qtable[i].push_back(QTableEntry(neighb, MilliSeconds(0), m_convergence_threshold, m_learn_more_threshold, m_nodeip));
-      } else { // some initial estimates i guess
-        auto min_it = std::min_element(m_qtable[i].begin(), m_qtable[i].end(), [] (QTableEntry a, QTableEntry b) { return a.GetQValue() < b.GetQValue(); } );
-        if (m_neighbours.size() > 0) {
-          m_qtable[i].push_back(QTableEntry(neighb, min_it->GetQValue() + MilliSeconds(NEW_NEIGHBOUR_INITIAL_INCREMENT), m_convergence_threshold, m_learn_more_threshold, m_nodeip));
-        } else {
-          m_qtable[i].push_back(QTableEntry(neighb, MilliSeconds(NEW_NEIGHBOUR_INITIAL_INCREMENT), m_convergence_threshold, m_learn_more_threshold, m_nodeip));
-        }
+  if (col >= row.size()) {
+    // the slots in between are taken by neighbours that are synced after this one
+    row.resize(col + 1);
+  }
+  row[col] = QTableEntry(neighb, estim, m_convergence_threshold, m_learn_more_threshold, m_nodeip);
+}
+
+void
+QTable::CountEntry(uint32_t dst_id, uint32_t col, int32_t delta) {
+  const QTableEntry& entry = m_qtable[dst_id][col];
+  if (!IsColumnAvailable(col)) {
+    return;
+  }
+  if (!entry.HasConverged()) {
+    std::vector<uint32_t>& cols = m_unconverged_cols[dst_id];
+    std::vector<uint32_t>& pos = m_unconverged_pos[dst_id];
+    if (delta > 0) {
+      if (col >= pos.size()) {
+        pos.resize(col + 1);
       }
+      pos[col] = cols.size();
+      cols.push_back(col);
+    } else {
+      NS_ASSERT_MSG(col < pos.size() && pos[col] < cols.size() && cols[pos[col]] == col, "Column " << col << " was not counted as unconverged.");
+      // the last column takes its place
+      uint32_t last = cols.back();
+      cols[pos[col]] = last;
+      pos[last] = pos[col];
+      cols.pop_back();
     }
-    m_neighbours.push_back(neighb);
-  } else {
-    NS_LOG_ERROR("I (" << m_nodeip << ") received a SendHello message from an AODV neighbour and it was already a neighbour. neighb= " << neighb << ". (3x bc traffic types.)");
+  }
+  if (m_topo->IsColumnNeighbour(col) && !entry.IsBlackListed() && entry.IsAvailable()) {
+    m_nr_usable[dst_id] += delta;
   }
 }
 
-void QTable::RemoveNeighbour(Ipv4Address neighb) {
-  if (std::find(m_unavail.begin(), m_unavail.end(), neighb) != m_unavail.end()) {
-    NS_LOG_DEBUG("Removing unavailable neighbour " << neighb << ".");
+void
+QTable::RecountRow(uint32_t dst_id) {
+  m_unconverged_cols[dst_id].clear();
+  m_nr_usable[dst_id] = 0;
+  for (uint32_t col = 0; col < m_qtable[dst_id].size(); col++) {
+    CountEntry(dst_id, col, 1);
+  }
+  NoteRowConvergence(dst_id);
+}
 
-    auto unavail_index = std::find(m_unavail.begin(), m_unavail.end(), neighb);
-    auto neighbours_index = std::find(m_neighbours.begin(), m_neighbours.end(), neighb);
+void
+QTable::NoteRowConvergence(uint32_t dst_id) {
+  // as HasConverged(dst), except that rows that were only looked up (and are empty) never converge
+  bool converged = !m_qtable[dst_id].empty() && m_unconverged_cols[dst_id].empty();
+  if (converged != m_row_converged[dst_id]) {
+    m_row_converged[dst_id] = converged;
+    m_counters.Increment(converged ? QRC_CONVERGED : QRC_UNCONVERGED);
+  }
+}
 
-    NS_ASSERT_MSG(unavail_index != m_unavail.end(),"Trying to delete a neighbour that is no longer unavailable...somehow. I dont think this can ever actually happen");
-    NS_ASSERT_MSG(neighbours_index != m_neighbours.end(), "Trying to delete a neighbour that has already been deleted, again, unlikely but to be sure let's check.");
+uint32_t
+QTable::ColumnOfEntry(uint32_t dst_id, const QTableEntry& entry) const {
+  const std::vector<QTableEntry >& row = m_qtable[dst_id];
+  NS_ASSERT_MSG(!row.empty() && &entry >= &row.front() && &entry <= &row.back(), "Entry is not part of the row of dst id " << dst_id << " at " << m_nodeip << ".");
+  return &entry - &row.front();
+}
 
-    // Neighbour is still marked as unavailable -> remove it from both the list of neighbours and from the list of unavailables...
-    m_unavail.erase(unavail_index);
-    m_neighbours.erase(neighbours_index);
-  } else {
-    NS_LOG_DEBUG("Tried to remove neighbour but availability has been restored already.");
+QTable::QTable(Ptr<QTableTopology> topology, Ipv4Address nodeip, float learning_rate, float convergence_threshold,
+          float learn_more_threshold, std::string addition, bool _in_test, bool print_qtables, float gamma,
+          Time sampling_interval) :
+  m_topo(topology), m_nodeip(nodeip),m_learningrate(learning_rate), m_convergence_threshold(convergence_threshold), m_gamma(gamma),
+  m_learn_more_threshold(learn_more_threshold), m_destinations(topology->GetNeighbours()),
+  m_in_test(_in_test), m_print_qtables(print_qtables) {
+
+  const std::vector<Ipv4Address>& neighbours = m_topo->GetNeighbours();
+  for (auto neighb : neighbours) {
+    m_listed[InternDestination(neighb)] = true;
+  }
+  for (auto neighb : neighbours) {
+    std::vector<QTableEntry >& row = m_qtable[InternDestination(neighb)];
+    row.clear();
+    for (auto i : neighbours) {
+      if (i == neighb) {
+        row.push_back(QTableEntry(i, MilliSeconds(INITIAL_QVALUE_QTABLEENTRY_VIA), m_convergence_threshold, m_learn_more_threshold, m_nodeip));
+      } else { // some initial estimates i guess
+        row.push_back(QTableEntry(i, MilliSeconds(INITIAL_QVALUE_QTABLEENTRY_NOT_VIA), m_convergence_threshold, m_learn_more_threshold, m_nodeip));
+      }
+    }
+    RecountRow(InternDestination(neighb));
+  }
+  // convertQTableRecords.py turns <ip>_qtable<addition>.bin into the <ip>_qtable<addition>.txt drawQTables.py reads
+  std::stringstream ss;
+  ss << m_nodeip << "_qtable" << addition << ".bin";
+  m_output_file_name = ss.str();
+
+  if (!m_in_test && m_print_qtables) {
+    m_recorder = Create<QTableRecorder> (m_output_file_name, sampling_interval);
+    for (auto neighb : neighbours) {
+      m_recorder->AddNeighbour(ColumnOf(neighb), neighb);
+    }
+    for (auto dst : m_destinations) {
+      uint32_t dst_id = InternDestination(dst);
+      m_recorder->AddDestination(dst_id, dst);
+      RecordRow(dst_id, false);
+    }
+    m_recorder->CellsRecorded();
   }
 }
 
-bool fileEmpty (std::string filename) {
-  std::fstream filestr;
-  filestr.open(filename, std::ios::in);
+bool QTable::HasConverged(Ipv4Address dst, bool best_estim_only) {
+  uint32_t dst_id = InternDestination(dst);
+  if (!best_estim_only) {
+    // every entry in an available column has converged
+    return m_unconverged_cols[dst_id].empty();
+  }
+  // the best estimate has converged, the first one if several entries share the lowest q value
+  if (m_best_col[dst_id] == BEST_ESTIM_STALE) {
+    RefreshBestCols(dst_id);
+  }
+  return m_first_best_col[dst_id] != BEST_ESTIM_NONE && m_qtable[dst_id][m_first_best_col[dst_id]].HasConverged();
+}
 
-  for (std::string line; std::getline(filestr, line); )
-  {
-    filestr.close();
-    return false;
+void
+QTable::RecordNeighbourAdded(Ipv4Address neighb, uint32_t col) {
+  if (m_recorder) {
+    m_recorder->AddNeighbour(col, neighb);
+    for (auto i : m_destinations) {
+      RecordRow(InternDestination(i), false);
+    }
+    m_recorder->CellsRecorded();
   }
-  filestr.close();
-  return true;
 }
 
 void
 QTable::SetQValueWrapper(Ipv4Address dst, Ipv4Address next_hop, Time new_value) {
-  ToFile(m_output_file_name);
-  GetEntryByRef(dst,next_hop).SetQValue(new_value);
-  ToFile(m_output_file_name);
+  uint32_t dst_id = InternDestination(dst);
+  QTableEntry& entry = EntryOfRow(dst, next_hop, dst_id);
+  uint32_t col = ColumnOfEntry(dst_id, entry);
+  CountEntry(dst_id, col, -1);
+  entry.SetQValue(new_value);
+  CountEntry(dst_id, col, 1);
+  NoteRowConvergence(dst_id);
+  m_best_col[dst_id] = BEST_ESTIM_STALE;
+  RecordRow(dst_id);
 }
 
 void
-QTable::ToFile(std::string filename) {
-  if (m_out_stream == 0 || m_in_test || !m_print_qtables) {
-    return;
+QTable::SetQValueWrapper(Ipv4Address dst, QTableEntry& entry, Time new_value) {
+  uint32_t dst_id = InternDestination(dst);
+  uint32_t col = ColumnOfEntry(dst_id, entry);
+  CountEntry(dst_id, col, -1);
+  entry.SetQValue(new_value);
+  CountEntry(dst_id, col, 1);
+  NoteRowConvergence(dst_id);
+  m_best_col[dst_id] = BEST_ESTIM_STALE;
+  RecordRow(dst_id);
+}
+
+void
+QTable::SetSenderConverged(Ipv4Address dst, QTableEntry& entry, bool b) {
+  uint32_t dst_id = InternDestination(dst);
+  uint32_t col = ColumnOfEntry(dst_id, entry);
+  CountEntry(dst_id, col, -1);
+  entry.SetSenderConverged(b);
+  CountEntry(dst_id, col, 1);
+  NoteRowConvergence(dst_id);
+}
+
+void
+QTable::AddStrike(Ipv4Address dst, QTableEntry& entry) {
+  uint32_t dst_id = InternDestination(dst);
+  uint32_t col = ColumnOfEntry(dst_id, entry);
+  bool was_blacklisted = entry.IsBlackListed();
+  CountEntry(dst_id, col, -1);
+  entry.AddStrike();
+  CountEntry(dst_id, col, 1);
+  if (!was_blacklisted && entry.IsBlackListed()) {
+    m_counters.Increment(QRC_BLACKLISTED);
   }
+}
 
-  if (fileEmpty(filename)) {
-    for (auto i : m_destinations) {
-      for (auto j : m_neighbours) {
-        *(m_out_stream->GetStream ()) << i << " -> " << j << ",";
-      }
-    }
-    *(m_out_stream->GetStream ()) << std::endl;
+void
+QTable::DeductStrike(Ipv4Address dst, QTableEntry& entry) {
+  uint32_t dst_id = InternDestination(dst);
+  uint32_t col = ColumnOfEntry(dst_id, entry);
+  bool was_blacklisted = entry.IsBlackListed();
+  CountEntry(dst_id, col, -1);
+  entry.DeductStrike();
+  CountEntry(dst_id, col, 1);
+  if (was_blacklisted && !entry.IsBlackListed()) {
+    m_counters.Increment(QRC_UNBLACKLISTED);
   }
-  *(m_out_stream->GetStream ()) << Simulator::Now() << "|";
-  for (auto i : m_destinations) {
-    for (auto j : m_neighbours) {
-      *(m_out_stream->GetStream ())  << std::find_if( m_qtable[i].begin(), m_qtable[i].end(), [j](const QTableEntry& elt){ return elt.GetNextHop() == j;} )->GetQValue() << ",";
-    }
+}
+
+void
+QTable::RecordRow(uint32_t dst_id, bool sample) {
+  if (!m_recorder) {
+    return;
+  }
+  const std::vector<QTableEntry >& row = m_qtable[dst_id];
+  for (uint32_t col = 0; col < row.size(); col++) {
+    m_recorder->RecordCell(dst_id, col, row[col].GetQValue());
+  }
+  if (sample) {
+    m_recorder->CellsRecorded();
   }
-  *(m_out_stream->GetStream ()) << std::endl;
 }
 
 void
 QTable::FinalFile() {
-  if (!m_out_stream) {
+  if (!m_recorder) {
     return;
   }
-  for (auto i : m_destinations) {
-    for (auto j : m_neighbours) {
-      *(m_out_stream->GetStream ()) << i << " >> " << j << ",";
-    }
-  }
-  *(m_out_stream->GetStream ()) << std::endl;
+  m_recorder->Close();
 }
 
 bool
 QTable::CheckDestinationKnown(const Ipv4Address& dst) {
-  if (!((dst == m_nodeip) || m_qtable.find(dst) != m_qtable.end())) {
+  if (!((dst == m_nodeip) || HasRow(dst))) {
     NS_LOG_DEBUG("CheckDestinationKnown " << dst << " " << m_nodeip << "  "
-                  << (std::find(m_neighbours.begin(), m_neighbours.end(), dst) != m_neighbours.end()) << "    "
+                  << (std::find(m_topo->GetNeighbours().begin(), m_topo->GetNeighbours().end(), dst) != m_topo->GetNeighbours().end()) << "    "
                   << (std::find(m_destinations.begin(), m_destinations.end(), dst) != m_destinations.end()));
   }
-  return (dst == m_nodeip) || m_qtable.find(dst) != m_qtable.end();
+  return (dst == m_nodeip) || HasRow(dst);
 }
 
 bool
 QTable::AddDestination(Ipv4Address via, Ipv4Address dst, Time t) {
   NS_ASSERT_MSG(m_nodeip != dst, m_nodeip << " tried to add QRoute to itself. Let the debugging commence!");
-  if (m_qtable.find(dst) != m_qtable.end()) {
+  if (HasRow(dst)) {
     NS_LOG_DEBUG("[" << m_nodeip << "]" << "Tried adding " << dst << " via " << via << " but the destination was already known. Do we do anything instead..?");
     // dst is already known as a destination for this node, we dont have to add it again...
     return false;
@@ -349,19 +634,31 @@ QTable::AddDestination(Ipv4Address via, Ipv4Address dst, Time t) {
     //   }
     // }
     m_destinations.push_back(dst);
-    m_qtable[dst] = std::vector<QTableEntry >();
-
-    for (auto i : m_neighbours) {
-      if (via == Ipv4Address(IP_WHEN_NO_NEXT_HOP_NEIGHBOUR_KNOWN_YET)) {
-        m_qtable[dst].push_back(QTableEntry(i, MilliSeconds(INITIAL_QVALUE_QTABLEENTRY_VIA), m_convergence_threshold, m_learn_more_threshold, m_nodeip)); //this is dodgy too ...
+    uint32_t dst_id = InternDestination(dst);
+    m_listed[dst_id] = true;
+    std::vector<QTableEntry >& row = m_qtable[dst_id];
+    row.reserve(m_topo->NrColumns());
+
+    for (uint32_t col = 0; col < m_topo->NrColumns(); col++) {
+      Ipv4Address i = m_topo->NeighbourOf(col);
+      if (!m_topo->IsColumnNeighbour(col)) {
+        row.push_back(QTableEntry()); // free slot
+      } else if (via == Ipv4Address(IP_WHEN_NO_NEXT_HOP_NEIGHBOUR_KNOWN_YET)) {
+        row.push_back(QTableEntry(i, MilliSeconds(INITIAL_QVALUE_QTABLEENTRY_VIA), m_convergence_threshold, m_learn_more_threshold, m_nodeip)); //this is dodgy too ...
       } else {
         if (i == via) {
-          m_qtable[dst].push_back(QTableEntry(i, t,m_convergence_threshold, m_learn_more_threshold, m_nodeip));
+          row.push_back(QTableEntry(i, t,m_convergence_threshold, m_learn_more_threshold, m_nodeip));
         } else { // some initial estimates i guess
-          m_qtable[dst].push_back(QTableEntry(i, t + MilliSeconds(INITIAL_QVALUE_QTABLEENTRY_NOT_VIA), m_convergence_threshold, m_learn_more_threshold, m_nodeip)); //Actually no idea...
+          row.push_back(QTableEntry(i, t + MilliSeconds(INITIAL_QVALUE_QTABLEENTRY_NOT_VIA), m_convergence_threshold, m_learn_more_threshold, m_nodeip)); //Actually no idea...
         }
       }
     }
+    m_best_col[dst_id] = BEST_ESTIM_STALE;
+    RecountRow(dst_id);
+    if (m_recorder) {
+      m_recorder->AddDestination(dst_id, dst);
+      RecordRow(dst_id);
+    }
     return true;
   }
 }
@@ -388,9 +685,10 @@ QTable::PrettyPrint(std::string extra_info) {
 
   // Print the column headers, i.e. neighb | neighb | neighb | neighb ...
   for (const auto& dst : m_destinations) {
-    for (unsigned int i = 0; i < m_qtable[dst].size(); i++) {
-      m_qtable[dst].at(i).GetNextHop().Print(help);
-      if (std::find(m_unavail.begin(), m_unavail.end(), m_qtable[dst].at(i).GetNextHop() ) != m_unavail.end()) {
+    const std::vector<QTableEntry >& row = m_qtable[InternDestination(dst)];
+    for (unsigned int i = 0; i < row.size(); i++) {
+      row.at(i).GetNextHop().Print(help);
+      if (!IsColumnAvailable(i)) {
         help << " (U)";
       }
       tmp = help.str();
@@ -411,14 +709,15 @@ QTable::PrettyPrint(std::string extra_info) {
 
     oss << tmp << "   |   ";
 
-    for (unsigned int i = 0; i < m_qtable[dst].size(); i++) {
-      help << m_qtable[dst].at(i).GetQValue().As (Time::MS);
+    const std::vector<QTableEntry >& row = m_qtable[InternDestination(dst)];
+    for (unsigned int i = 0; i < row.size(); i++) {
+      help << row.at(i).GetQValue().As (Time::MS);
       tmp = help.str();
       help.str(std::string());
 
-      if (m_qtable[dst].at(i).HasConverged() ) {
+      if (row.at(i).HasConverged() ) {
         tmp_C = "(C) ";
-      } else if (m_qtable[dst].at(i).IsBlackListed() ) {
+      } else if (row.at(i).IsBlackListed() ) {
         tmp_C = "(B) ";
       } else {
         tmp_C = "";
@@ -447,17 +746,22 @@ QTable::PrettyPrint(std::string extra_info) {
 }
 
 QTableEntry& QTable::GetEntryByRef(Ipv4Address dst,Ipv4Address via) {
-  NS_ASSERT_MSG(std::find_if(m_qtable[dst].begin(), m_qtable[dst].end(), [via](const QTableEntry& obj) {
-      return obj.GetNextHop() == via;
-    } ) != m_qtable[dst].end(),
+  return EntryOfRow(dst, via, InternDestination(dst));
+}
+
+QTableEntry&
+QTable::EntryOfRow(Ipv4Address dst, Ipv4Address via, uint32_t dst_id) {
+  std::vector<QTableEntry >& row = m_qtable[dst_id];
+  int32_t col = ColumnOf(via);
+  NS_ASSERT_MSG(col >= 0 && static_cast<uint32_t>(col) < row.size() && row[col].GetNextHop() == via,
   "\nTried to find an entry by reference but it did not exist!? dst=" << dst << " via="<<via<<" and i am " << m_nodeip << std::endl << PrettyPrint() );
 
-  return *(std::find_if(m_qtable[dst].begin(), m_qtable[dst].end(), [via](const QTableEntry& obj) {return obj.GetNextHop() == via; } ) );
+  return row[col];
 }
 
 QTableEntry
 QTable::GetNextEstimToLearn(Ipv4Address dst) {
-  NS_ASSERT_MSG(m_qtable.find(dst) != m_qtable.end() || dst == m_nodeip, "(best estim) If we encounter a dst we have previously not registered we will get strange behaviour. (right?)");
+  NS_ASSERT_MSG(HasRow(dst) || dst == m_nodeip, "(best estim) If we encounter a dst we have previously not registered we will get strange behaviour. (right?)");
   QTableEntry q;
   q.SetNodeIp(m_nodeip);
 
@@ -465,9 +769,11 @@ QTable::GetNextEstimToLearn(Ipv4Address dst) {
     return QTableEntry(q.GetNextHop(),Seconds(0), m_convergence_threshold, m_learn_more_threshold, m_nodeip);
   }
 
-  for (const auto& elt : m_qtable[dst]) {
+  const std::vector<QTableEntry >& row = m_qtable[InternDestination(dst)];
+  for (uint32_t col = 0; col < row.size(); col++) {
+    const QTableEntry& elt = row[col];
     if (  (elt.HasConverged() ) ||
-          (std::find(m_unavail.begin(),m_unavail.end(),elt.GetNextHop()) != m_unavail.end())
+          !IsColumnAvailable(col)
        ) {
       //do nothing
     } else {
@@ -475,17 +781,7 @@ QTable::GetNextEstimToLearn(Ipv4Address dst) {
     }
   }
 
-  bool any_neighb_reachable = false;
-  for (const auto& j : m_neighbours) {
-    if ( std::find(m_unavail.begin(), m_unavail.end(), j) != m_unavail.end() ) {
-      any_neighb_reachable = false || any_neighb_reachable;
-      // NS_ASSERT_MSG(false, "ALL NEIGHBOURS ARE UNREACHABLE");
-    } else {
-      any_neighb_reachable = true;
-    }
-  }
-
-  if (!any_neighb_reachable) {
+  if (!AnyNeighbourReachable()) {
     return QTableEntry(Ipv4Address(NO_NEIGHBOURS_REACHABLE_ROUTE_IP), MilliSeconds(NO_NEIGHBOURS_REACHABLE_ROUTE_MS), m_convergence_threshold, m_learn_more_threshold, m_nodeip);
   }
 
@@ -496,7 +792,7 @@ QTable::GetNextEstimToLearn(Ipv4Address dst) {
 
 QTableEntry
 QTable::GetNextEstim(Ipv4Address dst, Ipv4Address via) {
-  NS_ASSERT_MSG(m_qtable.find(dst) != m_qtable.end() || dst == m_nodeip, "(best estim) If we encounter a dst we have previously not registered we will get strange behaviour. (right?)");
+  NS_ASSERT_MSG(HasRow(dst) || dst == m_nodeip, "(best estim) If we encounter a dst we have previously not registered we will get strange behaviour. (right?)");
 
   QTableEntry q;
   q.SetNodeIp(m_nodeip);
@@ -505,26 +801,19 @@ QTable::GetNextEstim(Ipv4Address dst, Ipv4Address via) {
     return QTableEntry(q.GetNextHop(),Seconds(0), m_convergence_threshold, m_learn_more_threshold, m_nodeip);
   }
 
-  for (const auto& elt : m_qtable[dst]) {
-    if (elt.GetNextHop() != via ||
-        (elt.GetQValue() <= q.GetQValue() && std::find(m_unavail.begin(),m_unavail.end(),elt.GetNextHop()) != m_unavail.end())) {
+  // only the entry of via can be picked, so look it up directly
+  const std::vector<QTableEntry >& row = m_qtable[InternDestination(dst)];
+  int32_t col = ColumnOf(via);
+  if (col >= 0 && static_cast<uint32_t>(col) < row.size()) {
+    const QTableEntry& elt = row[col];
+    if (elt.GetQValue() <= q.GetQValue() && !IsColumnAvailable(col)) {
       //do nothing
     } else {
       q = elt;
     }
   }
 
-  bool any_neighb_reachable = false;
-  for (const auto& j : m_neighbours) {
-    if ( std::find(m_unavail.begin(), m_unavail.end(), j) != m_unavail.end() ) {
-      any_neighb_reachable = false || any_neighb_reachable;
-      // NS_ASSERT_MSG(false, "ALL NEIGHBOURS ARE UNREACHABLE");
-    } else {
-      any_neighb_reachable = true;
-    }
-  }
-
-  if (!any_neighb_reachable) {
+  if (!AnyNeighbourReachable()) {
     return QTableEntry(Ipv4Address(NO_NEIGHBOURS_REACHABLE_ROUTE_IP), MilliSeconds(NO_NEIGHBOURS_REACHABLE_ROUTE_MS), m_convergence_threshold, m_learn_more_threshold, m_nodeip);
   }
 
@@ -534,7 +823,7 @@ QTable::GetNextEstim(Ipv4Address dst, Ipv4Address via) {
 
 QTableEntry
 QTable::GetNextEstim(Ipv4Address dst, Ipv4Address next_hop_a, Ipv4Address next_hop_b) {
-  NS_ASSERT_MSG(m_qtable.find(dst) != m_qtable.end() || dst == m_nodeip, "(best estim) If we encounter a dst we have previously not registered we will get strange behaviour. (right?)");
+  NS_ASSERT_MSG(HasRow(dst) || dst == m_nodeip, "(best estim) If we encounter a dst we have previously not registered we will get strange behaviour. (right?)");
 
   QTableEntry q;
   q.SetNodeIp(m_nodeip);
@@ -548,9 +837,11 @@ QTable::GetNextEstim(Ipv4Address dst, Ipv4Address next_hop_a, Ipv4Address next_h
     q_by_ref = GetEntryByRef(dst, q.GetNextHop());
   }
 
-  for (const auto& elt : m_qtable[dst]) {
+  const std::vector<QTableEntry >& row = m_qtable[InternDestination(dst)];
+  for (uint32_t col = 0; col < row.size(); col++) {
+    const QTableEntry& elt = row[col];
     if (elt.GetNextHop() == next_hop_a || // if its next hop a
-        (elt.GetQValue() <= q.GetQValue() && std::find(m_unavail.begin(),m_unavail.end(),elt.GetNextHop()) != m_unavail.end()) ||
+        (elt.GetQValue() <= q.GetQValue() && !IsColumnAvailable(col)) ||
         elt.GetQValue() > q.GetQValue() || // or if its a worse estimate
         elt.GetNextHop() == next_hop_b || // or if its next hop b
         q_by_ref.IsBlackListed() // or if its blacklisted, BUT FOR THAT WE NEED IT BY REF
@@ -563,9 +854,10 @@ QTable::GetNextEstim(Ipv4Address dst, Ipv4Address next_hop_a, Ipv4Address next_h
 
   if (q.GetNextHop() == Ipv4Address(UNINITIALIZED_IP_ADDRESS_VALUE_QTABLE) && q.GetQValue() == Years(10) ) {
     NS_ASSERT(false);
-    for (const auto& elt : m_qtable[dst]) {
+    for (uint32_t col = 0; col < row.size(); col++) {
+      const QTableEntry& elt = row[col];
       if (elt.GetNextHop() == next_hop_a ||
-          (elt.GetQValue() > q.GetQValue() && std::find(m_unavail.begin(),m_unavail.end(),elt.GetNextHop()) != m_unavail.end()) ||
+          (elt.GetQValue() > q.GetQValue() && !IsColumnAvailable(col)) ||
           q.IsBlackListed()
           ) {
         //do nothing
@@ -576,17 +868,7 @@ QTable::GetNextEstim(Ipv4Address dst, Ipv4Address next_hop_a, Ipv4Address next_h
   }
   NS_ASSERT(!(q.GetNextHop() == Ipv4Address(UNINITIALIZED_IP_ADDRESS_VALUE_QTABLE) && q.GetQValue() == Years(10)));
 
-  bool any_neighb_reachable = false;
-  for (const auto& j : m_neighbours) {
-    if ( std::find(m_unavail.begin(), m_unavail.end(), j) != m_unavail.end() ) {
-      any_neighb_reachable = false || any_neighb_reachable;
-      // NS_ASSERT_MSG(false, "ALL NEIGHBOURS ARE UNREACHABLE");
-    } else {
-      any_neighb_reachable = true;
-    }
-  }
-
-  if (!any_neighb_reachable) {
+  if (!AnyNeighbourReachable()) {
     return QTableEntry(Ipv4Address(NO_NEIGHBOURS_REACHABLE_ROUTE_IP), MilliSeconds(NO_NEIGHBOURS_REACHABLE_ROUTE_MS), m_convergence_threshold, m_learn_more_threshold, m_nodeip);
   }
 
@@ -600,29 +882,26 @@ QTable::AllNeighboursBlacklisted(Ipv4Address dst) {
   NS_ASSERT_MSG(dst != Ipv4Address(NO_NEIGHBOURS_REACHABLE_ROUTE_IP), "At least be a real destination IP address if you're going to check this." );
   NS_ASSERT_MSG(dst != Ipv4Address(UNINITIALIZED_IP_ADDRESS_VALUE_QTABLE), "At least be a real destination IP address if you're going to check this." );
 
-  bool all_neighb_blacklisted = true;
-  for (const auto& j : m_neighbours) {
-    if (dst == m_nodeip) {
-      return false;
-    } else{
-      if ( std::find(m_unavail.begin(), m_unavail.end(), j) == m_unavail.end() && !GetEntryByRef(dst,j).IsBlackListed() && GetEntryByRef(dst,j).IsAvailable() ) {
-        all_neighb_blacklisted = false;
-      } else {
-        all_neighb_blacklisted = true && all_neighb_blacklisted;
-      }
-    }
+  if (dst == m_nodeip) {
+    return m_topo->GetNeighbours().empty();
   }
-  // if (all_neighb_blacklisted){
-  //   std::cout << PrettyPrint() << std::endl;
-  // }
-  return all_neighb_blacklisted;
+
+  uint32_t dst_id = InternDestination(dst);
+  NS_ASSERT_MSG(m_topo->GetNeighbours().empty() || !m_qtable[dst_id].empty(), "\nTried to find an entry by reference but it did not exist!? dst=" << dst << " and i am " << m_nodeip);
+  // no neighbour is available and not blacklisted
+  return m_nr_usable[dst_id] == 0;
 }
 
 
 QTableEntry
 QTable::GetNextEstim(Ipv4Address dst) {
+  return BestEstimOfRow(dst, m_topo->FindDestination(dst));
+}
+
+QTableEntry
+QTable::BestEstimOfRow(Ipv4Address dst, int32_t dst_id) {
   /* if we cant find the destination in our qtable or if the destination is still ourselves ( if we're the PTST tagged packet's destination, this case happens ) */
-  NS_ASSERT_MSG(m_qtable.find(dst) != m_qtable.end() || dst == m_nodeip, "(best estim) If we encounter a dst we have previously not registered we will get strange behaviour. (right?)");
+  NS_ASSERT_MSG(HasRow(dst_id) || dst == m_nodeip, "(best estim) If we encounter a dst we have previously not registered we will get strange behaviour. (right?)");
 
   QTableEntry q;
   q.SetNodeIp(m_nodeip);
@@ -631,31 +910,24 @@ QTable::GetNextEstim(Ipv4Address dst) {
     return QTableEntry(q.GetNextHop(),Seconds(0), m_convergence_threshold, m_learn_more_threshold, m_nodeip);
   }
 
-  if (AllNeighboursBlacklisted(dst) && m_nodeip == Ipv4Address("10.1.1.1") /* only the source sending randomly otherwise loops */ ) {
+  if (m_nodeip == Ipv4Address("10.1.1.1") /* only the source sending randomly otherwise loops */ && AllNeighboursBlacklisted(dst) ) {
     // this is still experimental though
     // NS_ASSERT_MSG(false, "this part is yet to do");
     return GetRandomEstim(dst, false); //dont look at unconv only, just any random one will do..
   }
 
-  for (const auto& elt : m_qtable[dst]) {
-    if (elt.GetQValue() > q.GetQValue() || (elt.GetQValue() <= q.GetQValue() && std::find(m_unavail.begin(),m_unavail.end(),elt.GetNextHop()) != m_unavail.end())) {
-      //do nothing
-    } else {
-      q = elt;
-    }
+  /* the best column only changes when a qvalue of this row or the availability of a neighbour changes, so it is
+   * cached per destination and invalidated by the functions that do either of those */
+  uint32_t row_id = (HasRow(dst_id) ? EnsureRow(dst_id) : InternDestination(dst));
+  const std::vector<QTableEntry >& row = m_qtable[row_id];
+  if (m_best_col[row_id] == BEST_ESTIM_STALE) {
+    RefreshBestCols(row_id);
   }
-
-  bool any_neighb_reachable = false;
-  for (const auto& j : m_neighbours) {
-    if ( std::find(m_unavail.begin(), m_unavail.end(), j) != m_unavail.end() ) {
-      any_neighb_reachable = false || any_neighb_reachable;
-      // NS_ASSERT_MSG(false, "ALL NEIGHBOURS ARE UNREACHABLE");
-    } else {
-      any_neighb_reachable = true;
-    }
+  if (m_best_col[row_id] != BEST_ESTIM_NONE) {
+    q = row[m_best_col[row_id]];
   }
 
-  if (!any_neighb_reachable) {
+  if (!AnyNeighbourReachable()) {
     return QTableEntry(Ipv4Address(NO_NEIGHBOURS_REACHABLE_ROUTE_IP), MilliSeconds(NO_NEIGHBOURS_REACHABLE_ROUTE_MS), m_convergence_threshold, m_learn_more_threshold, m_nodeip);
   }
 
@@ -663,6 +935,30 @@ QTable::GetNextEstim(Ipv4Address dst) {
   return q;
 }
 
+void
+QTable::RefreshBestCols(uint32_t dst_id) {
+  const std::vector<QTableEntry >& row = m_qtable[dst_id];
+  int32_t best = BEST_ESTIM_NONE, first_best = BEST_ESTIM_NONE;
+  Time best_estim = QTableEntry().GetQValue();
+  Time first_best_estim = best_estim;
+  for (uint32_t col = 0; col < row.size(); col++) {
+    if (!IsColumnAvailable(col)) {
+      continue;
+    }
+    // ties go to the last available entry
+    if (row[col].GetQValue() <= best_estim) {
+      best_estim = row[col].GetQValue();
+      best = col;
+    }
+    if (row[col].GetQValue() < first_best_estim) {
+      first_best_estim = row[col].GetQValue();
+      first_best = col;
+    }
+  }
+  m_best_col[dst_id] = best;
+  m_first_best_col[dst_id] = first_best;
+}
+
 void QTableEntry::DeductStrike() {
   m_number_of_strikes -= 1;
   if (m_number_of_strikes == 0 && IsBlackListed()) {
@@ -687,7 +983,7 @@ bool QTable::LearnLess(Ipv4Address dst) {
   bool ret = false;
   QTableEntry best_estim = GetNextEstim(dst);
   if (GetEntryByRef(dst,best_estim.GetNextHop()).LearnLess()) {
-    for (const auto& neighb : m_neighbours) {
+    for (const auto& neighb : m_topo->GetNeighbours()) {
       if (GetEntryByRef(dst,neighb).LearnLess()) {
         ret = true;
       }
@@ -718,7 +1014,7 @@ QTable::GetRandomEstim(Ipv4Address dst, bool _unconverged_entries_only) {
     unconverged_entries_only = false;
   }
   /* if we cant find the destination in our qtable or if the destination is still ourselves ( if we're the PTST tagged packet's destination, this case happens ) */
-  NS_ASSERT_MSG(m_qtable.find(dst) != m_qtable.end() || dst == m_nodeip, "(random estim) If we encounter a dst we have previously not registered we will get strange behaviour. (right?)");
+  NS_ASSERT_MSG(HasRow(dst) || dst == m_nodeip, "(random estim) If we encounter a dst we have previously not registered we will get strange behaviour. (right?)");
 
   Ipv4Address next_hop;
 
@@ -727,28 +1023,40 @@ QTable::GetRandomEstim(Ipv4Address dst, bool _unconverged_entries_only) {
     return QTableEntry( next_hop, Seconds(0), m_convergence_threshold, m_learn_more_threshold, m_nodeip);
   }
 
-  std::set<int> tried_indices;
-  int random_index = 0;
-  while (true) {
-    random_index = rand()%(m_neighbours.size() );
-    if  (IsNeighbourAvailable(m_qtable[ dst ].at(random_index).GetNextHop() ) && //if the nieghbour isnt available -> route is no good
-        ( (unconverged_entries_only && !m_qtable[ dst ].at(random_index).HasConverged()) || !unconverged_entries_only)  ){ // if were only looking for non-converged values, skip this value
-     break;
-    }
-    tried_indices.insert(random_index);
-    if (tried_indices.size() == m_neighbours.size()) {
+  uint32_t dst_id = InternDestination(dst);
+  const std::vector<QTableEntry >& row = m_qtable[dst_id];
+  if (row.empty()) {
+    return QTableEntry(Ipv4Address(NO_NEIGHBOURS_REACHABLE_ROUTE_IP), MilliSeconds(NO_NEIGHBOURS_REACHABLE_ROUTE_MS), m_convergence_threshold, m_learn_more_threshold, m_nodeip);
+  }
+  /* draw straight from the columns that qualify instead of retrying random columns until one does : the unconverged
+   * entries of the row (only ever available columns, see CountEntry) or the available columns */
+  uint32_t col;
+  if (unconverged_entries_only) {
+    const std::vector<uint32_t>& unconverged = m_unconverged_cols[dst_id];
+    NS_ASSERT_MSG(!unconverged.empty(), "A row that has not converged has no unconverged entries.");
+    col = unconverged[DrawIndex(unconverged.size())];
+  } else {
+    if (m_topo->NrAvailableColumns() == 0) {
       return QTableEntry(Ipv4Address(NO_NEIGHBOURS_REACHABLE_ROUTE_IP), MilliSeconds(NO_NEIGHBOURS_REACHABLE_ROUTE_MS), m_convergence_threshold, m_learn_more_threshold, m_nodeip);
-      NS_ASSERT_MSG(false, "ALL NEIGHBOURS ARE UNREACHABLE");
     }
+    col = m_topo->AvailableColumn(DrawIndex(m_topo->NrAvailableColumns()));
   }
-  return m_qtable[ dst ].at(random_index);
+  NS_ASSERT_MSG(col < row.size(), "Column " << col << " is not in the row of " << dst);
+  return row[col];
+}
+
+uint32_t
+QTable::DrawIndex(uint32_t n) {
+  if (!m_random) {
+    m_random = CreateObject<UniformRandomVariable> ();
+  }
+  return m_random->GetInteger(0, n - 1);
 }
 
 void
 QTable::Update(Ipv4Address via, Ipv4Address dst, Time _queue_time_, Time travel_time, Time next_hop_estimate) {
   /* if no information is known about dst, no updates will happen and we will assert(false) so we make sure to do this first*/
   AddDestination(via, dst, travel_time);
-  ToFile(m_output_file_name);
   // NS_ASSERT(false);
 
   Time queue_time = _queue_time_ ;
@@ -761,84 +1069,87 @@ QTable::Update(Ipv4Address via, Ipv4Address dst, Time _queue_time_, Time travel_
 
   // m qtable dst is 0 for some reason
 
-  for (auto & q : m_qtable[dst]) {
-    if (via == q.GetNextHop()) {
-      old_value = q.GetQValue();
-      if (old_value == NanoSeconds(0)) {
-        queue_time = NanoSeconds(0);
-      }
+  uint32_t dst_id = InternDestination(dst);
+  std::vector<QTableEntry >& row = m_qtable[dst_id];
+  int32_t via_col = ColumnOf(via);
+  m_best_col[dst_id] = BEST_ESTIM_STALE;
+  if (via_col >= 0 && static_cast<uint32_t>(via_col) < row.size()) {
+    QTableEntry& q = row[via_col];
+    old_value = q.GetQValue();
+    if (old_value == NanoSeconds(0)) {
+      queue_time = NanoSeconds(0);
+    }
 
-      if (m_nodeip == showme){
-        NS_LOG_DEBUG  ( "{" );
-        NS_LOG_DEBUG  ( "  [node = " << m_nodeip << "] Received more information about a route from " << m_nodeip << " to " << dst << " via " << via << "." );
-        NS_LOG_DEBUG  ( "  Old estimate was " << q.GetQValue().As (Time::MS) << "  ((( " << q.GetQValue() << ")))");
-        // Given that P actually spent q units of time in x’s queue and s units in transmission to y, x can update its estimate s.t.:
+    if (m_nodeip == showme){
+      NS_LOG_DEBUG  ( "{" );
+      NS_LOG_DEBUG  ( "  [node = " << m_nodeip << "] Received more information about a route from " << m_nodeip << " to " << dst << " via " << via << "." );
+      NS_LOG_DEBUG  ( "  Old estimate was " << q.GetQValue().As (Time::MS) << "  ((( " << q.GetQValue() << ")))");
+      // Given that P actually spent q units of time in x’s queue and s units in transmission to y, x can update its estimate s.t.:
 
-        // Time new_estim = Time(m_learningrate * (MilliSeconds(1) /* q */+ MilliSeconds(1) /* s */ + t - q.second).GetInteger());
-        NS_LOG_DEBUG  ( "  Trying to learn something with \n\t - queue time = " << _queue_time_.As(Time::MS) << " / if old is 0 : " << queue_time.As(Time::MS)
-                  << " \n\t - travel time = " << travel_time.As(Time::MS) << " \n\t - estimate received from nextHop = " << next_hop_estimate.As(Time::MS) << " \n\t - old estimate = " << q.GetQValue().As(Time::MS));
-      }
+      // Time new_estim = Time(m_learningrate * (MilliSeconds(1) /* q */+ MilliSeconds(1) /* s */ + t - q.second).GetInteger());
+      NS_LOG_DEBUG  ( "  Trying to learn something with \n\t - queue time = " << _queue_time_.As(Time::MS) << " / if old is 0 : " << queue_time.As(Time::MS)
+                << " \n\t - travel time = " << travel_time.As(Time::MS) << " \n\t - estimate received from nextHop = " << next_hop_estimate.As(Time::MS) << " \n\t - old estimate = " << q.GetQValue().As(Time::MS));
+    }
 
 
-      Time new_estim = Time(m_learningrate * (queue_time /* q */+ travel_time /* s */ + next_hop_estimate - q.GetQValue()).GetInteger());
-      // q.second = q.second + new_estim;
-
-      /** Different formulas
-       * Boyan's formula (paper)
-       * delta_Qx(d,y)=a ( q + s + t - Qx(d,y) ) <-- but what are we supposed to actually do with the delta ?
-       *
-       *
-       * Other formula (wikipedia)
-       * Q(st, at) = (1-a) * Q(st, at) + a * ( rt + discount * estim of optimal future value)
-       *
-       * = new val           = old val
-       *
-       *
-       * On QLearningTests/test2.txt, the difference in node 2 was 0.990ms vs 0.929ms and 0.881ms vs 0.899ms ...
-       * For node0, (boyan's calc)
-       *   10.1.1.1(node)   |          10.1.1.3   |          10.1.1.2   |
-       *         10.1.1.2   |           +54.0ms   |          +3.336ms   |
-       *         10.1.1.3   |          +2.416ms   |           +54.0ms   |
-       *         10.1.1.4   |          +1.489ms   |        +99999.0ms   |
-       *
-       *
-       *  vs wiki
-       *   10.1.1.1(node)   |          10.1.1.3   |          10.1.1.2   |
-       *         10.1.1.2   |           +54.0ms   |          +3.336ms   |
-       *         10.1.1.3   |          +2.416ms   |           +54.0ms   |
-       *         10.1.1.4   |          +1.489ms   |        +99999.0ms   |
-       */
-       Time perceived_reward = travel_time + queue_time + Time::FromInteger(m_gamma * next_hop_estimate.GetInteger(), Time::NS);// so fix this to use the int i guess maybe ? ;
-
-
-       // Time temp_q_for_discount_factor = Time( (1 - m_learningrate) * q.GetQValue().GetInteger()) + Time( ( m_learningrate * perceived_reward.GetInteger() ) ) ;
-       // // std::cout << "new value = " << temp_q_for_discount_factor.GetSeconds();
-       // QTableEntry next_state_best;
-       // for (const auto& neighbour : m_neighbours) {
-       //   QTableEntry tmp = GetNextEstim(dst, neighbour);
-       //   if (neighbour != via && next_state_best.GetQValue() > tmp.GetQValue() ) {
-       //     next_state_best = tmp;
-       //   }
-       // }
-       // if (temp_q_for_discount_factor > next_state_best.GetQValue() && via != next_state_best.GetNextHop() ) {
-       //   temp_q_for_discount_factor = next_state_best.GetQValue();
-       // }
-       // std::cout << " and after the gamma change thing it is = " << temp_q_for_discount_factor.GetSeconds() << "\n(nexthop = "<<via<<", and dst="<<dst<<")\n" << PrettyPrint();
-
-       q.SetQValue(   Time( (1 - m_learningrate) * q.GetQValue().GetInteger() ) +
-                      Time( ( m_learningrate * ( perceived_reward.GetInteger() + 0 * m_gamma * next_hop_estimate.GetInteger() ) ) ) );
-
-       q.SetCoefficientTally((1-m_learningrate) * q.GetCoefficientTally());
-
-       fix_rest  = q.GetQValue();
-       if (m_nodeip == showme) {
-         NS_LOG_DEBUG ( "  Learned new estim = " << q.GetQValue().As(Time::MS) );
-         NS_LOG_DEBUG ( "  Learned new estim = " << fix_rest );
-         NS_LOG_DEBUG(PrettyPrint());
-       }
-    }
-  }
-  for (auto & q : m_qtable[dst]) {
+    Time new_estim = Time(m_learningrate * (queue_time /* q */+ travel_time /* s */ + next_hop_estimate - q.GetQValue()).GetInteger());
+    // q.second = q.second + new_estim;
+
+    /** Different formulas
+     * Boyan's formula (paper)
+     * delta_Qx(d,y)=a ( q + s + t - Qx(d,y) ) <-- but what are we supposed to actually do with the delta ?
+     *
+     *
+     * Other formula (wikipedia)
+     * Q(st, at) = (1-a) * Q(st, at) + a * ( rt + discount * estim of optimal future value)
+     *
+     * = new val           = old val
+     *
+     *
+     * On QLearningTests/test2.txt, the difference in node 2 was 0.990ms vs 0.929ms and 0.881ms vs 0.899ms ...
+     * For node0, (boyan's calc)
+     *   10.1.1.1(node)   |          10.1.1.3   |          10.1.1.2   |
+     *         10.1.1.2   |           +54.0ms   |          +3.336ms   |
+     *         10.1.1.3   |          +2.416ms   |           +54.0ms   |
+     *         10.1.1.4   |          +1.489ms   |        +99999.0ms   |
+     *
+     *
+     *  vs wiki
+     *   10.1.1.1(node)   |          10.1.1.3   |          10.1.1.2   |
+     *         10.1.1.2   |           +54.0ms   |          +3.336ms   |
+     *         10.1.1.3   |          +2.416ms   |           +54.0ms   |
+     *         10.1.1.4   |          +1.489ms   |        +99999.0ms   |
+     */
+     Time perceived_reward = travel_time + queue_time + Time::FromInteger(m_gamma * next_hop_estimate.GetInteger(), Time::NS);// so fix this to use the int i guess maybe ? ;
+
+
+     // Time temp_q_for_discount_factor = Time( (1 - m_learningrate) * q.GetQValue().GetInteger()) + Time( ( m_learningrate * perceived_reward.GetInteger() ) ) ;
+     // // std::cout << "new value = " << temp_q_for_discount_factor.GetSeconds();
+     // QTableEntry next_state_best;
+     // for (const auto& neighbour : m_neighbours) {
+     //   QTableEntry tmp = GetNextEstim(dst, neighbour);
+     //   if (neighbour != via && next_state_best.GetQValue() > tmp.GetQValue() ) {
+     //     next_state_best = tmp;
+     //   }
+     // }
+     // if (temp_q_for_discount_factor > next_state_best.GetQValue() && via != next_state_best.GetNextHop() ) {
+     //   temp_q_for_discount_factor = next_state_best.GetQValue();
+     // }
+     // std::cout << " and after the gamma change thing it is = " << temp_q_for_discount_factor.GetSeconds() << "\n(nexthop = "<<via<<", and dst="<<dst<<")\n" << PrettyPrint();
+
+     q.SetQValue(   Time( (1 - m_learningrate) * q.GetQValue().GetInteger() ) +
+                    Time( ( m_learningrate * ( perceived_reward.GetInteger() + 0 * m_gamma * next_hop_estimate.GetInteger() ) ) ) );
+
+     q.SetCoefficientTally((1-m_learningrate) * q.GetCoefficientTally());
+
+     fix_rest  = q.GetQValue();
+     if (m_nodeip == showme) {
+       NS_LOG_DEBUG ( "  Learned new estim = " << q.GetQValue().As(Time::MS) );
+       NS_LOG_DEBUG ( "  Learned new estim = " << fix_rest );
+       NS_LOG_DEBUG(PrettyPrint());
+     }
+  }
+  for (auto & q : row) {
     if (q.GetQValue() == MilliSeconds(INITIAL_QVALUE_QTABLEENTRY_NOT_VIA)) {
       q.SetQValue(fix_rest + MilliSeconds(INITIAL_QVALUE_QTABLEENTRY_NOT_VIA));
     }
@@ -848,7 +1159,8 @@ QTable::Update(Ipv4Address via, Ipv4Address dst, Time _queue_time_, Time travel_
     NS_LOG_DEBUG  (PrettyPrint());
     NS_LOG_DEBUG  ( "}" );
   }
-  ToFile(m_output_file_name);
+  RecountRow(dst_id);
+  RecordRow(dst_id);
 }
 
 uint64_t
@@ -862,44 +1174,47 @@ QTable::CalculateNewQValue(Ipv4Address via, Ipv4Address dst, Time _queue_time_,
   Time fix_rest= Seconds(0);
   Time new_value = Seconds(99);
 
-  for (auto & q : m_qtable[dst]) {
-    if (via == q.GetNextHop()) {
-      old_value = q.GetQValue();
-      if (old_value == NanoSeconds(0)) {
-        queue_time = NanoSeconds(0);
-      }
+  uint32_t dst_id = InternDestination(dst);
+  std::vector<QTableEntry >& row = m_qtable[dst_id];
+  int32_t via_col = ColumnOf(via);
+  m_best_col[dst_id] = BEST_ESTIM_STALE;
+  if (via_col >= 0 && static_cast<uint32_t>(via_col) < row.size()) {
+    QTableEntry& q = row[via_col];
+    old_value = q.GetQValue();
+    if (old_value == NanoSeconds(0)) {
+      queue_time = NanoSeconds(0);
+    }
 
-      if (m_nodeip == showme){
-        NS_LOG_DEBUG( "{ ONLY CALCULATING THE VALUE NOT UPDATING" );
-        NS_LOG_DEBUG( "  [node = " << m_nodeip << "] Received more information about a route from " << m_nodeip << " to " << dst << " via " << via << "." );
-        NS_LOG_DEBUG( "  Old estimate was " << q.GetQValue().As (Time::MS) << "  ((( " << q.GetQValue() << ")))");
-        // Given that P actually spent q units of time in x’s queue and s units in transmission to y, x can update its estimate s.t.:
+    if (m_nodeip == showme){
+      NS_LOG_DEBUG( "{ ONLY CALCULATING THE VALUE NOT UPDATING" );
+      NS_LOG_DEBUG( "  [node = " << m_nodeip << "] Received more information about a route from " << m_nodeip << " to " << dst << " via " << via << "." );
+      NS_LOG_DEBUG( "  Old estimate was " << q.GetQValue().As (Time::MS) << "  ((( " << q.GetQValue() << ")))");
+      // Given that P actually spent q units of time in x’s queue and s units in transmission to y, x can update its estimate s.t.:
 
-        // Time new_estim = Time(m_learningrate * (MilliSeconds(1) /* q */+ MilliSeconds(1) /* s */ + t - q.second).GetInteger());
-        NS_LOG_DEBUG( "  Trying to learn something with \n\t - queue time = " << _queue_time_.As(Time::MS) << " / if old is 0 : " << queue_time.As(Time::MS)
-                  << " \n\t - travel time = " << travel_time.As(Time::MS) << " \n\t - estimate received from nextHop = " << next_hop_estimate.As(Time::MS) << " \n\t - old estimate = " << q.GetQValue().As(Time::MS));
-      }
+      // Time new_estim = Time(m_learningrate * (MilliSeconds(1) /* q */+ MilliSeconds(1) /* s */ + t - q.second).GetInteger());
+      NS_LOG_DEBUG( "  Trying to learn something with \n\t - queue time = " << _queue_time_.As(Time::MS) << " / if old is 0 : " << queue_time.As(Time::MS)
+                << " \n\t - travel time = " << travel_time.As(Time::MS) << " \n\t - estimate received from nextHop = " << next_hop_estimate.As(Time::MS) << " \n\t - old estimate = " << q.GetQValue().As(Time::MS));
+    }
 
-      Time perceived_reward = travel_time + queue_time + next_hop_estimate;
-
-      // Time temp_q_for_discount_factor = Time( (1 - m_learningrate) * q.GetQValue().GetInteger()) + Time( ( m_learningrate * perceived_reward.GetInteger() ) ) ;
-      // QTableEntry next_state_best = GetNextEstim(dst);
-      // if (temp_q_for_discount_factor > next_state_best.GetQValue() && via != next_state_best.GetNextHop() ) {
-      //   temp_q_for_discount_factor = next_state_best.GetQValue();
-      // }
-      new_value =    Time( (1 - m_learningrate) * q.GetQValue().GetInteger()) +
-                     Time( ( m_learningrate * ( perceived_reward.GetInteger() + m_gamma * next_hop_estimate.GetInteger() ) ) );
-
-      fix_rest  = q.GetQValue();
-      if (m_nodeip == showme) {
-        NS_LOG_DEBUG( "  Learned new estim = " << q.GetQValue().As(Time::MS) );
-        NS_LOG_DEBUG( "  Learned new estim = " << fix_rest );
-        NS_LOG_DEBUG(PrettyPrint());
-      }
+    Time perceived_reward = travel_time + queue_time + next_hop_estimate;
+
+    // Time temp_q_for_discount_factor = Time( (1 - m_learningrate) * q.GetQValue().GetInteger()) + Time( ( m_learningrate * perceived_reward.GetInteger() ) ) ;
+    // QTableEntry next_state_best = GetNextEstim(dst);
+    // if (temp_q_for_discount_factor > next_state_best.GetQValue() && via != next_state_best.GetNextHop() ) {
+    //   temp_q_for_discount_factor = next_state_best.GetQValue();
+    // }
+    new_value =    Time( (1 - m_learningrate) * q.GetQValue().GetInteger()) +
+                   Time( ( m_learningrate * ( perceived_reward.GetInteger() + m_gamma * next_hop_estimate.GetInteger() ) ) );
+
+    fix_rest  = q.GetQValue();
+    if (m_nodeip == showme) {
+      NS_LOG_DEBUG( "  Learned new estim = " << q.GetQValue().As(Time::MS) );
+      NS_LOG_DEBUG( "  Learned new estim = " << fix_rest );
+      NS_LOG_DEBUG(PrettyPrint());
     }
   }
 
- for (auto & q : m_qtable[dst]) {
+ for (auto & q : row) {
    if (q.GetQValue() == MilliSeconds(INITIAL_QVALUE_QTABLEENTRY_NOT_VIA)) {
      NS_ASSERT_MSG(q.GetQValue() == MilliSeconds(1), "actually rather not have this happen.");
      q.SetQValue(fix_rest + MilliSeconds(INITIAL_QVALUE_QTABLEENTRY_NOT_VIA));
@@ -912,6 +1227,8 @@ QTable::CalculateNewQValue(Ipv4Address via, Ipv4Address dst, Time _queue_time_,
     NS_LOG_DEBUG( "}" );
   }
   NS_ASSERT(new_value != Seconds(99));
+  RecountRow(dst_id);
+  RecordRow(dst_id);
   return new_value.GetInteger();
 }
 
@@ -921,21 +1238,276 @@ QTable::ChangeQValuesFromZero(Ipv4Address dst, Ipv4Address aodv_next_hop) {
   // After the mixup in commit 3f622ef where I replaced != 0ns by == 0ns I've decided to rewrite this function
   // as follows, mainly for clarity. Tests all passed at this point.
   bool all_q_equal_to_zero = true;
-  for (const auto& q : m_qtable[dst]) {
+  uint32_t dst_id = InternDestination(dst);
+  std::vector<QTableEntry >& row = m_qtable[dst_id];
+  for (const auto& q : row) {
     if (!(q.GetQValue() == NanoSeconds(0))) {
       all_q_equal_to_zero = false;
     }
   }
   if (all_q_equal_to_zero) {
-    for (auto& q : m_qtable[dst]) {
+    m_best_col[dst_id] = BEST_ESTIM_STALE;
+    for (auto& q : row) {
       if (q.GetNextHop() == aodv_next_hop) {
         q.SetQValue(MilliSeconds(INITIAL_QVALUE_QTABLEENTRY_NOT_VIA));
       } else {
         q.SetQValue(MilliSeconds(INITIAL_QVALUE_QTABLEENTRY_VIA));
       }
     }
+    RecountRow(dst_id);
+    RecordRow(dst_id);
   }
   return;
 }
 
+void
+QTable::Save(std::ostream& os) {
+  PutValue<uint32_t>(os, m_destinations.size());
+  for (const auto& dst : m_destinations) {
+    const std::vector<QTableEntry >& row = m_qtable[InternDestination(dst)];
+    uint32_t nr_entries = 0;
+    for (uint32_t col = 0; col < row.size(); col++) {
+      nr_entries += m_topo->IsColumnNeighbour(col);
+    }
+    PutValue<uint32_t>(os, dst.Get());
+    PutValue<uint32_t>(os, nr_entries);
+    for (uint32_t col = 0; col < row.size(); col++) {
+      if (m_topo->IsColumnNeighbour(col)) {
+        PutValue<uint32_t>(os, row[col].GetNextHop().Get());
+        row[col].Save(os);
+      }
+    }
+  }
+}
+
+bool
+QTable::Load(std::istream& is) {
+  uint32_t nr_rows = GetValue<uint32_t>(is);
+  for (uint32_t r = 0; r < nr_rows && is.good(); r++) {
+    Ipv4Address dst(GetValue<uint32_t>(is));
+    uint32_t nr_entries = GetValue<uint32_t>(is);
+    if (dst != m_nodeip && !HasRow(dst)) {
+      AddDestination(Ipv4Address(IP_WHEN_NO_NEXT_HOP_NEIGHBOUR_KNOWN_YET), dst, Seconds(0));
+    }
+    uint32_t dst_id = InternDestination(dst);
+    std::vector<QTableEntry >& row = m_qtable[dst_id];
+    for (uint32_t e = 0; e < nr_entries && is.good(); e++) {
+      int32_t col = ColumnOf(Ipv4Address(GetValue<uint32_t>(is)));
+      // the snapshot's neighbours were added before the rows, so every entry has a column to go to
+      if (col < 0 || static_cast<uint32_t>(col) >= row.size()) {
+        return false;
+      }
+      row[col].Load(is);
+    }
+    m_best_col[dst_id] = BEST_ESTIM_STALE;
+    RecountRow(dst_id);
+    RecordRow(dst_id);
+  }
+  return is.good();
+}
+
+MultiClassQTable::MultiClassQTable() { }
+
+MultiClassQTable::MultiClassQTable(std::vector<Ipv4Address> neighbours, Ipv4Address nodeip, float learning_rate, float convergence_threshold,
+                                   float learn_more_threshold, bool in_test, bool print_qtables, float gamma, Time sampling_interval) :
+  m_topo(Create<QTableTopology> (neighbours)), m_nodeip(nodeip) {
+  m_tables.resize(NR_QTABLE_CLASSES);
+  m_tables[QTABLE_WEB] = QTable(m_topo, nodeip, learning_rate, convergence_threshold, learn_more_threshold, "_web", in_test, print_qtables, gamma, sampling_interval);
+  m_tables[QTABLE_VIDEO] = QTable(m_topo, nodeip, learning_rate, convergence_threshold, learn_more_threshold, "_video", in_test, print_qtables, gamma, sampling_interval);
+  m_tables[QTABLE_VOIP] = QTable(m_topo, nodeip, learning_rate, convergence_threshold, learn_more_threshold, "_voip", in_test, print_qtables, gamma, sampling_interval);
+}
+
+MultiClassQTable::QTableClass
+MultiClassQTable::ClassOf(TrafficType t) {
+  if (t == ICMP || t == WEB || t == OTHER || t == UDP_ECHO || t == TRAFFIC_C) {
+    return QTABLE_WEB;
+  } else if (t == VIDEO|| t == TRAFFIC_B) {
+    return QTABLE_VIDEO;
+  } else if (t == VOIP || t == TRAFFIC_A) {
+    return QTABLE_VOIP;
+  } else {
+    NS_FATAL_ERROR("unknown traffic.");
+  }
+}
+
+std::string
+MultiClassQTable::NameOf(QTableClass c) {
+  switch (c) {
+    case QTABLE_WEB:   return "web";
+    case QTABLE_VOIP:  return "voip";
+    case QTABLE_VIDEO: return "video";
+    default:
+      NS_FATAL_ERROR("unknown qtable class.");
+  }
+}
+
+void
+MultiClassQTable::MarkNeighbDown(Ipv4Address neighb) {
+  int32_t col = m_topo->ColumnOf(neighb);
+  if (col >= 0) {
+    if (m_topo->IsColumnAvailable(col)) {
+      // neighbour is not yet marked as unavail, the rows catch up when they are used next
+      m_topo->SetColumnAvailable(col, false);
+      NS_LOG_DEBUG(neighb << " is down. Marked at node" << m_nodeip << "." );
+    }
+  } else {
+    NS_LOG_DEBUG("Trying to mark a neighbour unavailable but it's not a neighbour");
+  }
+}
+
+void
+MultiClassQTable::AddNeighbour(Ipv4Address neighb) {
+  int32_t col = m_topo->ColumnOf(neighb);
+  if (col >= 0 && !m_topo->IsColumnAvailable(col)) {
+    NS_LOG_ERROR("I (" << m_nodeip << ") received a SendHello message from an AODV neighbour and it was marked unavail. neighb= " << neighb << ". Unmarking it.");
+    m_topo->SetColumnAvailable(col, true);
+  } else {
+    NS_LOG_ERROR("I (" << m_nodeip << ") received a SendHello message from an AODV neighbour and it was not marked unavail. neighb= " << neighb << ".");
+  }
+  if (col < 0) {
+    NS_LOG_ERROR("I (" << m_nodeip << ") received a SendHello message from an AODV neighbour and it was not already a neighbour. neighb= " << neighb << ". Adding the neighbour.");
+    uint32_t new_col = m_topo->AddNeighbour(neighb);
+    for (auto& table : m_tables) {
+      table.RecordNeighbourAdded(neighb, new_col);
+    }
+  } else {
+    NS_LOG_ERROR("I (" << m_nodeip << ") received a SendHello message from an AODV neighbour and it was already a neighbour. neighb= " << neighb << ".");
+  }
+}
+
+void
+MultiClassQTable::RemoveNeighbour(Ipv4Address neighb) {
+  int32_t col = m_topo->ColumnOf(neighb);
+  if (col >= 0 && !m_topo->IsColumnAvailable(col)) {
+    // Neighbour is still marked as unavailable -> remove it, its column goes to the next new neighbour
+    NS_LOG_DEBUG("Removing unavailable neighbour " << neighb << ".");
+    m_topo->RemoveNeighbour(neighb);
+    for (auto& table : m_tables) {
+      if (table.m_recorder) {
+        table.m_recorder->RemoveNeighbour(col);
+      }
+    }
+  } else {
+    NS_LOG_DEBUG("Tried to remove neighbour but availability has been restored already.");
+  }
+}
+
+bool
+MultiClassQTable::AddDestination(Ipv4Address via, Ipv4Address dst, Time t) {
+  bool regular_table = m_tables[QTABLE_WEB].AddDestination(via,dst,t);
+  bool voip_table = m_tables[QTABLE_VOIP].AddDestination(via,dst,t);
+  bool video_table = m_tables[QTABLE_VIDEO].AddDestination(via,dst,t);
+
+  NS_ASSERT( regular_table == voip_table);
+  NS_ASSERT( regular_table == video_table);
+  return regular_table && voip_table && video_table;
+}
+
+bool
+MultiClassQTable::CheckDestinationKnown(const Ipv4Address& dst) {
+  bool regular_table = m_tables[QTABLE_WEB].CheckDestinationKnown(dst);
+  bool voip_table = m_tables[QTABLE_VOIP].CheckDestinationKnown(dst);
+  bool video_table = m_tables[QTABLE_VIDEO].CheckDestinationKnown(dst);
+
+  NS_ASSERT(regular_table == voip_table);
+  NS_ASSERT(voip_table == video_table);
+  return regular_table && voip_table && video_table;
+}
+
+void
+MultiClassQTable::ChangeQValuesFromZero(Ipv4Address dst, Ipv4Address aodv_next_hop) {
+  for (auto& table : m_tables) {
+    table.ChangeQValuesFromZero(dst, aodv_next_hop);
+  }
+}
+
+void
+MultiClassQTable::SetRandomVariable(Ptr<UniformRandomVariable> random) {
+  for (auto& table : m_tables) {
+    table.m_random = random;
+  }
+}
+
+void
+MultiClassQTable::Unconverge() {
+  for (auto& table : m_tables) {
+    table.Unconverge();
+  }
+}
+
+std::array<QTableEntry, MultiClassQTable::NR_QTABLE_CLASSES>
+MultiClassQTable::GetNextEstims(Ipv4Address dst) {
+  std::array<QTableEntry, NR_QTABLE_CLASSES> estims;
+  int32_t dst_id = m_topo->FindDestination(dst);
+  // same order as the per class calls this replaces, GetRandomEstim draws from the random stream of the node
+  for (auto t : {TRAFFIC_A, TRAFFIC_B, TRAFFIC_C}) {
+    estims[ClassOf(t)] = m_tables[ClassOf(t)].BestEstimOfRow(dst, dst_id);
+  }
+  return estims;
+}
+
+void
+MultiClassQTable::SetSenderConverged(Ipv4Address dst, Ipv4Address via, bool b) {
+  uint32_t dst_id = m_topo->InternDestination(dst);
+  for (auto& table : m_tables) {
+    table.SetSenderConverged(dst, table.EntryOfRow(dst, via, table.EnsureRow(dst_id)), b);
+  }
+}
+
+void
+MultiClassQTable::Save(std::ostream& os) {
+  os.write(QTABLE_SNAPSHOT_MAGIC, sizeof(QTABLE_SNAPSHOT_MAGIC));
+  PutValue<uint32_t>(os, m_nodeip.Get());
+  PutValue<uint32_t>(os, m_topo->GetNeighbours().size());
+  for (const auto& neighb : m_topo->GetNeighbours()) {
+    PutValue<uint32_t>(os, neighb.Get());
+    PutValue<uint8_t>(os, m_topo->IsNeighbourAvailable(neighb));
+  }
+  for (auto& table : m_tables) {
+    table.Save(os);
+  }
+}
+
+bool
+MultiClassQTable::Load(std::istream& is) {
+  char magic[sizeof(QTABLE_SNAPSHOT_MAGIC)];
+  is.read(magic, sizeof(magic));
+  if (!is.good() || !std::equal(magic, magic + sizeof(magic), QTABLE_SNAPSHOT_MAGIC) || Ipv4Address(GetValue<uint32_t>(is)) != m_nodeip) {
+    return false;
+  }
+  uint32_t nr_neighbours = GetValue<uint32_t>(is);
+  std::vector<Ipv4Address> down;
+  for (uint32_t n = 0; n < nr_neighbours && is.good(); n++) {
+    Ipv4Address neighb(GetValue<uint32_t>(is));
+    bool available = GetValue<uint8_t>(is);
+    if (m_topo->ColumnOf(neighb) < 0) {
+      AddNeighbour(neighb);
+    }
+    if (!available) {
+      down.push_back(neighb);
+    }
+  }
+  for (auto& table : m_tables) {
+    if (!table.Load(is)) {
+      return false;
+    }
+  }
+  // after the rows, so that the entries of rows that were added are marked unavailable too
+  for (const auto& neighb : down) {
+    MarkNeighbDown(neighb);
+  }
+  return true;
+}
+
+std::array<QTableEntry*, MultiClassQTable::NR_QTABLE_CLASSES>
+MultiClassQTable::GetEntriesByRef(Ipv4Address dst, Ipv4Address via) {
+  std::array<QTableEntry*, NR_QTABLE_CLASSES> entries;
+  uint32_t dst_id = m_topo->InternDestination(dst);
+  for (auto t : {TRAFFIC_A, TRAFFIC_B, TRAFFIC_C}) {
+    QTable& table = m_tables[ClassOf(t)];
+    entries[ClassOf(t)] = &table.EntryOfRow(dst, via, table.EnsureRow(dst_id));
+  }
+  return entries;
+}
+
 } //namespace ns3
@@ -4,14 +4,20 @@
 #include "ns3/ipv4-address.h"
 #include "ns3/nstime.h"
 #include "ns3/log.h"
-#include "ns3/output-stream-wrapper.h"
+#include "ns3/qtable-recorder.h"
+#include "ns3/qrouting-counters.h"
 #include "ns3/thomas-configuration.h"
+#include "ns3/traffic-types.h"
+#include "ns3/simple-ref-count.h"
 #include "ns3/simulator.h"
 #include "ns3/make-functional-event.h"
+#include "ns3/random-variable-stream.h"
 #include <algorithm>
 #include <fstream>
 #include <vector>
+#include <array>
 #include <map>
+#include <unordered_map>
 #include <cstdlib>
 
 
@@ -32,7 +38,7 @@ public:
   void SetRealLoss(uint16_t t) { m_real_observed_loss = t; }
   void SetSenderConverged(bool b);
   void SetUnavailable(bool b) { m_unavailable = b; }
-  bool IsAvailable() { return !m_unavailable; }
+  bool IsAvailable() const { return !m_unavailable; }
   bool HasConverged() const { return m_converged && m_sender_converged && !m_unavailable; }
   void Unconverge();
   void SetCoefficientTally(float f) { m_coeff_tally = (f < 1.0 ? 1.0:f); }
@@ -40,11 +46,17 @@ public:
   bool LearnMore();
   bool LearnLess();
   void SetNodeIp(Ipv4Address ip) { m_my_ip = ip;}
-  bool IsBlackListed() { return m_blacklisted; }
+  bool IsBlackListed() const { return m_blacklisted; }
   void SetBlacklisted(bool b) { m_blacklisted = b; }
   int GetNrOfStrikes() { return m_number_of_strikes; }
+  // The QTable counts converged and blacklisted entries per row, so entries of a QTable must have their
+  // sender convergence and strikes changed through QTable::SetSenderConverged, AddStrike and DeductStrike.
   void AddStrike();
   void DeductStrike();
+  // The learned state of the entry, for MultiClassQTable::Save / Load. The next hop, thresholds and availability
+  // belong to the table the entry is in and are left alone by Load.
+  void Save(std::ostream& os) const;
+  void Load(std::istream& is);
 private:
   Ipv4Address m_next_hop;
   Time m_my_estim;
@@ -64,10 +76,81 @@ private:
   int m_number_of_strikes;
 };
 
+/**
+ * The neighbour registry of a node and the ids of its destinations (rows), shared by the QTables of all of its
+ * traffic classes so that they are looked up and kept up to date once instead of per class.
+ *
+ * Every neighbour holds a slot, which is its column in the rows of the QTables for as long as it is a neighbour.
+ * The slot of a removed neighbour goes on a free list and is handed to the next new neighbour, so rows are never
+ * wider than the most neighbours the node had at once. Adding, removing or marking a neighbour down only changes
+ * the slot bits and counters here and bumps the generation; a QTable brings a row up to date with the changes the
+ * next time it uses that row (see QTable::SyncRow).
+ */
+class QTableTopology : public SimpleRefCount<QTableTopology> {
+public:
+  QTableTopology(std::vector<Ipv4Address> neighbours);
+
+  // Row id of dst, a dst seen for the first time gets the next id
+  uint32_t InternDestination(Ipv4Address dst);
+  // Row id of dst, or -1 if no class has a row for it
+  int32_t FindDestination(Ipv4Address dst) const;
+  Ipv4Address DestinationOf(uint32_t dst_id) const { return m_dst_addrs[dst_id]; }
+
+  // Column (slot) of neighb, or -1 if it is not a neighbour
+  int32_t ColumnOf(Ipv4Address neighb) const;
+  Ipv4Address NeighbourOf(uint32_t col) const { return m_slot_addrs[col]; }
+  uint32_t NrColumns() const { return m_slot_addrs.size(); }
+  // Column of neighb, which takes a free slot (or a new one) if it was not a neighbour yet. A new neighbour is available.
+  uint32_t AddNeighbour(Ipv4Address neighb);
+  // Frees the slot of neighb
+  void RemoveNeighbour(Ipv4Address neighb);
+  void SetColumnAvailable(uint32_t col, bool available);
+
+  bool IsColumnAvailable(uint32_t col) const { return m_neighbour_bits[col] && !m_unavail_bits[col]; }
+  // false for a free slot
+  bool IsColumnNeighbour(uint32_t col) const { return m_neighbour_bits[col]; }
+  bool IsNeighbourAvailable(Ipv4Address neighb) const;
+  bool AnyNeighbourReachable() const { return !m_available_cols.empty(); }
+  // The available columns, in no particular order, to draw a random next hop from
+  uint32_t NrAvailableColumns() const { return m_available_cols.size(); }
+  uint32_t AvailableColumn(uint32_t i) const { return m_available_cols[i]; }
+  const std::vector<Ipv4Address>& GetNeighbours() const { return m_neighbours; }
+  std::vector<Ipv4Address> GetUnavails() const;
+
+  // Bumped by every change to the neighbours, the generation a change happened in orders it against the rows
+  uint64_t GetGeneration() const { return m_generation; }
+  uint64_t ColumnAddedAt(uint32_t col) const { return m_added_at[col]; }
+  uint64_t AvailabilityChangedAt(uint32_t col) const { return m_changed_at[col]; }
+
+private:
+  // Adds col to (or takes it out of) m_available_cols
+  void IndexAvailable(uint32_t col, bool available);
+
+  std::unordered_map<Ipv4Address, uint32_t, Ipv4AddressHash> m_dst_ids;
+  std::vector<Ipv4Address> m_dst_addrs;
+  std::unordered_map<Ipv4Address, uint32_t, Ipv4AddressHash> m_neighb_ids;
+  // The current neighbours, in no particular order once one was removed
+  std::vector<Ipv4Address> m_neighbours;
+  // Indexed by column : the neighbour in the slot and its index in m_neighbours, whether the slot is taken and
+  // the neighbour in it is down, and the generations it was taken in and its availability last changed in
+  std::vector<Ipv4Address> m_slot_addrs;
+  std::vector<uint32_t> m_neighbour_pos;
+  std::vector<bool> m_neighbour_bits;
+  std::vector<bool> m_unavail_bits;
+  std::vector<uint64_t> m_added_at;
+  std::vector<uint64_t> m_changed_at;
+  std::vector<uint32_t> m_free_slots;
+  // The available columns and, indexed by column, the position of an available one in there
+  std::vector<uint32_t> m_available_cols;
+  std::vector<uint32_t> m_available_pos;
+  uint64_t m_generation;
+};
+
 class QTable {
 public:
   QTable();
-  QTable(std::vector<Ipv4Address>, Ipv4Address, float, float, float, std::vector<Ipv4Address>, std::string, bool, bool, float);
+  QTable(Ptr<QTableTopology>, Ipv4Address, float, float, float, std::string, bool, bool, float,
+         Time sampling_interval = Seconds(0));
   ~QTable();
 
   // true if destination is already in our list of destinations
@@ -84,19 +167,20 @@ public:
   QTableEntry GetNextEstim(Ipv4Address,Ipv4Address,Ipv4Address);
   QTableEntry GetNextEstimToLearn(Ipv4Address);
   QTableEntry GetRandomEstim(Ipv4Address,bool=false);
+  // Q values must be changed through SetQValueWrapper (or Update), not through this reference,
+  // otherwise the cached best estimate of dst goes stale.
   QTableEntry& GetEntryByRef(Ipv4Address,Ipv4Address);
 
   bool AllNeighboursBlacklisted(Ipv4Address);
   std::string PrettyPrint(std::string="");
   void PrettyPrintToCout() { std::cout << PrettyPrint(); }
-  void ToFile(std::string filename);
+  // Writes out what is left of the qtable recording (see QTableRecorder)
   void FinalFile();
   void ChangeQValuesFromZero(Ipv4Address dst, Ipv4Address aodv_next_hop) ;
-  void MarkNeighbDown(Ipv4Address);
-  void AddNeighbour(Ipv4Address);
 
-  bool IsNeighbourAvailable(Ipv4Address);
+  bool IsNeighbourAvailable(Ipv4Address neighb) { return m_topo->IsNeighbourAvailable(neighb); }
 
+  // O(1), the counts of converged and usable entries of every row are kept up to date as entries change
   bool HasConverged(Ipv4Address dst, bool = false);
 
   void Unconverge();
@@ -105,15 +189,83 @@ public:
   bool LearnMore(Ipv4Address);
 
   void SetQValueWrapper(Ipv4Address,Ipv4Address,Time);
+  // Same, for an entry of the row of dst that was already looked up (e.g. by MultiClassQTable::GetEntriesByRef)
+  void SetQValueWrapper(Ipv4Address,QTableEntry&,Time);
+  // QTableEntry::SetSenderConverged, AddStrike and DeductStrike for an entry of the row of dst
+  void SetSenderConverged(Ipv4Address dst, QTableEntry& entry, bool b);
+  void AddStrike(Ipv4Address dst, QTableEntry& entry);
+  void DeductStrike(Ipv4Address dst, QTableEntry& entry);
+
+  // Blacklist and convergence transitions of this class at this node so far (see QRoutingCounter)
+  const QRoutingCounters& GetCounters() const { return m_counters; }
 
   //For test...
-  std::vector<Ipv4Address> GetNeighbours() { return m_neighbours; }
-  std::vector<Ipv4Address> GetUnavails() { return m_unavail; }
-  std::vector<QTableEntry> GetEstims(Ipv4Address dst) { return m_qtable[dst]; }
+  std::vector<Ipv4Address> GetNeighbours() { return m_topo->GetNeighbours(); }
+  std::vector<Ipv4Address> GetUnavails() { return m_topo->GetUnavails(); }
+  std::vector<QTableEntry> GetEstims(Ipv4Address dst) { return m_qtable[InternDestination(dst)]; }
 private:
-  void RemoveNeighbour(Ipv4Address);
-  // std::map<Ipv4Address, std::vector<std::pair<Ipv4Address, Time> > > m_qtable;
-  std::map<Ipv4Address, std::vector<QTableEntry > > m_qtable;
+  // the neighbour bookkeeping is shared with the other classes, so it is changed for all of them at once
+  friend class MultiClassQTable;
+  void RecordNeighbourAdded(Ipv4Address neighb, uint32_t col);
+  QTableEntry BestEstimOfRow(Ipv4Address dst, int32_t dst_id);
+  void RefreshBestCols(uint32_t dst_id);
+  QTableEntry& EntryOfRow(Ipv4Address dst, Ipv4Address via, uint32_t dst_id);
+  // Uniform in [0, n)
+  uint32_t DrawIndex(uint32_t n);
+  void Save(std::ostream& os);
+  bool Load(std::istream& is);
+  uint32_t ColumnOfEntry(uint32_t dst_id, const QTableEntry& entry) const;
+
+  // Adds (delta = 1) or takes out (delta = -1) what the entry at dst_id, col counts for in m_unconverged_cols and
+  // m_nr_usable. Take an entry out before changing it and add it again after.
+  void CountEntry(uint32_t dst_id, uint32_t col, int32_t delta);
+  void RecountRow(uint32_t dst_id);
+  // Counts the row turning converged or unconverged since the last call, once the counts of the row are complete again
+  void NoteRowConvergence(uint32_t dst_id);
+  // Applies the changes to the neighbours since the row was last used : columns of new neighbours get their initial
+  // estimate and the entries of columns that went down or came back are marked so. Then the row is recounted.
+  // O(1) if nothing changed, every access to a row goes through here (InternDestination / EnsureRow).
+  void SyncRow(uint32_t dst_id);
+  // The entry of the neighbour that just took column col, in the row of a destination
+  void InitColumn(uint32_t dst_id, uint32_t col);
+
+  // Hands the current values of a row to the recorder, which keeps the ones that changed. Pass sample=false
+  // when recording several rows and call m_recorder->CellsRecorded() after the last one.
+  void RecordRow(uint32_t dst_id, bool sample = true);
+  // Row id of dst, an unknown dst gets an empty row (as std::map::operator[] used to do). The row is synced.
+  uint32_t InternDestination(Ipv4Address dst) { return EnsureRow(m_topo->InternDestination(dst)); }
+  uint32_t EnsureRow(uint32_t dst_id);
+  // true if this class has a row for dst, which it may not have while another class does
+  bool HasRow(Ipv4Address dst) const { return HasRow(m_topo->FindDestination(dst)); }
+  bool HasRow(int32_t dst_id) const { return dst_id >= 0 && static_cast<uint32_t>(dst_id) < m_has_row.size() && m_has_row[dst_id]; }
+  int32_t ColumnOf(Ipv4Address neighb) const { return m_topo->ColumnOf(neighb); }
+  bool IsColumnAvailable(uint32_t col) const { return m_topo->IsColumnAvailable(col); }
+  bool AnyNeighbourReachable() const { return m_topo->AnyNeighbourReachable(); }
+
+  Ptr<QTableTopology> m_topo;
+  // Dense destination x neighbour matrix : m_qtable[dst id][column], both from m_topo. Once synced, rows of known
+  // destinations hold one entry per column, the entry in a free slot is a placeholder that is never picked.
+  std::vector<std::vector<QTableEntry > > m_qtable;
+  std::vector<bool> m_has_row;
+  // Indexed by dst id : whether the row is one of m_destinations (rows that were only looked up stay empty), and the
+  // topology generation the row was last synced in
+  std::vector<bool> m_listed;
+  std::vector<uint64_t> m_row_generation;
+  // Indexed by dst id, the column GetNextEstim(dst) settled on (or BEST_ESTIM_STALE/BEST_ESTIM_NONE). Ties go to the
+  // last column there, HasConverged(dst, true) looks at the first of them, which is m_first_best_col.
+  std::vector<int32_t> m_best_col;
+  std::vector<int32_t> m_first_best_col;
+  // Indexed by dst id : the columns of the entries in available columns that have not converged (in no particular
+  // order, with the position of a column in there indexed by column), and the number of current neighbours that are
+  // available and not blacklisted
+  std::vector<std::vector<uint32_t> > m_unconverged_cols;
+  std::vector<std::vector<uint32_t> > m_unconverged_pos;
+  std::vector<uint32_t> m_nr_usable;
+  // GetRandomEstim draws from this, the stream of the node (see MultiClassQTable::SetRandomVariable)
+  Ptr<UniformRandomVariable> m_random;
+  // Indexed by dst id, whether the row was converged when NoteRowConvergence last looked
+  std::vector<bool> m_row_converged;
+  QRoutingCounters m_counters;
 
   Ipv4Address m_nodeip;
   float m_learningrate;
@@ -121,14 +273,79 @@ private:
   float m_gamma;
   float m_learn_more_threshold;
   std::string m_output_file_name;
-  std::vector<Ipv4Address> m_neighbours;
   std::vector<Ipv4Address> m_destinations;
-  std::vector<Ipv4Address> m_unavail;
-  Ptr<OutputStreamWrapper> m_out_stream;
+  Ptr<QTableRecorder> m_recorder;
   bool m_in_test;
   bool m_print_qtables;
 };
 
+/**
+ * The QTables of the web, video and voip traffic classes of a node, on top of one QTableTopology.
+ *
+ * Neighbour changes are applied to the topology once and then to the entries of every class, and the
+ * Get...s functions look a destination up once for all classes. The entries themselves stay one matrix
+ * per class : a class only gets a row for a destination when it is asked about it, and the learning
+ * phase logic depends on each class's rows evolving on their own.
+ *
+ * Save writes the tables to a snapshot that Load restores them from, so that a run can start from where
+ * another one was (see the Snapshot* attributes of QLearner). Snapshot layout (native byte order) :
+ *   the magic "QSN1", uint32 node ip, uint32 nr of neighbours, nr x { uint32 ip, uint8 available }
+ *   per class (in QTableClass order) : uint32 nr of rows, nr x { uint32 dst ip, uint32 nr of entries, nr x entry }
+ *   entry : uint32 next hop, int64 qvalue (ns), uint64 real delay, uint16 real loss, float coefficient tally,
+ *           uint8 flags (converged, sender converged, learn more, learn less, blacklisted), uint8 strikes
+ */
+class MultiClassQTable {
+public:
+  enum QTableClass {
+    QTABLE_WEB = 0,
+    QTABLE_VOIP,
+    QTABLE_VIDEO,
+    NR_QTABLE_CLASSES
+  };
+
+  MultiClassQTable();
+  MultiClassQTable(std::vector<Ipv4Address> neighbours, Ipv4Address nodeip, float learning_rate, float convergence_threshold,
+                   float learn_more_threshold, bool in_test, bool print_qtables, float gamma, Time sampling_interval = Seconds(0));
+
+  static QTableClass ClassOf(TrafficType t);
+  // "web", "voip" or "video"
+  static std::string NameOf(QTableClass c);
+  QTable& GetTable(TrafficType t) { return m_tables[ClassOf(t)]; }
+  QTable& GetTable(QTableClass c) { return m_tables[c]; }
+
+  void MarkNeighbDown(Ipv4Address);
+  void AddNeighbour(Ipv4Address);
+  // true if dst was added, in which case it was added to every class
+  bool AddDestination(Ipv4Address via, Ipv4Address dst, Time t);
+  bool CheckDestinationKnown(const Ipv4Address& dst);
+  void ChangeQValuesFromZero(Ipv4Address dst, Ipv4Address aodv_next_hop);
+  void Unconverge();
+  // The stream every class draws its random next hops from (GetRandomEstim), so runs repeat with the seed and run
+  // number of the simulation. Until this is called each class creates a stream of its own.
+  void SetRandomVariable(Ptr<UniformRandomVariable> random);
+
+  // GetNextEstim(dst) of every class, indexed by QTableClass
+  std::array<QTableEntry, NR_QTABLE_CLASSES> GetNextEstims(Ipv4Address dst);
+  // GetEntryByRef(dst, via) of every class, indexed by QTableClass. Use QTable::SetQValueWrapper to change their q values.
+  std::array<QTableEntry*, NR_QTABLE_CLASSES> GetEntriesByRef(Ipv4Address dst, Ipv4Address via);
+  // QTable::SetSenderConverged on the entry of dst via via of every class
+  void SetSenderConverged(Ipv4Address dst, Ipv4Address via, bool b);
+
+  // Frees the column of a neighbour that is down, for the next new neighbour to take
+  void RemoveNeighbour(Ipv4Address);
+
+  void Save(std::ostream& os);
+  // Neighbours of the snapshot that are missing are added, entries via neighbours that are not in the snapshot keep
+  // their values. false if the stream does not hold a snapshot of this node.
+  bool Load(std::istream& is);
+
+private:
+
+  Ptr<QTableTopology> m_topo;
+  std::vector<QTable> m_tables;
+  Ipv4Address m_nodeip;
+};
+
 
 } //namespace ns3
 
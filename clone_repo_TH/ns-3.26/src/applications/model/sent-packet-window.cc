@@ -0,0 +1,71 @@
+#include "sent-packet-window.h"
+#include "ns3/assert.h"
+
+namespace ns3 {
+
+/* ring slots to start with, grows by doubling */
+static const uint32_t SENT_PACKET_WINDOW_INITIAL_CAPACITY = 16;
+
+SentPacketWindow::SentPacketWindow() : m_ring(SENT_PACKET_WINDOW_INITIAL_CAPACITY), m_head(0), m_size(0) {
+}
+
+uint32_t
+SentPacketWindow::FirstNotBefore(uint64_t ts) const {
+  uint32_t lo = 0, hi = m_size;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (At(mid).time < ts) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+uint64_t
+SentPacketWindow::CountOfNewestUpTo(uint32_t i) const {
+  uint64_t newest_time = At(i).time;
+  if (newest_time == 0) {
+    return 0;
+  }
+  return At(FirstNotBefore(newest_time)).count;
+}
+
+void
+SentPacketWindow::Sent(uint64_t now) {
+  NS_ASSERT_MSG(m_size == 0 || At(m_size - 1).time <= now, "Packets should be counted in the order they are sent.");
+  uint64_t count = (m_size == 0 ? 0 : CountOfNewestUpTo(m_size - 1));
+
+  if (m_size == m_ring.size()) {
+    std::vector<Entry> bigger(m_ring.size() * 2);
+    for (uint32_t i = 0; i < m_size; i++) {
+      bigger[i] = At(i);
+    }
+    m_ring.swap(bigger);
+    m_head = 0;
+  }
+  Entry& e = m_ring[(m_head + m_size) & (m_ring.size() - 1)];
+  e.time = now;
+  e.count = count + 1;
+  m_size++;
+}
+
+void
+SentPacketWindow::Expire(uint64_t cutoff) {
+  while (m_size > 1 && At(0).time < cutoff) {
+    m_head = (m_head + 1) & (m_ring.size() - 1);
+    m_size--;
+  }
+}
+
+uint64_t
+SentPacketWindow::GetCountBefore(uint64_t ts) const {
+  uint32_t first = FirstNotBefore(ts);
+  if (first == 0) {
+    return 0;
+  }
+  return CountOfNewestUpTo(first - 1);
+}
+
+} //namespace ns3
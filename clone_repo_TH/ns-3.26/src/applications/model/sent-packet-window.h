@@ -0,0 +1,44 @@
+#ifndef SENT_PACKET_WINDOW_H
+#define SENT_PACKET_WINDOW_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Running count of the packets sent via one neighbour to one destination, remembered per send time over a sliding
+ * window so the count at the time a QLrnHeader was sent can be looked up later (for the loss estimate).
+ * Entries are appended in time order to a ring buffer, so expiring is popping from the front and lookups are binary searches.
+ */
+class SentPacketWindow {
+public:
+  SentPacketWindow();
+
+  // Counts one more packet, sent at time now (ns), which should not be before the previous one
+  void Sent(uint64_t now);
+  // Forgets the entries from before cutoff (ns), the newest entry is always kept
+  void Expire(uint64_t cutoff);
+  // Count of the newest entry from before ts (ns), 0 if there is none
+  uint64_t GetCountBefore(uint64_t ts) const;
+  uint32_t GetSize() const { return m_size; }
+
+private:
+  struct Entry {
+    uint64_t time;
+    uint64_t count;
+  };
+  const Entry& At(uint32_t i) const { return m_ring[(m_head + i) & (m_ring.size() - 1)]; }
+  // index of the first entry at or after ts, m_size if there is none
+  uint32_t FirstNotBefore(uint64_t ts) const;
+  // count of the newest entry at or before index i, entries sent at the same time all count as the first of them
+  uint64_t CountOfNewestUpTo(uint32_t i) const;
+
+  std::vector<Entry> m_ring;
+  uint32_t m_head;
+  uint32_t m_size;
+};
+
+} //namespace ns3
+
+#endif /* SENT_PACKET_WINDOW_H */
@@ -72,4 +72,7 @@
 
 #define MAX_NR_STRIKES_BLACKLISTED_NODE 5
 
+#define PACKETTABLE_INITIAL_CAPACITY 1024 // slots, a power of 2
+#define PACKETTABLE_RETENTION_MAX_DELAYS 20 // packets are forgotten this many MAC queue MaxDelays after their last (de)queue
+
 #endif /* THOMAS_CONFIG_H_ */
@@ -2,8 +2,10 @@
 #define PTS_TAG_H
 
 #include "ns3/tag.h"
+#include "ns3/packet.h"
 #include "ns3/nstime.h"
 #include "ns3/thomas-configuration.h"
+#include "ns3/traffic-types.h"
 namespace ns3 {
 
 class RandomDecisionTag : public Tag {
@@ -559,6 +561,242 @@ private:
   bool m_drop;
 };
 
+class TrafficTypeTag : public Tag {
+public:
+  TrafficTypeTag (TrafficType t = OTHER) : Tag (), m_traffic_type(t) { }
+
+  static TypeId GetTypeId ()
+  {
+    static TypeId tid = TypeId ("ns3::TrafficTypeTag")
+      .SetParent<Tag> ()
+      .SetGroupName("Application")
+      .AddConstructor<TrafficTypeTag> ()
+    ;
+    return tid;
+  }
+
+  TypeId  GetInstanceTypeId () const {
+    return GetTypeId ();
+  }
+
+  TrafficType GetTrafficType() const { return m_traffic_type; }
+  void SetTrafficType(TrafficType t) { m_traffic_type = t; }
+
+  uint32_t GetSerializedSize () const {
+    return sizeof(uint8_t);
+  }
+
+  void  Serialize (TagBuffer i) const {
+    i.WriteU8(m_traffic_type);
+  }
+
+  void  Deserialize (TagBuffer i) {
+    m_traffic_type = static_cast<TrafficType>(i.ReadU8());
+  }
+
+  void Print (std::ostream &os) const {
+    os << PrettyPrint();
+  }
+
+  std::string PrettyPrint() const {
+    std::stringstream oss;
+    oss << "PacketTag caching the traffic type (" << int(m_traffic_type) << ") AODV's CheckTraffic found for this packet.";
+    return oss.str();
+  }
+private:
+  TrafficType m_traffic_type;
+};
+
+/**
+ * The Q-routing tags of a data packet (QLrnInfoTag, PortNrTag, PacketTimeSentTagPrecursorAB/CT, PacketTimeSentTag,
+ * QRoutedTrafficPacketTag, RandomDecisionTag and TrafficTypeTag) fused into one packet tag, so that a hop finds all of
+ * them with a single PacketTagList lookup and deserialisation instead of one per tag.
+ *
+ * Every part is optional. Peek/Set/Remove work like the Packet methods of the same name did for the separate tags,
+ * but on this copy: Get it from the packet once, work on it, and Store it back if anything changed.
+ * The layout is fixed, a version byte and a byte of part flags followed by every part in the order above
+ * (parts that are not set are written with their default values).
+ */
+class QRoutingTag : public Tag {
+public:
+  enum Part {
+    INFO            = 0x01,
+    PORT            = 0x02,
+    PRECURSOR_AB    = 0x04,
+    PRECURSOR_CT    = 0x08,
+    TIME_SENT       = 0x10,
+    Q_ROUTED        = 0x20,
+    RANDOM_DECISION = 0x40,
+    TRAFFIC_TYPE    = 0x80
+  };
+  static const uint8_t VERSION = 1;
+
+  QRoutingTag () : Tag (), m_parts(0) { }
+
+  static TypeId GetTypeId ()
+  {
+    static TypeId tid = TypeId ("ns3::QRoutingTag")
+      .SetParent<Tag> ()
+      .SetGroupName("Application")
+      .AddConstructor<QRoutingTag> ()
+    ;
+    return tid;
+  }
+
+  TypeId  GetInstanceTypeId () const {
+    return GetTypeId ();
+  }
+
+  /// the tag p carries, or one without any parts if it has none
+  static QRoutingTag Get (Ptr<const Packet> p) {
+    QRoutingTag tag;
+    p->PeekPacketTag(tag);
+    return tag;
+  }
+
+  /// puts this tag on p in place of the one it had, or takes that one off if no parts are left
+  void Store (Ptr<const Packet> p) const {
+    // like Packet::AddPacketTag, tags may be changed on a const packet
+    Ptr<Packet> q = ConstCast<Packet>(p);
+    QRoutingTag tag = *this;
+    if (m_parts != 0) {
+      q->ReplacePacketTag(tag);
+    } else {
+      q->RemovePacketTag(tag);
+    }
+  }
+
+  bool Has (Part part) const { return m_parts & part; }
+  bool IsEmpty () const { return m_parts == 0; }
+
+  bool Peek (QLrnInfoTag& t) const { return PeekPart(INFO, m_info, t); }
+  bool Peek (PortNrTag& t) const { return PeekPart(PORT, m_port, t); }
+  bool Peek (PacketTimeSentTagPrecursorAB& t) const { return PeekPart(PRECURSOR_AB, m_precursor_ab, t); }
+  bool Peek (PacketTimeSentTagPrecursorCT& t) const { return PeekPart(PRECURSOR_CT, m_precursor_ct, t); }
+  bool Peek (PacketTimeSentTag& t) const { return PeekPart(TIME_SENT, m_time_sent, t); }
+  bool Peek (QRoutedTrafficPacketTag& t) const { return PeekPart(Q_ROUTED, m_q_routed, t); }
+  bool Peek (RandomDecisionTag& t) const { return PeekPart(RANDOM_DECISION, m_random_decision, t); }
+  bool Peek (TrafficTypeTag& t) const { return PeekPart(TRAFFIC_TYPE, m_traffic_type, t); }
+
+  void Set (const QLrnInfoTag& t) { SetPart(INFO, m_info, t); }
+  void Set (const PortNrTag& t) { SetPart(PORT, m_port, t); }
+  void Set (const PacketTimeSentTagPrecursorAB& t) { SetPart(PRECURSOR_AB, m_precursor_ab, t); }
+  void Set (const PacketTimeSentTagPrecursorCT& t) { SetPart(PRECURSOR_CT, m_precursor_ct, t); }
+  void Set (const PacketTimeSentTag& t) { SetPart(TIME_SENT, m_time_sent, t); }
+  void Set (const QRoutedTrafficPacketTag& t) { SetPart(Q_ROUTED, m_q_routed, t); }
+  void Set (const RandomDecisionTag& t) { SetPart(RANDOM_DECISION, m_random_decision, t); }
+  void Set (const TrafficTypeTag& t) { SetPart(TRAFFIC_TYPE, m_traffic_type, t); }
+
+  bool Remove (QLrnInfoTag& t) { return RemovePart(INFO, m_info, t); }
+  bool Remove (PacketTimeSentTagPrecursorAB& t) { return RemovePart(PRECURSOR_AB, m_precursor_ab, t); }
+  bool Remove (PacketTimeSentTagPrecursorCT& t) { return RemovePart(PRECURSOR_CT, m_precursor_ct, t); }
+  bool Remove (PacketTimeSentTag& t) { return RemovePart(TIME_SENT, m_time_sent, t); }
+  bool Remove (RandomDecisionTag& t) { return RemovePart(RANDOM_DECISION, m_random_decision, t); }
+
+  uint32_t GetSerializedSize () const {
+    return 2 * sizeof(uint8_t) + m_info.GetSerializedSize() + m_port.GetSerializedSize() + m_precursor_ab.GetSerializedSize()
+           + m_precursor_ct.GetSerializedSize() + m_time_sent.GetSerializedSize() + m_q_routed.GetSerializedSize()
+           + m_random_decision.GetSerializedSize() + m_traffic_type.GetSerializedSize();
+  }
+
+  void  Serialize (TagBuffer i) const {
+    i.WriteU8(VERSION);
+    i.WriteU8(m_parts);
+    WritePart(i, m_info);
+    WritePart(i, m_port);
+    WritePart(i, m_precursor_ab);
+    WritePart(i, m_precursor_ct);
+    WritePart(i, m_time_sent);
+    WritePart(i, m_q_routed);
+    WritePart(i, m_random_decision);
+    WritePart(i, m_traffic_type);
+  }
+
+  void  Deserialize (TagBuffer i) {
+    uint8_t version = i.ReadU8();
+    NS_ASSERT_MSG(version == VERSION, "QRoutingTag of version " << int(version) << ", expected " << int(VERSION));
+    m_parts = i.ReadU8();
+    ReadPart(i, m_info);
+    ReadPart(i, m_port);
+    ReadPart(i, m_precursor_ab);
+    ReadPart(i, m_precursor_ct);
+    ReadPart(i, m_time_sent);
+    ReadPart(i, m_q_routed);
+    ReadPart(i, m_random_decision);
+    ReadPart(i, m_traffic_type);
+  }
+
+  void  Print (std::ostream &os) const {
+    os << PrettyPrint();
+  }
+
+  std::string PrettyPrint() const {
+    std::stringstream oss;
+    oss << "QRoutingTag:";
+    if (Has(INFO)) { oss << " " << m_info.PrettyPrint(); }
+    if (Has(PORT)) { oss << " " << m_port.PrettyPrint(); }
+    if (Has(PRECURSOR_AB)) { oss << " " << m_precursor_ab.PrettyPrint(); }
+    if (Has(PRECURSOR_CT)) { oss << " " << m_precursor_ct.PrettyPrint(); }
+    if (Has(TIME_SENT)) { oss << " " << m_time_sent.PrettyPrint(); }
+    if (Has(Q_ROUTED)) { oss << " " << m_q_routed.PrettyPrint(); }
+    if (Has(RANDOM_DECISION)) { oss << " " << m_random_decision.PrettyPrint(); }
+    if (Has(TRAFFIC_TYPE)) { oss << " " << m_traffic_type.PrettyPrint(); }
+    return oss.str();
+  }
+
+private:
+  template <typename T>
+  bool PeekPart (Part part, const T& mine, T& t) const {
+    if (!Has(part)) {
+      return false;
+    }
+    t = mine;
+    return true;
+  }
+  template <typename T>
+  void SetPart (Part part, T& mine, const T& t) {
+    mine = t;
+    m_parts |= part;
+  }
+  // the parts take their TagBuffer by value, so each one goes through a buffer of its own
+  template <typename T>
+  static void WritePart (TagBuffer& i, const T& part) {
+    uint8_t buf[MAX_PART_SIZE];
+    uint32_t size = part.GetSerializedSize();
+    NS_ASSERT(size <= MAX_PART_SIZE);
+    part.Serialize(TagBuffer(buf, buf + size));
+    i.Write(buf, size);
+  }
+  template <typename T>
+  static void ReadPart (TagBuffer& i, T& part) {
+    uint8_t buf[MAX_PART_SIZE];
+    uint32_t size = part.GetSerializedSize();
+    NS_ASSERT(size <= MAX_PART_SIZE);
+    i.Read(buf, size);
+    part.Deserialize(TagBuffer(buf, buf + size));
+  }
+  template <typename T>
+  bool RemovePart (Part part, T& mine, T& t) {
+    bool found = PeekPart(part, mine, t);
+    mine = T();
+    m_parts &= ~part;
+    return found;
+  }
+
+  static const uint32_t MAX_PART_SIZE = 32;
+
+  /// Part flags of the parts that are set
+  uint8_t m_parts;
+  QLrnInfoTag m_info;
+  PortNrTag m_port;
+  PacketTimeSentTagPrecursorAB m_precursor_ab;
+  PacketTimeSentTagPrecursorCT m_precursor_ct;
+  PacketTimeSentTag m_time_sent;
+  QRoutedTrafficPacketTag m_q_routed;
+  RandomDecisionTag m_random_decision;
+  TrafficTypeTag m_traffic_type;
+};
+
 } //namespace ns3
 
 #endif /* PTS_TAG_H */
@@ -0,0 +1,43 @@
+#ifndef TRAFFIC_RATE_CONTROL_H
+#define TRAFFIC_RATE_CONTROL_H
+
+#include "ns3/application.h"
+#include "ns3/fatal-error.h"
+
+namespace ns3 {
+
+/**
+ * What the QLearner needs from the traffic generators it is handed (SetLearningTrafficGen / SetTrafficGen)
+ * to switch between the learning and the data phase and to throttle the learning traffic.
+ * Implemented by OnOffApplication, PPBPApplication, UdpClient and UdpEchoClient.
+ */
+class TrafficRateControl {
+public:
+  virtual ~TrafficRateControl () { }
+
+  /// Stop sending for now, the application keeps running so Resume can pick up where it left off
+  virtual void Freeze () = 0;
+  /// Undo Freeze
+  virtual void Resume () = 0;
+  /// The coarse steps taken when the learning phase starts (IncreaseRate) or ends (ReduceRate)
+  virtual void IncreaseRate () = 0;
+  virtual void ReduceRate () = 0;
+  /// Multiply the rate by factor, more than 1 sends more, less than 1 sends less
+  virtual void ScaleRate (double factor) = 0;
+  /// Whether what is sent from now on is learning traffic
+  virtual void SetLearning (bool b) = 0;
+};
+
+/// The TrafficRateControl of a, which has to be one of the generators implementing it
+inline TrafficRateControl*
+GetTrafficRateControl (Ptr<Application> a) {
+  TrafficRateControl* control = dynamic_cast<TrafficRateControl*> (PeekPointer(a));
+  if (control == 0) {
+    NS_FATAL_ERROR("The traffic generators a QLearner controls have to implement TrafficRateControl, " << a->GetInstanceTypeId().GetName() << " does not.");
+  }
+  return control;
+}
+
+} //namespace ns3
+
+#endif /* TRAFFIC_RATE_CONTROL_H */
@@ -1,8 +1,74 @@
 #include "ns3/traffic-types.h"
+#include <sstream>
 
 namespace ns3 {
 
-TrafficRequirements::TrafficRequirements(float jitter,float delay, float loss_percentage) :
-    m_jitter_max(jitter), m_delay_max(delay), m_random_loss_percentage_max(loss_percentage) { }
+/* The requirements of the traffic types, see the table in traffic-types.h. UDP_ECHO has none. */
+static constexpr std::array<TrafficRequirements, NR_TRAFFIC_TYPES> DEFAULT_TRAFFIC_REQUIREMENTS
+  {{
+    /* OTHER */     TrafficRequirements(500 * 1000000,500 * 1000000,100), //had to add this one due to "fix" of PortNrTag, AODV was now also being put in here
+    /* ICMP */      TrafficRequirements(500 * 1000000,500 * 1000000,100),
+    /* WEB */       TrafficRequirements(500 * 1000000,500 * 1000000,20),
+    /* VOIP */      TrafficRequirements(500 * 1000000,500 * 1000000,0.05),
+    /* VIDEO */     TrafficRequirements(500 * 1000000,500 * 1000000,2),
+    /* UDP_ECHO */  TrafficRequirements(),
+    /* TRAFFIC_A */ TrafficRequirements(50 * 1000000,100 * 1000000,0.0005),
+    /* TRAFFIC_B */ TrafficRequirements(150 * 1000000,100 * 1000000,0.02),
+    /* TRAFFIC_C */ TrafficRequirements(500 * 1000000,500 * 1000000,0.20),
+  }};
+
+std::array<TrafficRequirements, NR_TRAFFIC_TYPES> g_traffic_requirements = DEFAULT_TRAFFIC_REQUIREMENTS;
+
+void
+SetTrafficRequirements(TrafficType t, const TrafficRequirements& reqs) {
+  NS_ABORT_MSG_IF(t >= NR_TRAFFIC_TYPES, "Unknown traffic type " << t);
+  if (reqs.GetJitterMax() <= 0 || reqs.GetDelayMax() <= 0 || reqs.GetRandomLossMax() < 0) {
+    NS_FATAL_ERROR("The requirements of traffic type " << t << " have to be a positive jitter and delay and a loss of at least 0.");
+  }
+  g_traffic_requirements[t] = reqs;
+}
+
+void
+ResetTrafficRequirements() {
+  g_traffic_requirements = DEFAULT_TRAFFIC_REQUIREMENTS;
+}
+
+static TrafficType
+TrafficTypeFromName(const std::string& name) {
+  if      (name == "trafficA") { return TRAFFIC_A; }
+  else if (name == "trafficB") { return TRAFFIC_B; }
+  else if (name == "trafficC") { return TRAFFIC_C; }
+  else if (name == "web")      { return WEB; }
+  else if (name == "video")    { return VIDEO; }
+  else if (name == "voip")     { return VOIP; }
+  else if (name == "ping")     { return ICMP; }
+  else if (name == "other")    { return OTHER; }
+  NS_FATAL_ERROR("No traffic type is called " << name << ".");
+  return OTHER;
+}
+
+void
+ConfigureTrafficRequirements(const std::string& spec) {
+  std::stringstream stream(spec);
+  std::string segment;
+  while (std::getline(stream, segment, '/')) {
+    if (segment.empty()) {
+      continue;
+    }
+    std::string::size_type eq = segment.find('=');
+    if (eq == std::string::npos) {
+      NS_FATAL_ERROR("Traffic requirements are given as <type>=<jitter ms>:<delay ms>:<loss>, not " << segment);
+    }
+    std::stringstream values(segment.substr(eq + 1));
+    float jitter_ms, delay_ms, loss;
+    char sep1 = 0, sep2 = 0;
+    values >> jitter_ms >> sep1 >> delay_ms >> sep2 >> loss;
+    if (values.fail() || sep1 != ':' || sep2 != ':' || !(values >> std::ws).eof()) {
+      NS_FATAL_ERROR("Traffic requirements are given as <type>=<jitter ms>:<delay ms>:<loss>, not " << segment);
+    }
+    SetTrafficRequirements(TrafficTypeFromName(segment.substr(0, eq)),
+                           TrafficRequirements(jitter_ms * 1000000, delay_ms * 1000000, loss));
+  }
+}
 
 } //namespace ns3
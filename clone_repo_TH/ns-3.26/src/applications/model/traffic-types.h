@@ -3,7 +3,10 @@
 
 #include "ns3/tag.h"
 #include "ns3/nstime.h"
-#include <map>
+#include "ns3/abort.h"
+#include <array>
+#include <cstdint>
+#include <string>
 
 namespace ns3 {
 
@@ -20,17 +23,44 @@ enum TrafficType
   TRAFFIC_C = 8,
 };
 
+static const uint32_t NR_TRAFFIC_TYPES = TRAFFIC_C + 1;
+
+/**
+ * What a traffic type asks of a route : the maximum jitter and delay (ns) and random packet loss. The punishment
+ * thresholds QoSQLearner compares the loss of every feedback against are worked out here once. The delay and
+ * jitter coefficients keep dividing by the maximum, a multiplication by its reciprocal rounds differently.
+ */
 class TrafficRequirements {
 public:
-  TrafficRequirements(float,float,float);
-  TrafficRequirements() { NS_FATAL_ERROR("TrafficRequirements should not be default c'tor-ed."); }
-  float GetJitterMax() { return m_jitter_max;}
-  float GetDelayMax() { return m_delay_max;}
-  float GetRandomLossMax() { return m_random_loss_percentage_max;}
+  constexpr TrafficRequirements(float jitter, float delay, float loss_percentage) :
+    m_jitter_max(jitter), m_delay_max(delay), m_random_loss_percentage_max(loss_percentage),
+    m_loss_max_x2(2 * loss_percentage), m_loss_max_x10(10 * loss_percentage), m_defined(true) { }
+  // the requirements of a type that has none, looking them up is an error
+  constexpr TrafficRequirements() :
+    m_jitter_max(0), m_delay_max(0), m_random_loss_percentage_max(0),
+    m_loss_max_x2(0), m_loss_max_x10(0), m_defined(false) { }
+
+  constexpr float GetJitterMax() const { return m_jitter_max;}
+  constexpr float GetDelayMax() const { return m_delay_max;}
+  constexpr float GetRandomLossMax() const { return m_random_loss_percentage_max;}
+  constexpr bool IsDefined() const { return m_defined; }
+
+  // What QoSQLearner::ApplyMetricsToQValue multiplies a q value with, 1 if the metric meets the requirement
+  float DelayCoefficient(uint64_t delay) const { return delay < m_delay_max ? 1.0 : 1 + delay / m_delay_max; }
+  // jitter is lower qvals so mult more
+  float JitterCoefficient(uint64_t jitter) const { return jitter < m_jitter_max ? 1.0 : 2 + jitter / m_jitter_max; }
+  float LossCoefficient(float actual_percent_loss) const {
+    return actual_percent_loss > m_loss_max_x10 ? 12.5 :
+           actual_percent_loss > m_loss_max_x2 ? 8 :
+           actual_percent_loss > m_random_loss_percentage_max ? 4 : 1.0;
+  }
 private:
   float m_jitter_max;
   float m_delay_max;
   float m_random_loss_percentage_max;
+  float m_loss_max_x2;
+  float m_loss_max_x10;
+  bool m_defined;
 };
 /*
 
@@ -43,17 +73,28 @@ Reordered packets       %     0 to 0.001
 
 */
 
-static std::map<TrafficType,TrafficRequirements> TrafficTypeReqsMap
-  {
-    std::make_pair (TRAFFIC_A, TrafficRequirements(50 * 1000000,100 * 1000000,0.0005)),
-    std::make_pair (TRAFFIC_B, TrafficRequirements(150 * 1000000,100 * 1000000,0.02)),
-    std::make_pair (TRAFFIC_C, TrafficRequirements(500 * 1000000,500 * 1000000,0.20)),
-    std::make_pair (WEB, TrafficRequirements(500 * 1000000,500 * 1000000,20)),
-    std::make_pair (VIDEO, TrafficRequirements(500 * 1000000,500 * 1000000,2)),
-    std::make_pair (VOIP, TrafficRequirements(500 * 1000000,500 * 1000000,0.05)),
-    std::make_pair (ICMP, TrafficRequirements(500 * 1000000,500 * 1000000,100)),
-    std::make_pair (OTHER, TrafficRequirements(500 * 1000000,500 * 1000000,100)), //had to add this one due to "fix" of PortNrTag, AODV was now also being put in here
-  };
+// The requirements in use, indexed by TrafficType. Read them with GetTrafficRequirements.
+extern std::array<TrafficRequirements, NR_TRAFFIC_TYPES> g_traffic_requirements;
+
+/// The requirements of t : DEFAULT_TRAFFIC_REQUIREMENTS (traffic-types.cc) unless they were configured otherwise,
+/// a type without requirements stops the simulation, in optimized builds too
+inline const TrafficRequirements&
+GetTrafficRequirements(TrafficType t) {
+  NS_ABORT_MSG_IF(t >= NR_TRAFFIC_TYPES || !g_traffic_requirements[t].IsDefined(), "Traffic type " << t << " has no requirements.");
+  return g_traffic_requirements[t];
 }
 
+void SetTrafficRequirements(TrafficType t, const TrafficRequirements& reqs);
+// Back to the defaults
+void ResetTrafficRequirements();
+/**
+ * Overrides the requirements of the traffic types in spec, a '/' separated list of <type>=<jitter>:<delay>:<loss>,
+ * the jitter and delay in ms, the loss as in the table above and the types named as in the test files (trafficA,
+ * trafficB, trafficC, web, video, voip, ping or other), e.g. "trafficA=40:80:0.001/trafficC=400:400:0.1".
+ * Configure it before the simulation starts, the types not in spec keep their requirements.
+ */
+void ConfigureTrafficRequirements(const std::string& spec);
+
+} //namespace ns3
+
 #endif /* TRAFFIC_TYPES_H_ */
@@ -30,6 +30,7 @@
 #include "ns3/uinteger.h"
 #include "udp-client.h"
 #include "seq-ts-header.h"
+#include "ns3/thomas-packet-tags.h"
 #include <cstdlib>
 #include <cstdio>
 
@@ -79,6 +80,9 @@ UdpClient::UdpClient ()
   m_sent = 0;
   m_socket = 0;
   m_sendEvent = EventId ();
+  m_frozen = false;
+  m_learning = false;
+  m_packet_number = 0;
 }
 
 UdpClient::~UdpClient ()
@@ -145,7 +149,10 @@ UdpClient::StartApplication (void)
 
   m_socket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
   m_socket->SetAllowBroadcast (true);
-  m_sendEvent = Simulator::Schedule (Seconds (0.0), &UdpClient::Send, this);
+  if (!m_frozen)
+    {
+      m_sendEvent = Simulator::Schedule (Seconds (0.0), &UdpClient::Send, this);
+    }
 }
 
 void
@@ -164,6 +171,13 @@ UdpClient::Send (void)
   seqTs.SetSeq (m_sent);
   Ptr<Packet> p = Create<Packet> (m_size-(8+4)); // 8+4 : the size of the seqTs header
   p->AddHeader (seqTs);
+  if (m_learning)
+    {
+      uint16_t port = InetSocketAddress::IsMatchingType (m_peerAddress) ? InetSocketAddress::ConvertFrom (m_peerAddress).GetPort () : m_peerPort;
+      QRoutingTag qrt;
+      qrt.Set (PortNrTag (port, true, m_packet_number++));
+      qrt.Store (p);
+    }
 
   std::stringstream peerAddressStringStream;
   if (Ipv4Address::IsMatchingType (m_peerAddress))
@@ -196,4 +210,54 @@ UdpClient::Send (void)
     }
 }
 
+void
+UdpClient::Freeze (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_frozen = true;
+  Simulator::Cancel (m_sendEvent);
+}
+
+void
+UdpClient::Resume (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_frozen)
+    {
+      return;
+    }
+  m_frozen = false;
+  if (m_socket != 0 && m_sent < m_count)
+    {
+      m_sendEvent = Simulator::Schedule (m_interval, &UdpClient::Send, this);
+    }
+}
+
+void
+UdpClient::IncreaseRate (void)
+{
+  ScaleRate (10);
+}
+
+void
+UdpClient::ReduceRate (void)
+{
+  ScaleRate (0.1);
+}
+
+void
+UdpClient::ScaleRate (double factor)
+{
+  NS_LOG_FUNCTION (this << factor);
+  NS_ASSERT_MSG (factor > 0, "Can not scale the rate by " << factor);
+  // the next packet goes out at the new rate, the one already scheduled keeps its time
+  m_interval = Seconds (m_interval.GetSeconds () / factor);
+}
+
+void
+UdpClient::SetLearning (bool b)
+{
+  m_learning = b;
+}
+
 } // Namespace ns3
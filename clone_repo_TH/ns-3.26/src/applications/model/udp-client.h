@@ -27,6 +27,7 @@
 #include "ns3/event-id.h"
 #include "ns3/ptr.h"
 #include "ns3/ipv4-address.h"
+#include "ns3/traffic-rate-control.h"
 
 namespace ns3 {
 
@@ -40,7 +41,7 @@ class Packet;
  *  in their payloads
  *
  */
-class UdpClient : public Application
+class UdpClient : public Application, public TrafficRateControl
 {
 public:
   /**
@@ -65,6 +66,14 @@ public:
    */
   void SetRemote (Address addr);
 
+  // TrafficRateControl
+  void Freeze (void);
+  void Resume (void);
+  void IncreaseRate (void);
+  void ReduceRate (void);
+  void ScaleRate (double factor);
+  void SetLearning (bool b);
+
 protected:
   virtual void DoDispose (void);
 
@@ -87,6 +96,9 @@ private:
   Address m_peerAddress; //!< Remote peer address
   uint16_t m_peerPort; //!< Remote peer port
   EventId m_sendEvent; //!< Event to send the next packet
+  bool m_frozen; //!< True between Freeze and Resume
+  bool m_learning; //!< Packets sent while learning carry a PortNrTag for the QLearner
+  uint64_t m_packet_number; //!< Number of the next tagged packet
 
 };
 
@@ -28,6 +28,7 @@
 #include "ns3/uinteger.h"
 #include "ns3/trace-source-accessor.h"
 #include "udp-echo-client.h"
+#include "ns3/thomas-packet-tags.h"
 
 namespace ns3 {
 
@@ -82,6 +83,9 @@ UdpEchoClient::UdpEchoClient ()
   m_sendEvent = EventId ();
   m_data = 0;
   m_dataSize = 0;
+  m_frozen = false;
+  m_learning = false;
+  m_packet_number = 0;
 }
 
 UdpEchoClient::~UdpEchoClient()
@@ -153,7 +157,10 @@ UdpEchoClient::StartApplication (void)
 
   m_socket->SetRecvCallback (MakeCallback (&UdpEchoClient::HandleRead, this));
   m_socket->SetAllowBroadcast (true);
-  ScheduleTransmit (Seconds (0.));
+  if (!m_frozen)
+    {
+      ScheduleTransmit (Seconds (0.));
+    }
 }
 
 void 
@@ -312,6 +319,13 @@ UdpEchoClient::Send (void)
       //
       p = Create<Packet> (m_size);
     }
+  if (m_learning)
+    {
+      uint16_t port = InetSocketAddress::IsMatchingType (m_peerAddress) ? InetSocketAddress::ConvertFrom (m_peerAddress).GetPort () : m_peerPort;
+      QRoutingTag qrt;
+      qrt.Set (PortNrTag (port, true, m_packet_number++));
+      qrt.Store (p);
+    }
   // call to the trace sinks before the packet is actually sent,
   // so that tags added to the packet can be sent as well
   m_txTrace (p);
@@ -346,6 +360,56 @@ UdpEchoClient::Send (void)
     }
 }
 
+void
+UdpEchoClient::Freeze (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_frozen = true;
+  Simulator::Cancel (m_sendEvent);
+}
+
+void
+UdpEchoClient::Resume (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_frozen)
+    {
+      return;
+    }
+  m_frozen = false;
+  if (m_socket != 0 && m_sent < m_count)
+    {
+      ScheduleTransmit (m_interval);
+    }
+}
+
+void
+UdpEchoClient::IncreaseRate (void)
+{
+  ScaleRate (10);
+}
+
+void
+UdpEchoClient::ReduceRate (void)
+{
+  ScaleRate (0.1);
+}
+
+void
+UdpEchoClient::ScaleRate (double factor)
+{
+  NS_LOG_FUNCTION (this << factor);
+  NS_ASSERT_MSG (factor > 0, "Can not scale the rate by " << factor);
+  // the next packet goes out at the new rate, the one already scheduled keeps its time
+  m_interval = Seconds (m_interval.GetSeconds () / factor);
+}
+
+void
+UdpEchoClient::SetLearning (bool b)
+{
+  m_learning = b;
+}
+
 void
 UdpEchoClient::HandleRead (Ptr<Socket> socket)
 {
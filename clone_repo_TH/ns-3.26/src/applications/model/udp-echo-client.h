@@ -24,6 +24,7 @@
 #include "ns3/ptr.h"
 #include "ns3/ipv4-address.h"
 #include "ns3/traced-callback.h"
+#include "ns3/traffic-rate-control.h"
 
 namespace ns3 {
 
@@ -36,7 +37,7 @@ class Packet;
  *
  * Every packet sent should be returned by the server and received here.
  */
-class UdpEchoClient : public Application
+class UdpEchoClient : public Application, public TrafficRateControl
 {
 public:
   /**
@@ -130,6 +131,14 @@ public:
    */
   void SetFill (uint8_t *fill, uint32_t fillSize, uint32_t dataSize);
 
+  // TrafficRateControl
+  void Freeze (void);
+  void Resume (void);
+  void IncreaseRate (void);
+  void ReduceRate (void);
+  void ScaleRate (double factor);
+  void SetLearning (bool b);
+
 protected:
   virtual void DoDispose (void);
 
@@ -169,6 +178,9 @@ private:
   Address m_peerAddress; //!< Remote peer address
   uint16_t m_peerPort; //!< Remote peer port
   EventId m_sendEvent; //!< Event to send the next packet
+  bool m_frozen; //!< True between Freeze and Resume
+  bool m_learning; //!< Packets sent while learning carry a PortNrTag for the QLearner
+  uint64_t m_packet_number; //!< Number of the next tagged packet
 
   /// Callbacks for tracing the packet Tx events
   TracedCallback<Ptr<const Packet> > m_txTrace;
@@ -16,11 +16,23 @@
 #include "ns3/random-variable-stream.h"
 #include "ns3/ppbp-helper.h"
 #include "ns3/v4ping.h"
+#include "ns3/packettable.h"
+#include "ns3/sent-packet-window.h"
+#include "ns3/qtable.h"
+#include "ns3/qlrn-feedback-header.h"
+#include "ns3/qrouting-counters.h"
+#include "ns3/qtable-recorder.h"
 
 // #include "qlrn-test-base.h"
 
 #include <iostream>
 #include <cmath>
+#include <sstream>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <set>
+#include <map>
 
 using namespace ns3;
 
@@ -89,6 +101,129 @@ private:
   void DoRun (void);
 };
 
+class PacketTableEvictionTestCase : public TestCase {
+public:
+  PacketTableEvictionTestCase ( ) : TestCase ("Testing PacketTable eviction"), m_table(Seconds(1), 4) {  }
+  ~PacketTableEvictionTestCase ( ) { }
+private:
+  void DoRun (void);
+  void PassThroughQueue (uint64_t uid) { m_table.EnqueuePacket(uid); m_table.DequeuePacket(uid); }
+  PacketTable m_table;
+};
+
+class SentPacketWindowTestCase : public TestCase {
+public:
+  SentPacketWindowTestCase ( ) : TestCase ("Testing SentPacketWindow counts and expiry") {  }
+  ~SentPacketWindowTestCase ( ) { }
+private:
+  void DoRun (void);
+};
+
+class MultiClassQTableTestCase : public TestCase {
+public:
+  MultiClassQTableTestCase ( ) : TestCase ("Testing MultiClassQTable neighbour changes across classes") {  }
+  ~MultiClassQTableTestCase ( ) { }
+private:
+  void DoRun (void);
+};
+
+class QTableCountersTestCase : public TestCase {
+public:
+  QTableCountersTestCase ( ) : TestCase ("Testing QTable convergence and blacklist counters against a full scan") {  }
+  ~QTableCountersTestCase ( ) { }
+private:
+  void DoRun (void);
+  void CheckAgainstScan (QTable& table, Ipv4Address dst, std::string when);
+};
+
+class QTableNeighbourSlotsTestCase : public TestCase {
+public:
+  QTableNeighbourSlotsTestCase ( ) : TestCase ("Testing QTableTopology slot reuse and lazy row updates") {  }
+  ~QTableNeighbourSlotsTestCase ( ) { }
+private:
+  void DoRun (void);
+};
+
+class QTableRandomEstimTestCase : public TestCase {
+public:
+  QTableRandomEstimTestCase ( ) : TestCase ("Testing QTable random next hops only come from eligible columns and repeat with the stream") {  }
+  ~QTableRandomEstimTestCase ( ) { }
+private:
+  void DoRun (void);
+};
+
+class QTableSnapshotTestCase : public TestCase {
+public:
+  QTableSnapshotTestCase ( ) : TestCase ("Testing MultiClassQTable snapshot save and load") {  }
+  ~QTableSnapshotTestCase ( ) { }
+private:
+  void DoRun (void);
+};
+
+class QTableRecorderTestCase : public TestCase {
+public:
+  QTableRecorderTestCase ( ) : TestCase ("Testing QTableRecorder recordings read back, with two recorders sharing the writer") {  }
+  ~QTableRecorderTestCase ( ) { }
+private:
+  void DoRun (void);
+};
+
+class QRoutingTagTestCase : public TestCase {
+public:
+  QRoutingTagTestCase ( ) : TestCase ("Testing QRoutingTag parts on packets and their copies") {  }
+  ~QRoutingTagTestCase ( ) { }
+private:
+  void DoRun (void);
+};
+
+class QLrnStatsSinkTestCase : public TestCase {
+public:
+  QLrnStatsSinkTestCase ( ) : TestCase ("Testing QLrnStatsSink records") {  }
+  ~QLrnStatsSinkTestCase ( ) { }
+private:
+  void DoRun (void);
+};
+
+class QLrnFeedbackHeaderTestCase : public TestCase {
+public:
+  QLrnFeedbackHeaderTestCase ( ) : TestCase ("Testing QLrnFeedbackHeader round trip and size") {  }
+  ~QLrnFeedbackHeaderTestCase ( ) { }
+private:
+  void DoRun (void);
+};
+
+class TrafficRateControlTestCase : public TestCase {
+public:
+  TrafficRateControlTestCase ( ) : TestCase ("Testing TrafficRateControl of the traffic generators") {  }
+  ~TrafficRateControlTestCase ( ) { }
+private:
+  void DoRun (void);
+};
+
+class RateStepTestCase : public TestCase {
+public:
+  RateStepTestCase ( ) : TestCase ("Testing the learning rate steps of QLearner with an interval and hysteresis") {  }
+  ~RateStepTestCase ( ) { }
+private:
+  void DoRun (void);
+};
+
+class TrafficRequirementsTestCase : public TestCase {
+public:
+  TrafficRequirementsTestCase ( ) : TestCase ("Testing the traffic requirements table and its punishment coefficients") {  }
+  ~TrafficRequirementsTestCase ( ) { }
+private:
+  void DoRun (void);
+};
+
+class QRoutingCountersTestCase : public TestCase {
+public:
+  QRoutingCountersTestCase ( ) : TestCase ("Testing the Q-routing counters and histograms") {  }
+  ~QRoutingCountersTestCase ( ) { }
+private:
+  void DoRun (void);
+};
+
 void QLearnerBasicShortTestCase::DoRun (void) {
   // NS_TEST_ASSERT_MSG_EQ (ConfigureTest ( true /* pcap */, false /*printRoutes*/, 37 /*totalTime */, false /*linkBreak*/, "ping" /* traffic */,
   //                                        0 /* numHops */, 0.0 /* eps */, 0.5 /* learning_rate */, "test0.txt"/* test_case_filename */ ),
@@ -218,6 +353,667 @@ void QLearnerVIDEOTestCase::DoRun (void) {
   NS_TEST_ASSERT_MSG_EQ (true, true, "ok true == true no problemo");
 }
 
+void PacketTableEvictionTestCase::DoRun (void) {
+  for (uint64_t uid = 0; uid < 3; uid++) {
+    Simulator::Schedule (MilliSeconds(10 * uid), &PacketTableEvictionTestCase::PassThroughQueue, this, uid);
+  }
+  // fourth packet fills the table past 3/4, the first three are older than the retention by then
+  Simulator::Schedule (Seconds(2), &PacketTableEvictionTestCase::PassThroughQueue, this, 3);
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_table.GetEvictions(), 3, "The three old packets should have been evicted.");
+  NS_TEST_ASSERT_MSG_EQ (m_table.GetSize(), 1, "Only the last packet should be left.");
+  NS_TEST_ASSERT_MSG_EQ (m_table.GetNumberOfTimesSeen(3), 1, "The last packet went through the queue once.");
+  NS_TEST_ASSERT_MSG_EQ (m_table.GetNumberOfTimesSeen(0), 0, "An evicted packet is no longer known.");
+  NS_TEST_ASSERT_MSG_EQ (m_table.GetPacketQueueTime(0), NanoSeconds(0), "An evicted packet has no queue time.");
+  NS_TEST_ASSERT_MSG_EQ (m_table.GetMisses(), 2, "Both lookups of the evicted packet should count as a miss.");
+}
+
+void SentPacketWindowTestCase::DoRun (void) {
+  SentPacketWindow w;
+  NS_TEST_ASSERT_MSG_EQ (w.GetCountBefore(100), 0, "Nothing sent yet.");
+  for (uint64_t t = 10; t <= 400; t += 10) {
+    w.Sent(t);
+  }
+  NS_TEST_ASSERT_MSG_EQ (w.GetCountBefore(10), 0, "Nothing was sent before the first packet.");
+  NS_TEST_ASSERT_MSG_EQ (w.GetCountBefore(11), 1, "One packet was sent before 11.");
+  NS_TEST_ASSERT_MSG_EQ (w.GetCountBefore(1000), 40, "All packets were sent before 1000.");
+
+  // packets sent at the same time all get the count of the first one sent then, plus one
+  w.Sent(500); w.Sent(500); w.Sent(500);
+  NS_TEST_ASSERT_MSG_EQ (w.GetCountBefore(501), 41, "Same-time packets count as the first of them.");
+
+  w.Expire(300);
+  NS_TEST_ASSERT_MSG_EQ (w.GetSize(), 14, "Entries from before 300 should be gone.");
+  NS_TEST_ASSERT_MSG_EQ (w.GetCountBefore(305), 30, "The entry at 300 should still be there.");
+  w.Expire(10000);
+  NS_TEST_ASSERT_MSG_EQ (w.GetSize(), 1, "The newest entry should always be kept.");
+  // the entry kept is the last one sent at 500, which counted 42
+  w.Sent(600);
+  NS_TEST_ASSERT_MSG_EQ (w.GetCountBefore(601), 43, "Counting goes on after expiring.");
+}
+
+void MultiClassQTableTestCase::DoRun (void) {
+  Ipv4Address me("10.1.1.1"), a("10.1.1.2"), b("10.1.1.3"), c("10.1.1.4"), dst("10.1.1.9");
+  std::vector<Ipv4Address> neighbours = {a, b};
+  MultiClassQTable qtables(neighbours, me, 0.5, 0.05, 0.5, true, false, 1.0);
+  NS_TEST_ASSERT_MSG_EQ (qtables.AddDestination(a, dst, MilliSeconds(5)), true, "dst is new to every class.");
+  NS_TEST_ASSERT_MSG_EQ (qtables.CheckDestinationKnown(dst), true, "dst should be known by every class.");
+
+  auto entries = qtables.GetEntriesByRef(dst, b);
+  for (auto t : {TRAFFIC_A, TRAFFIC_B, TRAFFIC_C}) {
+    NS_TEST_ASSERT_MSG_EQ (entries[MultiClassQTable::ClassOf(t)], &qtables.GetTable(t).GetEntryByRef(dst, b), "Entry of the wrong class.");
+  }
+  qtables.GetTable(TRAFFIC_A).SetQValueWrapper(dst, *entries[MultiClassQTable::ClassOf(TRAFFIC_A)], MilliSeconds(1));
+  NS_TEST_ASSERT_MSG_EQ (qtables.GetTable(TRAFFIC_A).GetNextEstim(dst).GetNextHop(), b, "The cheaper entry should be picked.");
+  NS_TEST_ASSERT_MSG_EQ (qtables.GetTable(TRAFFIC_C).GetNextEstim(dst).GetNextHop(), a, "Other classes keep their own values.");
+
+  qtables.MarkNeighbDown(b);
+  for (auto t : {TRAFFIC_A, TRAFFIC_B, TRAFFIC_C}) {
+    NS_TEST_ASSERT_MSG_EQ (qtables.GetTable(t).IsNeighbourAvailable(b), false, "b should be down in every class.");
+    NS_TEST_ASSERT_MSG_EQ (qtables.GetTable(t).GetEntryByRef(dst, b).IsAvailable(), false, "The entries via b should be unavailable.");
+  }
+  NS_TEST_ASSERT_MSG_EQ (qtables.GetNextEstims(dst)[MultiClassQTable::ClassOf(TRAFFIC_A)].GetNextHop(), a, "b is down, so a should be picked.");
+
+  qtables.AddNeighbour(b);
+  qtables.AddNeighbour(c);
+  for (auto t : {TRAFFIC_A, TRAFFIC_B, TRAFFIC_C}) {
+    NS_TEST_ASSERT_MSG_EQ (qtables.GetTable(t).GetNeighbours().size(), 3, "c should be a neighbour of every class.");
+    NS_TEST_ASSERT_MSG_EQ (qtables.GetTable(t).GetEntryByRef(dst, b).IsAvailable(), true, "b should be back in every class.");
+    NS_TEST_ASSERT_MSG_EQ (qtables.GetTable(t).GetEstims(dst).size(), 3, "Every row should have an entry for c.");
+  }
+  NS_TEST_ASSERT_MSG_EQ (qtables.GetNextEstims(dst)[MultiClassQTable::ClassOf(TRAFFIC_A)].GetNextHop(), b, "b is back and still the cheapest.");
+}
+
+// What HasConverged and AllNeighboursBlacklisted used to find by going over the row
+void QTableCountersTestCase::CheckAgainstScan (QTable& table, Ipv4Address dst, std::string when) {
+  std::vector<Ipv4Address> unavails = table.GetUnavails();
+  std::vector<Ipv4Address> neighbours = table.GetNeighbours();
+  bool converged = true, all_blacklisted = true;
+  QTableEntry best;
+  for (const auto& entry : table.GetEstims(dst)) {
+    if (std::find(unavails.begin(), unavails.end(), entry.GetNextHop()) != unavails.end()) {
+      continue;
+    }
+    converged = converged && entry.HasConverged();
+    if (best.GetQValue() > entry.GetQValue()) {
+      best = entry;
+    }
+    if (std::find(neighbours.begin(), neighbours.end(), entry.GetNextHop()) != neighbours.end() && !entry.IsBlackListed() && entry.IsAvailable()) {
+      all_blacklisted = false;
+    }
+  }
+  NS_TEST_ASSERT_MSG_EQ (table.HasConverged(dst), converged, "HasConverged differs from a full scan " << when);
+  NS_TEST_ASSERT_MSG_EQ (table.HasConverged(dst, true), best.HasConverged(), "HasConverged (best estim) differs from a full scan " << when);
+  NS_TEST_ASSERT_MSG_EQ (table.AllNeighboursBlacklisted(dst), all_blacklisted, "AllNeighboursBlacklisted differs from a full scan " << when);
+}
+
+void QTableCountersTestCase::DoRun (void) {
+  Ipv4Address me("10.1.1.1"), a("10.1.1.2"), b("10.1.1.3"), c("10.1.1.4"), dst("10.1.1.9");
+  MultiClassQTable qtables({a, b, c}, me, 0.5, 0.05, 0.5, true, false, 1.0);
+  qtables.AddDestination(a, dst, MilliSeconds(5));
+  QTable& table = qtables.GetTable(TRAFFIC_A);
+  CheckAgainstScan(table, dst, "at the start");
+  NS_TEST_ASSERT_MSG_EQ (table.HasConverged(dst), false, "Nothing has converged yet.");
+
+  // the same value twice converges an entry, the sender has to agree as well
+  for (auto via : {a, b, c}) {
+    table.SetQValueWrapper(dst, via, MilliSeconds(10));
+    table.SetQValueWrapper(dst, via, MilliSeconds(10));
+    CheckAgainstScan(table, dst, "after converging an entry");
+    qtables.SetSenderConverged(dst, via, true);
+    CheckAgainstScan(table, dst, "after the sender converged");
+  }
+  NS_TEST_ASSERT_MSG_EQ (table.HasConverged(dst), true, "Every entry has converged.");
+  NS_TEST_ASSERT_MSG_EQ (qtables.GetTable(TRAFFIC_C).HasConverged(dst), false, "Other classes did not converge.");
+
+  table.SetQValueWrapper(dst, b, MilliSeconds(40));
+  CheckAgainstScan(table, dst, "after unconverging b");
+  NS_TEST_ASSERT_MSG_EQ (table.HasConverged(dst), false, "b is no longer converged.");
+  qtables.MarkNeighbDown(b);
+  CheckAgainstScan(table, dst, "after b went down");
+  NS_TEST_ASSERT_MSG_EQ (table.HasConverged(dst), true, "Only available neighbours count.");
+  qtables.AddNeighbour(b);
+  CheckAgainstScan(table, dst, "after b came back");
+
+  for (auto via : {a, b}) {
+    for (int i = 0; i < MAX_NR_STRIKES_BLACKLISTED_NODE; i++) {
+      table.AddStrike(dst, table.GetEntryByRef(dst, via));
+      CheckAgainstScan(table, dst, "after a strike");
+    }
+  }
+  NS_TEST_ASSERT_MSG_EQ (table.AllNeighboursBlacklisted(dst), false, "c is not blacklisted.");
+  qtables.MarkNeighbDown(c);
+  CheckAgainstScan(table, dst, "after c went down");
+  NS_TEST_ASSERT_MSG_EQ (table.AllNeighboursBlacklisted(dst), true, "a and b are blacklisted and c is down.");
+  for (int i = 0; i < MAX_NR_STRIKES_BLACKLISTED_NODE; i++) {
+    table.DeductStrike(dst, table.GetEntryByRef(dst, a));
+    CheckAgainstScan(table, dst, "after deducting a strike");
+  }
+  NS_TEST_ASSERT_MSG_EQ (table.AllNeighboursBlacklisted(dst), false, "a is no longer blacklisted.");
+}
+
+void QTableNeighbourSlotsTestCase::DoRun (void) {
+  Ipv4Address me("10.1.1.1"), a("10.1.1.2"), b("10.1.1.3"), c("10.1.1.4"), d("10.1.1.5"), dst("10.1.1.9"), dst2("10.1.1.8");
+  MultiClassQTable qtables({a, b, c}, me, 0.5, 0.05, 0.5, true, false, 1.0);
+  qtables.AddDestination(a, dst, MilliSeconds(5));
+  QTable& table = qtables.GetTable(TRAFFIC_A);
+  table.SetQValueWrapper(dst, c, MilliSeconds(2));
+
+  // b has to be down before it can be removed
+  qtables.RemoveNeighbour(b);
+  NS_TEST_ASSERT_MSG_EQ (table.GetNeighbours().size(), 3, "b is still up, so it stays.");
+  qtables.MarkNeighbDown(b);
+  qtables.RemoveNeighbour(b);
+  NS_TEST_ASSERT_MSG_EQ (table.GetNeighbours().size(), 2, "b was removed.");
+  NS_TEST_ASSERT_MSG_EQ (table.GetUnavails().size(), 0, "A removed neighbour is not unavailable.");
+
+  // d takes the column b left behind, its entry starts from the best estimate before it
+  qtables.AddNeighbour(d);
+  NS_TEST_ASSERT_MSG_EQ (table.GetEstims(dst).size(), 3, "d reuses the column of b.");
+  NS_TEST_ASSERT_MSG_EQ (table.GetEntryByRef(dst, d).GetNextHop(), d, "The entry in the column is d's.");
+  NS_TEST_ASSERT_MSG_EQ (table.GetEntryByRef(dst, d).IsAvailable(), true, "d is available.");
+  NS_TEST_ASSERT_MSG_EQ (table.GetEntryByRef(dst, d).GetQValue(), MilliSeconds(2 + NEW_NEIGHBOUR_INITIAL_INCREMENT), "d starts from the best estimate.");
+  NS_TEST_ASSERT_MSG_EQ (table.GetNextEstim(dst).GetNextHop(), c, "c is still the best.");
+
+  // rows added after the churn line up with the columns too
+  qtables.AddDestination(c, dst2, MilliSeconds(7));
+  NS_TEST_ASSERT_MSG_EQ (table.GetEstims(dst2).size(), 3, "One entry per column.");
+  NS_TEST_ASSERT_MSG_EQ (table.GetEntryByRef(dst2, d).GetNextHop(), d, "d has an entry in the new row.");
+
+  // churn does not make the rows any wider
+  for (int i = 0; i < 20; i++) {
+    qtables.MarkNeighbDown(d);
+    qtables.RemoveNeighbour(d);
+    qtables.AddNeighbour(d);
+  }
+  qtables.MarkNeighbDown(a);
+  for (auto t : {TRAFFIC_A, TRAFFIC_B, TRAFFIC_C}) {
+    NS_TEST_ASSERT_MSG_EQ (qtables.GetTable(t).GetEstims(dst).size(), 3, "Slots are reused.");
+    NS_TEST_ASSERT_MSG_EQ (qtables.GetTable(t).GetEntryByRef(dst, a).IsAvailable(), false, "The entries via a are marked when the row is used.");
+    NS_TEST_ASSERT_MSG_EQ (qtables.GetTable(t).GetEntryByRef(dst2, d).IsAvailable(), true, "d is back.");
+  }
+  NS_TEST_ASSERT_MSG_EQ (table.GetNeighbours().size(), 3, "a, c and d are neighbours.");
+  NS_TEST_ASSERT_MSG_EQ (table.GetNextEstim(dst).GetNextHop(), c, "a is down and c is the best of the others.");
+  NS_TEST_ASSERT_MSG_EQ (table.IsNeighbourAvailable(b), true, "b is no longer a neighbour, so it is not marked down.");
+}
+
+void QTableRandomEstimTestCase::DoRun (void) {
+  Ipv4Address me("10.1.1.1"), a("10.1.1.2"), b("10.1.1.3"), c("10.1.1.4"), d("10.1.1.5"), dst("10.1.1.9");
+  MultiClassQTable qtables({a, b, c, d}, me, 0.5, 0.05, 0.5, true, false, 1.0);
+  qtables.AddDestination(a, dst, MilliSeconds(5));
+  QTable& table = qtables.GetTable(TRAFFIC_A);
+  table.SetQValueWrapper(dst, a, MilliSeconds(10));
+  table.SetQValueWrapper(dst, a, MilliSeconds(10));
+  qtables.SetSenderConverged(dst, a, true);
+  qtables.MarkNeighbDown(b);
+
+  std::set<Ipv4Address> unconverged, any;
+  for (int i = 0; i < 200; i++) {
+    unconverged.insert(table.GetRandomEstim(dst, true).GetNextHop());
+    any.insert(table.GetRandomEstim(dst, false).GetNextHop());
+  }
+  NS_TEST_ASSERT_MSG_EQ ((unconverged == std::set<Ipv4Address>{c, d}), true, "Only c and d are available and not converged.");
+  NS_TEST_ASSERT_MSG_EQ ((any == std::set<Ipv4Address>{a, c, d}), true, "b is down, the others all get picked.");
+
+  // converging the last ones makes the row converged, so any available neighbour will do
+  for (auto via : {c, d}) {
+    table.SetQValueWrapper(dst, via, MilliSeconds(10));
+    table.SetQValueWrapper(dst, via, MilliSeconds(10));
+    qtables.SetSenderConverged(dst, via, true);
+  }
+  NS_TEST_ASSERT_MSG_EQ (table.HasConverged(dst), true, "Every available entry has converged.");
+  NS_TEST_ASSERT_MSG_NE (table.GetRandomEstim(dst, true).GetNextHop(), b, "b is still down.");
+
+  // the draws only depend on the stream handed in
+  MultiClassQTable copy = qtables;
+  Ptr<UniformRandomVariable> r1 = CreateObject<UniformRandomVariable> (), r2 = CreateObject<UniformRandomVariable> ();
+  r1->SetStream(7);
+  r2->SetStream(7);
+  qtables.SetRandomVariable(r1);
+  copy.SetRandomVariable(r2);
+  for (int i = 0; i < 50; i++) {
+    NS_TEST_ASSERT_MSG_EQ (table.GetRandomEstim(dst).GetNextHop(), copy.GetTable(TRAFFIC_A).GetRandomEstim(dst).GetNextHop(), "Same stream, same next hops.");
+  }
+
+  qtables.MarkNeighbDown(a);
+  qtables.MarkNeighbDown(c);
+  qtables.MarkNeighbDown(d);
+  NS_TEST_ASSERT_MSG_EQ (table.GetRandomEstim(dst).GetNextHop(), Ipv4Address(NO_NEIGHBOURS_REACHABLE_ROUTE_IP), "Nobody is available.");
+}
+
+void QTableSnapshotTestCase::DoRun (void) {
+  Ipv4Address me("10.1.1.1"), a("10.1.1.2"), b("10.1.1.3"), c("10.1.1.4"), dst("10.1.1.9"), dst2("10.1.1.8");
+  MultiClassQTable qtables({a, b, c}, me, 0.5, 0.05, 0.5, true, false, 1.0);
+  qtables.AddDestination(a, dst, MilliSeconds(5));
+  qtables.AddDestination(b, dst2, MilliSeconds(7));
+  QTable& table = qtables.GetTable(TRAFFIC_A);
+  for (auto via : {a, b, c}) {
+    table.SetQValueWrapper(dst, via, MilliSeconds(10));
+    table.SetQValueWrapper(dst, via, MilliSeconds(10));
+    qtables.SetSenderConverged(dst, via, true);
+  }
+  qtables.GetTable(TRAFFIC_C).SetQValueWrapper(dst2, c, MilliSeconds(3));
+  for (int i = 0; i < MAX_NR_STRIKES_BLACKLISTED_NODE; i++) {
+    table.AddStrike(dst2, table.GetEntryByRef(dst2, a));
+  }
+  table.AddStrike(dst2, table.GetEntryByRef(dst2, b));
+  qtables.MarkNeighbDown(c);
+
+  std::stringstream snapshot;
+  qtables.Save(snapshot);
+
+  // c is not known (yet) where the snapshot is loaded
+  MultiClassQTable warm({a, b}, me, 0.5, 0.05, 0.5, true, false, 1.0);
+  NS_TEST_ASSERT_MSG_EQ (warm.Load(snapshot), true, "The snapshot was made by this node.");
+  for (auto t : {TRAFFIC_A, TRAFFIC_B, TRAFFIC_C}) {
+    NS_TEST_ASSERT_MSG_EQ (warm.GetTable(t).PrettyPrint(), qtables.GetTable(t).PrettyPrint(), "The loaded qtable differs from the saved one.");
+    for (auto d : {dst, dst2}) {
+      NS_TEST_ASSERT_MSG_EQ (warm.GetTable(t).HasConverged(d), qtables.GetTable(t).HasConverged(d), "Convergence was not restored.");
+      NS_TEST_ASSERT_MSG_EQ (warm.GetTable(t).AllNeighboursBlacklisted(d), qtables.GetTable(t).AllNeighboursBlacklisted(d), "Blacklisting was not restored.");
+      NS_TEST_ASSERT_MSG_EQ (warm.GetTable(t).GetNextEstim(d).GetNextHop(), qtables.GetTable(t).GetNextEstim(d).GetNextHop(), "A different next hop is picked.");
+    }
+  }
+  NS_TEST_ASSERT_MSG_EQ (warm.GetTable(TRAFFIC_A).HasConverged(dst), true, "dst had converged when the snapshot was made.");
+  NS_TEST_ASSERT_MSG_EQ (warm.GetTable(TRAFFIC_A).GetEntryByRef(dst2, a).IsBlackListed(), true, "a was blacklisted for dst2.");
+  NS_TEST_ASSERT_MSG_EQ (warm.GetTable(TRAFFIC_A).GetEntryByRef(dst2, b).GetNrOfStrikes(), 1, "b had one strike for dst2.");
+  NS_TEST_ASSERT_MSG_EQ (warm.GetTable(TRAFFIC_A).IsNeighbourAvailable(c), false, "c was down when the snapshot was made.");
+
+  std::stringstream other;
+  qtables.Save(other);
+  MultiClassQTable stranger({a, b}, a, 0.5, 0.05, 0.5, true, false, 1.0);
+  NS_TEST_ASSERT_MSG_EQ (stranger.Load(other), false, "A snapshot of another node should be refused.");
+}
+
+/* What a QTableRecorder file holds, read back the way convertQTableRecords.py does */
+struct QTableRecording {
+  QTableRecording() : ended(false), bytes_after_end(0) { }
+  std::map<uint32_t, Ipv4Address> destinations;
+  std::map<uint32_t, Ipv4Address> neighbours;
+  std::vector<uint32_t> removed;
+  std::vector<std::pair<uint32_t, int64_t> > cells; // row << 16 | column and qvalue, in the order they were sampled
+  bool ended;
+  size_t bytes_after_end;
+};
+
+static bool
+ReadQTableRecording(std::string filename, QTableRecording& rec) {
+  std::ifstream in(filename.c_str(), std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  if (data.size() < 4 || data.substr(0, 4) != "QTR1") {
+    return false;
+  }
+  size_t at = 4;
+  auto read = [&data, &at] (void* to, size_t size) {
+    if (at + size > data.size()) { return false; }
+    memcpy(to, data.data() + at, size);
+    at += size;
+    return true;
+  };
+  while (at < data.size() && !rec.ended) {
+    char tag = data[at++];
+    uint32_t id, ip, count;
+    int64_t t;
+    if (tag == 'D' || tag == 'N') {
+      if (!read(&id, 4) || !read(&ip, 4)) { return false; }
+      (tag == 'D' ? rec.destinations : rec.neighbours)[id] = Ipv4Address(ip);
+    } else if (tag == 'R') {
+      if (!read(&id, 4)) { return false; }
+      rec.removed.push_back(id);
+    } else if (tag == 'S') {
+      if (!read(&t, 8) || !read(&count, 4)) { return false; }
+      for (uint32_t i = 0; i < count; i++) {
+        uint16_t row, col;
+        int64_t value;
+        if (!read(&row, 2) || !read(&col, 2) || !read(&value, 8)) { return false; }
+        rec.cells.push_back(std::make_pair(uint32_t(row) << 16 | col, value));
+      }
+    } else if (tag == 'E') {
+      if (!read(&t, 8)) { return false; }
+      rec.ended = true;
+    } else {
+      return false;
+    }
+  }
+  rec.bytes_after_end = data.size() - at;
+  return true;
+}
+
+void QTableRecorderTestCase::DoRun (void) {
+  Ipv4Address a("10.1.1.2"), b("10.1.1.3"), dst("10.1.1.9"), dst2("10.1.1.8");
+  std::string big_file = CreateTempDirFilename("qtable_recorder_big.bin");
+  std::string small_file = CreateTempDirFilename("qtable_recorder_small.bin");
+  Ptr<QTableRecorder> big = Create<QTableRecorder> (big_file, Seconds(0));
+  Ptr<QTableRecorder> small = Create<QTableRecorder> (small_file, Seconds(0));
+
+  big->AddDestination(0, dst);
+  big->AddNeighbour(0, a);
+  big->AddNeighbour(1, b);
+  small->AddDestination(3, dst2);
+  small->AddNeighbour(0, b);
+  small->RecordCell(3, 0, Seconds(1));
+  small->CellsRecorded();
+  small->Close();
+
+  // about 1.5 MB of samples, so some go to the writer before Close, after the other recorder is done with it
+  const uint32_t nr_of_samples = 60000;
+  for (uint32_t i = 0; i < nr_of_samples; i++) {
+    big->RecordCell(0, i % 2, MilliSeconds(i));
+    big->CellsRecorded();
+    big->RecordCell(0, i % 2, MilliSeconds(i)); // unchanged, not sampled again
+    big->CellsRecorded();
+  }
+  big->RemoveNeighbour(1);
+  big->Close();
+
+  QTableRecording rec;
+  NS_TEST_ASSERT_MSG_EQ (ReadQTableRecording(big_file, rec), true, "The recording could not be read back.");
+  NS_TEST_ASSERT_MSG_EQ (rec.ended, true, "The recording was not closed.");
+  NS_TEST_ASSERT_MSG_EQ (rec.bytes_after_end, 0, "Nothing should follow the end of the recording.");
+  NS_TEST_ASSERT_MSG_EQ (rec.destinations[0], dst, "Wrong destination.");
+  NS_TEST_ASSERT_MSG_EQ (rec.neighbours[0], a, "Wrong first neighbour.");
+  NS_TEST_ASSERT_MSG_EQ (rec.neighbours[1], b, "Wrong second neighbour.");
+  NS_TEST_ASSERT_MSG_EQ (rec.removed.size(), 1, "One neighbour was removed.");
+  NS_TEST_ASSERT_MSG_EQ (rec.removed[0], 1, "The second neighbour was removed.");
+  NS_TEST_ASSERT_MSG_EQ (rec.cells.size(), nr_of_samples, "Every change should be sampled once.");
+  for (uint32_t i = 0; i < rec.cells.size(); i++) {
+    NS_TEST_ASSERT_MSG_EQ (rec.cells[i].first, i % 2, "Sample " << i << " is of the wrong cell.");
+    NS_TEST_ASSERT_MSG_EQ (rec.cells[i].second, MilliSeconds(i).GetInteger(), "Sample " << i << " has the wrong value.");
+  }
+
+  QTableRecording small_rec;
+  NS_TEST_ASSERT_MSG_EQ (ReadQTableRecording(small_file, small_rec), true, "The small recording could not be read back.");
+  NS_TEST_ASSERT_MSG_EQ (small_rec.ended, true, "The small recording was not closed.");
+  NS_TEST_ASSERT_MSG_EQ (small_rec.destinations[3], dst2, "Wrong destination in the small recording.");
+  NS_TEST_ASSERT_MSG_EQ (small_rec.cells.size(), 1, "The small recording has one sample.");
+  NS_TEST_ASSERT_MSG_EQ (small_rec.cells[0].first, (3u << 16), "Wrong cell in the small recording.");
+  NS_TEST_ASSERT_MSG_EQ (small_rec.cells[0].second, Seconds(1).GetInteger(), "Wrong value in the small recording.");
+}
+
+void QRoutingTagTestCase::DoRun (void) {
+  Ptr<Packet> p = Create<Packet> (100);
+  QRoutingTag empty = QRoutingTag::Get(p);
+  PortNrTag pnt;
+  NS_TEST_ASSERT_MSG_EQ (empty.IsEmpty(), true, "A new packet has no Q-routing tag.");
+  NS_TEST_ASSERT_MSG_EQ (empty.Peek(pnt), false, "A new packet has no PortNrTag part.");
+
+  QRoutingTag qrt;
+  qrt.Set(PortNrTag(PORT_NUMBER_TRAFFIC_A, true, 7));
+  qrt.Store(p);
+  // the copy shares its tags with p until one of them changes them
+  Ptr<Packet> copy = p->Copy();
+  qrt.Set(QLrnInfoTag(1234, Ipv4Address("10.1.1.2"), true, false));
+  qrt.Set(PacketTimeSentTag(55, 66, Ipv4Address("10.1.1.3")));
+  qrt.Store(p);
+
+  QRoutingTag got = QRoutingTag::Get(p);
+  QLrnInfoTag info;
+  PacketTimeSentTag ptst;
+  NS_TEST_ASSERT_MSG_EQ (got.Peek(pnt), true, "The PortNrTag part should be there.");
+  NS_TEST_ASSERT_MSG_EQ (pnt.GetDstPort(), PORT_NUMBER_TRAFFIC_A, "Wrong port.");
+  NS_TEST_ASSERT_MSG_EQ (pnt.GetLearningPkt(), true, "Wrong learning flag.");
+  NS_TEST_ASSERT_MSG_EQ (pnt.GetPktNumber(), 7, "Wrong packet number.");
+  NS_TEST_ASSERT_MSG_EQ (got.Peek(info), true, "The QLrnInfoTag part should be there.");
+  NS_TEST_ASSERT_MSG_EQ (info.GetTimeAsInt(), 1234, "Wrong time.");
+  NS_TEST_ASSERT_MSG_EQ (info.GetPrevHop(), Ipv4Address("10.1.1.2"), "Wrong prev hop.");
+  NS_TEST_ASSERT_MSG_EQ (info.GetMaint(), true, "Wrong maintenance flag.");
+  NS_TEST_ASSERT_MSG_EQ (info.GetUsableDelay(), false, "Wrong usable delay flag.");
+  NS_TEST_ASSERT_MSG_EQ (got.Peek(ptst), true, "The PacketTimeSentTag part should be there.");
+  NS_TEST_ASSERT_MSG_EQ (ptst.GetSentTimeAsInt(), 55, "Wrong sent time.");
+  NS_TEST_ASSERT_MSG_EQ (ptst.GetInitialEstimAsInt(), 66, "Wrong initial estim.");
+  NS_TEST_ASSERT_MSG_EQ (got.Has(QRoutingTag::RANDOM_DECISION), false, "No random decision was set.");
+
+  QRoutingTag of_copy = QRoutingTag::Get(copy);
+  NS_TEST_ASSERT_MSG_EQ (of_copy.Peek(pnt), true, "The copy keeps the PortNrTag part.");
+  NS_TEST_ASSERT_MSG_EQ (of_copy.Peek(info), false, "Parts set after copying should not show up in the copy.");
+
+  NS_TEST_ASSERT_MSG_EQ (got.Remove(ptst), true, "Removing a part that is there.");
+  NS_TEST_ASSERT_MSG_EQ (got.Remove(ptst), false, "Removing a part that is gone.");
+  got.Store(p);
+  NS_TEST_ASSERT_MSG_EQ (QRoutingTag::Get(p).Has(QRoutingTag::TIME_SENT), false, "The removed part should be gone from the packet.");
+  NS_TEST_ASSERT_MSG_EQ (QRoutingTag::Get(p).Has(QRoutingTag::INFO), true, "Other parts stay.");
+
+  QRoutingTag none;
+  none.Store(p);
+  NS_TEST_ASSERT_MSG_EQ (p->PeekPacketTag(none), false, "Storing a tag without parts takes it off the packet.");
+}
+
+void QLrnStatsSinkTestCase::DoRun (void) {
+  std::string filename = CreateTempDirFilename("out_stats_test.bin");
+  Ptr<QLrnStatsSink> sink = Create<QLrnStatsSink> (filename);
+  sink->Record(42, Seconds(6.5), MicroSeconds(4157), NanoSeconds(504432), QLrnStatsSink::LEARNING, Ipv4Address("10.1.1.6"), TRAFFIC_A);
+  sink->Record(43, Seconds(7), MilliSeconds(12), NanoSeconds(0), QLrnStatsSink::DELAY_OK | QLrnStatsSink::LOSS_OK, Ipv4Address("10.1.1.7"), VIDEO);
+  sink->Close();
+  sink->Record(44, Seconds(8), MilliSeconds(1), NanoSeconds(0), 0, Ipv4Address("10.1.1.7"), VIDEO);
+
+  std::ifstream in(filename.c_str(), std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  NS_TEST_ASSERT_MSG_EQ (data.size(), 4 + 2 * 38, "Expected the magic and two records, nothing after Close.");
+  NS_TEST_ASSERT_MSG_EQ (data.substr(0, 4), "QST1", "Wrong magic.");
+
+  const char* rec = data.data() + 4 + 38;
+  uint64_t uid; int64_t t, delay, estim; uint32_t ip;
+  memcpy(&uid, rec, 8); memcpy(&t, rec + 8, 8); memcpy(&delay, rec + 16, 8); memcpy(&estim, rec + 24, 8); memcpy(&ip, rec + 32, 4);
+  NS_TEST_ASSERT_MSG_EQ (uid, 43, "Wrong uid.");
+  NS_TEST_ASSERT_MSG_EQ (t, Seconds(7).GetInteger(), "Wrong time.");
+  NS_TEST_ASSERT_MSG_EQ (delay, MilliSeconds(12).GetInteger(), "Wrong delay.");
+  NS_TEST_ASSERT_MSG_EQ (estim, 0, "Wrong initial estimate.");
+  NS_TEST_ASSERT_MSG_EQ (Ipv4Address(ip), Ipv4Address("10.1.1.7"), "Wrong prev hop.");
+  NS_TEST_ASSERT_MSG_EQ (int(uint8_t(rec[36])), (QLrnStatsSink::DELAY_OK | QLrnStatsSink::LOSS_OK), "Wrong verdict.");
+  NS_TEST_ASSERT_MSG_EQ (int(uint8_t(rec[37])), VIDEO, "Wrong traffic type.");
+}
+
+void QLrnFeedbackHeaderTestCase::DoRun (void) {
+  QLrnFeedbackHeader feedback(true);
+  feedback.SetSentTime(Seconds(12).GetInteger());
+  for (uint32_t i = 0; i < 4; i++) {
+    QLrnFeedbackRecord r;
+    r.packet_id = 1000 + 3 * i - (i == 2 ? 7 : 0); // uids do not always go up
+    r.time_as_int = MilliSeconds(2 + i).GetInteger();
+    r.next_estim = MilliSeconds(20).GetInteger();
+    r.packet_dst = Ipv4Address(i < 3 ? "10.1.1.8" : "10.1.1.5");
+    r.traffic_type = i % 2 ? TRAFFIC_A : TRAFFIC_C;
+    r.sender_converged = i == 1;
+    r.real_delay = MilliSeconds(30).GetInteger();
+    r.real_loss = 125;
+    r.num_pkts = 40 + i;
+    r.made_at = Seconds(12).GetInteger() - MilliSeconds(4 - i).GetInteger();
+    feedback.AddRecord(r);
+  }
+  Ptr<Packet> p = Create<Packet> ();
+  p->AddHeader(feedback);
+  NS_TEST_ASSERT_MSG_LT (p->GetSize(), 3 * QoSQLrnHeader().GetSerializedSize(), "Four records should take less room than three QoSQLrnHeaders.");
+  NS_TEST_ASSERT_MSG_EQ (QLrnFeedbackHeader::IsFeedback(p, false), true, "Should be recognised as feedback.");
+
+  QLrnFeedbackHeader received;
+  p->RemoveHeader(received);
+  NS_TEST_ASSERT_MSG_EQ (received.IsValid(), true, "Header should deserialize.");
+  NS_TEST_ASSERT_MSG_EQ (received.IsQoS(), true, "QoS flag lost.");
+  NS_TEST_ASSERT_MSG_EQ (received.GetNRecords(), 4, "Wrong number of records.");
+  for (uint32_t i = 0; i < 4; i++) {
+    const QLrnFeedbackRecord& in = feedback.GetRecords()[i];
+    QoSQLrnHeader out = received.GetRecords()[i].ToQoSQLrnHeader();
+    NS_TEST_ASSERT_MSG_EQ (out.GetPktId(), in.packet_id, "Wrong uid in record " << i);
+    NS_TEST_ASSERT_MSG_EQ (out.GetTime(), in.time_as_int, "Wrong time in record " << i);
+    NS_TEST_ASSERT_MSG_EQ (out.GetNextEstim(), in.next_estim, "Wrong estim in record " << i);
+    NS_TEST_ASSERT_MSG_EQ (out.GetPDst(), in.packet_dst, "Wrong dst in record " << i);
+    NS_TEST_ASSERT_MSG_EQ (out.GetTrafficType(), in.traffic_type, "Wrong traffic type in record " << i);
+    NS_TEST_ASSERT_MSG_EQ (out.GetSenderConverged(), in.sender_converged, "Wrong converged bit in record " << i);
+    NS_TEST_ASSERT_MSG_EQ (out.GetRealDelay(), in.real_delay, "Wrong delay in record " << i);
+    NS_TEST_ASSERT_MSG_EQ (out.GetRealLoss(), in.real_loss, "Wrong loss in record " << i);
+    NS_TEST_ASSERT_MSG_EQ (out.GetNumPktsThatSenderReceivedFromMe(), in.num_pkts, "Wrong nr of pkts in record " << i);
+    NS_TEST_ASSERT_MSG_EQ (received.GetRecords()[i].made_at, in.made_at, "Wrong time made in record " << i);
+  }
+
+  Ptr<Packet> legacy = Create<Packet> ();
+  legacy->AddHeader(QLrnHeader(7, 0xB7, 0, false, Ipv4Address("10.1.1.8"), TRAFFIC_A));
+  NS_TEST_ASSERT_MSG_EQ (QLrnFeedbackHeader::IsFeedback(legacy, false), false, "A QLrnHeader starting with the magic byte is not feedback.");
+}
+
+void TrafficRateControlTestCase::DoRun (void) {
+  Ptr<UdpClient> udp = CreateObject<UdpClient> ();
+  udp->SetAttribute("Interval", TimeValue(Seconds(1)));
+  TrafficRateControl* control = GetTrafficRateControl(udp);
+  control->ScaleRate(2);
+  TimeValue interval;
+  udp->GetAttribute("Interval", interval);
+  NS_TEST_ASSERT_MSG_EQ (interval.Get(), MilliSeconds(500), "Twice the rate is half the interval.");
+  control->ReduceRate();
+  udp->GetAttribute("Interval", interval);
+  NS_TEST_ASSERT_MSG_EQ (interval.Get(), Seconds(5), "ReduceRate sends ten times less.");
+
+  Ptr<PPBPApplication> ppbp = CreateObject<PPBPApplication> ();
+  ppbp->SetAttribute("BurstIntensity", DataRateValue(DataRate("1Mb/s")));
+  control = GetTrafficRateControl(ppbp);
+  control->ScaleRate(1.5);
+  DataRateValue rate;
+  ppbp->GetAttribute("BurstIntensity", rate);
+  NS_TEST_ASSERT_MSG_EQ (rate.Get(), DataRate("1.5Mb/s"), "The burst intensity is scaled.");
+  control->IncreaseRate();
+  ppbp->GetAttribute("BurstIntensity", rate);
+  NS_TEST_ASSERT_MSG_EQ (rate.Get(), DataRate("15Mb/s"), "IncreaseRate sends ten times more.");
+
+  Ptr<OnOffApplication> onoff = CreateObject<OnOffApplication> ();
+  NS_TEST_ASSERT_MSG_EQ ((GetTrafficRateControl(onoff) != 0), true, "OnOffApplication is a TrafficRateControl.");
+}
+
+void RateStepTestCase::DoRun (void) {
+  ObjectFactory factory;
+  factory.SetTypeId("ns3::QLearner");
+  factory.Set("RateStepInterval", TimeValue(Seconds(1)));
+  factory.Set("RateStepHysteresis", UintegerValue(3));
+  Ptr<QLearner> qlearner = factory.Create<QLearner> ();
+  Ptr<UdpClient> udp = CreateObject<UdpClient> ();
+  udp->SetAttribute("Interval", TimeValue(Seconds(1)));
+  qlearner->SetLearningTrafficGen(udp);
+  // the same steps applied directly, to compare the interval of udp with
+  Ptr<UdpClient> expected = CreateObject<UdpClient> ();
+  expected->SetAttribute("Interval", TimeValue(Seconds(1)));
+  TimeValue interval, expected_interval;
+
+  qlearner->VoteLearningRate(+1);
+  qlearner->VoteLearningRate(+1);
+  udp->GetAttribute("Interval", interval);
+  NS_TEST_ASSERT_MSG_EQ (interval.Get(), Seconds(1), "Two votes stay under the hysteresis.");
+  qlearner->VoteLearningRate(+1);
+  GetTrafficRateControl(expected)->ScaleRate(1.5);
+  udp->GetAttribute("Interval", interval);
+  expected->GetAttribute("Interval", expected_interval);
+  NS_TEST_ASSERT_MSG_EQ (interval.Get(), expected_interval.Get(), "The third vote steps the rate up.");
+
+  Simulator::Stop(MilliSeconds(500));
+  Simulator::Run();
+  for (int i = 0; i < 4; i++) {
+    qlearner->VoteLearningRate(-1);
+  }
+  udp->GetAttribute("Interval", interval);
+  NS_TEST_ASSERT_MSG_EQ (interval.Get(), expected_interval.Get(), "No step within the interval, however many votes.");
+
+  Simulator::Stop(Seconds(1));
+  Simulator::Run();
+  qlearner->VoteLearningRate(-1);
+  GetTrafficRateControl(expected)->ScaleRate(0.5);
+  udp->GetAttribute("Interval", interval);
+  expected->GetAttribute("Interval", expected_interval);
+  NS_TEST_ASSERT_MSG_EQ (interval.Get(), expected_interval.Get(), "The votes within the interval were kept, the first one after it steps the rate down.");
+
+  Simulator::Stop(Seconds(2));
+  Simulator::Run();
+  qlearner->VoteLearningRate(+1);
+  qlearner->VoteLearningRate(+1);
+  udp->GetAttribute("Interval", interval);
+  NS_TEST_ASSERT_MSG_EQ (interval.Get(), expected_interval.Get(), "The votes start over after a step.");
+  qlearner->VoteLearningRate(+1);
+  GetTrafficRateControl(expected)->ScaleRate(1.5);
+  udp->GetAttribute("Interval", interval);
+  expected->GetAttribute("Interval", expected_interval);
+  NS_TEST_ASSERT_MSG_EQ (interval.Get(), expected_interval.Get(), "Three new votes step the rate up again.");
+  Simulator::Destroy();
+}
+
+void TrafficRequirementsTestCase::DoRun (void) {
+  const TrafficRequirements& a = GetTrafficRequirements(TRAFFIC_A);
+  NS_TEST_ASSERT_MSG_EQ (a.GetDelayMax(), 100 * 1000000, "The default delay of traffic A.");
+  NS_TEST_ASSERT_MSG_EQ (GetTrafficRequirements(VOIP).GetRandomLossMax(), float(0.05), "The default loss of voip.");
+  NS_TEST_ASSERT_MSG_EQ (g_traffic_requirements[UDP_ECHO].IsDefined(), false, "Udp echo has no requirements.");
+
+  // the coefficients ApplyMetricsToQValue used to work out with divisions
+  NS_TEST_ASSERT_MSG_EQ (a.DelayCoefficient(99 * 1000000), 1.0, "Within the delay requirement.");
+  NS_TEST_ASSERT_MSG_EQ (a.DelayCoefficient(250 * 1000000), 1 + 250 * 1000000 / a.GetDelayMax(), "Over the delay requirement, divided as QoSQLearner always did.");
+  NS_TEST_ASSERT_MSG_EQ (a.JitterCoefficient(10 * 1000000), 1.0, "Within the jitter requirement.");
+  NS_TEST_ASSERT_MSG_EQ (a.JitterCoefficient(75 * 1000000), 2 + 75 * 1000000 / a.GetJitterMax(), "Over the jitter requirement, divided as QoSQLearner always did.");
+  NS_TEST_ASSERT_MSG_EQ (a.LossCoefficient(0.0004), 1.0, "Within the loss requirement.");
+  NS_TEST_ASSERT_MSG_EQ (a.LossCoefficient(0.0008), 4, "Over the loss requirement.");
+  NS_TEST_ASSERT_MSG_EQ (a.LossCoefficient(0.002), 8, "Over twice the loss requirement.");
+  NS_TEST_ASSERT_MSG_EQ (a.LossCoefficient(0.01), 12.5, "Over ten times the loss requirement.");
+
+  ConfigureTrafficRequirements("trafficA=40:80:0.001/voip=100:150:0.1");
+  NS_TEST_ASSERT_MSG_EQ (GetTrafficRequirements(TRAFFIC_A).GetDelayMax(), 80 * 1000000, "Configured delay, in ns.");
+  NS_TEST_ASSERT_MSG_EQ (GetTrafficRequirements(TRAFFIC_A).GetJitterMax(), 40 * 1000000, "Configured jitter, in ns.");
+  NS_TEST_ASSERT_MSG_EQ (GetTrafficRequirements(TRAFFIC_A).LossCoefficient(0.0015), 4, "The thresholds follow the configured loss.");
+  NS_TEST_ASSERT_MSG_EQ (GetTrafficRequirements(VOIP).GetRandomLossMax(), float(0.1), "Configured loss.");
+  NS_TEST_ASSERT_MSG_EQ (GetTrafficRequirements(TRAFFIC_B).GetDelayMax(), 100 * 1000000, "Types that were not configured keep theirs.");
+  ResetTrafficRequirements();
+  NS_TEST_ASSERT_MSG_EQ (GetTrafficRequirements(TRAFFIC_A).GetDelayMax(), 100 * 1000000, "Back to the defaults.");
+}
+
+void QRoutingCountersTestCase::DoRun (void) {
+  LogHistogram histogram;
+  NS_TEST_ASSERT_MSG_EQ (histogram.GetPercentile(0.5), 0, "An empty histogram has no percentiles.");
+  NS_TEST_ASSERT_MSG_EQ (LogHistogram::BucketOf(0), 0, "Zeros have a bucket of their own.");
+  NS_TEST_ASSERT_MSG_EQ (LogHistogram::BucketOf(3), 2, "3 is in [2, 4).");
+  NS_TEST_ASSERT_MSG_EQ (LogHistogram::BucketOf(4), 3, "4 is in [4, 8).");
+  NS_TEST_ASSERT_MSG_EQ (LogHistogram::BucketUpperBound(LogHistogram::BucketOf(1000)), 1023, "1000 is in [512, 1024).");
+  for (uint64_t v : {0, 1, 3, 100, 1000}) {
+    histogram.Add(v);
+  }
+  NS_TEST_ASSERT_MSG_EQ (histogram.GetCount(), 5, "Five values were added.");
+  NS_TEST_ASSERT_MSG_EQ (histogram.GetMin(), 0, "The minimum is exact.");
+  NS_TEST_ASSERT_MSG_EQ_TOL (histogram.GetMean(), 220.8, 1e-9, "The mean is exact.");
+  NS_TEST_ASSERT_MSG_EQ (histogram.GetPercentile(0.4), 1, "The 2nd smallest value is in the bucket of 1.");
+  NS_TEST_ASSERT_MSG_EQ (histogram.GetPercentile(0.8), 127, "The 4th smallest value is in [64, 128).");
+  NS_TEST_ASSERT_MSG_EQ (histogram.GetPercentile(1), 1000, "Percentiles do not go past the maximum.");
+  LogHistogram more;
+  more.Add(5000);
+  histogram += more;
+  NS_TEST_ASSERT_MSG_EQ (histogram.GetCount(), 6, "Merged.");
+  NS_TEST_ASSERT_MSG_EQ (histogram.GetMax(), 5000, "Merged maximum.");
+
+  // the transitions are counted by the QTable they happen in
+  Ipv4Address me("10.1.1.1"), a("10.1.1.2"), b("10.1.1.3"), dst("10.1.1.9");
+  MultiClassQTable qtables({a, b}, me, 0.5, 0.05, 0.5, true, false, 1.0);
+  qtables.AddDestination(a, dst, MilliSeconds(5));
+  QTable& table = qtables.GetTable(TRAFFIC_A);
+  for (auto via : {a, b}) {
+    table.SetQValueWrapper(dst, via, MilliSeconds(10));
+    table.SetQValueWrapper(dst, via, MilliSeconds(10));
+    qtables.SetSenderConverged(dst, via, true);
+  }
+  NS_TEST_ASSERT_MSG_EQ (table.GetCounters().Get(QRC_CONVERGED), 1, "dst converged once both entries did.");
+  table.SetQValueWrapper(dst, b, MilliSeconds(40));
+  NS_TEST_ASSERT_MSG_EQ (table.GetCounters().Get(QRC_UNCONVERGED), 1, "b changed too much.");
+  for (int i = 0; i < MAX_NR_STRIKES_BLACKLISTED_NODE + 2; i++) {
+    table.AddStrike(dst, table.GetEntryByRef(dst, a));
+  }
+  NS_TEST_ASSERT_MSG_EQ (table.GetCounters().Get(QRC_BLACKLISTED), 1, "a was blacklisted once.");
+  for (int i = 0; i < MAX_NR_STRIKES_BLACKLISTED_NODE; i++) {
+    table.DeductStrike(dst, table.GetEntryByRef(dst, a));
+  }
+  NS_TEST_ASSERT_MSG_EQ (table.GetCounters().Get(QRC_UNBLACKLISTED), 1, "a lost all its strikes.");
+  NS_TEST_ASSERT_MSG_EQ (qtables.GetTable(TRAFFIC_C).GetCounters().Get(QRC_CONVERGED), 0, "Other classes count for themselves.");
+
+  // and the QLearner adds them to its own
+  Ptr<QLearner> learner = CreateObject<QLearner> (0.0, 0.5, 0.0);
+  learner->SetQTables(qtables);
+  QRoutingCounters counters = learner->GetCounters(MultiClassQTable::ClassOf(TRAFFIC_A));
+  NS_TEST_ASSERT_MSG_EQ (counters.Get(QRC_BLACKLISTED), 1, "The QTable's transitions are part of the counters.");
+  NS_TEST_ASSERT_MSG_EQ (counters.Get(QRC_DECISION_EXPLOIT), 0, "No routing decisions were made.");
+  std::stringstream ss;
+  WriteCounters(ss, 1.5, "10.1.1.1", "voip", counters);
+  NS_TEST_ASSERT_MSG_EQ ((ss.str().find("1.5,10.1.1.1,voip,blacklisted,1,,,,,\n") != std::string::npos), true, "One line per counter.");
+}
+
 class QLrnTestSuite : public TestSuite {
 public:
   QLrnTestSuite ();
@@ -229,6 +1025,21 @@ QLrnTestSuite::QLrnTestSuite ()
   Packet::EnablePrinting();
   std::cout << "CAREFUL : this will take some time." << std::endl;
   //Note : for these first three tests, there is always one packet dropped due to ARP cache being full
+  AddTestCase (new PacketTableEvictionTestCase, TestCase::QUICK);
+  AddTestCase (new SentPacketWindowTestCase, TestCase::QUICK);
+  AddTestCase (new MultiClassQTableTestCase, TestCase::QUICK);
+  AddTestCase (new QTableCountersTestCase, TestCase::QUICK);
+  AddTestCase (new QTableNeighbourSlotsTestCase, TestCase::QUICK);
+  AddTestCase (new QTableRandomEstimTestCase, TestCase::QUICK);
+  AddTestCase (new QTableSnapshotTestCase, TestCase::QUICK);
+  AddTestCase (new QTableRecorderTestCase, TestCase::QUICK);
+  AddTestCase (new QRoutingTagTestCase, TestCase::QUICK);
+  AddTestCase (new QLrnStatsSinkTestCase, TestCase::QUICK);
+  AddTestCase (new QLrnFeedbackHeaderTestCase, TestCase::QUICK);
+  AddTestCase (new TrafficRateControlTestCase, TestCase::QUICK);
+  AddTestCase (new RateStepTestCase, TestCase::QUICK);
+  AddTestCase (new TrafficRequirementsTestCase, TestCase::QUICK);
+  AddTestCase (new QRoutingCountersTestCase, TestCase::QUICK);
   AddTestCase (new QLearnerBasicShortTestCase, TestCase::QUICK);
   // AddTestCase (new QLearnerBasicMediumTestCase, TestCase::QUICK);
   // AddTestCase (new QLearnerBasicLongTestCase, TestCase::QUICK);
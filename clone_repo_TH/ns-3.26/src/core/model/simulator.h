@@ -184,6 +184,14 @@ public:
    */
   static uint32_t GetContext (void);
 
+  /**
+   * Get the number of events executed so far, e.g. to report the
+   * events per second of wall clock time of a simulation.
+   *
+   * \return The total number of events executed.
+   */
+  static uint64_t GetEventCount (void);
+
   /** Context enum values. */
   enum {
     /**
@@ -29,11 +29,27 @@
 #include "ns3/fatal-error.h"
 #include "ns3/log.h"
 #include <cstring>
+#include <new>
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("PacketTagList");
 
+struct PacketTagList::TagData *
+PacketTagList::CreateTagData (uint32_t dataSize)
+{
+  // data already holds one byte, and a tag that serializes to nothing still gets that one
+  uint32_t extra = dataSize > 1 ? dataSize - 1 : 0;
+  void * p = std::malloc (sizeof (struct TagData) + extra);
+  if (p == 0)
+    {
+      NS_FATAL_ERROR ("Out of memory allocating a packet tag of " << dataSize << " bytes");
+    }
+  struct TagData * data = new (p) struct TagData ();
+  data->size = dataSize > 1 ? dataSize : 1;
+  return data;
+}
+
 bool
 PacketTagList::COWTraverse (Tag & tag, PacketTagList::COWWriter Writer)
 {
@@ -133,10 +149,10 @@ PacketTagList::COWTraverse (Tag & tag, PacketTagList::COWWriter Writer)
       NS_ASSERT (cur != 0);
       NS_ASSERT (cur->count > 1);
       cur->count--;                       // unmerge cur
-      struct TagData * copy = new struct TagData ();
+      struct TagData * copy = CreateTagData (cur->size);
       copy->tid = cur->tid;
       copy->count = 1;
-      memcpy (copy->data, cur->data, TagData::MAX_SIZE);
+      memcpy (copy->data, cur->data, cur->size);
       copy->next = cur->next;             // merge into tail
       copy->next->count++;                // mark new merge
       *prevNext = copy;                   // point prior list at copy
@@ -171,13 +187,13 @@ PacketTagList::RemoveWriter (Tag & tag, bool preMerge,
   // found tid
   bool found = true;
   tag.Deserialize (TagBuffer (cur->data,
-                              cur->data + TagData::MAX_SIZE));
+                              cur->data + cur->size));
   *prevNext = cur->next;            // link around cur
 
   if (preMerge)
     {
       // found tid before first merge, so delete cur
-      delete cur;
+      FreeTagData (cur);
     }
   else
     {
@@ -214,18 +230,30 @@ PacketTagList::ReplaceWriter (Tag & tag, bool preMerge,
 
   // found tid
   bool found = true;
-  if (preMerge)
+  if (preMerge && tag.GetSerializedSize () <= cur->size)
     {
       // found tid before first merge, so just rewrite
       tag.Serialize (TagBuffer (cur->data,
                                 cur->data + tag.GetSerializedSize ()));
     }
+  else if (preMerge)
+    {
+      // found tid before first merge, but the new value does not fit
+      struct TagData * copy = CreateTagData (tag.GetSerializedSize ());
+      copy->tid = cur->tid;
+      copy->count = 1;
+      tag.Serialize (TagBuffer (copy->data,
+                                copy->data + tag.GetSerializedSize ()));
+      copy->next = cur->next;
+      *prevNext = copy;
+      FreeTagData (cur);
+    }
   else
     {
       // cur is always a merge at this point
       // need to copy, replace, and link past cur
       cur->count--;                     // unmerge cur
-      struct TagData * copy = new struct TagData ();
+      struct TagData * copy = CreateTagData (tag.GetSerializedSize ());
       copy->tid = tag.GetInstanceTypeId ();
       copy->count = 1;
       tag.Serialize (TagBuffer (copy->data,
@@ -249,12 +277,11 @@ PacketTagList::Add (const Tag &tag) const
     {
       NS_ASSERT_MSG (cur->tid != tag.GetInstanceTypeId (), "Error: cannot add the same kind of tag twice.");
     }
-  struct TagData * head = new struct TagData ();
+  struct TagData * head = CreateTagData (tag.GetSerializedSize ());
   head->count = 1;
   head->next = 0;
   head->tid = tag.GetInstanceTypeId ();
   head->next = m_next;
-  NS_ASSERT (tag.GetSerializedSize () <= TagData::MAX_SIZE);
   tag.Serialize (TagBuffer (head->data, head->data + tag.GetSerializedSize ()));
 
   const_cast<PacketTagList *> (this)->m_next = head;
@@ -270,7 +297,7 @@ PacketTagList::Peek (Tag &tag) const
       if (cur->tid == tid) 
         {
           /* found tag */
-          tag.Deserialize (TagBuffer (cur->data, cur->data + TagData::MAX_SIZE));
+          tag.Deserialize (TagBuffer (cur->data, cur->data + cur->size));
           return true;
         }
     }
@@ -26,6 +26,7 @@
 */
 
 #include <stdint.h>
+#include <cstdlib>
 #include <ostream>
 #include "ns3/type-id.h"
 
@@ -122,7 +123,8 @@ class Tag;
  *
  * \par <b> Memory Management: </b>
  * \n
- * Packet tags must serialize to a finite maximum size, see TagData
+ * Each TagData is allocated with exactly the room its tag serializes to,
+ * see CreateTagData.
  *
  * This documentation entitles the original author to a free beer.
  */
@@ -134,39 +136,19 @@ public:
    *
    * See PacketTagList for a discussion of the data structure.
    *
-   * See TagData::TagData_e for a discussion of the size limit on
-   * tag serialization.
+   * \internal
+   * #data is the last member and is allocated past its declared size by
+   * CreateTagData, so a TagData must never be created with new or copied
+   * by value. (https://www.nsnam.org/bugzilla/show_bug.cgi?id=2221, the
+   * fixed 21 byte buffer this replaces was too small for some tags.)
    */
   struct TagData
   {
-    /**
-     * \brief Packet Tag maximum size
-     *
-     * The maximum size (in bytes) of a Tag is stored
-     * in this constant.
-     *
-     * \internal
-     * Ideally, TagData would be 32 bytes in size, so they require
-     * no padding on 64-bit architectures.  (The architecture
-     * affects the size because of the \c #next pointer.)
-     * This would leave 18 bytes for \c #data.  However,
-     * ns3:Ipv6PacketInfoTag needs 19 bytes!  The current
-     * implementation allows 20 bytes, which gives TagData
-     * a size of 30 bytes on 32-byte machines (which gets
-     * padded with 2 bytes), and 34 bytes on 64-bit machines, which
-     * gets padded to 40 bytes.
-     */
-    enum TagData_e
-    {
-      // https://www.nsnam.org/bugzilla/show_bug.cgi?id=2221 Changed to 28 because thats how much I need
-      // but seems problematic as it requires a rebuild of (almost) the entire ns3 thing..
-      MAX_SIZE = 21           /**< Size of serialization buffer #data */
-  };
-
-    uint8_t data[MAX_SIZE];   /**< Serialization buffer */
     struct TagData * next;   /**< Pointer to next in list */
     TypeId tid;               /**< Type of the tag serialized into #data */
     uint32_t count;           /**< Number of incoming links */
+    uint32_t size;            /**< Size of the serialization buffer #data */
+    uint8_t data[1];          /**< Serialization buffer, really #size bytes */
   };  /* struct TagData */
 
   /**
@@ -241,6 +223,20 @@ public:
   const struct PacketTagList::TagData *Head (void) const;
 
 private:
+  /**
+   * Allocate a TagData with room for \pname{dataSize} bytes of serialized tag.
+   *
+   * \param [in] dataSize The size of the serialization buffer.
+   * \returns The new TagData, to be released with FreeTagData.
+   */
+  static struct TagData * CreateTagData (uint32_t dataSize);
+  /**
+   * Release a TagData made by CreateTagData.
+   *
+   * \param [in] data The TagData to release.
+   */
+  inline static void FreeTagData (struct TagData * data);
+
   /**
    * Typedef of method function pointer for copy-on-write operations
    *
@@ -352,17 +348,24 @@ PacketTagList::RemoveAll (void)
         }
       if (prev != 0)
         {
-	  delete prev;
+	  FreeTagData (prev);
         }
       prev = cur;
     }
   if (prev != 0)
     {
-      delete prev;
+      FreeTagData (prev);
     }
   m_next = 0;
 }
 
+void
+PacketTagList::FreeTagData (struct TagData * data)
+{
+  data->~TagData ();
+  std::free (data);
+}
+
 } // namespace ns3
 
 #endif /* PACKET_TAG_LIST_H */
@@ -114,7 +114,7 @@ PacketTagIterator::Item::GetTag (Tag &tag) const
   NS_ASSERT (tag.GetInstanceTypeId () == m_data->tid);
   tag.Deserialize (TagBuffer ((uint8_t*)m_data->data,
                               (uint8_t*)m_data->data
-                              + PacketTagList::TagData::MAX_SIZE));
+                              + m_data->size));
 }
 
 
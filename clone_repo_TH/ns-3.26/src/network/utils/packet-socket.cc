@@ -642,17 +642,14 @@ DeviceNameTag::GetInstanceTypeId (void) const
 uint32_t
 DeviceNameTag::GetSerializedSize (void) const
 {
-  uint32_t s = 1 + m_deviceName.size();  // +1 for name length field
-  s = std::min (s, (uint32_t)PacketTagList::TagData::MAX_SIZE);
-  return s;
+  uint8_t l = (uint8_t) std::min (m_deviceName.size (), (size_t) 255);
+  return 1 + l;  // +1 for name length field
 }
 void
 DeviceNameTag::Serialize (TagBuffer i) const
 {
   const char *n = m_deviceName.c_str();
-  uint8_t l = (uint8_t) m_deviceName.size ();
-
-  l = std::min ((uint32_t)l, (uint32_t)PacketTagList::TagData::MAX_SIZE - 1);
+  uint8_t l = (uint8_t) std::min (m_deviceName.size (), (size_t) 255);
 
   i.WriteU8 (l);
   i.Write ( (uint8_t*) n , (uint32_t) l);
@@ -19,9 +19,15 @@
  */
 
 #include "error-rate-model.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include <algorithm>
+#include <cmath>
 
 namespace ns3 {
 
+NS_LOG_COMPONENT_DEFINE ("ErrorRateModel");
+
 NS_OBJECT_ENSURE_REGISTERED (ErrorRateModel);
 
 TypeId ErrorRateModel::GetTypeId (void)
@@ -29,10 +35,33 @@ TypeId ErrorRateModel::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::ErrorRateModel")
     .SetParent<Object> ()
     .SetGroupName ("Wifi")
+    .AddAttribute ("TableResolution", "Step (dB) of the SNR tables the chunk success rates are interpolated from, "
+                   "0 evaluates the model for every chunk.",
+                   DoubleValue (0),
+                   MakeDoubleAccessor (&ErrorRateModel::m_tableResolutionDb),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("TableMinSnr", "Lowest SNR (dB) in the tables, lower SNRs are evaluated exactly.",
+                   DoubleValue (-20),
+                   MakeDoubleAccessor (&ErrorRateModel::m_tableMinSnrDb),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("TableMaxSnr", "Highest SNR (dB) in the tables, higher SNRs are evaluated exactly.",
+                   DoubleValue (50),
+                   MakeDoubleAccessor (&ErrorRateModel::m_tableMaxSnrDb),
+                   MakeDoubleChecker<double> ())
   ;
   return tid;
 }
 
+ErrorRateModel::ErrorRateModel ()
+  : m_tableResolutionDb (0),
+    m_tableMinSnrDb (-20),
+    m_tableMaxSnrDb (50),
+    m_tablesResolutionDb (0),
+    m_tablesMinSnrDb (0),
+    m_tablesMaxSnrDb (0)
+{
+}
+
 double
 ErrorRateModel::CalculateSnr (WifiTxVector txVector, double ber) const
 {
@@ -57,4 +86,75 @@ ErrorRateModel::CalculateSnr (WifiTxVector txVector, double ber) const
   return low;
 }
 
+const std::vector<double> &
+ErrorRateModel::GetTable (WifiMode mode, WifiTxVector txVector) const
+{
+  if (m_tablesResolutionDb != m_tableResolutionDb || m_tablesMinSnrDb != m_tableMinSnrDb || m_tablesMaxSnrDb != m_tableMaxSnrDb)
+    {
+      m_tables.clear ();
+      m_tablesResolutionDb = m_tableResolutionDb;
+      m_tablesMinSnrDb = m_tableMinSnrDb;
+      m_tablesMaxSnrDb = m_tableMaxSnrDb;
+    }
+  //everything in the TXVECTOR the phy rate of the mode depends on
+  uint64_t key = (uint64_t (mode.GetUid ()) << 32) | (uint64_t (txVector.GetChannelWidth ()) << 16)
+    | (uint64_t (txVector.IsShortGuardInterval ()) << 8) | txVector.GetNss ();
+  std::map<uint64_t, std::vector<double> >::iterator table = m_tables.find (key);
+  if (table == m_tables.end ())
+    {
+      NS_ASSERT_MSG (m_tableMaxSnrDb > m_tableMinSnrDb, "The tables of an ErrorRateModel need a TableMaxSnr above TableMinSnr");
+      uint32_t size = std::ceil ((m_tableMaxSnrDb - m_tableMinSnrDb) / m_tableResolutionDb) + 1;
+      table = m_tables.insert (std::make_pair (key, std::vector<double> (size))).first;
+      for (uint32_t i = 0; i < size; i++)
+        {
+          double snr = std::pow (10.0, (m_tableMinSnrDb + i * m_tableResolutionDb) / 10.0);
+          table->second[i] = GetChunkSuccessRate (mode, txVector, snr, 1);
+        }
+      NS_LOG_DEBUG ("table of " << size << " SNRs for " << mode << " at " << txVector.GetChannelWidth () << "MHz");
+    }
+  return table->second;
+}
+
+double
+ErrorRateModel::CalculateChunkSuccessRate (WifiMode mode, WifiTxVector txVector, double snr, uint32_t nbits) const
+{
+  double rate;
+  CalculateChunkSuccessRates (mode, txVector, &snr, &nbits, &rate, 1);
+  return rate;
+}
+
+void
+ErrorRateModel::CalculateChunkSuccessRates (WifiMode mode, WifiTxVector txVector, const double *snrs, const uint32_t *nbits, double *rates, uint32_t n) const
+{
+  if (m_tableResolutionDb == 0)
+    {
+      for (uint32_t i = 0; i < n; i++)
+        {
+          rates[i] = GetChunkSuccessRate (mode, txVector, snrs[i], nbits[i]);
+        }
+      return;
+    }
+  const std::vector<double> &table = GetTable (mode, txVector);
+  const double *bitRates = &table[0];
+  double last = table.size () - 1;
+  //no branches in here, SNRs outside the table are clamped to it and evaluated again below
+  for (uint32_t i = 0; i < n; i++)
+    {
+      double position = (10 * std::log10 (snrs[i]) - m_tableMinSnrDb) / m_tableResolutionDb;
+      position = std::min (std::max (position, 0.0), last);
+      uint32_t below = std::min (double (uint32_t (position)), last - 1);
+      double fraction = position - below;
+      rates[i] = std::pow ((1 - fraction) * bitRates[below] + fraction * bitRates[below + 1], static_cast<double> (nbits[i]));
+    }
+  double minSnr = std::pow (10.0, m_tableMinSnrDb / 10.0);
+  double maxSnr = std::pow (10.0, m_tableMaxSnrDb / 10.0);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      if (!(snrs[i] >= minSnr && snrs[i] <= maxSnr))
+        {
+          rates[i] = GetChunkSuccessRate (mode, txVector, snrs[i], nbits[i]);
+        }
+    }
+}
+
 } //namespace ns3
@@ -22,6 +22,8 @@
 #define ERROR_RATE_MODEL_H
 
 #include <stdint.h>
+#include <map>
+#include <vector>
 #include "wifi-mode.h"
 #include "wifi-tx-vector.h"
 #include "ns3/object.h"
@@ -31,12 +33,20 @@ namespace ns3 {
  * \ingroup wifi
  * \brief the interface for Wifi's error models
  *
+ * The chunk success rate of every model is the success rate of a single
+ * bit to the power of the number of bits. With a TableResolution set, the
+ * success rate of a single bit is tabulated per mode over the SNR (in dB) at
+ * first use, and CalculateChunkSuccessRate(s) interpolate in that table
+ * instead of evaluating the model. SNRs outside the table are still
+ * evaluated exactly.
  */
 class ErrorRateModel : public Object
 {
 public:
   static TypeId GetTypeId (void);
 
+  ErrorRateModel ();
+
   /**
    * \param txVector a specific transmission vector including WifiMode
    * \param ber a target ber
@@ -69,6 +79,52 @@ public:
    * \return probability of successfully receiving the chunk
    */
   virtual double GetChunkSuccessRate (WifiMode mode, WifiTxVector txVector, double snr, uint32_t nbits) const = 0;
+
+  /**
+   * The same as GetChunkSuccessRate, interpolated from the table of the
+   * mode if TableResolution is set.
+   *
+   * \param mode the Wi-Fi mode applicable to this chunk
+   * \param txVector TXVECTOR of the overall transmission
+   * \param snr the SNR of the chunk
+   * \param nbits the number of bits in this chunk
+   *
+   * \return probability of successfully receiving the chunk
+   */
+  double CalculateChunkSuccessRate (WifiMode mode, WifiTxVector txVector, double snr, uint32_t nbits) const;
+  /**
+   * CalculateChunkSuccessRate for n chunks sent with the same mode, which
+   * looks up the table once and interpolates in a loop the compiler can
+   * vectorise.
+   *
+   * \param mode the Wi-Fi mode applicable to the chunks
+   * \param txVector TXVECTOR of the overall transmission
+   * \param snrs the SNRs of the chunks
+   * \param nbits the number of bits in each chunk
+   * \param rates filled with the probability of successfully receiving each chunk
+   * \param n the number of chunks
+   */
+  void CalculateChunkSuccessRates (WifiMode mode, WifiTxVector txVector, const double *snrs, const uint32_t *nbits, double *rates, uint32_t n) const;
+
+
+private:
+  /**
+   * \param mode a Wi-Fi mode
+   * \param txVector the TXVECTOR it is sent with
+   *
+   * \return the table of the success rate of a bit, from
+   * m_tableMinSnrDb up in steps of m_tableResolutionDb
+   */
+  const std::vector<double> & GetTable (WifiMode mode, WifiTxVector txVector) const;
+
+  double m_tableResolutionDb;  //!< Step of the SNR tables (dB), 0 = no tables
+  double m_tableMinSnrDb;      //!< Lowest SNR in the tables (dB)
+  double m_tableMaxSnrDb;      //!< Highest SNR in the tables (dB)
+
+  mutable std::map<uint64_t, std::vector<double> > m_tables;  //!< The tables per mode, channel width, guard interval and NSS
+  mutable double m_tablesResolutionDb;  //!< The resolution the tables in m_tables were made for
+  mutable double m_tablesMinSnrDb;      //!< The lowest SNR the tables in m_tables were made for
+  mutable double m_tablesMaxSnrDb;      //!< The highest SNR the tables in m_tables were made for
 };
 
 } //namespace ns3
@@ -199,13 +199,18 @@ Time
 InterferenceHelper::GetEnergyDuration (double energyW)
 {
   Time now = Simulator::Now ();
+  if (!m_rxing)
+    {
+      //no reception needs the changes before now any more
+      EraseNiChanges (m_niChanges.lower_bound (now));
+    }
   double noiseInterferenceW = 0.0;
   Time end = now;
   noiseInterferenceW = m_firstPower;
-  for (NiChanges::const_iterator i = m_niChanges.begin (); i != m_niChanges.end (); i++)
+  for (NiChangeTimeline::const_iterator i = m_niChanges.begin (); i != m_niChanges.end (); i++)
     {
-      noiseInterferenceW += i->GetDelta ();
-      end = i->GetTime ();
+      noiseInterferenceW += i->second;
+      end = i->first;
       if (end < now)
         {
           continue;
@@ -224,18 +229,10 @@ InterferenceHelper::AppendEvent (Ptr<InterferenceHelper::Event> event)
   Time now = Simulator::Now ();
   if (!m_rxing)
     {
-      NiChanges::iterator nowIterator = GetPosition (now);
-      for (NiChanges::iterator i = m_niChanges.begin (); i != nowIterator; i++)
-        {
-          m_firstPower += i->GetDelta ();
-        }
-      m_niChanges.erase (m_niChanges.begin (), nowIterator);
-      m_niChanges.insert (m_niChanges.begin (), NiChange (event->GetStartTime (), event->GetRxPowerW ()));
-    }
-  else
-    {
-      AddNiChangeEvent (NiChange (event->GetStartTime (), event->GetRxPowerW ()));
+      //the start of the event becomes the first change, the start of a reception if it is received
+      EraseNiChanges (GetPosition (now));
     }
+  AddNiChangeEvent (NiChange (event->GetStartTime (), event->GetRxPowerW ()));
   AddNiChangeEvent (NiChange (event->GetEndTime (), -event->GetRxPowerW ()));
 
 }
@@ -261,13 +258,14 @@ InterferenceHelper::CalculateNoiseInterferenceW (Ptr<InterferenceHelper::Event>
 {
   double noiseInterference = m_firstPower;
   NS_ASSERT (m_rxing);
-  for (NiChanges::const_iterator i = m_niChanges.begin () + 1; i != m_niChanges.end (); i++)
+  //the first change is the start of the reception, walk from there to its end
+  for (NiChangeTimeline::const_iterator i = ++m_niChanges.begin (); i != m_niChanges.end (); i++)
     {
-      if ((event->GetEndTime () == i->GetTime ()) && event->GetRxPowerW () == -i->GetDelta ())
+      if ((event->GetEndTime () == i->first) && event->GetRxPowerW () == -i->second)
         {
           break;
         }
-      ni->push_back (*i);
+      ni->push_back (NiChange (i->first, i->second));
     }
   ni->insert (ni->begin (), NiChange (event->GetStartTime (), noiseInterference));
   ni->push_back (NiChange (event->GetEndTime (), 0));
@@ -283,7 +281,7 @@ InterferenceHelper::CalculateChunkSuccessRate (double snir, Time duration, WifiM
     }
   uint32_t rate = mode.GetPhyRate (txVector);
   uint64_t nbits = (uint64_t)(rate * duration.GetSeconds ());
-  double csr = m_errorRateModel->GetChunkSuccessRate (mode, txVector, snir, (uint32_t)nbits);
+  double csr = m_errorRateModel->CalculateChunkSuccessRate (mode, txVector, snir, (uint32_t)nbits);
   return csr;
 }
 
@@ -302,38 +300,53 @@ InterferenceHelper::CalculatePlcpPayloadPer (Ptr<const InterferenceHelper::Event
   Time plcpPayloadStart = plcpHtTrainingSymbolsStart + WifiPhy::GetPlcpHtTrainingSymbolDuration (preamble, event->GetTxVector ()) + WifiPhy::GetPlcpVhtSigBDuration (preamble); //packet start time + preamble + L-SIG + HT-SIG or VHT-SIG-A (A1 + A2) + (V)HT Training + VHT-SIG-B
   double noiseInterferenceW = (*j).GetDelta ();
   double powerW = event->GetRxPowerW ();
+  uint32_t rate = payloadMode.GetPhyRate (event->GetTxVector ());
+  //the chunks all have the payload mode, collect them and let the error rate model evaluate them at once
+  m_chunkSnrs.clear ();
+  m_chunkBits.clear ();
   j++;
   while (ni->end () != j)
     {
       Time current = (*j).GetTime ();
       NS_LOG_DEBUG ("previous= " << previous << ", current=" << current);
       NS_ASSERT (current >= previous);
+      Time chunk = Seconds (0);
       //Case 1: Both previous and current point to the payload
       if (previous >= plcpPayloadStart)
         {
-          psr *= CalculateChunkSuccessRate (CalculateSnr (powerW,
-                                                          noiseInterferenceW,
-                                                          event->GetTxVector ().GetChannelWidth ()),
-                                            current - previous,
-                                            payloadMode, event->GetTxVector ());
-
-          NS_LOG_DEBUG ("Both previous and current point to the payload: mode=" << payloadMode << ", psr=" << psr);
+          chunk = current - previous;
+          NS_LOG_DEBUG ("Both previous and current point to the payload: mode=" << payloadMode << ", chunk=" << chunk);
         }
       //Case 2: previous is before payload and current is in the payload
       else if (current >= plcpPayloadStart)
         {
-          psr *= CalculateChunkSuccessRate (CalculateSnr (powerW,
-                                                          noiseInterferenceW,
-                                                          event->GetTxVector ().GetChannelWidth ()),
-                                            current - plcpPayloadStart,
-                                            payloadMode, event->GetTxVector ());
-          NS_LOG_DEBUG ("previous is before payload and current is in the payload: mode=" << payloadMode << ", psr=" << psr);
+          chunk = current - plcpPayloadStart;
+          NS_LOG_DEBUG ("previous is before payload and current is in the payload: mode=" << payloadMode << ", chunk=" << chunk);
+        }
+      //an empty chunk always succeeds
+      if (chunk != NanoSeconds (0))
+        {
+          m_chunkSnrs.push_back (CalculateSnr (powerW,
+                                               noiseInterferenceW,
+                                               event->GetTxVector ().GetChannelWidth ()));
+          m_chunkBits.push_back ((uint32_t)(uint64_t)(rate * chunk.GetSeconds ()));
         }
 
       noiseInterferenceW += (*j).GetDelta ();
       previous = (*j).GetTime ();
       j++;
     }
+  m_chunkRates.resize (m_chunkSnrs.size ());
+  if (!m_chunkSnrs.empty ())
+    {
+      m_errorRateModel->CalculateChunkSuccessRates (payloadMode, event->GetTxVector (), &m_chunkSnrs[0], &m_chunkBits[0],
+                                                    &m_chunkRates[0], m_chunkSnrs.size ());
+    }
+  for (uint32_t i = 0; i < m_chunkRates.size (); i++)
+    {
+      psr *= m_chunkRates[i];
+    }
+  NS_LOG_DEBUG ("payload: mode=" << payloadMode << ", chunks=" << m_chunkRates.size () << ", psr=" << psr);
 
   double per = 1 - psr;
   return per;
@@ -841,16 +854,27 @@ InterferenceHelper::EraseEvents (void)
   m_firstPower = 0.0;
 }
 
-InterferenceHelper::NiChanges::iterator
+InterferenceHelper::NiChangeTimeline::iterator
 InterferenceHelper::GetPosition (Time moment)
 {
-  return std::upper_bound (m_niChanges.begin (), m_niChanges.end (), NiChange (moment, 0));
+  return m_niChanges.upper_bound (moment);
+}
+
+void
+InterferenceHelper::EraseNiChanges (NiChangeTimeline::iterator end)
+{
+  for (NiChangeTimeline::const_iterator i = m_niChanges.begin (); i != end; i++)
+    {
+      m_firstPower += i->second;
+    }
+  m_niChanges.erase (m_niChanges.begin (), end);
 }
 
 void
 InterferenceHelper::AddNiChangeEvent (NiChange change)
 {
-  m_niChanges.insert (GetPosition (change.GetTime ()), change);
+  //after the changes at the same time
+  m_niChanges.insert (std::make_pair (change.GetTime (), change.GetDelta ()));
 }
 
 void
@@ -24,6 +24,7 @@
 #include <stdint.h>
 #include <vector>
 #include <list>
+#include <map>
 #include "wifi-mode.h"
 #include "wifi-preamble.h"
 #include "wifi-phy-standard.h"
@@ -264,6 +265,11 @@ private:
    * typedef for a vector of NiChanges
    */
   typedef std::vector <NiChange> NiChanges;
+  /**
+   * typedef for the changes in noise and interference power (W) by time.
+   * Changes at the same time stay in the order they were added.
+   */
+  typedef std::multimap<Time, double> NiChangeTimeline;
   /**
    * typedef for a list of Events
    */
@@ -331,11 +337,20 @@ private:
   double m_noiseFigure; /**< noise figure (linear) */
   Ptr<ErrorRateModel> m_errorRateModel;
   /// Experimental: needed for energy duration calculation
-  NiChanges m_niChanges;
-  double m_firstPower;
+  NiChangeTimeline m_niChanges;
+  mutable std::vector<double> m_chunkSnrs;    //!< The SNRs of the payload chunks CalculatePlcpPayloadPer evaluates at once
+  mutable std::vector<uint32_t> m_chunkBits;  //!< The number of bits in those chunks
+  mutable std::vector<double> m_chunkRates;   //!< The success rates of those chunks
+  double m_firstPower;  ///< The noise and interference power before the first change in m_niChanges
   bool m_rxing;
   /// Returns an iterator to the first nichange, which is later than moment
-  NiChanges::iterator GetPosition (Time moment);
+  NiChangeTimeline::iterator GetPosition (Time moment);
+  /**
+   * Folds the changes up to the given iterator into m_firstPower and erases them.
+   *
+   * \param end the first change to keep
+   */
+  void EraseNiChanges (NiChangeTimeline::iterator end);
   /**
    * Add NiChange to the list at the appropriate position.
    *
@@ -40,6 +40,13 @@ WifiMacQueue::Item::Item (Ptr<const Packet> packet,
 {
 }
 
+WifiMacQueue::Slot::Slot ()
+  : item (0, WifiMacHeader (), Seconds (0)),
+    id (0),
+    live (false)
+{
+}
+
 TypeId
 WifiMacQueue::GetTypeId (void)
 {
@@ -75,7 +82,14 @@ WifiMacQueue::GetTypeId (void)
 }
 
 WifiMacQueue::WifiMacQueue ()
-  : m_size (0)
+  : m_head (0),
+    m_frontEnd (0),
+    m_backBegin (0),
+    m_tail (0),
+    m_nextId (1),
+    m_peeked (0),
+    m_peekedId (0),
+    m_size (0)
 {
 }
 
@@ -120,57 +134,204 @@ WifiMacQueue::Enqueue (Ptr<const Packet> packet, const WifiMacHeader &hdr)
         }
       else if (m_dropPolicy == DROP_OLDEST)
         {
-          m_queue.pop_front ();
-          m_size--;
+          Erase (m_head);
         }
     }
-  Time now = Simulator::Now ();
-  m_queue.push_back (Item (packet, hdr, now));
-  m_size++;
+  Insert (packet, hdr, false);
 
-  PortNrTag pnt; packet->PeekPacketTag(pnt);
+  PortNrTag pnt; QRoutingTag::Get(packet).Peek(pnt);
   m_enqueueTrace(packet->GetUid(), pnt.GetLearningPkt() );
 }
 
+WifiMacQueue::Slot &
+WifiMacQueue::At (int64_t pos)
+{
+  return m_slots[static_cast<uint64_t> (pos) & (m_slots.size () - 1)];
+}
+
+int64_t
+WifiMacQueue::Next (int64_t pos)
+{
+  do
+    {
+      pos++;
+    }
+  while (pos < m_tail && !At (pos).live);
+  return pos;
+}
+
+bool
+WifiMacQueue::IsExpired (const Item &item) const
+{
+  return item.tstamp + m_maxDelay <= Simulator::Now ();
+}
+
 void
-WifiMacQueue::Cleanup (void)
+WifiMacQueue::Insert (Ptr<const Packet> packet, const WifiMacHeader &hdr, bool front)
 {
-  if (m_queue.empty ())
+  if (m_tail - m_head + 1 > static_cast<int64_t> (m_slots.size ()))
     {
-      return;
+      uint32_t capacity = 16;
+      while (capacity < 2 * (m_size + 1))
+        {
+          capacity *= 2;
+        }
+      Compact (capacity);
+    }
+  int64_t pos = front ? --m_head : m_tail++;
+  Slot &slot = At (pos);
+  slot.item = Item (packet, hdr, Simulator::Now ());
+  slot.id = m_nextId++;
+  slot.live = true;
+  m_size++;
+  if (hdr.IsQosData ())
+    {
+      TidAndAddressEntries &entries = m_index[std::make_pair (hdr.GetAddr1 (), hdr.GetQosTid ())];
+      if (front)
+        {
+          entries.positions.push_front (std::make_pair (pos, slot.id));
+        }
+      else
+        {
+          entries.positions.push_back (std::make_pair (pos, slot.id));
+        }
+      entries.n++;
     }
+}
 
-  Time now = Simulator::Now ();
-  uint32_t n = 0;
-  for (PacketQueueI i = m_queue.begin (); i != m_queue.end (); )
+void
+WifiMacQueue::Erase (int64_t pos)
+{
+  Slot &slot = At (pos);
+  NS_ASSERT (slot.live);
+  slot.item.packet = 0;
+  slot.live = false;
+  m_size--;
+  if (slot.item.hdr.IsQosData ())
     {
-      if (i->tstamp + m_maxDelay > now)
+      TidAndAddressIndex::iterator it = m_index.find (std::make_pair (slot.item.hdr.GetAddr1 (), slot.item.hdr.GetQosTid ()));
+      NS_ASSERT (it != m_index.end () && it->second.n > 0);
+      if (--it->second.n == 0)
         {
-          i++;
+          m_index.erase (it);
         }
       else
         {
-          i = m_queue.erase (i);
-          n++;
+          // packets mostly leave at either end, the positions of the ones taken from the middle
+          // are dropped once there are more than twice as many positions as packets
+          std::deque<std::pair<int64_t, uint64_t> > &positions = it->second.positions;
+          std::pair<int64_t, uint64_t> entry = std::make_pair (pos, slot.id);
+          if (positions.front () == entry)
+            {
+              positions.pop_front ();
+            }
+          else if (positions.back () == entry)
+            {
+              positions.pop_back ();
+            }
+          if (positions.size () > 2 * it->second.n)
+            {
+              std::deque<std::pair<int64_t, uint64_t> > live;
+              for (std::deque<std::pair<int64_t, uint64_t> >::const_iterator i = positions.begin (); i != positions.end (); i++)
+                {
+                  if (At (i->first).live && At (i->first).id == i->second)
+                    {
+                      live.push_back (*i);
+                    }
+                }
+              positions.swap (live);
+            }
         }
     }
-  m_size -= n;
+
+  // keep the first and last packet of both parts live, and the parts next to each other when one is empty
+  while (m_head < m_frontEnd && !At (m_head).live)
+    {
+      m_head++;
+    }
+  while (m_frontEnd > m_head && !At (m_frontEnd - 1).live)
+    {
+      m_frontEnd--;
+    }
+  while (m_backBegin < m_tail && !At (m_backBegin).live)
+    {
+      m_backBegin++;
+    }
+  while (m_tail > m_backBegin && !At (m_tail - 1).live)
+    {
+      m_tail--;
+    }
+  if (m_head == m_frontEnd)
+    {
+      m_head = m_frontEnd = m_backBegin;
+    }
+  if (m_backBegin == m_tail)
+    {
+      m_backBegin = m_tail = m_frontEnd;
+    }
+}
+
+void
+WifiMacQueue::Compact (uint32_t capacity)
+{
+  std::vector<Slot> slots (capacity);
+  int64_t frontEnd = 0;
+  int64_t n = 0;
+  m_index.clear ();
+  for (int64_t pos = m_head; pos < m_tail; pos = Next (pos))
+    {
+      if (pos == m_backBegin)
+        {
+          frontEnd = n;
+        }
+      Slot &slot = slots[n];
+      std::swap (slot, At (pos));
+      if (slot.item.hdr.IsQosData ())
+        {
+          TidAndAddressEntries &entries = m_index[std::make_pair (slot.item.hdr.GetAddr1 (), slot.item.hdr.GetQosTid ())];
+          entries.positions.push_back (std::make_pair (n, slot.id));
+          entries.n++;
+        }
+      n++;
+    }
+  if (m_backBegin == m_tail)
+    {
+      frontEnd = n;
+    }
+  m_slots.swap (slots);
+  m_head = 0;
+  m_frontEnd = m_backBegin = frontEnd;
+  m_tail = n;
+}
+
+void
+WifiMacQueue::Cleanup (void)
+{
+  // The packets put at the front are newest first and the packets put at the back oldest first,
+  // so the expired ones are at the end of the first and the start of the second.
+  while (m_frontEnd > m_head && IsExpired (At (m_frontEnd - 1).item))
+    {
+      Erase (m_frontEnd - 1);
+    }
+  while (m_backBegin < m_tail && IsExpired (At (m_backBegin).item))
+    {
+      Erase (m_backBegin);
+    }
 }
 
 Ptr<const Packet>
 WifiMacQueue::Dequeue (WifiMacHeader *hdr)
 {
   Cleanup ();
-  if (!m_queue.empty ())
+  if (m_size > 0)
     {
-      Item i = m_queue.front ();
-      m_queue.pop_front ();
-      m_size--;
-      *hdr = i.hdr;
-
-      PortNrTag pnt; i.packet->PeekPacketTag(pnt);
-      m_dequeueTrace(i.packet->GetUid(), pnt.GetLearningPkt());
-      return i.packet;
+      Ptr<const Packet> packet = At (m_head).item.packet;
+      *hdr = At (m_head).item.hdr;
+      Erase (m_head);
+
+      PortNrTag pnt; QRoutingTag::Get(packet).Peek(pnt);
+      m_dequeueTrace(packet->GetUid(), pnt.GetLearningPkt());
+      return packet;
     }
   return 0;
 }
@@ -179,40 +340,63 @@ Ptr<const Packet>
 WifiMacQueue::Peek (WifiMacHeader *hdr)
 {
   Cleanup ();
-  if (!m_queue.empty ())
+  if (m_size > 0)
     {
-      Item i = m_queue.front ();
-      *hdr = i.hdr;
-      return i.packet;
+      *hdr = At (m_head).item.hdr;
+      return At (m_head).item.packet;
     }
   return 0;
 }
 
-Ptr<const Packet>
-WifiMacQueue::DequeueByTidAndAddress (WifiMacHeader *hdr, uint8_t tid,
-                                      WifiMacHeader::AddressType type, Mac48Address dest)
+int64_t
+WifiMacQueue::FindByTidAndAddress (uint8_t tid, WifiMacHeader::AddressType type, Mac48Address addr)
 {
-  Cleanup ();
-  Ptr<const Packet> packet = 0;
-  if (!m_queue.empty ())
+  if (type != WifiMacHeader::ADDR1)
     {
-      PacketQueueI it;
-      for (it = m_queue.begin (); it != m_queue.end (); ++it)
+      for (int64_t pos = m_head; pos < m_tail; pos = Next (pos))
         {
-          if (it->hdr.IsQosData ())
+          const Item &item = At (pos).item;
+          if (item.hdr.IsQosData ()
+              && GetAddressForPacket (type, item) == addr
+              && item.hdr.GetQosTid () == tid)
             {
-              if (GetAddressForPacket (type, it) == dest
-                  && it->hdr.GetQosTid () == tid)
-                {
-                  packet = it->packet;
-                  *hdr = it->hdr;
-                  m_queue.erase (it);
-                  m_size--;
-                  break;
-                }
+              return pos;
             }
         }
+      return m_tail;
+    }
+  TidAndAddressIndex::iterator it = m_index.find (std::make_pair (addr, tid));
+  if (it == m_index.end ())
+    {
+      return m_tail;
+    }
+  std::deque<std::pair<int64_t, uint64_t> > &positions = it->second.positions;
+  while (!positions.empty ())
+    {
+      const Slot &slot = At (positions.front ().first);
+      if (slot.live && slot.id == positions.front ().second)
+        {
+          return positions.front ().first;
+        }
+      positions.pop_front ();
+    }
+  NS_ASSERT_MSG (false, "The index has no positions for " << it->second.n << " packets");
+  return m_tail;
+}
+
+Ptr<const Packet>
+WifiMacQueue::DequeueByTidAndAddress (WifiMacHeader *hdr, uint8_t tid,
+                                      WifiMacHeader::AddressType type, Mac48Address dest)
+{
+  Cleanup ();
+  int64_t pos = FindByTidAndAddress (tid, type, dest);
+  if (pos == m_tail)
+    {
+      return 0;
     }
+  Ptr<const Packet> packet = At (pos).item.packet;
+  *hdr = At (pos).item.hdr;
+  Erase (pos);
   return packet;
 }
 
@@ -221,31 +405,23 @@ WifiMacQueue::PeekByTidAndAddress (WifiMacHeader *hdr, uint8_t tid,
                                    WifiMacHeader::AddressType type, Mac48Address dest, Time *timestamp)
 {
   Cleanup ();
-  if (!m_queue.empty ())
+  int64_t pos = FindByTidAndAddress (tid, type, dest);
+  if (pos == m_tail)
     {
-      PacketQueueI it;
-      for (it = m_queue.begin (); it != m_queue.end (); ++it)
-        {
-          if (it->hdr.IsQosData ())
-            {
-              if (GetAddressForPacket (type, it) == dest
-                  && it->hdr.GetQosTid () == tid)
-                {
-                  *hdr = it->hdr;
-                  *timestamp = it->tstamp;
-                  return it->packet;
-                }
-            }
-        }
+      return 0;
     }
-  return 0;
+  m_peeked = pos;
+  m_peekedId = At (pos).id;
+  *hdr = At (pos).item.hdr;
+  *timestamp = At (pos).item.tstamp;
+  return At (pos).item.packet;
 }
 
 bool
 WifiMacQueue::IsEmpty (void)
 {
   Cleanup ();
-  return m_queue.empty ();
+  return m_size == 0;
 }
 
 uint32_t
@@ -258,24 +434,26 @@ WifiMacQueue::GetSize (void)
 void
 WifiMacQueue::Flush (void)
 {
-  m_queue.erase (m_queue.begin (), m_queue.end ());
+  m_slots.clear ();
+  m_index.clear ();
+  m_head = m_frontEnd = m_backBegin = m_tail = 0;
   m_size = 0;
 }
 
 Mac48Address
-WifiMacQueue::GetAddressForPacket (enum WifiMacHeader::AddressType type, PacketQueueI it)
+WifiMacQueue::GetAddressForPacket (enum WifiMacHeader::AddressType type, const Item &item) const
 {
   if (type == WifiMacHeader::ADDR1)
     {
-      return it->hdr.GetAddr1 ();
+      return item.hdr.GetAddr1 ();
     }
   if (type == WifiMacHeader::ADDR2)
     {
-      return it->hdr.GetAddr2 ();
+      return item.hdr.GetAddr2 ();
     }
   if (type == WifiMacHeader::ADDR3)
     {
-      return it->hdr.GetAddr3 ();
+      return item.hdr.GetAddr3 ();
     }
   return 0;
 }
@@ -283,13 +461,19 @@ WifiMacQueue::GetAddressForPacket (enum WifiMacHeader::AddressType type, PacketQ
 bool
 WifiMacQueue::Remove (Ptr<const Packet> packet)
 {
-  PacketQueueI it = m_queue.begin ();
-  for (; it != m_queue.end (); it++)
+  // the MAC removes the packets it aggregates right after peeking them
+  if (m_peeked >= m_head && m_peeked < m_tail
+      && At (m_peeked).live && At (m_peeked).id == m_peekedId
+      && At (m_peeked).item.packet == packet)
     {
-      if (it->packet == packet)
+      Erase (m_peeked);
+      return true;
+    }
+  for (int64_t pos = m_head; pos < m_tail; pos = Next (pos))
+    {
+      if (At (pos).item.packet == packet)
         {
-          m_queue.erase (it);
-          m_size--;
+          Erase (pos);
           return true;
         }
     }
@@ -304,9 +488,7 @@ WifiMacQueue::PushFront (Ptr<const Packet> packet, const WifiMacHeader &hdr)
     {
       return;
     }
-  Time now = Simulator::Now ();
-  m_queue.push_front (Item (packet, hdr, now));
-  m_size++;
+  Insert (packet, hdr, true);
 }
 
 uint32_t
@@ -314,22 +496,22 @@ WifiMacQueue::GetNPacketsByTidAndAddress (uint8_t tid, WifiMacHeader::AddressTyp
                                           Mac48Address addr)
 {
   Cleanup ();
-  uint32_t nPackets = 0;
-  if (!m_queue.empty ())
+  if (type != WifiMacHeader::ADDR1)
     {
-      PacketQueueI it;
-      for (it = m_queue.begin (); it != m_queue.end (); it++)
+      uint32_t nPackets = 0;
+      for (int64_t pos = m_head; pos < m_tail; pos = Next (pos))
         {
-          if (GetAddressForPacket (type, it) == addr)
+          const Item &item = At (pos).item;
+          if (GetAddressForPacket (type, item) == addr
+              && item.hdr.IsQosData () && item.hdr.GetQosTid () == tid)
             {
-              if (it->hdr.IsQosData () && it->hdr.GetQosTid () == tid)
-                {
-                  nPackets++;
-                }
+              nPackets++;
             }
         }
+      return nPackets;
     }
-  return nPackets;
+  TidAndAddressIndex::const_iterator it = m_index.find (std::make_pair (addr, tid));
+  return it == m_index.end () ? 0 : it->second.n;
 }
 
 Ptr<const Packet>
@@ -337,21 +519,20 @@ WifiMacQueue::DequeueFirstAvailable (WifiMacHeader *hdr, Time &timestamp,
                                      const QosBlockedDestinations *blockedPackets)
 {
   Cleanup ();
-  Ptr<const Packet> packet = 0;
-  for (PacketQueueI it = m_queue.begin (); it != m_queue.end (); it++)
+  for (int64_t pos = m_head; pos < m_tail; pos = Next (pos))
     {
-      if (!it->hdr.IsQosData ()
-          || !blockedPackets->IsBlocked (it->hdr.GetAddr1 (), it->hdr.GetQosTid ()))
+      const Item &item = At (pos).item;
+      if (!item.hdr.IsQosData ()
+          || !blockedPackets->IsBlocked (item.hdr.GetAddr1 (), item.hdr.GetQosTid ()))
         {
-          *hdr = it->hdr;
-          timestamp = it->tstamp;
-          packet = it->packet;
-          m_queue.erase (it);
-          m_size--;
+          *hdr = item.hdr;
+          timestamp = item.tstamp;
+          Ptr<const Packet> packet = item.packet;
+          Erase (pos);
           return packet;
         }
     }
-  return packet;
+  return 0;
 }
 
 Ptr<const Packet>
@@ -359,14 +540,15 @@ WifiMacQueue::PeekFirstAvailable (WifiMacHeader *hdr, Time &timestamp,
                                   const QosBlockedDestinations *blockedPackets)
 {
   Cleanup ();
-  for (PacketQueueI it = m_queue.begin (); it != m_queue.end (); it++)
+  for (int64_t pos = m_head; pos < m_tail; pos = Next (pos))
     {
-      if (!it->hdr.IsQosData ()
-          || !blockedPackets->IsBlocked (it->hdr.GetAddr1 (), it->hdr.GetQosTid ()))
+      const Item &item = At (pos).item;
+      if (!item.hdr.IsQosData ()
+          || !blockedPackets->IsBlocked (item.hdr.GetAddr1 (), item.hdr.GetQosTid ()))
         {
-          *hdr = it->hdr;
-          timestamp = it->tstamp;
-          return it->packet;
+          *hdr = item.hdr;
+          timestamp = item.tstamp;
+          return item.packet;
         }
     }
   return 0;
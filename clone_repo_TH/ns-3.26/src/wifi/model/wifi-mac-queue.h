@@ -23,7 +23,9 @@
 #ifndef WIFI_MAC_QUEUE_H
 #define WIFI_MAC_QUEUE_H
 
-#include <list>
+#include <vector>
+#include <deque>
+#include <map>
 #include <utility>
 #include "ns3/packet.h"
 #include "ns3/nstime.h"
@@ -31,6 +33,9 @@
 #include "wifi-mac-header.h"
 #include "ns3/traced-callback.h"
 #include "ns3/thomas-packet-tags.h"
+
+class WifiMacQueueTest;
+
 namespace ns3 {
 class QosBlockedDestinations;
 
@@ -48,6 +53,13 @@ class QosBlockedDestinations;
  * to verify whether or not it should be dropped. If
  * dot11EDCATableMSDULifetime has elapsed, it is dropped.
  * Otherwise, it is returned to the caller.
+ *
+ * The packets are kept in a ring buffer. Packets put at the end are in
+ * the order they arrived and packets put at the front in the reverse
+ * order, so the expired packets are found at the boundary between the
+ * two without looking at the others. The QoS data packets are also
+ * indexed by TID and Address1, which is how the MAC looks them up for
+ * aggregation and block ack.
  */
 class WifiMacQueue : public Object
 {
@@ -157,8 +169,9 @@ public:
                                          Time *timestamp);
   /**
    * If exists, removes <i>packet</i> from queue and returns true. Otherwise it
-   * takes no effects and return false. Deletion of the packet is
-   * performed in linear time (O(n)).
+   * takes no effects and return false. Deletion of the packet last returned
+   * by PeekByTidAndAddress is performed in constant time, of any other
+   * packet in linear time (O(n)).
    *
    * \param packet the packet to be removed
    *
@@ -226,6 +239,8 @@ public:
 
 
 protected:
+  friend class ::WifiMacQueueTest;
+
   /**
    * Clean up the queue by removing packets that exceeded the maximum delay.
    */
@@ -253,28 +268,97 @@ protected:
   };
 
   /**
-   * typedef for packet (struct Item) queue.
+   * A slot of the ring buffer.
    */
-  typedef std::list<struct Item> PacketQueue;
+  struct Slot
+  {
+    Slot ();
+    Item item;   //!< the packet, empty if the slot is not live
+    uint64_t id; //!< unique number of the item, to recognise it in the index
+    bool live;   //!< whether the slot holds a packet of the queue
+  };
+
   /**
-   * typedef for packet (struct Item) queue reverse iterator.
+   * The positions of the QoS data packets with a given TID and Address1,
+   * front to back, and their number. Positions of packets that left the queue
+   * are dropped when they were at either end of the list, and all at once when
+   * there are more than twice as many positions as packets.
    */
-  typedef std::list<struct Item>::reverse_iterator PacketQueueRI;
+  struct TidAndAddressEntries
+  {
+    std::deque<std::pair<int64_t, uint64_t> > positions; //!< position and id of the packets
+    uint32_t n;                                          //!< number of packets in the queue
+  };
+
   /**
-   * typedef for packet (struct Item) queue iterator.
+   * typedef for the index of the QoS data packets by Address1 and TID.
    */
-  typedef std::list<struct Item>::iterator PacketQueueI;
+  typedef std::map<std::pair<Mac48Address, uint8_t>, TidAndAddressEntries> TidAndAddressIndex;
+
   /**
-   * Return the appropriate address for the given packet (given by PacketQueue iterator).
+   * Return the appropriate address for the given packet.
    *
    * \param type
-   * \param it
+   * \param item
    *
    * \return the address
    */
-  Mac48Address GetAddressForPacket (enum WifiMacHeader::AddressType type, PacketQueueI it);
+  Mac48Address GetAddressForPacket (enum WifiMacHeader::AddressType type, const Item &item) const;
+  /**
+   * \param pos the position of a packet
+   * \return the slot at that position
+   */
+  Slot & At (int64_t pos);
+  /**
+   * \param pos a position in the queue
+   * \return the position of the first packet after it, or m_tail
+   */
+  int64_t Next (int64_t pos);
+  /**
+   * \param item the packet
+   * \return true if the packet stayed longer than the maximum delay
+   */
+  bool IsExpired (const Item &item) const;
+  /**
+   * Put the packet at the front or the back of the ring buffer, growing or
+   * compacting it when it is full.
+   *
+   * \param packet the packet
+   * \param hdr the header of the packet
+   * \param front whether to put the packet at the front
+   */
+  void Insert (Ptr<const Packet> packet, const WifiMacHeader &hdr, bool front);
+  /**
+   * Remove the packet at the given position.
+   *
+   * \param pos the position of the packet
+   */
+  void Erase (int64_t pos);
+  /**
+   * Move the ring buffer into one of the given capacity, without the free
+   * slots between the packets, and rebuild the index.
+   *
+   * \param capacity the new capacity, a power of two
+   */
+  void Compact (uint32_t capacity);
+  /**
+   * \param tid the given TID
+   * \param type the given address type
+   * \param addr the given destination
+   *
+   * \return the position of the first QoS packet with the TID and address, or m_tail
+   */
+  int64_t FindByTidAndAddress (uint8_t tid, WifiMacHeader::AddressType type, Mac48Address addr);
 
-  PacketQueue m_queue; //!< Packet (struct Item) queue
+  std::vector<Slot> m_slots; //!< Ring buffer, the packet at position p is in slot p & (size - 1)
+  int64_t m_head;            //!< Position of the first packet
+  int64_t m_frontEnd;        //!< End of the packets put at the front
+  int64_t m_backBegin;       //!< Start of the packets put at the back
+  int64_t m_tail;            //!< Position after the last packet
+  uint64_t m_nextId;         //!< Id of the next packet
+  int64_t m_peeked;          //!< Position of the packet last returned by PeekByTidAndAddress
+  uint64_t m_peekedId;       //!< Id of the packet last returned by PeekByTidAndAddress
+  TidAndAddressIndex m_index; //!< QoS data packets by Address1 and TID
   uint32_t m_size;     //!< Current queue size
   uint32_t m_maxSize;  //!< Queue capacity
   Time m_maxDelay;     //!< Time to live for packets in the queue
@@ -19,11 +19,7 @@
  */
 
 /* And thomas includes ... */
-#include "ns3/ipv4-header.h"
 #include "ns3/ipv4-l3-protocol.h"
-#include "ns3/udp-header.h"
-#include "ns3/q-learner.h"
-#include "ns3/thomas-packet-tags.h"
 /* end */
 
 #include "wifi-net-device.h"
@@ -105,6 +101,7 @@ WifiNetDevice::DoDispose (void)
   m_phy = 0;
   m_stationManager = 0;
   m_queueInterface = 0;
+  m_txAccounting = MakeNullCallback<void, Ptr<const Packet> > ();
   NetDevice::DoDispose ();
 }
 
@@ -328,51 +325,10 @@ WifiNetDevice::Send (Ptr<Packet> packet, const Address& dest, uint16_t protocolN
   /* Thomas adding stuff */
   // Since this is the place where we actually see the packet in the source node without any udp around it,
   // this is the only place were we can properly count it...
-  //Reusing this code from the qlrn-test-base.cc, there it is used to set QLearners, here, we do it to count traffic packets...
-  bool counted = false;
-  Ptr<Packet> p_copy = packet->Copy();
-  Ipv4Header ipHeader;
-  p_copy->RemoveHeader (ipHeader);
-  UdpHeader u;
-  p_copy->PeekHeader(u);
-  PortNrTag pnt;
-  p_copy->PeekPacketTag(pnt);
-
-  for (unsigned int j = 0; j < GetNode()->GetNApplications(); j++) {
-    try {
-      auto qq = dynamic_cast<QLearner*> (   PeekPointer(GetNode()->GetApplication (j) ) );
-      if (qq != 0) {
-        // What was the point of this anyway ?
-        // if ((u.GetDestinationPort() == 9999 || u.GetSourcePort() == 9999) && (ipHeader.GetSource() == GetNode()->GetObject<Ipv4>()->GetAddress(1,0).GetLocal() || GetNode()->GetObject<Ipv4>()->GetAddress(1,0).GetLocal() == ipHeader.GetDestination())) {
-        //   std::cout << ipHeader.GetSource() << "  " << ipHeader.GetDestination() << std::endl;
-        // }
-        if (GetNode()->GetObject<Ipv4>()->GetAddress(1,0).GetLocal() == ipHeader.GetSource()){
-          //And we see that the port is not 654 (AODV) or 404 (QLRN) traffic or 0 (ICMP ? ), we do the counting...
-          // Added conditions for 9998 s.t. udp-echo tests work, otherwise that traffic would be counted twice. Since its only in tests, i guess no problem...
-          if (u.GetDestinationPort() != 654 && u.GetDestinationPort() != 404 && u.GetDestinationPort() != 0 && u.GetDestinationPort() != 9998 && u.GetSourcePort() != 9998) {
-            // std::cout<<std::endl;
-            // p_copy->Print(std::cout) ;std::cout<< std::endl;
-            counted = true;
-            if (qq->GetAODV() && pnt.GetDstPort() == 0) {
-              qq->GetAODV()->PacketTrackingOutput(p_copy);
-            }
-          }
-        }
-      }
-      // If we are the source of the packet
-    } catch (const std::bad_cast &) {
-      // do nothing, keep searching
-    }
-  }
-  if (!counted) {
-    if (GetNode()->GetObject<Ipv4>()->GetAddress(1,0).GetLocal() == ipHeader.GetSource()){
-      if (u.GetDestinationPort() != 654 && u.GetDestinationPort() != 404 && u.GetDestinationPort() != 0 && u.GetDestinationPort() != 9998 && u.GetSourcePort() != 9998) {
-        auto aodvProto = Ipv4RoutingHelper::GetRouting <aodv::RoutingProtocol>(GetNode()->GetObject<Ipv4> ()->GetRoutingProtocol ());
-        if (pnt.GetDstPort() == 0) { aodvProto->PacketTrackingOutput(p_copy); }
-        counted = true;
-      }
+  if (!m_txAccounting.IsNull () && protocolNumber == Ipv4L3Protocol::PROT_NUMBER)
+    {
+      m_txAccounting (packet);
     }
-  }
   /* end of what Thomas added*/
 
   Mac48Address realTo = Mac48Address::ConvertFrom (dest);
@@ -500,6 +456,12 @@ WifiNetDevice::SupportsSendFrom (void) const
   return m_mac->SupportsSendFrom ();
 }
 
+void
+WifiNetDevice::SetTxAccountingCallback (TxAccountingCallback cb)
+{
+  m_txAccounting = cb;
+}
+
 uint8_t
 WifiNetDevice::SelectQueue (Ptr<QueueItem> item) const
 {
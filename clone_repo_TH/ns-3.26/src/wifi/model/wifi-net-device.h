@@ -111,6 +111,16 @@ public:
   virtual void SetPromiscReceiveCallback (PromiscReceiveCallback cb);
   virtual bool SupportsSendFrom (void) const;
 
+  /**
+   * Callback handed every IPv4 packet given to Send, with its IPv4 header still on, before the MAC sees it.
+   */
+  typedef Callback<void, Ptr<const Packet> > TxAccountingCallback;
+  /**
+   * \param cb the callback the routing protocol uses to count the packets this node originates.
+   *
+   * Devices without one (the default) do no accounting at all in Send.
+   */
+  void SetTxAccountingCallback (TxAccountingCallback cb);
 
 protected:
   virtual void DoDispose (void);
@@ -202,6 +212,7 @@ private:
   Ptr<NetDeviceQueueInterface> m_queueInterface;   //!< NetDevice queue interface
   NetDevice::ReceiveCallback m_forwardUp;
   NetDevice::PromiscReceiveCallback m_promiscRx;
+  TxAccountingCallback m_txAccounting;
 
   TracedCallback<Ptr<const Packet>, Mac48Address> m_rxLogger;
   TracedCallback<Ptr<const Packet>, Mac48Address> m_txLogger;
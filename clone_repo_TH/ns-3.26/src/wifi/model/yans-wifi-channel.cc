@@ -25,10 +25,16 @@
 #include "ns3/node.h"
 #include "ns3/log.h"
 #include "ns3/pointer.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
 #include "ns3/object-factory.h"
 #include "yans-wifi-channel.h"
 #include "ns3/propagation-loss-model.h"
 #include "ns3/propagation-delay-model.h"
+#include "ns3/constant-position-mobility-model.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 namespace ns3 {
 
@@ -51,11 +57,40 @@ YansWifiChannel::GetTypeId (void)
                    PointerValue (),
                    MakePointerAccessor (&YansWifiChannel::m_delay),
                    MakePointerChecker<PropagationDelayModel> ())
+    .AddAttribute ("MaxRange", "Receivers further away from the sender than this (m) are skipped, "
+                   "0 delivers every transmission to every PHY.",
+                   DoubleValue (0),
+                   MakeDoubleAccessor (&YansWifiChannel::m_maxRange),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("DeriveMaxRange", "Derive the maximum range from the propagation loss model and the transmit power, "
+                   "gains and thresholds of the PHYs instead of using MaxRange. "
+                   "Only for deterministic loss models that decrease with distance.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&YansWifiChannel::m_deriveMaxRange),
+                   MakeBooleanChecker ())
+    .AddAttribute ("MaxRangeMarginDb", "How far (dB) below the lowest energy detection and CCA mode 1 threshold "
+                   "a derived maximum range still reaches, to keep weak interferers.",
+                   DoubleValue (10),
+                   MakeDoubleAccessor (&YansWifiChannel::m_maxRangeMarginDb),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("CachePropagation", "Compute the received power and delay between two PHYs that stand still once, "
+                   "until one of them changes course. Only for deterministic loss and delay models.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&YansWifiChannel::m_cachePropagation),
+                   MakeBooleanChecker ())
   ;
   return tid;
 }
 
 YansWifiChannel::YansWifiChannel ()
+  : m_maxRange (0),
+    m_deriveMaxRange (false),
+    m_maxRangeMarginDb (10),
+    m_cachePropagation (false),
+    m_tracked (false),
+    m_gridBuilt (false),
+    m_gridDerived (false),
+    m_cellSize (0)
 {
 }
 
@@ -83,20 +118,70 @@ YansWifiChannel::Send (Ptr<YansWifiPhy> sender, Ptr<const Packet> packet, double
 {
   Ptr<MobilityModel> senderMobility = sender->GetMobility ()->GetObject<MobilityModel> ();
   NS_ASSERT (senderMobility != 0);
-  uint32_t j = 0;
-  for (PhyList::const_iterator i = m_phyList.begin (); i != m_phyList.end (); i++, j++)
+  if ((m_maxRange > 0 || m_deriveMaxRange || m_cachePropagation) && !m_tracked)
     {
-      if (sender != (*i))
+      TrackPhys ();
+    }
+  double maxRange = 0;
+  if (m_maxRange > 0 || m_deriveMaxRange)
+    {
+      if (!m_gridBuilt || m_gridDerived != m_deriveMaxRange || (!m_deriveMaxRange && m_cellSize != m_maxRange))
+        {
+          BuildGrid ();
+        }
+      maxRange = m_cellSize;
+      FindReceivers (senderMobility->GetPosition ());
+    }
+  uint32_t senderIndex = 0;
+  bool cacheFromSender = false;
+  if (m_cachePropagation)
+    {
+      if (m_propagation.empty ())
+        {
+          Propagation unknown;
+          unknown.txPowerDbm = std::numeric_limits<double>::quiet_NaN ();
+          m_propagation.assign (m_phyList.size () * m_phyList.size (), unknown);
+        }
+      senderIndex = m_indexOf.find (PeekPointer (sender))->second;
+      cacheFromSender = !m_phyMoving[senderIndex];
+    }
+  //without a maximum range every PHY is a receiver, else only the ones FindReceivers found
+  uint32_t nReceivers = maxRange > 0 ? m_receivers.size () : m_phyList.size ();
+  for (uint32_t k = 0; k < nReceivers; k++)
+    {
+      uint32_t j = maxRange > 0 ? m_receivers[k] : k;
+      if (sender != m_phyList[j])
         {
           //For now don't account for inter channel interference
-          if ((*i)->GetChannelNumber () != sender->GetChannelNumber ())
+          if (m_phyList[j]->GetChannelNumber () != sender->GetChannelNumber ())
             {
               continue;
             }
 
-          Ptr<MobilityModel> receiverMobility = (*i)->GetMobility ()->GetObject<MobilityModel> ();
-          Time delay = m_delay->GetDelay (senderMobility, receiverMobility);
-          double rxPowerDbm = m_loss->CalcRxPower (txPowerDbm, senderMobility, receiverMobility);
+          Ptr<MobilityModel> receiverMobility = m_phyList[j]->GetMobility ()->GetObject<MobilityModel> ();
+          if (maxRange > 0 && senderMobility->GetDistanceFrom (receiverMobility) > maxRange)
+            {
+              continue;
+            }
+          Time delay;
+          double rxPowerDbm;
+          if (cacheFromSender && !m_phyMoving[j])
+            {
+              Propagation &propagation = m_propagation[senderIndex * m_phyList.size () + j];
+              if (propagation.txPowerDbm != txPowerDbm)
+                {
+                  propagation.delay = m_delay->GetDelay (senderMobility, receiverMobility);
+                  propagation.rxPowerDbm = m_loss->CalcRxPower (txPowerDbm, senderMobility, receiverMobility);
+                  propagation.txPowerDbm = txPowerDbm;
+                }
+              delay = propagation.delay;
+              rxPowerDbm = propagation.rxPowerDbm;
+            }
+          else
+            {
+              delay = m_delay->GetDelay (senderMobility, receiverMobility);
+              rxPowerDbm = m_loss->CalcRxPower (txPowerDbm, senderMobility, receiverMobility);
+            }
           NS_LOG_DEBUG ("propagation: txPower=" << txPowerDbm << "dbm, rxPower=" << rxPowerDbm << "dbm, " <<
                         "distance=" << senderMobility->GetDistanceFrom (receiverMobility) << "m, delay=" << delay);
           Ptr<Packet> copy = packet->Copy ();
@@ -125,6 +210,203 @@ YansWifiChannel::Send (Ptr<YansWifiPhy> sender, Ptr<const Packet> packet, double
     }
 }
 
+double
+YansWifiChannel::DeriveMaxRange (void) const
+{
+  NS_ASSERT (m_loss != 0);
+  //the strongest signal any of the PHYs sends and the weakest one any of them still notices
+  double txPowerDbm = -std::numeric_limits<double>::infinity ();
+  double thresholdDbm = std::numeric_limits<double>::infinity ();
+  for (PhyList::const_iterator i = m_phyList.begin (); i != m_phyList.end (); i++)
+    {
+      txPowerDbm = std::max (txPowerDbm, std::max ((*i)->GetTxPowerStart (), (*i)->GetTxPowerEnd ()) + (*i)->GetTxGain ());
+      thresholdDbm = std::min (thresholdDbm, std::min ((*i)->GetEdThreshold (), (*i)->GetCcaMode1Threshold ()) - (*i)->GetRxGain ());
+    }
+  thresholdDbm -= m_maxRangeMarginDb;
+
+  Ptr<ConstantPositionMobilityModel> a = CreateObject<ConstantPositionMobilityModel> ();
+  Ptr<ConstantPositionMobilityModel> b = CreateObject<ConstantPositionMobilityModel> ();
+  a->SetPosition (Vector (0, 0, 0));
+  //double the distance until the signal is too weak, then halve the interval down to a metre
+  double inRange = 0;
+  double outOfRange = 1;
+  b->SetPosition (Vector (outOfRange, 0, 0));
+  while (m_loss->CalcRxPower (txPowerDbm, a, b) >= thresholdDbm)
+    {
+      inRange = outOfRange;
+      outOfRange *= 2;
+      if (outOfRange > 1e7)
+        {
+          NS_FATAL_ERROR ("The propagation loss model keeps a " << txPowerDbm << " dBm signal above " << thresholdDbm <<
+                          " dBm at " << inRange << " m, no maximum range can be derived from it.");
+        }
+      b->SetPosition (Vector (outOfRange, 0, 0));
+    }
+  while (outOfRange - inRange > 1)
+    {
+      double middle = (inRange + outOfRange) / 2;
+      b->SetPosition (Vector (middle, 0, 0));
+      if (m_loss->CalcRxPower (txPowerDbm, a, b) >= thresholdDbm)
+        {
+          inRange = middle;
+        }
+      else
+        {
+          outOfRange = middle;
+        }
+    }
+  NS_LOG_DEBUG ("derived maximum range " << outOfRange << "m for txPower=" << txPowerDbm << "dbm, threshold=" << thresholdDbm << "dbm");
+  return outOfRange;
+}
+
+void
+YansWifiChannel::TrackPhys (void) const
+{
+  m_phyMoving.assign (m_phyList.size (), false);
+  for (std::map<const MobilityModel *, std::vector<uint32_t> >::iterator i = m_physOf.begin (); i != m_physOf.end (); i++)
+    {
+      i->second.clear ();
+    }
+  for (uint32_t j = 0; j < m_phyList.size (); j++)
+    {
+      Ptr<MobilityModel> mobility = m_phyList[j]->GetMobility ();
+      NS_ASSERT_MSG (mobility != 0, "A PHY on a YansWifiChannel with a maximum range or a propagation cache needs a mobility model");
+      std::map<const MobilityModel *, std::vector<uint32_t> >::iterator physOf = m_physOf.find (PeekPointer (mobility));
+      if (physOf == m_physOf.end ())
+        {
+          mobility->TraceConnectWithoutContext ("CourseChange", MakeCallback (&YansWifiChannel::CourseChanged, this));
+          physOf = m_physOf.insert (std::make_pair (PeekPointer (mobility), std::vector<uint32_t> ())).first;
+        }
+      physOf->second.push_back (j);
+      m_phyMoving[j] = IsMoving (j);
+    }
+  m_tracked = true;
+  m_gridBuilt = false;
+  m_propagation.clear ();
+}
+
+bool
+YansWifiChannel::IsMoving (uint32_t i) const
+{
+  //its position changes without CourseChange notifications
+  Vector velocity = m_phyList[i]->GetMobility ()->GetVelocity ();
+  return velocity.x != 0 || velocity.y != 0 || velocity.z != 0;
+}
+
+void
+YansWifiChannel::BuildGrid (void) const
+{
+  m_cellSize = m_deriveMaxRange ? DeriveMaxRange () : m_maxRange;
+  m_gridDerived = m_deriveMaxRange;
+  NS_ASSERT (m_cellSize > 0);
+  m_grid.clear ();
+  m_moving.clear ();
+  m_cellOfPhy.assign (m_phyList.size (), 0);
+  for (uint32_t j = 0; j < m_phyList.size (); j++)
+    {
+      Place (j);
+    }
+  m_gridBuilt = true;
+  NS_LOG_DEBUG ("grid of " << m_grid.size () << " cells of " << m_cellSize << "m, " << m_moving.size () << " moving PHYs");
+}
+
+uint64_t
+YansWifiChannel::CellOf (const Vector &position) const
+{
+  int32_t column = std::floor (position.x / m_cellSize);
+  int32_t row = std::floor (position.y / m_cellSize);
+  return (uint64_t (uint32_t (column)) << 32) | uint32_t (row);
+}
+
+void
+YansWifiChannel::Place (uint32_t i) const
+{
+  if (m_phyMoving[i])
+    {
+      m_moving.push_back (i);
+    }
+  else
+    {
+      m_cellOfPhy[i] = CellOf (m_phyList[i]->GetMobility ()->GetPosition ());
+      m_grid[m_cellOfPhy[i]].push_back (i);
+    }
+}
+
+void
+YansWifiChannel::Unplace (uint32_t i) const
+{
+  std::vector<uint32_t> &phys = m_phyMoving[i] ? m_moving : m_grid[m_cellOfPhy[i]];
+  phys.erase (std::find (phys.begin (), phys.end (), i));
+  if (!m_phyMoving[i] && phys.empty ())
+    {
+      m_grid.erase (m_cellOfPhy[i]);
+    }
+}
+
+void
+YansWifiChannel::CourseChanged (Ptr<const MobilityModel> mobility) const
+{
+  if (!m_tracked)
+    {
+      return;
+    }
+  std::map<const MobilityModel *, std::vector<uint32_t> >::const_iterator physOf = m_physOf.find (PeekPointer (mobility));
+  if (physOf == m_physOf.end ())
+    {
+      return;
+    }
+  for (std::vector<uint32_t>::const_iterator i = physOf->second.begin (); i != physOf->second.end (); i++)
+    {
+      if (m_gridBuilt)
+        {
+          Unplace (*i);
+        }
+      m_phyMoving[*i] = IsMoving (*i);
+      if (m_gridBuilt)
+        {
+          Place (*i);
+        }
+      if (!m_propagation.empty ())
+        {
+          ForgetPropagation (*i);
+        }
+    }
+}
+
+void
+YansWifiChannel::FindReceivers (const Vector &senderPosition) const
+{
+  m_receivers.clear ();
+  //a cell is as large as the range, so everything in range is in the cell of the sender or one next to it
+  int32_t column = std::floor (senderPosition.x / m_cellSize);
+  int32_t row = std::floor (senderPosition.y / m_cellSize);
+  for (int32_t c = column - 1; c <= column + 1; c++)
+    {
+      for (int32_t r = row - 1; r <= row + 1; r++)
+        {
+          Grid::const_iterator cell = m_grid.find ((uint64_t (uint32_t (c)) << 32) | uint32_t (r));
+          if (cell != m_grid.end ())
+            {
+              m_receivers.insert (m_receivers.end (), cell->second.begin (), cell->second.end ());
+            }
+        }
+    }
+  m_receivers.insert (m_receivers.end (), m_moving.begin (), m_moving.end ());
+  //the same order as without a maximum range, which keeps the order of the Receive events
+  std::sort (m_receivers.begin (), m_receivers.end ());
+}
+
+void
+YansWifiChannel::ForgetPropagation (uint32_t i) const
+{
+  uint32_t n = m_phyList.size ();
+  for (uint32_t k = 0; k < n; k++)
+    {
+      m_propagation[i * n + k].txPowerDbm = std::numeric_limits<double>::quiet_NaN ();
+      m_propagation[k * n + i].txPowerDbm = std::numeric_limits<double>::quiet_NaN ();
+    }
+}
+
 void
 YansWifiChannel::Receive (uint32_t i, Ptr<Packet> packet, struct Parameters parameters) const
 {
@@ -146,7 +428,11 @@ YansWifiChannel::GetDevice (uint32_t i) const
 void
 YansWifiChannel::Add (Ptr<YansWifiPhy> phy)
 {
+  m_indexOf[PeekPointer (phy)] = m_phyList.size ();
   m_phyList.push_back (phy);
+  //its mobility model may not be known yet, the next Send tracks it
+  m_tracked = false;
+  m_gridBuilt = false;
 }
 
 int64_t
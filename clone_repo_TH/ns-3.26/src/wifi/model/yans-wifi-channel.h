@@ -22,6 +22,8 @@
 #define YANS_WIFI_CHANNEL_H
 
 #include <vector>
+#include <map>
+#include <unordered_map>
 #include <stdint.h>
 #include "ns3/packet.h"
 #include "wifi-channel.h"
@@ -30,10 +32,12 @@
 #include "wifi-tx-vector.h"
 #include "yans-wifi-phy.h"
 #include "ns3/nstime.h"
+#include "ns3/vector.h"
 
 namespace ns3 {
 
 class NetDevice;
+class MobilityModel;
 class PropagationLossModel;
 class PropagationDelayModel;
 
@@ -57,6 +61,21 @@ struct Parameters
  * class and contains a ns3::PropagationLossModel and a ns3::PropagationDelayModel.
  * By default, no propagation models are set so, it is the caller's responsability
  * to set them before using the channel.
+ *
+ * Every transmission is delivered to every other PHY on the same channel
+ * number unless a maximum range is set, either with the MaxRange attribute or
+ * derived from the loss model with DeriveMaxRange. Receivers further away
+ * than that range are then skipped: they get no Receive event and the packet
+ * does not count as interference for them either. The PHYs are kept in a
+ * uniform grid with cells as large as the range, so a transmission only
+ * looks at the PHYs in the 3x3 cells around the sender. The grid follows the
+ * CourseChange notifications of the mobility models; PHYs that are moving
+ * (non-zero velocity) are checked on every transmission instead.
+ *
+ * With CachePropagation, the received power and delay between two PHYs that
+ * stand still are computed once and read from a matrix afterwards, until one
+ * of them changes course. This only gives the same results for deterministic
+ * loss and delay models.
  */
 class YansWifiChannel : public WifiChannel
 {
@@ -135,8 +154,102 @@ private:
   void Receive (uint32_t i, Ptr<Packet> packet, struct Parameters parameters) const;
 
   PhyList m_phyList;                   //!< List of YansWifiPhys connected to this YansWifiChannel
+  std::unordered_map<const YansWifiPhy *, uint32_t> m_indexOf;  //!< The index of every PHY in the PHY list
   Ptr<PropagationLossModel> m_loss;    //!< Propagation loss model
   Ptr<PropagationDelayModel> m_delay;  //!< Propagation delay model
+
+  /**
+   * The propagation between a sender and a receiver, computed for txPowerDbm
+   * (NaN if it has to be computed again).
+   */
+  struct Propagation
+  {
+    double txPowerDbm;   //!< The transmit power the received power is for
+    double rxPowerDbm;   //!< The received power
+    Time delay;          //!< The propagation delay
+  };
+
+  /**
+   * The grid cells, a cell is keyed by its column in the upper and its row
+   * in the lower 32 bits, and holds the indices of its PHYs.
+   */
+  typedef std::unordered_map<uint64_t, std::vector<uint32_t> > Grid;
+
+  /**
+   * Finds the distance at which the strongest transmitter of the PHY list
+   * falls below the lowest energy detection threshold minus the margin.
+   *
+   * \return the derived maximum range in m
+   */
+  double DeriveMaxRange (void) const;
+  /**
+   * Connects to the CourseChange trace of the mobility models of the PHYs
+   * not seen before, and starts the grid and the propagation cache over.
+   */
+  void TrackPhys (void) const;
+  /**
+   * \param i index of the PHY in the PHY list
+   * \return whether the mobility model of the PHY has a non-zero velocity
+   */
+  bool IsMoving (uint32_t i) const;
+  /**
+   * (Re)builds the grid from the current positions of the PHYs.
+   */
+  void BuildGrid (void) const;
+  /**
+   * \param position a position
+   * \return the key of the grid cell the position falls in
+   */
+  uint64_t CellOf (const Vector &position) const;
+  /**
+   * Puts the i-th PHY in the cell of its current position, or in the list of
+   * moving PHYs if it is moving.
+   *
+   * \param i index of the PHY in the PHY list
+   */
+  void Place (uint32_t i) const;
+  /**
+   * Takes the i-th PHY out of its grid cell or the list of moving PHYs.
+   *
+   * \param i index of the PHY in the PHY list
+   */
+  void Unplace (uint32_t i) const;
+  /**
+   * Connected to the CourseChange trace of the mobility models of the PHYs.
+   *
+   * \param mobility the mobility model that changed course
+   */
+  void CourseChanged (Ptr<const MobilityModel> mobility) const;
+  /**
+   * Fills m_receivers with the indices of the PHYs in the 3x3 cells around
+   * the sender and the moving PHYs, in increasing order.
+   *
+   * \param senderPosition the position of the sender
+   */
+  void FindReceivers (const Vector &senderPosition) const;
+  /**
+   * Forgets the cached propagation from and to the i-th PHY.
+   *
+   * \param i index of the PHY in the PHY list
+   */
+  void ForgetPropagation (uint32_t i) const;
+
+  double m_maxRange;                   //!< Receivers further away than this (m) are skipped, 0 = no cutoff
+  bool m_deriveMaxRange;               //!< Derive m_maxRange from the loss model and the PHY thresholds
+  double m_maxRangeMarginDb;           //!< How far below the energy detection threshold a derived range still reaches (dB)
+  bool m_cachePropagation;             //!< Cache the propagation between PHYs that stand still
+
+  mutable bool m_tracked;              //!< Whether the CourseChange traces of all PHYs are connected
+  mutable bool m_gridBuilt;            //!< Whether the grid holds all PHYs of the PHY list
+  mutable bool m_gridDerived;          //!< Whether the grid was built for a derived range
+  mutable double m_cellSize;           //!< Size of the grid cells (m), the maximum range in use
+  mutable Grid m_grid;                 //!< The PHYs that stand still, per cell
+  mutable std::vector<uint64_t> m_cellOfPhy;  //!< The cell of every PHY in the grid
+  mutable std::vector<bool> m_phyMoving;      //!< Whether a PHY is moving, and so in m_moving rather than in the grid
+  mutable std::vector<uint32_t> m_moving;     //!< The PHYs that are moving
+  mutable std::map<const MobilityModel *, std::vector<uint32_t> > m_physOf;  //!< The PHYs of every connected mobility model
+  mutable std::vector<uint32_t> m_receivers;  //!< The candidate receivers of the transmission being sent
+  mutable std::vector<Propagation> m_propagation;  //!< The cached propagation, sender-major, empty when not caching
 };
 
 } //namespace ns3
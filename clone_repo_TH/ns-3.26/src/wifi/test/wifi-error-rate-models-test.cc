@@ -23,6 +23,7 @@
 #include "ns3/dsss-error-rate-model.h"
 #include "ns3/yans-error-rate-model.h"
 #include "ns3/nist-error-rate-model.h"
+#include "ns3/double.h"
 
 using namespace ns3;
 
@@ -279,6 +280,69 @@ WifiErrorRateModelsTestCaseNist::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ_TOL (ps, 0.999, 0.001, "Not equal within tolerance");
 }
 
+class WifiErrorRateModelsTestCaseTable : public TestCase
+{
+public:
+  WifiErrorRateModelsTestCaseTable ();
+  virtual ~WifiErrorRateModelsTestCaseTable ();
+
+private:
+  virtual void DoRun (void);
+  void CheckTable (Ptr<ErrorRateModel> model, double tolerance);
+};
+
+WifiErrorRateModelsTestCaseTable::WifiErrorRateModelsTestCaseTable ()
+  : TestCase ("WifiErrorRateModel test case SNR tables")
+{
+}
+
+WifiErrorRateModelsTestCaseTable::~WifiErrorRateModelsTestCaseTable ()
+{
+}
+
+void
+WifiErrorRateModelsTestCaseTable::CheckTable (Ptr<ErrorRateModel> model, double tolerance)
+{
+  WifiTxVector txVector;
+  const char *modes[] = {"OfdmRate6Mbps", "OfdmRate9Mbps", "OfdmRate12Mbps", "OfdmRate18Mbps",
+                         "OfdmRate24Mbps", "OfdmRate36Mbps", "OfdmRate48Mbps", "OfdmRate54Mbps"};
+  uint32_t nbits[] = {1, 100, 16000};
+  for (uint32_t m = 0; m < 8; m++)
+    {
+      WifiMode mode (modes[m]);
+      std::vector<double> snrs;
+      std::vector<uint32_t> bits;
+      for (double snr = -25; snr < 55; snr += 0.37)
+        {
+          for (uint32_t b = 0; b < 3; b++)
+            {
+              snrs.push_back (std::pow (10.0, snr / 10.0));
+              bits.push_back (nbits[b]);
+            }
+        }
+      std::vector<double> rates (snrs.size ());
+      model->SetAttribute ("TableResolution", DoubleValue (0.05));
+      model->CalculateChunkSuccessRates (mode, txVector, &snrs[0], &bits[0], &rates[0], snrs.size ());
+      for (uint32_t i = 0; i < snrs.size (); i++)
+        {
+          double exact = model->GetChunkSuccessRate (mode, txVector, snrs[i], bits[i]);
+          NS_TEST_ASSERT_MSG_EQ_TOL (rates[i], exact, tolerance, "the table is too far off for " << mode << " at snr " << snrs[i] << " and " << bits[i] << " bits");
+          NS_TEST_ASSERT_MSG_EQ (model->CalculateChunkSuccessRate (mode, txVector, snrs[i], bits[i]), rates[i], "a batch of chunks differs from single chunks");
+        }
+      //without a table the model is evaluated for every chunk
+      model->SetAttribute ("TableResolution", DoubleValue (0));
+      NS_TEST_ASSERT_MSG_EQ (model->CalculateChunkSuccessRate (mode, txVector, snrs[100], bits[100]),
+                             model->GetChunkSuccessRate (mode, txVector, snrs[100], bits[100]), "a chunk without a table is not exact");
+    }
+}
+
+void
+WifiErrorRateModelsTestCaseTable::DoRun (void)
+{
+  CheckTable (CreateObject<YansErrorRateModel> (), 0.01);
+  CheckTable (CreateObject<NistErrorRateModel> (), 0.01);
+}
+
 class WifiErrorRateModelsTestSuite : public TestSuite
 {
 public:
@@ -290,6 +354,7 @@ WifiErrorRateModelsTestSuite::WifiErrorRateModelsTestSuite ()
 {
   AddTestCase (new WifiErrorRateModelsTestCaseDsss, TestCase::QUICK);
   AddTestCase (new WifiErrorRateModelsTestCaseNist, TestCase::QUICK);
+  AddTestCase (new WifiErrorRateModelsTestCaseTable, TestCase::QUICK);
 }
 
 static WifiErrorRateModelsTestSuite wifiErrorRateModelsTestSuite;
@@ -34,11 +34,16 @@
 #include "ns3/rng-seed-manager.h"
 #include "ns3/config.h"
 #include "ns3/boolean.h"
+#include "ns3/double.h"
 #include "ns3/string.h"
 #include "ns3/packet-socket-address.h"
 #include "ns3/packet-socket-server.h"
 #include "ns3/packet-socket-client.h"
 #include "ns3/packet-socket-helper.h"
+#include "ns3/wifi-mac-queue.h"
+#include "ns3/interference-helper.h"
+#include "ns3/nist-error-rate-model.h"
+#include "ns3/wifi-phy.h"
 
 using namespace ns3;
 
@@ -1090,6 +1095,543 @@ Bug2222TestCase::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ (m_countInternalCollisions, 1, "unexpected number of internal collisions!");
 }
 
+//-----------------------------------------------------------------------------
+/**
+ * Make sure that a YansWifiChannel with a maximum range only delivers to the
+ * PHYs within that range, also after a PHY has moved into it, and that a
+ * range can be derived from the default loss model.
+ */
+
+class YansWifiChannelMaxRangeTest : public TestCase
+{
+public:
+  YansWifiChannelMaxRangeTest ();
+
+  virtual void DoRun (void);
+
+
+private:
+  void RunOne (Ptr<YansWifiChannel> channel, Vector farPosition, Vector movedPosition);
+  void SendOnePacket (Ptr<WifiNetDevice> dev);
+  void RxBegin (std::string context, Ptr<const Packet> p);
+
+  std::map<std::string, uint32_t> m_received;
+};
+
+YansWifiChannelMaxRangeTest::YansWifiChannelMaxRangeTest ()
+  : TestCase ("Test case for the maximum range of YansWifiChannel")
+{
+}
+
+void
+YansWifiChannelMaxRangeTest::SendOnePacket (Ptr<WifiNetDevice> dev)
+{
+  Ptr<Packet> p = Create<Packet> ();
+  dev->Send (p, dev->GetBroadcast (), 1);
+}
+
+void
+YansWifiChannelMaxRangeTest::RxBegin (std::string context, Ptr<const Packet> p)
+{
+  m_received[context]++;
+}
+
+void
+YansWifiChannelMaxRangeTest::RunOne (Ptr<YansWifiChannel> channel, Vector farPosition, Vector movedPosition)
+{
+  m_received.clear ();
+  NodeContainer nodes;
+  nodes.Create (3);
+
+  YansWifiPhyHelper phy = YansWifiPhyHelper::Default ();
+  phy.SetChannel (channel);
+  WifiHelper wifi;
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager", "DataMode", StringValue ("OfdmRate6Mbps"));
+  WifiMacHelper mac;
+  mac.SetType ("ns3::AdhocWifiMac");
+  NetDeviceContainer devices = wifi.Install (phy, mac, nodes);
+
+  MobilityHelper mobility;
+  Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+  positionAlloc->Add (Vector (0.0, 0.0, 0.0));
+  positionAlloc->Add (Vector (50.0, 0.0, 0.0));
+  positionAlloc->Add (farPosition);
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (nodes);
+
+  for (uint32_t i = 1; i < 3; i++)
+    {
+      Ptr<WifiNetDevice> dev = DynamicCast<WifiNetDevice> (devices.Get (i));
+      std::ostringstream context;
+      context << i;
+      dev->GetPhy ()->TraceConnect ("PhyRxBegin", context.str (), MakeCallback (&YansWifiChannelMaxRangeTest::RxBegin, this));
+    }
+
+  Ptr<WifiNetDevice> sender = DynamicCast<WifiNetDevice> (devices.Get (0));
+  Simulator::Schedule (Seconds (1.0), &YansWifiChannelMaxRangeTest::SendOnePacket, this, sender);
+  Simulator::Schedule (Seconds (2.0), &MobilityModel::SetPosition, nodes.Get (2)->GetObject<MobilityModel> (), movedPosition);
+  Simulator::Schedule (Seconds (3.0), &YansWifiChannelMaxRangeTest::SendOnePacket, this, sender);
+
+  Simulator::Stop (Seconds (4.0));
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+YansWifiChannelMaxRangeTest::DoRun (void)
+{
+  //a fixed rss reaches everywhere, the maximum range decides who receives
+  YansWifiChannelHelper fixed;
+  fixed.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+  fixed.AddPropagationLoss ("ns3::FixedRssLossModel", "Rss", DoubleValue (-50));
+  Ptr<YansWifiChannel> channel = fixed.Create ();
+  channel->SetAttribute ("MaxRange", DoubleValue (100));
+  RunOne (channel, Vector (500.0, 0.0, 0.0), Vector (80.0, 0.0, 0.0));
+  NS_TEST_ASSERT_MSG_EQ (m_received["1"], 2, "the PHY in range did not receive both packets");
+  NS_TEST_ASSERT_MSG_EQ (m_received["2"], 1, "the PHY out of range received the first packet or the moved PHY missed the second");
+
+  //moving the PHY out of range
+  channel = fixed.Create ();
+  channel->SetAttribute ("MaxRange", DoubleValue (100));
+  RunOne (channel, Vector (0.0, 60.0, 0.0), Vector (-300.0, 60.0, 0.0));
+  NS_TEST_ASSERT_MSG_EQ (m_received["2"], 1, "the PHY moved out of range still received the second packet");
+
+  //the default log distance loss leaves a range of a few hundred metres
+  channel = YansWifiChannelHelper::Default ().Create ();
+  channel->SetAttribute ("DeriveMaxRange", BooleanValue (true));
+  RunOne (channel, Vector (5000.0, 0.0, 0.0), Vector (5000.0, 10.0, 0.0));
+  NS_TEST_ASSERT_MSG_EQ (m_received["1"], 2, "the PHY in the derived range did not receive both packets");
+  NS_TEST_ASSERT_MSG_EQ (m_received["2"], 0, "the PHY out of the derived range received a packet");
+}
+
+//-----------------------------------------------------------------------------
+/**
+ * Make sure that the propagation cache of YansWifiChannel gives the same
+ * received power as computing it, also after a receiver has moved.
+ */
+
+class YansWifiChannelPropagationCacheTest : public TestCase
+{
+public:
+  YansWifiChannelPropagationCacheTest ();
+
+  virtual void DoRun (void);
+
+
+private:
+  void RunOne (bool cache);
+  void SendOnePacket (Ptr<WifiNetDevice> dev);
+  void MonitorSnifferRx (Ptr<const Packet> packet, uint16_t channelFreqMhz, uint16_t channelNumber, uint32_t rate,
+                         WifiPreamble preamble, WifiTxVector txVector, struct mpduInfo aMpdu, struct signalNoiseDbm signalNoise);
+
+  std::vector<double> m_signals;
+};
+
+YansWifiChannelPropagationCacheTest::YansWifiChannelPropagationCacheTest ()
+  : TestCase ("Test case for the propagation cache of YansWifiChannel")
+{
+}
+
+void
+YansWifiChannelPropagationCacheTest::SendOnePacket (Ptr<WifiNetDevice> dev)
+{
+  Ptr<Packet> p = Create<Packet> ();
+  dev->Send (p, dev->GetBroadcast (), 1);
+}
+
+void
+YansWifiChannelPropagationCacheTest::MonitorSnifferRx (Ptr<const Packet> packet, uint16_t channelFreqMhz, uint16_t channelNumber, uint32_t rate,
+                                                       WifiPreamble preamble, WifiTxVector txVector, struct mpduInfo aMpdu, struct signalNoiseDbm signalNoise)
+{
+  m_signals.push_back (signalNoise.signal);
+}
+
+void
+YansWifiChannelPropagationCacheTest::RunOne (bool cache)
+{
+  m_signals.clear ();
+  NodeContainer nodes;
+  nodes.Create (2);
+
+  Ptr<YansWifiChannel> channel = YansWifiChannelHelper::Default ().Create ();
+  channel->SetAttribute ("CachePropagation", BooleanValue (cache));
+  YansWifiPhyHelper phy = YansWifiPhyHelper::Default ();
+  phy.SetChannel (channel);
+  WifiHelper wifi;
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager", "DataMode", StringValue ("OfdmRate6Mbps"));
+  WifiMacHelper mac;
+  mac.SetType ("ns3::AdhocWifiMac");
+  NetDeviceContainer devices = wifi.Install (phy, mac, nodes);
+
+  MobilityHelper mobility;
+  Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+  positionAlloc->Add (Vector (0.0, 0.0, 0.0));
+  positionAlloc->Add (Vector (10.0, 0.0, 0.0));
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (nodes);
+
+  DynamicCast<WifiNetDevice> (devices.Get (1))->GetPhy ()->TraceConnectWithoutContext ("MonitorSnifferRx",
+    MakeCallback (&YansWifiChannelPropagationCacheTest::MonitorSnifferRx, this));
+
+  Ptr<WifiNetDevice> sender = DynamicCast<WifiNetDevice> (devices.Get (0));
+  Simulator::Schedule (Seconds (1.0), &YansWifiChannelPropagationCacheTest::SendOnePacket, this, sender);
+  Simulator::Schedule (Seconds (2.0), &YansWifiChannelPropagationCacheTest::SendOnePacket, this, sender);
+  Simulator::Schedule (Seconds (3.0), &MobilityModel::SetPosition, nodes.Get (1)->GetObject<MobilityModel> (), Vector (40.0, 0.0, 0.0));
+  Simulator::Schedule (Seconds (4.0), &YansWifiChannelPropagationCacheTest::SendOnePacket, this, sender);
+
+  Simulator::Stop (Seconds (5.0));
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+YansWifiChannelPropagationCacheTest::DoRun (void)
+{
+  RunOne (false);
+  std::vector<double> computed = m_signals;
+  RunOne (true);
+  NS_TEST_ASSERT_MSG_EQ (m_signals.size (), 3, "not every packet was received");
+  NS_TEST_ASSERT_MSG_EQ (computed.size (), m_signals.size (), "the cache changed the number of received packets");
+  for (uint32_t i = 0; i < m_signals.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ_TOL (m_signals[i], computed[i], 1e-9, "the cached received power differs from the computed one");
+    }
+  NS_TEST_ASSERT_MSG_LT (m_signals[2], m_signals[1] - 10, "the received power did not drop after the receiver moved away");
+}
+
+//-----------------------------------------------------------------------------
+/**
+ * Make sure the interference timeline gives the right energy durations and
+ * reception SNIR and PER when overlapping signals arrive while nothing is
+ * received, so that the changes before them are folded away, and after a
+ * reception has ended.
+ */
+class InterferenceHelperTimelineTest : public TestCase
+{
+public:
+  InterferenceHelperTimelineTest ();
+
+  virtual void DoRun (void);
+
+
+private:
+  void AddSignal (Time duration, double rxPowerW);
+  void CheckEnergyDuration (double energyW, Time expected);
+  void StartReception (void);
+  void CheckReception (void);
+  void EndReception (void);
+
+  InterferenceHelper m_interference;
+  Ptr<NistErrorRateModel> m_errorRateModel;
+  Ptr<InterferenceHelper::Event> m_event;
+  WifiTxVector m_txVector;
+};
+
+InterferenceHelperTimelineTest::InterferenceHelperTimelineTest ()
+  : TestCase ("Test case for the interference timeline of InterferenceHelper")
+{
+}
+
+void
+InterferenceHelperTimelineTest::AddSignal (Time duration, double rxPowerW)
+{
+  m_interference.AddForeignSignal (duration, rxPowerW);
+}
+
+void
+InterferenceHelperTimelineTest::CheckEnergyDuration (double energyW, Time expected)
+{
+  NS_TEST_EXPECT_MSG_EQ (m_interference.GetEnergyDuration (energyW), expected,
+                         "wrong energy duration above " << energyW << "W at " << Simulator::Now ());
+}
+
+void
+InterferenceHelperTimelineTest::StartReception (void)
+{
+  m_event = m_interference.Add (100, m_txVector, WIFI_PREAMBLE_LONG, MicroSeconds (200), 1e-8);
+  m_interference.NotifyRxStart ();
+}
+
+void
+InterferenceHelperTimelineTest::CheckReception (void)
+{
+  //thermal noise at 290K over 20 MHz, with a noise figure of 1
+  double noiseFloorW = 1.3803e-23 * 290.0 * 20 * 1000000;
+  struct InterferenceHelper::SnrPer snrPer = m_interference.CalculatePlcpPayloadSnrPer (m_event);
+  NS_TEST_ASSERT_MSG_EQ_TOL (snrPer.snr, 1e-8 / (noiseFloorW + 3e-9), 1e-9, "the SNIR does not count both signals on the air at the start of the reception");
+
+  //the first signal ends at 100us and the second at 120us, the reception lasts until 260us
+  Time payloadStart = m_event->GetStartTime () + WifiPhy::GetPlcpPreambleDuration (m_txVector, WIFI_PREAMBLE_LONG)
+    + WifiPhy::GetPlcpHeaderDuration (m_txVector, WIFI_PREAMBLE_LONG);
+  NS_TEST_ASSERT_MSG_LT (payloadStart, MicroSeconds (100), "the payload should start before the first signal ends");
+  Time ends[] = {MicroSeconds (100), MicroSeconds (120), MicroSeconds (260)};
+  double interferenceW[] = {3e-9, 2e-9, 0};
+  uint32_t rate = m_txVector.GetMode ().GetPhyRate (m_txVector);
+  double psr = 1.0;
+  Time previous = payloadStart;
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      uint32_t nbits = (uint32_t)(uint64_t)(rate * (ends[i] - previous).GetSeconds ());
+      psr *= m_errorRateModel->CalculateChunkSuccessRate (m_txVector.GetMode (), m_txVector, 1e-8 / (noiseFloorW + interferenceW[i]), nbits);
+      previous = ends[i];
+    }
+  NS_TEST_ASSERT_MSG_EQ_TOL (snrPer.per, 1 - psr, 1e-12, "the PER does not follow the interference over the payload");
+  NS_TEST_ASSERT_MSG_GT (snrPer.per, 0, "the interference should cause errors");
+}
+
+void
+InterferenceHelperTimelineTest::EndReception (void)
+{
+  m_interference.NotifyRxEnd ();
+  m_event = 0;
+}
+
+void
+InterferenceHelperTimelineTest::DoRun (void)
+{
+  m_errorRateModel = CreateObject<NistErrorRateModel> ();
+  m_interference.SetNoiseFigure (1);
+  m_interference.SetErrorRateModel (m_errorRateModel);
+  m_txVector.SetMode (WifiPhy::GetOfdmRate6Mbps ());
+  m_txVector.SetChannelWidth (20);
+  m_txVector.SetNss (1);
+
+  Simulator::Schedule (MicroSeconds (0), &InterferenceHelperTimelineTest::AddSignal, this, MicroSeconds (100), 1e-9);
+  Simulator::Schedule (MicroSeconds (20), &InterferenceHelperTimelineTest::AddSignal, this, MicroSeconds (100), 2e-9);
+  Simulator::Schedule (MicroSeconds (50), &InterferenceHelperTimelineTest::CheckEnergyDuration, this, 2.5e-9, MicroSeconds (50));
+  Simulator::Schedule (MicroSeconds (50), &InterferenceHelperTimelineTest::CheckEnergyDuration, this, 0.5e-9, MicroSeconds (70));
+  Simulator::Schedule (MicroSeconds (60), &InterferenceHelperTimelineTest::StartReception, this);
+  Simulator::Schedule (MicroSeconds (110), &InterferenceHelperTimelineTest::CheckEnergyDuration, this, 1.1e-8, MicroSeconds (10));
+  Simulator::Schedule (MicroSeconds (110), &InterferenceHelperTimelineTest::CheckEnergyDuration, this, 0.5e-8, MicroSeconds (150));
+  Simulator::Schedule (MicroSeconds (260), &InterferenceHelperTimelineTest::CheckReception, this);
+  Simulator::Schedule (MicroSeconds (260), &InterferenceHelperTimelineTest::EndReception, this);
+  Simulator::Schedule (MicroSeconds (300), &InterferenceHelperTimelineTest::CheckEnergyDuration, this, 1e-10, MicroSeconds (0));
+  Simulator::Schedule (MicroSeconds (300), &InterferenceHelperTimelineTest::AddSignal, this, MicroSeconds (50), 1e-9);
+  Simulator::Schedule (MicroSeconds (300), &InterferenceHelperTimelineTest::CheckEnergyDuration, this, 1e-10, MicroSeconds (50));
+  Simulator::Run ();
+  Simulator::Destroy ();
+  m_interference.EraseEvents ();
+  m_errorRateModel = 0;
+}
+
+//-----------------------------------------------------------------------------
+/**
+ * Make sure the ring buffer and the index of WifiMacQueue give the same packets
+ * as a plain list that drops every expired packet, with packets put at both ends,
+ * removed from the middle and expiring while the queue is full.
+ */
+class WifiMacQueueTest : public TestCase
+{
+public:
+  WifiMacQueueTest ();
+
+  virtual void DoRun (void);
+
+
+private:
+  /// a packet in the list the queue is compared to
+  struct Expected
+  {
+    Ptr<const Packet> packet;
+    WifiMacHeader hdr;
+    Time tstamp;
+  };
+
+  void Step (void);
+  void Put (uint32_t i, bool front);
+  void CheckDequeued (Ptr<const Packet> packet, std::list<Expected>::iterator it);
+  std::list<Expected>::iterator FindExpected (uint8_t tid, Mac48Address addr);
+  void Check (void);
+
+  Ptr<WifiMacQueue> m_queue;
+  std::list<Expected> m_expected;
+  Mac48Address m_addrs[3];
+  uint32_t m_step;
+};
+
+WifiMacQueueTest::WifiMacQueueTest ()
+  : TestCase ("Test case for the packets and expiry of WifiMacQueue")
+{
+}
+
+void
+WifiMacQueueTest::Put (uint32_t i, bool front)
+{
+  Expected e;
+  e.packet = Create<Packet> (100 + i);
+  e.hdr.SetType (i % 5 == 0 ? WIFI_MAC_DATA : WIFI_MAC_QOSDATA);
+  e.hdr.SetAddr1 (m_addrs[i % 3]);
+  if (e.hdr.IsQosData ())
+    {
+      e.hdr.SetQosTid (i % 2);
+    }
+  e.tstamp = Simulator::Now ();
+  if (m_expected.size () < m_queue->GetMaxSize ())
+    {
+      if (front)
+        {
+          m_expected.push_front (e);
+        }
+      else
+        {
+          m_expected.push_back (e);
+        }
+    }
+  if (front)
+    {
+      m_queue->PushFront (e.packet, e.hdr);
+    }
+  else
+    {
+      m_queue->Enqueue (e.packet, e.hdr);
+    }
+}
+
+void
+WifiMacQueueTest::CheckDequeued (Ptr<const Packet> packet, std::list<Expected>::iterator it)
+{
+  if (it == m_expected.end ())
+    {
+      NS_TEST_EXPECT_MSG_EQ (packet, 0, "a packet was dequeued from an empty queue");
+      return;
+    }
+  NS_TEST_EXPECT_MSG_EQ (packet, it->packet, "the wrong packet was dequeued at step " << m_step);
+  m_expected.erase (it);
+}
+
+std::list<WifiMacQueueTest::Expected>::iterator
+WifiMacQueueTest::FindExpected (uint8_t tid, Mac48Address addr)
+{
+  for (std::list<Expected>::iterator it = m_expected.begin (); it != m_expected.end (); it++)
+    {
+      if (it->hdr.IsQosData () && it->hdr.GetQosTid () == tid && it->hdr.GetAddr1 () == addr)
+        {
+          return it;
+        }
+    }
+  return m_expected.end ();
+}
+
+void
+WifiMacQueueTest::Step (void)
+{
+  for (std::list<Expected>::iterator it = m_expected.begin (); it != m_expected.end (); )
+    {
+      if (it->tstamp + m_queue->GetMaxDelay () <= Simulator::Now ())
+        {
+          it = m_expected.erase (it);
+        }
+      else
+        {
+          it++;
+        }
+    }
+
+  WifiMacHeader hdr;
+  Time tstamp;
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      Put (m_step + i, false);
+    }
+  if (m_step % 3 != 2)
+    {
+      Put (m_step, true);
+    }
+  if (m_step % 6 == 1)
+    {
+      Ptr<const Packet> packet = m_queue->Dequeue (&hdr);
+      CheckDequeued (packet, m_expected.begin ());
+    }
+  if (m_step % 2 == 0)
+    {
+      Mac48Address addr = m_addrs[m_step % 3];
+      Ptr<const Packet> packet = m_queue->DequeueByTidAndAddress (&hdr, m_step % 4 / 2, WifiMacHeader::ADDR1, addr);
+      CheckDequeued (packet, FindExpected (m_step % 4 / 2, addr));
+    }
+  if (m_step % 5 == 2)
+    {
+      Ptr<const Packet> packet = m_queue->PeekByTidAndAddress (&hdr, 1, WifiMacHeader::ADDR1, m_addrs[1], &tstamp);
+      if (packet != 0)
+        {
+          NS_TEST_EXPECT_MSG_EQ (m_queue->Remove (packet), true, "the peeked packet was not removed");
+          CheckDequeued (packet, FindExpected (1, m_addrs[1]));
+        }
+    }
+  if (m_step % 7 == 3 && m_expected.size () > 2)
+    {
+      std::list<Expected>::iterator it = m_expected.begin ();
+      std::advance (it, m_expected.size () / 2);
+      NS_TEST_EXPECT_MSG_EQ (m_queue->Remove (it->packet), true, "the packet in the middle was not removed");
+      m_expected.erase (it);
+    }
+  Check ();
+
+  if (++m_step < 80)
+    {
+      Simulator::Schedule (MilliSeconds (50), &WifiMacQueueTest::Step, this);
+    }
+}
+
+void
+WifiMacQueueTest::Check (void)
+{
+  WifiMacHeader hdr;
+  Time tstamp;
+  NS_TEST_EXPECT_MSG_EQ (m_queue->GetSize (), m_expected.size (), "wrong number of packets at step " << m_step);
+  Ptr<const Packet> first = m_queue->Peek (&hdr);
+  Ptr<const Packet> expected = m_expected.empty () ? 0 : m_expected.front ().packet;
+  NS_TEST_EXPECT_MSG_EQ (first, expected, "wrong first packet at step " << m_step);
+  for (uint32_t a = 0; a < 3; a++)
+    {
+      for (uint8_t tid = 0; tid < 2; tid++)
+        {
+          uint32_t n = 0;
+          for (std::list<Expected>::iterator it = m_expected.begin (); it != m_expected.end (); it++)
+            {
+              if (it->hdr.IsQosData () && it->hdr.GetQosTid () == tid && it->hdr.GetAddr1 () == m_addrs[a])
+                {
+                  n++;
+                }
+            }
+          NS_TEST_EXPECT_MSG_EQ (m_queue->GetNPacketsByTidAndAddress (tid, WifiMacHeader::ADDR1, m_addrs[a]), n,
+                                 "wrong number of packets for an address at step " << m_step);
+          WifiMacQueue::TidAndAddressIndex::const_iterator entries = m_queue->m_index.find (std::make_pair (m_addrs[a], tid));
+          if (entries != m_queue->m_index.end ())
+            {
+              NS_TEST_EXPECT_MSG_LT_OR_EQ (entries->second.positions.size (), 2 * n,
+                                           "the index keeps the positions of packets that left at step " << m_step);
+            }
+          std::list<Expected>::iterator it = FindExpected (tid, m_addrs[a]);
+          expected = it == m_expected.end () ? 0 : it->packet;
+          Ptr<const Packet> packet = m_queue->PeekByTidAndAddress (&hdr, tid, WifiMacHeader::ADDR1, m_addrs[a], &tstamp);
+          NS_TEST_EXPECT_MSG_EQ (packet, expected, "wrong first packet for an address at step " << m_step);
+        }
+    }
+}
+
+void
+WifiMacQueueTest::DoRun (void)
+{
+  m_queue = CreateObject<WifiMacQueue> ();
+  m_queue->SetMaxSize (24);
+  m_queue->SetMaxDelay (MilliSeconds (500));
+  m_addrs[0] = Mac48Address ("00:00:00:00:00:01");
+  m_addrs[1] = Mac48Address ("00:00:00:00:00:02");
+  m_addrs[2] = Mac48Address ("00:00:00:00:00:03");
+  m_step = 0;
+  m_expected.clear ();
+
+  Simulator::Schedule (Seconds (1.0), &WifiMacQueueTest::Step, this);
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  m_queue->Flush ();
+  NS_TEST_ASSERT_MSG_EQ (m_queue->IsEmpty (), true, "the queue is not empty after a flush");
+  m_queue = 0;
+}
+
 //-----------------------------------------------------------------------------
 
 class WifiTestSuite : public TestSuite
@@ -1108,6 +1650,10 @@ WifiTestSuite::WifiTestSuite ()
   AddTestCase (new Bug730TestCase, TestCase::QUICK); //Bug 730
   AddTestCase (new SetChannelFrequencyTest, TestCase::QUICK);
   AddTestCase (new Bug2222TestCase, TestCase::QUICK); //Bug 2222
+  AddTestCase (new YansWifiChannelMaxRangeTest, TestCase::QUICK);
+  AddTestCase (new YansWifiChannelPropagationCacheTest, TestCase::QUICK);
+  AddTestCase (new InterferenceHelperTimelineTest, TestCase::QUICK);
+  AddTestCase (new WifiMacQueueTest, TestCase::QUICK);
 }
 
 static WifiTestSuite g_wifiTestSuite;
@@ -0,0 +1,366 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Microbenchmark of the QTable and QLearner decision paths, without a wifi simulation around them.
+ *
+ * Builds MultiClassQTables of --destinations x --neighbours and replays a synthetic stream of feedback and routing
+ * decisions on them, or (--replay) the updates of a qtable recording made with --printQTables (<ip>_qtable_web.bin).
+ * Per API it reports the time per call (best of --iterations runs), the heap allocations per call and, where the
+ * kernel lets us read the hardware counters, the cache misses per call.
+ *
+ *   ./waf --run "bench-qlearner --destinations=64 --neighbours=8 --ops=100000"
+ */
+#include "ns3/command-line.h"
+#include "ns3/node.h"
+#include "ns3/qtable.h"
+#include "ns3/qos-q-learner.h"
+#include "ns3/thomas-configuration.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace ns3;
+
+/* every allocation of the process goes through these, so the benchmarks can tell how many a call makes */
+static uint64_t g_nr_allocations = 0;
+
+void* operator new (std::size_t size) {
+  g_nr_allocations++;
+  void* p = std::malloc(size == 0 ? 1 : size);
+  if (p == 0) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete (void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete (void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+/* Cache misses of this thread, from the perf events of the kernel. Not available everywhere (containers,
+ * perf_event_paranoid), in which case the benchmarks print n/a. */
+class CacheMissCounter {
+public:
+  CacheMissCounter() : m_fd(-1) {
+#ifdef __linux__
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    m_fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+  }
+  ~CacheMissCounter() {
+#ifdef __linux__
+    if (m_fd >= 0) {
+      close(m_fd);
+    }
+#endif
+  }
+  bool IsAvailable() const { return m_fd >= 0; }
+  void Start() {
+#ifdef __linux__
+    if (m_fd >= 0) {
+      ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+  uint64_t Stop() {
+    uint64_t count = 0;
+#ifdef __linux__
+    if (m_fd >= 0) {
+      ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(m_fd, &count, sizeof(count)) != sizeof(count)) {
+        count = 0;
+      }
+    }
+#endif
+    return count;
+  }
+private:
+  int m_fd;
+};
+
+/* One call of an API, on operand i of the pre-generated stream */
+typedef std::function<void (uint32_t)> BenchOp;
+/* Gives the op a fresh copy of the tables to work on, outside of the timed part */
+typedef std::function<void ()> BenchSetup;
+
+static uint32_t g_iterations = 5;
+static CacheMissCounter* g_cache_misses = 0;
+
+static void
+RunBench (const char* name, uint32_t n, BenchSetup setup, BenchOp op) {
+  double best_ns = std::numeric_limits<double>::max();
+  uint64_t allocations = 0, misses = 0;
+  for (uint32_t it = 0; it < g_iterations; it++) {
+    setup();
+    uint64_t allocations_before = g_nr_allocations;
+    g_cache_misses->Start();
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < n; i++) {
+      op(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+    uint64_t it_misses = g_cache_misses->Stop();
+    double ns = std::chrono::duration<double, std::nano> (end - start).count();
+    if (ns < best_ns) {
+      best_ns = ns;
+      misses = it_misses;
+    }
+    allocations = g_nr_allocations - allocations_before;
+  }
+  std::cout << std::left << std::setw(48) << name << std::right
+            << std::setw(12) << std::fixed << std::setprecision(1) << best_ns / n << " ns/op"
+            << std::setw(10) << std::setprecision(2) << double(allocations) / n << " allocs/op";
+  if (g_cache_misses->IsAvailable()) {
+    std::cout << std::setw(10) << std::setprecision(2) << double(misses) / n << " misses/op";
+  } else {
+    std::cout << std::setw(10) << "n/a" << " misses/op";
+  }
+  std::cout << std::endl;
+}
+
+static Ipv4Address
+NeighbourIp (uint32_t k) {
+  return Ipv4Address(0x0a020000 + k + 1);
+}
+
+static Ipv4Address
+DestinationIp (uint32_t d) {
+  return Ipv4Address(0x0a030000 + d + 1);
+}
+
+/* One feedback or routing decision of the synthetic stream */
+struct Operand {
+  Ipv4Address dst;
+  Ipv4Address via;
+  Time travel;
+  Time next_estim;
+  uint64_t metric;
+};
+
+static void
+BenchSynthetic (uint32_t nr_destinations, uint32_t nr_neighbours, uint32_t n, uint32_t seed) {
+  Ipv4Address me("10.0.0.1");
+  std::vector<Ipv4Address> neighbours;
+  for (uint32_t k = 0; k < nr_neighbours; k++) {
+    neighbours.push_back(NeighbourIp(k));
+  }
+  MultiClassQTable base(neighbours, me, 0.5, 0.05, 0.5, true, false, 1.0);
+  std::mt19937 rng(seed);
+  for (uint32_t d = 0; d < nr_destinations; d++) {
+    base.AddDestination(neighbours[rng() % nr_neighbours], DestinationIp(d), MilliSeconds(1 + rng() % 50));
+  }
+
+  std::vector<Operand> ops(n);
+  for (auto& o : ops) {
+    o.dst = DestinationIp(rng() % nr_destinations);
+    o.via = neighbours[rng() % nr_neighbours];
+    o.travel = MicroSeconds(100 + rng() % 10000);
+    o.next_estim = MicroSeconds(rng() % 50000);
+    o.metric = MilliSeconds(rng() % 300).GetInteger();
+  }
+
+  std::cout << "Synthetic stream : " << nr_destinations << " destinations x " << nr_neighbours << " neighbours, "
+            << n << " ops" << std::endl;
+
+  MultiClassQTable tables;
+  BenchSetup fresh = [&] () { tables = base; };
+  RunBench ("QTable::Update", n, fresh, [&] (uint32_t i) {
+    tables.GetTable(TRAFFIC_A).Update(ops[i].via, ops[i].dst, Seconds(0), ops[i].travel, ops[i].next_estim);
+  });
+  RunBench ("QTable::GetNextEstim", n, fresh, [&] (uint32_t i) {
+    tables.GetTable(TRAFFIC_A).GetNextEstim(ops[i].dst);
+  });
+  RunBench ("QTable::GetNextEstim after each Update", n, fresh, [&] (uint32_t i) {
+    QTable& table = tables.GetTable(TRAFFIC_A);
+    table.Update(ops[i].via, ops[i].dst, Seconds(0), ops[i].travel, ops[i].next_estim);
+    table.GetNextEstim(ops[i].dst);
+  });
+  RunBench ("MultiClassQTable::GetNextEstims", n, fresh, [&] (uint32_t i) {
+    tables.GetNextEstims(ops[i].dst);
+  });
+  RunBench ("QTable::GetRandomEstim", n, [&] () {
+    fresh();
+    Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable> ();
+    random->SetStream(seed);
+    tables.SetRandomVariable(random);
+  }, [&] (uint32_t i) {
+    tables.GetTable(TRAFFIC_A).GetRandomEstim(ops[i].dst);
+  });
+  RunBench ("QTable::HasConverged", n, fresh, [&] (uint32_t i) {
+    tables.GetTable(TRAFFIC_A).HasConverged(ops[i].dst);
+  });
+  RunBench ("QTable::HasConverged (best estim)", n, fresh, [&] (uint32_t i) {
+    tables.GetTable(TRAFFIC_A).HasConverged(ops[i].dst, true);
+  });
+  RunBench ("MultiClassQTable neighbour down + back up", n, fresh, [&] (uint32_t i) {
+    tables.MarkNeighbDown(ops[i].via);
+    tables.AddNeighbour(ops[i].via);
+  });
+  RunBench ("  ... with a GetNextEstims in between", n, fresh, [&] (uint32_t i) {
+    tables.MarkNeighbDown(ops[i].via);
+    tables.GetNextEstims(ops[i].dst);
+    tables.AddNeighbour(ops[i].via);
+  });
+
+  // QoSQLearner only needs a node (for its id) and its tables to apply metrics
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<QoSQLearner> qosq = CreateObject<QoSQLearner> (0.0, 0.5, 0.0);
+  node->AddApplication(qosq);
+  RunBench ("QoSQLearner::ApplyMetricsToQValue", n, [&] () { qosq->SetQTables(base); }, [&] (uint32_t i) {
+    qosq->ApplyMetricsToQValue(ops[i].dst, ops[i].via, ops[i].travel.GetInteger(), TRAFFIC_A, ops[i].metric, ops[i].metric / 2, 10000 - ops[i].metric % 100);
+  });
+  node->Dispose();
+}
+
+/* One cell of a sample of a qtable recording (see QTableRecorder), or a neighbour that was added or removed */
+struct ReplayOp {
+  char tag;
+  Ipv4Address dst;
+  Ipv4Address via;
+  Time value;
+};
+
+template <typename T>
+static bool
+Get (std::istream& is, T& v) {
+  return bool(is.read(reinterpret_cast<char*> (&v), sizeof(v)));
+}
+
+static bool
+ReadRecording (std::string filename, std::vector<Ipv4Address>& neighbours, std::vector<Ipv4Address>& destinations, std::vector<ReplayOp>& ops) {
+  std::ifstream is(filename.c_str(), std::ios::binary);
+  char magic[4];
+  if (!is.read(magic, 4) || std::strncmp(magic, "QTR1", 4) != 0) {
+    return false;
+  }
+  std::map<uint32_t, Ipv4Address> rows, cols;
+  bool sampled = false;
+  char tag;
+  while (is.get(tag)) {
+    uint32_t id, ip, count;
+    int64_t t;
+    if (tag == 'D') {
+      Get(is, id); Get(is, ip);
+      rows[id] = Ipv4Address(ip);
+      destinations.push_back(Ipv4Address(ip));
+    } else if (tag == 'N') {
+      Get(is, id); Get(is, ip);
+      cols[id] = Ipv4Address(ip);
+      if (sampled) {
+        ops.push_back(ReplayOp {'N', Ipv4Address(), Ipv4Address(ip), Seconds(0)});
+      } else {
+        neighbours.push_back(Ipv4Address(ip));
+      }
+    } else if (tag == 'R') {
+      Get(is, id);
+      ops.push_back(ReplayOp {'R', Ipv4Address(), cols[id], Seconds(0)});
+    } else if (tag == 'S') {
+      Get(is, t); Get(is, count);
+      sampled = true;
+      for (uint32_t c = 0; c < count; c++) {
+        uint16_t row, col;
+        int64_t v;
+        Get(is, row); Get(is, col); Get(is, v);
+        ops.push_back(ReplayOp {'S', rows[row], cols[col], NanoSeconds(v)});
+      }
+    } else if (tag == 'E') {
+      break;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void
+BenchReplay (std::string filename) {
+  std::vector<Ipv4Address> neighbours, destinations;
+  std::vector<ReplayOp> ops;
+  if (!ReadRecording(filename, neighbours, destinations, ops)) {
+    std::cerr << filename << " is not a qtable recording." << std::endl;
+    exit (1);
+  }
+  Ipv4Address me("10.0.0.1");
+  MultiClassQTable base(neighbours, me, 0.5, 0.05, 0.5, true, false, 1.0);
+  for (const auto& dst : destinations) {
+    if (!base.CheckDestinationKnown(dst)) {
+      base.AddDestination(Ipv4Address(IP_WHEN_NO_NEXT_HOP_NEIGHBOUR_KNOWN_YET), dst, Seconds(0));
+    }
+  }
+  std::cout << "Replaying " << filename << " : " << destinations.size() << " destinations x " << neighbours.size()
+            << " neighbours, " << ops.size() << " ops" << std::endl;
+
+  MultiClassQTable tables;
+  RunBench ("SetQValueWrapper + GetNextEstim (replay)", ops.size(), [&] () { tables = base; }, [&] (uint32_t i) {
+    const ReplayOp& o = ops[i];
+    if (o.tag == 'S') {
+      QTable& table = tables.GetTable(WEB);
+      if (table.CheckDestinationKnown(o.dst) && table.IsNeighbourAvailable(o.via)) {
+        table.SetQValueWrapper(o.dst, o.via, o.value);
+        table.GetNextEstim(o.dst);
+      }
+    } else if (o.tag == 'N') {
+      tables.AddNeighbour(o.via);
+    } else {
+      tables.MarkNeighbDown(o.via);
+      tables.RemoveNeighbour(o.via);
+    }
+  });
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t destinations = 64, neighbours = 8, n = 100000, seed = 1;
+  std::string replay = "";
+
+  CommandLine cmd;
+  cmd.AddValue ("destinations", "number of destinations (rows) of the synthetic tables", destinations);
+  cmd.AddValue ("neighbours", "number of neighbours (columns) of the synthetic tables", neighbours);
+  cmd.AddValue ("ops", "number of calls per benchmark", n);
+  cmd.AddValue ("iterations", "number of runs per benchmark, the fastest one is reported", g_iterations);
+  cmd.AddValue ("seed", "seed of the synthetic stream", seed);
+  cmd.AddValue ("replay", "qtable recording (<ip>_qtable_web.bin, see --printQTables) to replay instead", replay);
+  cmd.Parse (argc, argv);
+
+  if (destinations == 0 || neighbours == 0 || n == 0 || g_iterations == 0) {
+    std::cerr << "destinations, neighbours, ops and iterations have to be at least 1." << std::endl;
+    exit (1);
+  }
+
+  CacheMissCounter cache_misses;
+  g_cache_misses = &cache_misses;
+  if (replay != "") {
+    BenchReplay (replay);
+  } else {
+    BenchSynthetic (destinations, neighbours, n, seed);
+  }
+  return 0;
+}